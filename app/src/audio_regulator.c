@@ -7,6 +7,7 @@
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
 
+#include "metrics.h"
 #include "util/log.h"
 
 //#define SC_AUDIO_REGULATOR_DEBUG // uncomment to debug
@@ -283,6 +284,13 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         }
     }
 
+    if (underflow) {
+        sc_metrics_add(SC_METRIC_AUDIO_UNDERFLOW_SAMPLES, underflow);
+    }
+    if (skipped_samples) {
+        sc_metrics_add(SC_METRIC_AUDIO_DROPPED_SAMPLES, skipped_samples);
+    }
+
     atomic_store_explicit(&ar->received, true, memory_order_relaxed);
     if (!played) {
         // Nothing more to do
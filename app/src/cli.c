@@ -116,6 +116,24 @@ enum {
     OPT_DISPLAY_IME_POLICY,
     OPT_TCP_RESTREAM,
     OPT_TCP_CONTROL_FORWARDING,
+    OPT_RTSP_SERVER,
+    OPT_FMP4_SERVER,
+    OPT_TCP_WEBSOCKET,
+    OPT_MJPEG_SERVER,
+    OPT_MJPEG_MAX_FPS,
+    OPT_MJPEG_MAX_SIZE,
+    OPT_MJPEG_WORKERS,
+    OPT_TCP_TIMESHIFT,
+    OPT_METRICS_PORT,
+    OPT_TRACE,
+    OPT_THREAD_POLICY,
+    OPT_TCP_PACING_RATE,
+    OPT_AUDIO_RAW_AGGREGATION,
+    OPT_HEADLESS,
+    OPT_RESUME,
+    OPT_LATENCY_TEST,
+    OPT_LATENCY_TEST_EVENT,
+    OPT_LATENCY_TEST_REGION,
 };
 
 struct sc_option {
@@ -215,6 +233,18 @@ static const struct sc_option options[] = {
                 "codec provided by --audio-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_AUDIO_RAW_AGGREGATION,
+        .longopt = "audio-raw-aggregation",
+        .argdesc = "ms",
+        .text = "With --audio-codec=raw, aggregate the captured samples into "
+                "packets of at least the given duration (in milliseconds), to "
+                "reduce the per-packet overhead at the cost of latency.\n"
+                "The device captures the audio by blocks of 1024 samples "
+                "(~21.3ms), so the actual duration is a multiple of this "
+                "block.\n"
+                "Default is 0 (one packet per block).",
+    },
     {
         .longopt_id = OPT_AUDIO_SOURCE,
         .longopt = "audio-source",
@@ -423,6 +453,16 @@ static const struct sc_option options[] = {
         .longopt = "encoder",
         .argdesc = "name",
     },
+    {
+        .longopt_id = OPT_FMP4_SERVER,
+        .longopt = "fmp4-server",
+        .argdesc = "port",
+        .text = "Serve the video and audio streams as fragmented MP4 over HTTP "
+                "on the specified port (on localhost).\n"
+                "Open http://127.0.0.1:<port>/ in a browser to play the stream "
+                "(via Media Source Extensions), or read "
+                "http://127.0.0.1:<port>/stream.mp4 directly.",
+    },
     {
         .shortopt = 'f',
         .longopt = "fullscreen",
@@ -456,6 +496,19 @@ static const struct sc_option options[] = {
                 "It may only work over USB.\n"
                 "Also see --keyboard and --mouse.",
     },
+    {
+        .longopt_id = OPT_HEADLESS,
+        .longopt = "headless",
+        .text = "Do not use SDL at all: no window, no playback and no input "
+                "on the computer, and the clipboard is not synchronized with "
+                "the computer. The streams are only consumed by the "
+                "recorder, the servers (--tcp-restream, --rtsp-server...) "
+                "and the V4L2 sink, and the device may still be controlled "
+                "by --tcp-control-forwarding.\n"
+                "Implies --no-window --no-audio-playback.\n"
+                "This is always the case in a headless build (meson option "
+                "-Dheadless=true). Not supported on Windows.",
+    },
     {
         .shortopt = 'h',
         .longopt = "help",
@@ -500,6 +553,37 @@ static const struct sc_option options[] = {
         .longopt_id = OPT_HID_KEYBOARD_DEPRECATED,
         .longopt = "hid-keyboard",
     },
+    {
+        .longopt_id = OPT_LATENCY_TEST,
+        .longopt = "latency-test",
+        .argdesc = "n",
+        .text = "Measure the latency between the injection of an input event "
+                "and the reception of the decoded frame in which a region of "
+                "the device screen changes, n times, then print the latency "
+                "distribution and exit.\n"
+                "The device must change the region on each event, like the "
+                "fake device server does.\n"
+                "Also see --latency-test-event and --latency-test-region.",
+    },
+    {
+        .longopt_id = OPT_LATENCY_TEST_EVENT,
+        .longopt = "latency-test-event",
+        .argdesc = "event",
+        .text = "Select the input event injected by the latency test.\n"
+                "Possible values are \"touch\" (a tap at the center of the "
+                "region) and \"key\" (a press on SPACE).\n"
+                "Default is touch.",
+    },
+    {
+        .longopt_id = OPT_LATENCY_TEST_REGION,
+        .longopt = "latency-test-region",
+        .argdesc = "x:y:width:height",
+        .text = "Set the region of the video frames watched by the latency "
+                "test, in video frame coordinates.\n"
+                "Default is the top-left square whose side is 1/16 of the "
+                "smallest video dimension (inside the marker of the fake "
+                "device server).",
+    },
     {
         .longopt_id = OPT_LEGACY_PASTE,
         .longopt = "legacy-paste",
@@ -565,6 +649,56 @@ static const struct sc_option options[] = {
         .text = "Limit the frame rate of screen capture (officially supported "
                 "since Android 10, but may work on earlier versions).",
     },
+    {
+        .longopt_id = OPT_METRICS_PORT,
+        .longopt = "metrics-port",
+        .argdesc = "port",
+        .text = "Expose the pipeline metrics (packets and bytes received, "
+                "decoded and rendered frames, audio underflows, queue depths, "
+                "drops, restream clients...) in the Prometheus text format on "
+                "http://127.0.0.1:<port>/metrics.",
+    },
+    {
+        .longopt_id = OPT_MJPEG_MAX_FPS,
+        .longopt = "mjpeg-max-fps",
+        .argdesc = "value",
+        .text = "Limit the frame rate of the MJPEG server stream (the frames "
+                "are still captured and decoded at the device frame rate).\n"
+                "Default is 0 (unlimited).",
+    },
+    {
+        .longopt_id = OPT_MJPEG_MAX_SIZE,
+        .longopt = "mjpeg-max-size",
+        .argdesc = "value",
+        .text = "Downscale the MJPEG server images so that both dimensions "
+                "are lower or equal to the given value (the aspect ratio is "
+                "preserved).\n"
+                "Default is 0 (unlimited).",
+    },
+    {
+        .longopt_id = OPT_MJPEG_SERVER,
+        .longopt = "mjpeg-server",
+        .argdesc = "port",
+        .text = "Serve the video stream as multipart MJPEG over HTTP on the "
+                "specified port (on localhost).\n"
+                "Open http://127.0.0.1:<port>/ to read the stream, or "
+                "http://127.0.0.1:<port>/snapshot.jpg to get the last image.\n"
+                "The frames are decoded and encoded to JPEG on a pool of "
+                "worker threads.\n"
+                "While no client is connected, the frames are not decoded. On "
+                "the first request, if control is enabled and the video "
+                "stream is not also recorded or forwarded, a new key frame is "
+                "requested from the device (this restarts the encoder); "
+                "otherwise the first image waits for the next key frame.",
+    },
+    {
+        .longopt_id = OPT_MJPEG_WORKERS,
+        .longopt = "mjpeg-workers",
+        .argdesc = "n",
+        .text = "Set the number of threads encoding the MJPEG server images in "
+                "parallel (each thread encodes one frame at a time).\n"
+                "Default is 0 (one thread per CPU core, up to 16).",
+    },
     {
         .longopt_id = OPT_MOUSE,
         .longopt = "mouse",
@@ -843,12 +977,35 @@ static const struct sc_option options[] = {
                 "fails on the device. This option makes scrcpy fail if audio "
                 "is enabled but does not work."
     },
+    {
+        .longopt_id = OPT_RESUME,
+        .longopt = "resume",
+        .text = "When the connection to the device is lost (for example on a "
+                "Wi-Fi hiccup), restart the server on the same device and "
+                "resume the streams, instead of exiting.\n"
+                "The recorder, the restream servers and the control forwarder "
+                "are kept alive: their clients stay connected, and the gap is "
+                "a stream discontinuity (a new session).\n"
+                "Not supported with UHID input devices or --otg.",
+    },
     {
         // deprecated
         .longopt_id = OPT_ROTATION,
         .longopt = "rotation",
         .argdesc = "value",
     },
+    {
+        .longopt_id = OPT_RTSP_SERVER,
+        .longopt = "rtsp-server",
+        .argdesc = "port",
+        .text = "Serve the video and audio streams over RTSP on the specified "
+                "port (on localhost).\n"
+                "Clients (VLC, ffplay, GStreamer...) can play "
+                "rtsp://127.0.0.1:<port>/, using RTP over the RTSP connection "
+                "(interleaved TCP) or over UDP (unicast).\n"
+                "Supported codecs are H.264 and H.265 for video, Opus and AAC "
+                "for audio.",
+    },
     {
         .shortopt = 's',
         .longopt = "serial",
@@ -934,12 +1091,74 @@ static const struct sc_option options[] = {
                 "specified port.\n"
                 "Clients can connect to send control messages directly.",
     },
+    {
+        .longopt_id = OPT_TCP_PACING_RATE,
+        .longopt = "tcp-pacing-rate",
+        .argdesc = "value",
+        .text = "Limit the rate at which the --tcp-restream stream is sent to "
+                "the client, in bits per second, so that key frames are "
+                "spread over time in small bursts instead of being sent at "
+                "once at line rate.\n"
+                "Supports 'K' and 'M' suffixes. It must be higher than the "
+                "video bit rate (typically twice), otherwise the latency "
+                "increases indefinitely.\n"
+                "Default is 0 (unlimited).",
+    },
+    {
+        .longopt_id = OPT_TCP_TIMESHIFT,
+        .longopt = "tcp-timeshift",
+        .argdesc = "seconds",
+        .text = "Keep the last packets of the --tcp-restream stream in memory "
+                "during the given duration, so that a client can request to "
+                "replay the stream from a position in the past (from the "
+                "preceding key frame), and catch up with live at a faster "
+                "rate.\n"
+                "Default is 0 (disabled).",
+    },
+    {
+        .longopt_id = OPT_TCP_WEBSOCKET,
+        .longopt = "tcp-websocket",
+        .text = "Use the WebSocket protocol for --tcp-restream and "
+                "--tcp-control-forwarding, so that a browser can connect "
+                "directly (ws://<host>:<port>/).\n"
+                "Each message (codec info, packet header and data, control "
+                "message) is carried in a binary frame.",
+    },
+    {
+        .longopt_id = OPT_THREAD_POLICY,
+        .longopt = "thread-policy",
+        .argdesc = "role:key=value[:...]",
+        .text = "Set the CPU affinity and the priority of the threads having "
+                "the given role (their thread name, for example "
+                "video-demuxer, audio-demuxer, scrcpy-recorder, tcp-sink, "
+                "scrcpy-ctl, or main).\n"
+                "The supported keys are \"cpus\" (a CPU list, like "
+                "\"0-3,8\"), \"node\" (a NUMA node, whose CPUs are used) and "
+                "\"priority\" (low, normal, high or time-critical).\n"
+                "The actual placement of each thread is logged when it starts. "
+                "CPU affinity is only supported on Linux.\n"
+                "This option may be repeated, for example:\n"
+                "    --thread-policy=video-demuxer:cpus=2:priority=high "
+                "--thread-policy=scrcpy-recorder:node=1",
+    },
     {
         .longopt_id = OPT_TIME_LIMIT,
         .longopt = "time-limit",
         .argdesc = "seconds",
         .text = "Set the maximum mirroring time, in seconds.",
     },
+    {
+        .longopt_id = OPT_TRACE,
+        .longopt = "trace",
+        .argdesc = "file.json",
+        .text = "Record a timeline of the pipeline activity (packet reception, "
+                "decoding, rendering, sink pushes, control messages, "
+                "recording...) and write it to the given file on exit, in "
+                "the Chrome trace event format (readable by "
+                "chrome://tracing or Perfetto).\n"
+                "On Linux and macOS, the file may also be written at any time "
+                "by sending SIGUSR1 to the scrcpy process.",
+    },
     {
         .longopt_id = OPT_TUNNEL_HOST,
         .longopt = "tunnel-host",
@@ -1665,6 +1884,19 @@ parse_audio_output_buffer(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_audio_raw_aggregation(const char *s, uint16_t *ms) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000,
+                                "audio raw aggregation");
+    if (!ok) {
+        return false;
+    }
+
+    *ms = (uint16_t) value;
+    return true;
+}
+
 static bool
 parse_display_ime_policy(const char *s, enum sc_display_ime_policy *policy) {
     if (!strcmp(s, "local")) {
@@ -1988,6 +2220,97 @@ parse_port(const char *optarg, uint16_t *port) {
     return true;
 }
 
+static bool
+parse_mjpeg_max_fps(const char *s, uint16_t *max_fps) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000, "MJPEG max fps");
+    if (!ok) {
+        return false;
+    }
+
+    *max_fps = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_mjpeg_workers(const char *s, unsigned *workers) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 16, "MJPEG workers");
+    if (!ok) {
+        return false;
+    }
+
+    *workers = (unsigned) value;
+    return true;
+}
+
+static bool
+parse_latency_test(const char *s, unsigned *count) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 100000, "latency test");
+    if (!ok) {
+        return false;
+    }
+
+    *count = (unsigned) value;
+    return true;
+}
+
+static bool
+parse_latency_test_event(const char *s, enum sc_latency_test_event *event) {
+    if (!strcmp(s, "touch")) {
+        *event = SC_LATENCY_TEST_EVENT_TOUCH;
+        return true;
+    }
+    if (!strcmp(s, "key")) {
+        *event = SC_LATENCY_TEST_EVENT_KEY;
+        return true;
+    }
+    LOGE("Unsupported latency test event: %s (expected touch or key)", s);
+    return false;
+}
+
+static bool
+parse_latency_test_region(const char *s,
+                          struct sc_latency_test_region *region) {
+    long values[4];
+    size_t count = parse_integers_arg(s, ':', 4, values, 0, 0xFFFF,
+                                      "latency test region");
+    if (!count) {
+        return false;
+    }
+
+    if (count != 4) {
+        LOGE("Invalid latency test region (expected x:y:width:height): %s",
+             s);
+        return false;
+    }
+
+    if (!values[2] || !values[3]) {
+        LOGE("Empty latency test region: %s", s);
+        return false;
+    }
+
+    region->x = values[0];
+    region->y = values[1];
+    region->width = values[2];
+    region->height = values[3];
+    return true;
+}
+
+static bool
+parse_timeshift(const char *s, sc_tick *duration) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 24 * 60 * 60,
+                                "time-shift duration");
+    if (!ok) {
+        return false;
+    }
+
+    *duration = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
 static enum sc_record_format
 guess_record_format(const char *filename) {
     const char *dot = strrchr(filename, '.');
@@ -2372,6 +2695,104 @@ parse_mouse_bindings(const char *s, struct sc_mouse_bindings *mb) {
     return true;
 }
 
+static bool
+parse_thread_priority(const char *s, enum sc_thread_priority *priority) {
+    if (!strcmp(s, "low")) {
+        *priority = SC_THREAD_PRIORITY_LOW;
+        return true;
+    }
+    if (!strcmp(s, "normal")) {
+        *priority = SC_THREAD_PRIORITY_NORMAL;
+        return true;
+    }
+    if (!strcmp(s, "high")) {
+        *priority = SC_THREAD_PRIORITY_HIGH;
+        return true;
+    }
+    if (!strcmp(s, "time-critical")) {
+        *priority = SC_THREAD_PRIORITY_TIME_CRITICAL;
+        return true;
+    }
+    LOGE("Unsupported thread priority: %s (expected low, normal, high or "
+         "time-critical)", s);
+    return false;
+}
+
+static bool
+parse_thread_policy_param(const char *param, struct sc_thread_policy *policy) {
+    const char *value = strchr(param, '=');
+    if (!value) {
+        LOGE("Invalid thread policy parameter: '%s' (expected key=value)",
+             param);
+        return false;
+    }
+    size_t key_len = value - param;
+    ++value;
+
+    if (key_len == 4 && !strncmp(param, "cpus", 4)) {
+        if (!sc_cpu_set_parse(value, &policy->cpus)) {
+            LOGE("Could not parse CPU list: %s", value);
+            return false;
+        }
+        return true;
+    }
+
+    if (key_len == 4 && !strncmp(param, "node", 4)) {
+        long node;
+        if (!parse_integer_arg(value, &node, false, 0, 1023, "NUMA node")) {
+            return false;
+        }
+        policy->numa_node = node;
+        return true;
+    }
+
+    if (key_len == 8 && !strncmp(param, "priority", 8)) {
+        policy->has_priority = true;
+        return parse_thread_priority(value, &policy->priority);
+    }
+
+    LOGE("Unknown thread policy parameter: '%.*s' (expected cpus, node or "
+         "priority)", (int) key_len, param);
+    return false;
+}
+
+static bool
+parse_thread_policy(const char *s, struct sc_thread_policy *policy) {
+    memset(policy, 0, sizeof(*policy));
+    policy->numa_node = -1;
+
+    // role:key=value[:key=value...]
+    size_t role_len = strcspn(s, ":");
+    if (!role_len || role_len >= sizeof(policy->role) || !s[role_len]) {
+        LOGE("Invalid thread policy: '%s' (expected "
+             "role:key=value[:key=value...])", s);
+        return false;
+    }
+    memcpy(policy->role, s, role_len);
+    policy->role[role_len] = '\0';
+
+    const char *p = s + role_len;
+    while (*p == ':') {
+        ++p;
+        size_t len = strcspn(p, ":");
+        char param[256];
+        if (len >= sizeof(param)) {
+            LOGE("Thread policy parameter too long");
+            return false;
+        }
+        memcpy(param, p, len);
+        param[len] = '\0';
+
+        if (!parse_thread_policy_param(param, policy)) {
+            return false;
+        }
+
+        p += len;
+    }
+
+    return true;
+}
+
 static bool
 parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                        const char *optstring, const struct option *longopts) {
@@ -2743,6 +3164,9 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_REQUIRE_AUDIO:
                 opts->require_audio = true;
                 break;
+            case OPT_RESUME:
+                opts->resume = true;
+                break;
             case OPT_AUDIO_BUFFER:
                 if (!parse_buffering_time(optarg, &opts->audio_buffer)) {
                     return false;
@@ -2802,9 +3226,24 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_WINDOW:
                 opts->window = false;
                 break;
+            case OPT_HEADLESS:
+#ifdef _WIN32
+                LOGE("Headless mode (--headless) is not supported on "
+                     "Windows.");
+                return false;
+#else
+                opts->headless = true;
+                break;
+#endif
             case OPT_AUDIO_DUP:
                 opts->audio_dup = true;
                 break;
+            case OPT_AUDIO_RAW_AGGREGATION:
+                if (!parse_audio_raw_aggregation(optarg,
+                                                 &opts->audio_raw_aggregation)) {
+                    return false;
+                }
+                break;
             case 'G':
                 opts->gamepad_input_mode = SC_GAMEPAD_INPUT_MODE_UHID_OR_AOA;
                 break;
@@ -2853,6 +3292,86 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_RTSP_SERVER:
+                if (!parse_port(optarg, &opts->rtsp_port)) {
+                    return false;
+                }
+                break;
+            case OPT_FMP4_SERVER:
+                if (!parse_port(optarg, &opts->fmp4_port)) {
+                    return false;
+                }
+                break;
+            case OPT_TCP_WEBSOCKET:
+                opts->tcp_websocket = true;
+                break;
+            case OPT_TCP_TIMESHIFT:
+                if (!parse_timeshift(optarg, &opts->tcp_timeshift)) {
+                    return false;
+                }
+                break;
+            case OPT_TCP_PACING_RATE:
+                if (!parse_bit_rate(optarg, &opts->tcp_pacing_rate)) {
+                    return false;
+                }
+                break;
+            case OPT_METRICS_PORT:
+                if (!parse_port(optarg, &opts->metrics_port)) {
+                    return false;
+                }
+                break;
+            case OPT_TRACE:
+                opts->trace_filename = optarg;
+                break;
+            case OPT_THREAD_POLICY:
+                if (opts->thread_policy_count == SC_THREAD_POLICY_MAX) {
+                    LOGE("Too many thread policies (max %d)",
+                         SC_THREAD_POLICY_MAX);
+                    return false;
+                }
+                if (!parse_thread_policy(optarg,
+                        &opts->thread_policies[opts->thread_policy_count])) {
+                    return false;
+                }
+                ++opts->thread_policy_count;
+                break;
+            case OPT_MJPEG_SERVER:
+                if (!parse_port(optarg, &opts->mjpeg_port)) {
+                    return false;
+                }
+                break;
+            case OPT_MJPEG_MAX_FPS:
+                if (!parse_mjpeg_max_fps(optarg, &opts->mjpeg_max_fps)) {
+                    return false;
+                }
+                break;
+            case OPT_MJPEG_MAX_SIZE:
+                if (!parse_max_size(optarg, &opts->mjpeg_max_size)) {
+                    return false;
+                }
+                break;
+            case OPT_MJPEG_WORKERS:
+                if (!parse_mjpeg_workers(optarg, &opts->mjpeg_workers)) {
+                    return false;
+                }
+                break;
+            case OPT_LATENCY_TEST:
+                if (!parse_latency_test(optarg, &opts->latency_test)) {
+                    return false;
+                }
+                break;
+            case OPT_LATENCY_TEST_EVENT:
+                if (!parse_latency_test_event(optarg,
+                                              &opts->latency_test_event)) {
+                    return false;
+                }
+                break;
+            case OPT_LATENCY_TEST_REGION:
+                if (!parse_latency_test_region(optarg,
+                                               &opts->latency_test_region)) {
+                    return false;
+                }
+                break;
             default:
                 // getopt prints the error message on stderr
                 return false;
@@ -2890,6 +3409,41 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     v4l2 = !!opts->v4l2_device;
 #endif
 
+    if (opts->headless) {
+        if (otg) {
+            LOGE("--otg is incompatible with headless mode");
+            return false;
+        }
+
+        // The SDK keyboard is accepted (it is inert without a window), but
+        // HID devices could not be fed without SDL input events
+        enum sc_keyboard_input_mode kmode = opts->keyboard_input_mode;
+        if (kmode != SC_KEYBOARD_INPUT_MODE_AUTO
+                && kmode != SC_KEYBOARD_INPUT_MODE_SDK
+                && kmode != SC_KEYBOARD_INPUT_MODE_DISABLED) {
+            LOGE("In headless mode, --keyboard only supports sdk or "
+                 "disabled.");
+            return false;
+        }
+
+        if (opts->mouse_input_mode != SC_MOUSE_INPUT_MODE_AUTO
+                && opts->mouse_input_mode != SC_MOUSE_INPUT_MODE_DISABLED) {
+            LOGE("In headless mode, --mouse only supports disabled.");
+            return false;
+        }
+
+        if (opts->gamepad_input_mode != SC_GAMEPAD_INPUT_MODE_DISABLED) {
+            LOGE("In headless mode, --gamepad only supports disabled.");
+            return false;
+        }
+
+        // Nothing is rendered or played on the computer
+        opts->window = false;
+        opts->audio_playback = false;
+        // There is no computer clipboard to synchronize with
+        opts->clipboard_autosync = false;
+    }
+
     if (!opts->window) {
         // Without window, there cannot be any video playback
         opts->video_playback = false;
@@ -2908,17 +3462,44 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     }
 
     if (opts->video && !opts->video_playback && !opts->record_filename
-            && !v4l2 && !opts->tcp_restream_port) {
-        LOGI("No video playback, no recording, no V4L2 sink, no TCP restream: "
-             "video disabled");
+            && !v4l2 && !opts->tcp_restream_port && !opts->rtsp_port
+            && !opts->fmp4_port && !opts->mjpeg_port && !opts->latency_test) {
+        LOGI("No video playback, no recording, no V4L2 sink, no TCP restream, "
+             "no RTSP server, no fMP4 server, no MJPEG server, no latency "
+             "test: video disabled");
         opts->video = false;
     }
 
-    if (opts->audio && !opts->audio_playback && !opts->record_filename) {
-        LOGI("No audio playback, no recording: audio disabled");
+    if (opts->audio && !opts->audio_playback && !opts->record_filename
+            && !opts->rtsp_port && !opts->fmp4_port) {
+        LOGI("No audio playback, no recording, no RTSP server, "
+             "no fMP4 server: audio disabled");
         opts->audio = false;
     }
 
+    if ((opts->mjpeg_max_fps || opts->mjpeg_max_size || opts->mjpeg_workers)
+            && !opts->mjpeg_port) {
+        LOGE("MJPEG options require --mjpeg-server");
+        return false;
+    }
+
+    if (opts->tcp_timeshift && !opts->tcp_restream_port) {
+        LOGE("--tcp-timeshift requires --tcp-restream");
+        return false;
+    }
+
+    if (opts->tcp_pacing_rate && !opts->tcp_restream_port) {
+        LOGE("--tcp-pacing-rate requires --tcp-restream");
+        return false;
+    }
+
+    if (opts->tcp_websocket && !opts->tcp_restream_port
+            && !opts->tcp_control_forwarding_port) {
+        LOGE("--tcp-websocket requires --tcp-restream or "
+             "--tcp-control-forwarding");
+        return false;
+    }
+
     if (!opts->video && !opts->audio && !opts->control && !otg) {
         LOGE("No video, no audio, no control, no OTG: nothing to do");
         return false;
@@ -2937,6 +3518,13 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGI("FLAC audio: audio buffer increased to 120 ms (use "
                  "--audio-buffer to set a custom value)");
             opts->audio_buffer = SC_TICK_FROM_MS(120);
+        } else if (opts->audio_codec == SC_CODEC_RAW
+                && opts->audio_raw_aggregation) {
+            // A whole packet must be buffered before it is played
+            unsigned ms = 50 + opts->audio_raw_aggregation;
+            LOGI("Raw audio aggregation: audio buffer increased to %u ms (use "
+                 "--audio-buffer to set a custom value)", ms);
+            opts->audio_buffer = SC_TICK_FROM_MS(ms);
         } else {
             opts->audio_buffer = SC_TICK_FROM_MS(50);
         }
@@ -2994,6 +3582,22 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->resume) {
+        if (otg) {
+            LOGE("--resume is incompatible with --otg");
+            return false;
+        }
+
+        // The UHID devices are created by the server, they would be lost on
+        // resume
+        if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_UHID
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID
+                || opts->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
+            LOGE("--resume does not support UHID input devices");
+            return false;
+        }
+    }
+
     // If mouse bindings are not explicitly set, configure default bindings
     if (opts->mouse_bindings.pri.right_click == SC_MOUSE_BINDING_AUTO) {
         assert(opts->mouse_bindings.pri.middle_click == SC_MOUSE_BINDING_AUTO);
@@ -3262,10 +3866,20 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         }
     }
 
+    if (opts->fmp4_port && opts->audio && opts->audio_codec == SC_CODEC_RAW) {
+        LOGE("fMP4 server does not support RAW audio");
+        return false;
+    }
+
     if (opts->audio_codec == SC_CODEC_FLAC && opts->audio_bit_rate) {
         LOGW("--audio-bit-rate is ignored for FLAC audio codec");
     }
 
+    if (opts->audio_raw_aggregation && opts->audio_codec != SC_CODEC_RAW) {
+        LOGE("--audio-raw-aggregation is specific to --audio-codec=raw");
+        return false;
+    }
+
     if (opts->audio_codec == SC_CODEC_RAW) {
         if (opts->audio_bit_rate) {
             LOGW("--audio-bit-rate is ignored for raw audio codec");
@@ -3299,6 +3913,21 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("Cannot start an Android app if control is disabled");
             return false;
         }
+        if (opts->latency_test) {
+            LOGE("The latency test requires control");
+            return false;
+        }
+    }
+
+    if (opts->latency_test) {
+        if (!opts->video) {
+            LOGE("The latency test requires video, but --no-video was set");
+            return false;
+        }
+    } else if (opts->latency_test_event != SC_LATENCY_TEST_EVENT_TOUCH
+            || opts->latency_test_region.width) {
+        LOGE("Latency test options require --latency-test");
+        return false;
     }
 
 # ifdef _WIN32
@@ -3348,6 +3977,10 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("OTG mode: could not sink to V4L2 device");
             return false;
         }
+        if (opts->latency_test) {
+            LOGE("OTG mode: could not run the latency test");
+            return false;
+        }
     }
 
     return true;
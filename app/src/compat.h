@@ -6,7 +6,9 @@
 #include <libavcodec/version.h>
 #include <libavformat/version.h>
 #include <libavutil/version.h>
-#include <SDL2/SDL_version.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL_version.h>
+#endif
 
 #ifndef _WIN32
 # define PRIu64_ PRIu64
@@ -61,26 +63,35 @@
 # define SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
 #endif
 
-#if SDL_VERSION_ATLEAST(2, 0, 6)
-// <https://github.com/libsdl-org/SDL/commit/d7a318de563125e5bb465b1000d6bc9576fbc6fc>
-# define SCRCPY_SDL_HAS_HINT_TOUCH_MOUSE_EVENTS
+// Not documented in ffmpeg/doc/APIchanges, but the write_packet callback of
+// avio_alloc_context() takes a pointer-to-const buffer since lavf 61 (the
+// non-const variant was deprecated by FF_API_AVIO_WRITE_NONCONST).
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(61, 0, 100)
+# define SCRCPY_LAVF_HAS_AVIO_WRITE_CONST_BUFFER
 #endif
 
-#if SDL_VERSION_ATLEAST(2, 0, 8)
+#ifdef HAVE_SDL
+# if SDL_VERSION_ATLEAST(2, 0, 6)
+// <https://github.com/libsdl-org/SDL/commit/d7a318de563125e5bb465b1000d6bc9576fbc6fc>
+#  define SCRCPY_SDL_HAS_HINT_TOUCH_MOUSE_EVENTS
+# endif
+
+# if SDL_VERSION_ATLEAST(2, 0, 8)
 // <https://hg.libsdl.org/SDL/rev/dfde5d3f9781>
-# define SCRCPY_SDL_HAS_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
-#endif
+#  define SCRCPY_SDL_HAS_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
+# endif
 
-#if SDL_VERSION_ATLEAST(2, 0, 16)
-# define SCRCPY_SDL_HAS_THREAD_PRIORITY_TIME_CRITICAL
-#endif
+# if SDL_VERSION_ATLEAST(2, 0, 16)
+#  define SCRCPY_SDL_HAS_THREAD_PRIORITY_TIME_CRITICAL
+# endif
 
-#if SDL_VERSION_ATLEAST(2, 0, 18)
-# define SCRCPY_SDL_HAS_HINT_APP_NAME
-#endif
+# if SDL_VERSION_ATLEAST(2, 0, 18)
+#  define SCRCPY_SDL_HAS_HINT_APP_NAME
+# endif
 
-#if SDL_VERSION_ATLEAST(2, 0, 14)
-# define SCRCPY_SDL_HAS_HINT_AUDIO_DEVICE_APP_NAME
+# if SDL_VERSION_ATLEAST(2, 0, 14)
+#  define SCRCPY_SDL_HAS_HINT_AUDIO_DEVICE_APP_NAME
+# endif
 #endif
 
 #ifndef HAVE_STRDUP
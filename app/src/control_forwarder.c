@@ -5,6 +5,7 @@
 
 #include "control_msg.h"
 #include "util/log.h"
+#include "util/websocket.h"
 
 #define SC_CONTROL_MSG_MAX_SIZE 256
 
@@ -41,6 +42,17 @@ run_control_forwarder(void *data) {
         
         LOGI("Control forwarder: client connected");
         
+        struct sc_websocket_reader ws_reader;
+        if (forwarder->websocket) {
+            if (!sc_websocket_accept(forwarder->client_socket)) {
+                LOGW("Control forwarder: WebSocket handshake failed");
+                net_close(forwarder->client_socket);
+                forwarder->client_socket = SC_SOCKET_NONE;
+                continue;
+            }
+            sc_websocket_reader_init(&ws_reader, forwarder->client_socket);
+        }
+        
         // Forward control messages from TCP client to scrcpy control socket
         bool client_connected = true;
         uint8_t buffer[SC_CONTROL_MSG_MAX_SIZE];
@@ -48,7 +60,11 @@ run_control_forwarder(void *data) {
         while (client_connected && !forwarder->stopped) {
             // Receive control message from TCP client
             // Control messages are variable length, so we need to read carefully
-            ssize_t r = net_recv(forwarder->client_socket, buffer, sizeof(buffer));
+            // In WebSocket mode, the frames payload is forwarded as a stream
+            ssize_t r = forwarder->websocket
+                      ? sc_websocket_recv(&ws_reader, buffer, sizeof(buffer))
+                      : net_recv(forwarder->client_socket, buffer,
+                                 sizeof(buffer));
             
             if (r <= 0) {
                 // Client disconnected or error
@@ -61,12 +77,15 @@ run_control_forwarder(void *data) {
             }
             
             // Forward the received bytes directly to the control socket
-            sc_socket control_socket = forwarder->controller->control_socket;
-            ssize_t w = net_send_all(control_socket, buffer, r);
-            if (w != r) {
+            bool ok = sc_controller_send_raw(forwarder->controller, buffer, r);
+            if (!ok) {
                 LOGW("Control forwarder: failed to forward control message");
-                client_connected = false;
-                break;
+                if (!forwarder->resume) {
+                    client_connected = false;
+                    break;
+                }
+                // The device connection is resuming: the data is dropped, but
+                // the client is kept connected
             }
         }
         
@@ -88,8 +107,11 @@ run_control_forwarder(void *data) {
 }
 
 bool
-sc_control_forwarder_init(struct sc_control_forwarder *forwarder, uint16_t port) {
+sc_control_forwarder_init(struct sc_control_forwarder *forwarder, uint16_t port,
+                          bool websocket, bool resume) {
     forwarder->port = port;
+    forwarder->websocket = websocket;
+    forwarder->resume = resume;
     forwarder->server_socket = SC_SOCKET_NONE;
     forwarder->client_socket = SC_SOCKET_NONE;
     forwarder->stopped = false;
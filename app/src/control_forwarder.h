@@ -12,6 +12,11 @@
 
 struct sc_control_forwarder {
     uint16_t port;
+    // Use the WebSocket protocol (control messages in binary frames)
+    bool websocket;
+    // The device connection may be resumed: keep the client connected if a
+    // message could not be forwarded
+    bool resume;
     
     sc_socket server_socket;
     sc_socket client_socket;
@@ -25,7 +30,8 @@ struct sc_control_forwarder {
 };
 
 bool
-sc_control_forwarder_init(struct sc_control_forwarder *forwarder, uint16_t port);
+sc_control_forwarder_init(struct sc_control_forwarder *forwarder, uint16_t port,
+                          bool websocket, bool resume);
 
 bool
 sc_control_forwarder_start(struct sc_control_forwarder *forwarder,
@@ -182,6 +182,19 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
             size_t len = write_string_tiny(&buf[1], msg->start_app.name, 255);
             return 1 + len;
         }
+        case SC_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG: {
+            sc_write16be(&buf[1], msg->set_video_config.max_size);
+            // IEEE 754 single precision (read by DataInputStream.readFloat())
+            uint32_t max_fps;
+            static_assert(sizeof(max_fps) == sizeof(float), "Unexpected size");
+            memcpy(&max_fps, &msg->set_video_config.max_fps, sizeof(max_fps));
+            sc_write32be(&buf[3], max_fps);
+            sc_write16be(&buf[7], msg->set_video_config.crop_width);
+            sc_write16be(&buf[9], msg->set_video_config.crop_height);
+            sc_write16be(&buf[11], msg->set_video_config.crop_x);
+            sc_write16be(&buf[13], msg->set_video_config.crop_y);
+            return 15;
+        }
         case SC_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case SC_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case SC_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
@@ -318,6 +331,16 @@ sc_control_msg_log(const struct sc_control_msg *msg) {
         case SC_CONTROL_MSG_TYPE_RESET_VIDEO:
             LOG_CMSG("reset video");
             break;
+        case SC_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG:
+            LOG_CMSG("video config max_size=%" PRIu16 " max_fps=%f"
+                     " crop=%" PRIu16 ":%" PRIu16 ":%" PRIu16 ":%" PRIu16,
+                     msg->set_video_config.max_size,
+                     msg->set_video_config.max_fps,
+                     msg->set_video_config.crop_width,
+                     msg->set_video_config.crop_height,
+                     msg->set_video_config.crop_x,
+                     msg->set_video_config.crop_y);
+            break;
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
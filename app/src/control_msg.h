@@ -43,6 +43,7 @@ enum sc_control_msg_type {
     SC_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS,
     SC_CONTROL_MSG_TYPE_START_APP,
     SC_CONTROL_MSG_TYPE_RESET_VIDEO,
+    SC_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG,
 };
 
 enum sc_copy_key {
@@ -111,6 +112,15 @@ struct sc_control_msg {
         struct {
             char *name;
         } start_app;
+        struct {
+            uint16_t max_size; // 0 = unlimited
+            float max_fps; // 0 = unlimited
+            // no crop if width or height is 0
+            uint16_t crop_width;
+            uint16_t crop_height;
+            uint16_t crop_x;
+            uint16_t crop_y;
+        } set_video_config;
     };
 };
 
@@ -2,7 +2,9 @@
 
 #include <assert.h>
 
+#include "metrics.h"
 #include "util/log.h"
+#include "util/trace.h"
 
 // Drop droppable events above this limit
 #define SC_CONTROL_MSG_QUEUE_LIMIT 60
@@ -118,11 +120,32 @@ sc_controller_push_msg(struct sc_controller *controller,
     }
     // Otherwise, the msg is discarded
 
+    size = sc_vecdeque_size(&controller->queue);
     sc_mutex_unlock(&controller->mutex);
 
+    sc_metrics_set(SC_METRIC_CONTROLLER_QUEUE, size);
+    if (!pushed) {
+        sc_metrics_add(SC_METRIC_CONTROLLER_DROPPED, 1);
+    }
+
     return pushed;
 }
 
+bool
+sc_controller_send_raw(struct sc_controller *controller, const uint8_t *data,
+                       size_t len) {
+    sc_mutex_lock(&controller->mutex);
+    // Once stopped, the control socket may be closed (and replaced on resume)
+    bool ok = !controller->stopped;
+    if (ok) {
+        ssize_t w = net_send_all(controller->control_socket, data, len);
+        ok = w >= 0 && (size_t) w == len;
+    }
+    sc_mutex_unlock(&controller->mutex);
+
+    return ok;
+}
+
 static bool
 process_msg(struct sc_controller *controller,
             const struct sc_control_msg *msg, bool *eos) {
@@ -164,10 +187,15 @@ run_controller(void *data) {
 
         assert(!sc_vecdeque_is_empty(&controller->queue));
         struct sc_control_msg msg = sc_vecdeque_pop(&controller->queue);
+        size_t size = sc_vecdeque_size(&controller->queue);
         sc_mutex_unlock(&controller->mutex);
 
+        sc_metrics_set(SC_METRIC_CONTROLLER_QUEUE, size);
+
         bool eos;
+        sc_trace_begin("controller send");
         bool ok = process_msg(controller, &msg, &eos);
+        sc_trace_end("controller send");
         sc_control_msg_destroy(&msg);
         if (!ok) {
             if (eos) {
@@ -216,3 +244,20 @@ sc_controller_join(struct sc_controller *controller) {
     sc_thread_join(&controller->thread, NULL);
     sc_receiver_join(&controller->receiver);
 }
+
+bool
+sc_controller_resume(struct sc_controller *controller,
+                     sc_socket control_socket) {
+    assert(control_socket != SC_SOCKET_NONE);
+
+    // The threads are joined, but the control forwarder may still push
+    // messages concurrently
+    sc_mutex_lock(&controller->mutex);
+    controller->control_socket = control_socket;
+    controller->stopped = false;
+    sc_mutex_unlock(&controller->mutex);
+
+    controller->receiver.control_socket = control_socket;
+
+    return sc_controller_start(controller);
+}
@@ -54,8 +54,27 @@ sc_controller_stop(struct sc_controller *controller);
 void
 sc_controller_join(struct sc_controller *controller);
 
+/**
+ * Restart a stopped and joined controller on a new control socket
+ *
+ * The pending messages are kept: they are sent to the new socket.
+ */
+bool
+sc_controller_resume(struct sc_controller *controller,
+                     sc_socket control_socket);
+
 bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg);
 
+/**
+ * Send already serialized control messages directly to the control socket
+ *
+ * The data is dropped (and false is returned) while the controller is stopped
+ * (typically while the device connection is resuming).
+ */
+bool
+sc_controller_send_raw(struct sc_controller *controller, const uint8_t *data,
+                       size_t len);
+
 #endif
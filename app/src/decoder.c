@@ -1,10 +1,13 @@
 #include "decoder.h"
 
+#include <assert.h>
 #include <errno.h>
 #include <libavcodec/packet.h>
 #include <libavutil/avutil.h>
 
+#include "metrics.h"
 #include "util/log.h"
+#include "util/trace.h"
 
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_decoder, packet_sink)
@@ -23,6 +26,8 @@ sc_decoder_open(struct sc_decoder *decoder, AVCodecContext *ctx) {
     }
 
     decoder->ctx = ctx;
+    decoder->paused = false;
+    decoder->resync = false;
 
     return true;
 }
@@ -33,6 +38,43 @@ sc_decoder_close(struct sc_decoder *decoder) {
     av_frame_free(&decoder->frame);
 }
 
+// Return true if the packet must be decoded
+static bool
+sc_decoder_check_demand(struct sc_decoder *decoder, const AVPacket *packet) {
+    if (!sc_frame_source_sinks_want_frames(&decoder->frame_source)) {
+        if (!decoder->paused) {
+            LOGD("Decoder '%s': no frame consumer, paused", decoder->name);
+            decoder->paused = true;
+            decoder->resync = true;
+        }
+        return false;
+    }
+
+    if (decoder->paused) {
+        LOGD("Decoder '%s': resumed", decoder->name);
+        decoder->paused = false;
+        if (decoder->cbs && decoder->cbs->on_resync) {
+            decoder->cbs->on_resync(decoder, decoder->cbs_userdata);
+        }
+    }
+
+    if (decoder->resync) {
+        // The video packets depend on the previous ones since the last key
+        // frame (the config packet is merged into the key frames). Audio
+        // packets can be decoded independently.
+        bool is_video = decoder->ctx->codec_type == AVMEDIA_TYPE_VIDEO;
+        if (is_video && !(packet->flags & AV_PKT_FLAG_KEY)) {
+            return false;
+        }
+
+        LOGD("Decoder '%s': resynced", decoder->name);
+        avcodec_flush_buffers(decoder->ctx);
+        decoder->resync = false;
+    }
+
+    return true;
+}
+
 static bool
 sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
     bool is_config = packet->pts == AV_NOPTS_VALUE;
@@ -41,6 +83,13 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         return true;
     }
 
+    if (!sc_decoder_check_demand(decoder, packet)) {
+        sc_metrics_add(decoder->ctx->codec_type == AVMEDIA_TYPE_VIDEO
+                           ? SC_METRIC_DECODER_VIDEO_SKIPPED_PACKETS
+                           : SC_METRIC_DECODER_AUDIO_SKIPPED_PACKETS, 1);
+        return true;
+    }
+
     int ret = avcodec_send_packet(decoder->ctx, packet);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         LOGE("Decoder '%s': could not send video packet: %d",
@@ -61,6 +110,10 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         }
 
         // a frame was received
+        sc_metrics_add(decoder->ctx->codec_type == AVMEDIA_TYPE_VIDEO
+                           ? SC_METRIC_DECODER_VIDEO_FRAMES
+                           : SC_METRIC_DECODER_AUDIO_FRAMES, 1);
+
         bool ok = sc_frame_source_sinks_push(&decoder->frame_source,
                                              decoder->frame);
         av_frame_unref(decoder->frame);
@@ -73,6 +126,18 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
     return true;
 }
 
+static bool
+sc_decoder_session(struct sc_decoder *decoder, const AVCodecContext *ctx) {
+    assert(ctx == decoder->ctx);
+    (void) ctx;
+
+    LOGD("Decoder '%s': new session, flushing", decoder->name);
+    // Drop the references to the frames of the previous session, the next
+    // packet is a key frame
+    avcodec_flush_buffers(decoder->ctx);
+    return true;
+}
+
 static bool
 sc_decoder_packet_sink_open(struct sc_packet_sink *sink, AVCodecContext *ctx) {
     struct sc_decoder *decoder = DOWNCAST(sink);
@@ -89,18 +154,32 @@ static bool
 sc_decoder_packet_sink_push(struct sc_packet_sink *sink,
                             const AVPacket *packet) {
     struct sc_decoder *decoder = DOWNCAST(sink);
-    return sc_decoder_push(decoder, packet);
+    sc_trace_begin("decode");
+    bool ok = sc_decoder_push(decoder, packet);
+    sc_trace_end("decode");
+    return ok;
+}
+
+static bool
+sc_decoder_packet_sink_session(struct sc_packet_sink *sink,
+                               const AVCodecContext *ctx) {
+    struct sc_decoder *decoder = DOWNCAST(sink);
+    return sc_decoder_session(decoder, ctx);
 }
 
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name) {
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                const struct sc_decoder_callbacks *cbs, void *cbs_userdata) {
     decoder->name = name; // statically allocated
+    decoder->cbs = cbs;
+    decoder->cbs_userdata = cbs_userdata;
     sc_frame_source_init(&decoder->frame_source);
 
     static const struct sc_packet_sink_ops ops = {
         .open = sc_decoder_packet_sink_open,
         .close = sc_decoder_packet_sink_close,
         .push = sc_decoder_packet_sink_push,
+        .session = sc_decoder_packet_sink_session,
     };
 
     decoder->packet_sink.ops = &ops;
@@ -16,10 +16,28 @@ struct sc_decoder {
 
     AVCodecContext *ctx;
     AVFrame *frame;
+
+    // Set while no frame sink wants the frames: the packets are not decoded
+    bool paused;
+    // Set when decoding must restart from a key frame (after a pause)
+    bool resync;
+
+    const struct sc_decoder_callbacks *cbs; // may be NULL
+    void *cbs_userdata;
+};
+
+struct sc_decoder_callbacks {
+    // Called when decoding resumes after a pause (from the decoder thread):
+    // the packets are skipped until the next key frame, so the callback may
+    // request one from the device
+    void (*on_resync)(struct sc_decoder *decoder, void *userdata);
 };
 
 // The name must be statically allocated (e.g. a string literal)
+//
+// The callbacks may be NULL.
 void
-sc_decoder_init(struct sc_decoder *decoder, const char *name);
+sc_decoder_init(struct sc_decoder *decoder, const char *name,
+                const struct sc_decoder_callbacks *cbs, void *cbs_userdata);
 
 #endif
@@ -221,6 +221,12 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
     return true;
 }
 
+static bool
+sc_delay_buffer_frame_sink_wants_frames(struct sc_frame_sink *sink) {
+    struct sc_delay_buffer *db = DOWNCAST(sink);
+    return sc_frame_source_sinks_want_frames(&db->frame_source);
+}
+
 void
 sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
                      bool first_frame_asap) {
@@ -235,6 +241,7 @@ sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
         .open = sc_delay_buffer_frame_sink_open,
         .close = sc_delay_buffer_frame_sink_close,
         .push = sc_delay_buffer_frame_sink_push,
+        .wants_frames = sc_delay_buffer_frame_sink_wants_frames,
     };
 
     db->frame_sink.ops = &ops;
@@ -2,12 +2,16 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdio.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/channel_layout.h>
 
+#include "metrics.h"
 #include "packet_merger.h"
 #include "util/binary.h"
 #include "util/log.h"
+#include "util/net_reader.h"
+#include "util/trace.h"
 
 #define SC_PACKET_HEADER_SIZE 12
 
@@ -16,6 +20,11 @@
 
 #define SC_PACKET_PTS_MASK (SC_PACKET_FLAG_KEY_FRAME - 1)
 
+// A config packet flagged as a key frame starts a new session
+#define SC_PACKET_FLAG_SESSION \
+    (SC_PACKET_FLAG_CONFIG | SC_PACKET_FLAG_KEY_FRAME)
+#define SC_PACKET_SESSION_SIZE 12
+
 static enum AVCodecID
 sc_demuxer_to_avcodec_id(uint32_t codec_id) {
 #define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264" in ASCII
@@ -54,8 +63,7 @@ sc_demuxer_to_avcodec_id(uint32_t codec_id) {
 static bool
 sc_demuxer_recv_codec_id(struct sc_demuxer *demuxer, uint32_t *codec_id) {
     uint8_t data[4];
-    ssize_t r = net_recv_all(demuxer->socket, data, 4);
-    if (r < 4) {
+    if (!sc_net_reader_read(&demuxer->reader, data, 4)) {
         return false;
     }
 
@@ -67,8 +75,7 @@ static bool
 sc_demuxer_recv_video_size(struct sc_demuxer *demuxer, uint32_t *width,
                            uint32_t *height) {
     uint8_t data[8];
-    ssize_t r = net_recv_all(demuxer->socket, data, 8);
-    if (r < 8) {
+    if (!sc_net_reader_read(&demuxer->reader, data, 8)) {
         return false;
     }
 
@@ -78,7 +85,8 @@ sc_demuxer_recv_video_size(struct sc_demuxer *demuxer, uint32_t *width,
 }
 
 static bool
-sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
+sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet,
+                       bool *session) {
     // The video and audio streams contain a sequence of raw packets (as
     // provided by MediaCodec), each prefixed with a "meta" header.
     //
@@ -98,10 +106,20 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
     // ||                                PTS
     // | `- key frame
     //  `-- config packet
+    //
+    // If both flags are set, the packet is not a media packet: it announces a
+    // new capture session on the device (for example after a rotation). Its
+    // payload has the same layout as the video stream header:
+    //
+    // [. . . .|. . . .|. . . .]
+    //  <-----> <-----> <----->
+    //  codec    width   height
+    //    id
 
+    // Read through the read-ahead buffer: a header and the following small
+    // packets (typically audio packets) are received in a single recv()
     uint8_t header[SC_PACKET_HEADER_SIZE];
-    ssize_t r = net_recv_all(demuxer->socket, header, SC_PACKET_HEADER_SIZE);
-    if (r < SC_PACKET_HEADER_SIZE) {
+    if (!sc_net_reader_read(&demuxer->reader, header, SC_PACKET_HEADER_SIZE)) {
         return false;
     }
 
@@ -114,12 +132,16 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
         return false;
     }
 
-    r = net_recv_all(demuxer->socket, packet->data, len);
-    if (r < 0 || ((uint32_t) r) < len) {
+    if (!sc_net_reader_read(&demuxer->reader, packet->data, len)) {
         av_packet_unref(packet);
         return false;
     }
 
+    *session = (pts_flags & SC_PACKET_FLAG_SESSION) == SC_PACKET_FLAG_SESSION;
+    if (*session) {
+        return true;
+    }
+
     if (pts_flags & SC_PACKET_FLAG_CONFIG) {
         packet->pts = AV_NOPTS_VALUE;
     } else {
@@ -134,41 +156,47 @@ sc_demuxer_recv_packet(struct sc_demuxer *demuxer, AVPacket *packet) {
     return true;
 }
 
-static int
-run_demuxer(void *data) {
-    struct sc_demuxer *demuxer = data;
+static bool
+sc_demuxer_handle_session(struct sc_demuxer *demuxer,
+                          AVCodecContext *codec_ctx, uint32_t raw_codec_id,
+                          const AVPacket *packet) {
+    if (codec_ctx->codec_type != AVMEDIA_TYPE_VIDEO
+            || packet->size != SC_PACKET_SESSION_SIZE) {
+        LOGE("Demuxer '%s': unexpected session packet", demuxer->name);
+        return false;
+    }
 
-    // Flag to report end-of-stream (i.e. device disconnected)
-    enum sc_demuxer_status status = SC_DEMUXER_STATUS_ERROR;
+    uint32_t new_codec_id = sc_read32be(packet->data);
+    uint32_t width = sc_read32be(packet->data + 4);
+    uint32_t height = sc_read32be(packet->data + 8);
 
-    uint32_t raw_codec_id;
-    bool ok = sc_demuxer_recv_codec_id(demuxer, &raw_codec_id);
-    if (!ok) {
-        LOGE("Demuxer '%s': stream disabled due to connection error",
-             demuxer->name);
-        goto end;
+    if (new_codec_id != raw_codec_id) {
+        LOGE("Demuxer '%s': codec change not supported (0x%08" PRIx32
+             " -> 0x%08" PRIx32 ")", demuxer->name, raw_codec_id,
+             new_codec_id);
+        return false;
     }
 
-    if (raw_codec_id == 0) {
-        LOGW("Demuxer '%s': stream explicitly disabled by the device",
-             demuxer->name);
-        sc_packet_source_sinks_disable(&demuxer->packet_source);
-        status = SC_DEMUXER_STATUS_DISABLED;
-        goto end;
-    }
+    LOGI("Demuxer '%s': new session (%" PRIu32 "x%" PRIu32 ")", demuxer->name,
+         width, height);
 
-    if (raw_codec_id == 1) {
-        LOGE("Demuxer '%s': stream configuration error on the device",
-             demuxer->name);
-        goto end;
-    }
+    codec_ctx->width = width;
+    codec_ctx->height = height;
+
+    return sc_packet_source_sinks_session(&demuxer->packet_source, codec_ctx);
+}
+
+// Open the codec context and the sinks for the first stream
+static bool
+sc_demuxer_open_stream(struct sc_demuxer *demuxer, uint32_t raw_codec_id) {
+    assert(!demuxer->sinks_open);
 
     enum AVCodecID codec_id = sc_demuxer_to_avcodec_id(raw_codec_id);
     if (codec_id == AV_CODEC_ID_NONE) {
         LOGE("Demuxer '%s': stream disabled due to unsupported codec",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        return false;
     }
 
     const AVCodec *codec = avcodec_find_decoder(codec_id);
@@ -176,13 +204,13 @@ run_demuxer(void *data) {
         LOGE("Demuxer '%s': stream disabled due to missing decoder",
              demuxer->name);
         sc_packet_source_sinks_disable(&demuxer->packet_source);
-        goto end;
+        return false;
     }
 
     AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
     if (!codec_ctx) {
         LOG_OOM();
-        goto end;
+        return false;
     }
 
     codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
@@ -190,9 +218,9 @@ run_demuxer(void *data) {
     if (codec->type == AVMEDIA_TYPE_VIDEO) {
         uint32_t width;
         uint32_t height;
-        ok = sc_demuxer_recv_video_size(demuxer, &width, &height);
+        bool ok = sc_demuxer_recv_video_size(demuxer, &width, &height);
         if (!ok) {
-            goto finally_free_context;
+            goto error_free_context;
         }
 
         codec_ctx->width = width;
@@ -216,41 +244,193 @@ run_demuxer(void *data) {
 
     if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
         LOGE("Demuxer '%s': could not open codec", demuxer->name);
-        goto finally_free_context;
+        goto error_free_context;
     }
 
     if (!sc_packet_source_sinks_open(&demuxer->packet_source, codec_ctx)) {
-        goto finally_free_context;
+        goto error_free_context;
+    }
+
+    demuxer->codec_ctx = codec_ctx;
+    demuxer->raw_codec_id = raw_codec_id;
+    demuxer->sinks_open = true;
+
+    return true;
+
+error_free_context:
+    avcodec_free_context(&codec_ctx);
+
+    return false;
+}
+
+// Continue the stream on a new socket: the sinks are still open, the new
+// stream is a new session for them
+static bool
+sc_demuxer_resume_stream(struct sc_demuxer *demuxer, uint32_t raw_codec_id) {
+    assert(demuxer->sinks_open);
+
+    if (raw_codec_id != demuxer->raw_codec_id) {
+        LOGE("Demuxer '%s': codec change not supported on resume (0x%08"
+             PRIx32 " -> 0x%08" PRIx32 ")", demuxer->name,
+             demuxer->raw_codec_id, raw_codec_id);
+        return false;
+    }
+
+    AVCodecContext *codec_ctx = demuxer->codec_ctx;
+
+    if (codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        uint32_t width;
+        uint32_t height;
+        if (!sc_demuxer_recv_video_size(demuxer, &width, &height)) {
+            return false;
+        }
+
+        codec_ctx->width = width;
+        codec_ctx->height = height;
+    }
+
+    LOGI("Demuxer '%s': stream resumed", demuxer->name);
+
+    // The device restarts the PTS from its new capture origin
+    demuxer->pts_rebase = true;
+
+    return sc_packet_source_sinks_session(&demuxer->packet_source, codec_ctx);
+}
+
+static void
+sc_demuxer_close_sinks(struct sc_demuxer *demuxer) {
+    assert(demuxer->sinks_open);
+
+    sc_packet_source_sinks_close(&demuxer->packet_source);
+    avcodec_free_context(&demuxer->codec_ctx);
+    demuxer->sinks_open = false;
+}
+
+static void
+sc_demuxer_rebase_pts(struct sc_demuxer *demuxer, AVPacket *packet) {
+    assert(packet->pts != AV_NOPTS_VALUE);
+
+    if (demuxer->pts_rebase) {
+        // Continue the timeline of the previous stream, as if the gap was a
+        // period without any packet
+        sc_tick gap = sc_tick_now() - demuxer->eos_time;
+        demuxer->pts_offset =
+            demuxer->last_pts + SC_TICK_TO_US(gap) - packet->pts;
+        demuxer->pts_rebase = false;
+    }
+
+    packet->pts += demuxer->pts_offset;
+    packet->dts = packet->pts;
+    demuxer->last_pts = packet->pts;
+}
+
+static int
+run_demuxer(void *data) {
+    struct sc_demuxer *demuxer = data;
+
+    // Flag to report end-of-stream (i.e. device disconnected)
+    enum sc_demuxer_status status = SC_DEMUXER_STATUS_ERROR;
+
+    if (!sc_net_reader_init(&demuxer->reader, demuxer->socket)) {
+        goto end;
+    }
+
+    uint32_t raw_codec_id;
+    bool ok = sc_demuxer_recv_codec_id(demuxer, &raw_codec_id);
+    if (!ok) {
+        if (demuxer->sinks_open) {
+            // The connection has been lost again before the stream resumed
+            status = SC_DEMUXER_STATUS_EOS;
+            goto finally_destroy_reader;
+        }
+        LOGE("Demuxer '%s': stream disabled due to connection error",
+             demuxer->name);
+        goto finally_destroy_reader;
     }
 
+    if (raw_codec_id == 0) {
+        if (demuxer->sinks_open) {
+            LOGE("Demuxer '%s': stream disabled by the device on resume",
+                 demuxer->name);
+            goto finally_destroy_reader;
+        }
+        LOGW("Demuxer '%s': stream explicitly disabled by the device",
+             demuxer->name);
+        sc_packet_source_sinks_disable(&demuxer->packet_source);
+        status = SC_DEMUXER_STATUS_DISABLED;
+        goto finally_destroy_reader;
+    }
+
+    if (raw_codec_id == 1) {
+        LOGE("Demuxer '%s': stream configuration error on the device",
+             demuxer->name);
+        goto finally_destroy_reader;
+    }
+
+    ok = demuxer->sinks_open ? sc_demuxer_resume_stream(demuxer, raw_codec_id)
+                             : sc_demuxer_open_stream(demuxer, raw_codec_id);
+    if (!ok) {
+        goto finally_destroy_reader;
+    }
+
+    AVCodecContext *codec_ctx = demuxer->codec_ctx;
+
     // Config packets must be merged with the next non-config packet only for
     // H.26x
     bool must_merge_config_packet = raw_codec_id == SC_CODEC_ID_H264
                                  || raw_codec_id == SC_CODEC_ID_H265;
 
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        goto finally_destroy_reader;
+    }
+
     struct sc_packet_merger merger;
 
     if (must_merge_config_packet) {
         sc_packet_merger_init(&merger);
     }
 
-    AVPacket *packet = av_packet_alloc();
-    if (!packet) {
-        LOG_OOM();
-        goto finally_close_sinks;
-    }
+    bool is_video = codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO;
+    enum sc_metric packets_metric = is_video ? SC_METRIC_DEMUXER_VIDEO_PACKETS
+                                             : SC_METRIC_DEMUXER_AUDIO_PACKETS;
+    enum sc_metric bytes_metric = is_video ? SC_METRIC_DEMUXER_VIDEO_BYTES
+                                           : SC_METRIC_DEMUXER_AUDIO_BYTES;
 
     for (;;) {
-        bool ok = sc_demuxer_recv_packet(demuxer, packet);
+        bool session;
+        sc_trace_begin("demuxer recv");
+        bool ok = sc_demuxer_recv_packet(demuxer, packet, &session);
+        sc_trace_end("demuxer recv");
         if (!ok) {
             // end of stream
             status = SC_DEMUXER_STATUS_EOS;
             break;
         }
 
+        if (session) {
+            ok = sc_demuxer_handle_session(demuxer, codec_ctx, raw_codec_id,
+                                           packet);
+            av_packet_unref(packet);
+            if (!ok) {
+                break;
+            }
+            continue;
+        }
+
+        sc_metrics_add(packets_metric, 1);
+        sc_metrics_add(bytes_metric, packet->size);
+
+        if (packet->pts != AV_NOPTS_VALUE) {
+            sc_demuxer_rebase_pts(demuxer, packet);
+        }
+
         if (must_merge_config_packet) {
             // Prepend any config packet to the next media packet
+            sc_trace_begin("merge");
             ok = sc_packet_merger_merge(&merger, packet);
+            sc_trace_end("merge");
             if (!ok) {
                 av_packet_unref(packet);
                 break;
@@ -272,11 +452,18 @@ run_demuxer(void *data) {
     }
 
     av_packet_free(&packet);
-finally_close_sinks:
-    sc_packet_source_sinks_close(&demuxer->packet_source);
-finally_free_context:
-    avcodec_free_context(&codec_ctx);
+finally_destroy_reader:
+    sc_net_reader_destroy(&demuxer->reader);
 end:
+    if (demuxer->sinks_open) {
+        if (status == SC_DEMUXER_STATUS_EOS && demuxer->resumable) {
+            // Keep the sinks open, the stream may be resumed on a new socket
+            demuxer->eos_time = sc_tick_now();
+        } else {
+            sc_demuxer_close_sinks(demuxer);
+        }
+    }
+
     demuxer->cbs->on_ended(demuxer, status, demuxer->cbs_userdata);
 
     return 0;
@@ -291,17 +478,36 @@ sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
     demuxer->socket = socket;
     sc_packet_source_init(&demuxer->packet_source);
 
+    demuxer->resumable = false;
+    demuxer->sinks_open = false;
+    demuxer->codec_ctx = NULL;
+    demuxer->raw_codec_id = 0;
+    demuxer->pts_offset = 0;
+    demuxer->last_pts = 0;
+    demuxer->eos_time = 0;
+    demuxer->pts_rebase = false;
+
     assert(cbs && cbs->on_ended);
 
     demuxer->cbs = cbs;
     demuxer->cbs_userdata = cbs_userdata;
 }
 
+void
+sc_demuxer_set_resumable(struct sc_demuxer *demuxer, bool resumable) {
+    demuxer->resumable = resumable;
+}
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer) {
     LOGD("Demuxer '%s': starting thread", demuxer->name);
 
-    bool ok = sc_thread_create(&demuxer->thread, run_demuxer, "scrcpy-demuxer",
+    // "video-demuxer" or "audio-demuxer", to be able to apply a thread policy
+    // to each
+    char thread_name[16];
+    snprintf(thread_name, sizeof(thread_name), "%s-demuxer", demuxer->name);
+
+    bool ok = sc_thread_create(&demuxer->thread, run_demuxer, thread_name,
                                demuxer);
     if (!ok) {
         LOGE("Demuxer '%s': could not start thread", demuxer->name);
@@ -310,7 +516,28 @@ sc_demuxer_start(struct sc_demuxer *demuxer) {
     return true;
 }
 
+bool
+sc_demuxer_can_resume(const struct sc_demuxer *demuxer) {
+    return demuxer->resumable && demuxer->sinks_open;
+}
+
+bool
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket) {
+    assert(sc_demuxer_can_resume(demuxer));
+    assert(socket != SC_SOCKET_NONE);
+
+    demuxer->socket = socket;
+    return sc_demuxer_start(demuxer);
+}
+
 void
 sc_demuxer_join(struct sc_demuxer *demuxer) {
     sc_thread_join(&demuxer->thread, NULL);
 }
+
+void
+sc_demuxer_destroy(struct sc_demuxer *demuxer) {
+    if (demuxer->sinks_open) {
+        sc_demuxer_close_sinks(demuxer);
+    }
+}
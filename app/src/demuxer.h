@@ -4,10 +4,14 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
 
 #include "trait/packet_source.h"
 #include "util/net.h"
+#include "util/net_reader.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 struct sc_demuxer {
     struct sc_packet_source packet_source; // packet source trait
@@ -15,8 +19,24 @@ struct sc_demuxer {
     const char *name; // must be statically allocated (e.g. a string literal)
 
     sc_socket socket;
+    struct sc_net_reader reader; // initialized in the demuxer thread
     sc_thread thread;
 
+    // If set, the sinks are kept open on end-of-stream, so that the stream
+    // may be resumed on a new socket (see sc_demuxer_resume())
+    bool resumable;
+    bool sinks_open;
+    // Kept across resumed streams, since the sinks may reference it until
+    // they are closed
+    AVCodecContext *codec_ctx;
+    uint32_t raw_codec_id;
+
+    // The PTS restart on a resumed stream: an offset keeps them increasing
+    int64_t pts_offset;
+    int64_t last_pts;
+    sc_tick eos_time;
+    bool pts_rebase; // the offset must be computed on the next media packet
+
     const struct sc_demuxer_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -37,10 +57,31 @@ void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata);
 
+void
+sc_demuxer_set_resumable(struct sc_demuxer *demuxer, bool resumable);
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer);
 
+// Return true if the stream ended on end-of-stream with its sinks kept open
+// (the demuxer must be joined)
+bool
+sc_demuxer_can_resume(const struct sc_demuxer *demuxer);
+
+/**
+ * Restart a demuxer on a new socket, once it has been joined
+ *
+ * The sinks are not reopened: the new stream is a new session for them (the
+ * codec must not change).
+ */
+bool
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket);
+
 void
 sc_demuxer_join(struct sc_demuxer *demuxer);
 
+// Close the sinks left open by a resumable demuxer (it must be joined)
+void
+sc_demuxer_destroy(struct sc_demuxer *demuxer);
+
 #endif
@@ -1,12 +1,296 @@
 #include "events.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#ifndef _WIN32
+# include <fcntl.h>
+# include <limits.h>
+# include <signal.h>
+# include <string.h>
+# include <unistd.h>
+# define SC_EVENTS_HAS_INTERNAL_LOOP
+#endif
 
 #include "util/log.h"
 #include "util/thread.h"
 
+static bool sc_events_use_internal;
+
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+// The internal loop is a pipe: each event is written atomically (its size is
+// lower than PIPE_BUF), from any thread or from a signal handler, and read by
+// the main thread.
+//
+// Unlike a queue protected by a mutex, this is async-signal-safe, and the
+// capacity of the pipe buffer bounds the number of pending events (like the
+// SDL event queue).
+struct sc_internal_event {
+    uint32_t type;
+    sc_runnable_fn run;
+    void *userdata;
+};
+
+static_assert(sizeof(struct sc_internal_event) <= PIPE_BUF,
+              "Internal events must be written atomically");
+
+static int sc_event_pipe[2] = {-1, -1};
+
+// Protect the runnables rejection, so that no runnable may be posted once
+// sc_reject_new_runnables() returns (the signal handler never posts runnables)
+static sc_mutex sc_event_runnables_mutex;
+static bool sc_event_reject_runnables; // protected by the mutex
+
+static struct sigaction sc_events_old_sigint;
+static struct sigaction sc_events_old_sigterm;
+
+static bool
+sc_internal_push(const struct sc_internal_event *ie) {
+    ssize_t w = write(sc_event_pipe[1], ie, sizeof(*ie));
+    // A write of at most PIPE_BUF bytes is never partial
+    assert(w == -1 || w == sizeof(*ie));
+    return w == sizeof(*ie);
+}
+
+static void
+sc_events_on_signal(int sig) {
+    (void) sig;
+
+    int saved_errno = errno;
+    struct sc_internal_event ie = {
+        .type = SC_EVENT_QUIT,
+    };
+    // Nothing to do on error, it is not possible to log from here
+    (void) sc_internal_push(&ie);
+    errno = saved_errno;
+}
+
+static bool
+sc_internal_init(void) {
+    if (pipe(sc_event_pipe)) {
+        LOGE("Could not create event pipe: %s", strerror(errno));
+        return false;
+    }
+
+    // Never block the producers if the pipe is full (the event is rejected,
+    // like when the SDL event queue is full)
+    int flags = fcntl(sc_event_pipe[1], F_GETFL);
+    if (flags == -1
+            || fcntl(sc_event_pipe[1], F_SETFL, flags | O_NONBLOCK) == -1) {
+        LOGE("Could not configure event pipe: %s", strerror(errno));
+        goto error_close_pipe;
+    }
+
+    if (!sc_mutex_init(&sc_event_runnables_mutex)) {
+        goto error_close_pipe;
+    }
+
+    sc_event_reject_runnables = false;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sc_events_on_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGINT, &sa, &sc_events_old_sigint)) {
+        LOGE("Could not set SIGINT handler");
+        goto error_destroy_mutex;
+    }
+    if (sigaction(SIGTERM, &sa, &sc_events_old_sigterm)) {
+        LOGE("Could not set SIGTERM handler");
+        sigaction(SIGINT, &sc_events_old_sigint, NULL);
+        goto error_destroy_mutex;
+    }
+
+    return true;
+
+error_destroy_mutex:
+    sc_mutex_destroy(&sc_event_runnables_mutex);
+error_close_pipe:
+    close(sc_event_pipe[0]);
+    close(sc_event_pipe[1]);
+    sc_event_pipe[0] = -1;
+    sc_event_pipe[1] = -1;
+
+    return false;
+}
+
+static void
+sc_internal_destroy(void) {
+    sigaction(SIGINT, &sc_events_old_sigint, NULL);
+    sigaction(SIGTERM, &sc_events_old_sigterm, NULL);
+
+    sc_mutex_destroy(&sc_event_runnables_mutex);
+    close(sc_event_pipe[0]);
+    close(sc_event_pipe[1]);
+    sc_event_pipe[0] = -1;
+    sc_event_pipe[1] = -1;
+}
+
+static void
+sc_internal_to_event(const struct sc_internal_event *ie,
+                     struct sc_event *event) {
+    event->type = ie->type;
+    event->run = ie->run;
+    event->userdata = ie->userdata;
+}
+
+static bool
+sc_internal_wait(struct sc_event *event) {
+    struct sc_internal_event ie;
+    ssize_t r;
+    do {
+        r = read(sc_event_pipe[0], &ie, sizeof(ie));
+    } while (r == -1 && errno == EINTR);
+
+    if (r != sizeof(ie)) {
+        // Events are written atomically, so they are never read partially
+        assert(r == -1);
+        LOGE("Could not read event: %s", strerror(errno));
+        return false;
+    }
+
+    sc_internal_to_event(&ie, event);
+    return true;
+}
+
+static bool
+sc_internal_poll(struct sc_event *event) {
+    // Only called on exit: do not keep the read end non-blocking
+    int flags = fcntl(sc_event_pipe[0], F_GETFL);
+    if (flags == -1
+            || fcntl(sc_event_pipe[0], F_SETFL, flags | O_NONBLOCK) == -1) {
+        return false;
+    }
+
+    struct sc_internal_event ie;
+    ssize_t r;
+    do {
+        r = read(sc_event_pipe[0], &ie, sizeof(ie));
+    } while (r == -1 && errno == EINTR);
+
+    fcntl(sc_event_pipe[0], F_SETFL, flags);
+
+    if (r != sizeof(ie)) {
+        // EAGAIN: no pending event
+        assert(r == -1);
+        return false;
+    }
+
+    sc_internal_to_event(&ie, event);
+    return true;
+}
+#endif
+
+bool
+sc_events_init(bool internal) {
+#ifndef HAVE_SDL
+    assert(internal);
+#endif
+
+    sc_events_use_internal = internal;
+
+    if (internal) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+        return sc_internal_init();
+#else
+        LOGE("The internal event loop is not supported on this platform");
+        return false;
+#endif
+    }
+
+#ifdef HAVE_SDL
+    // Minimal SDL initialization
+    if (SDL_Init(SDL_INIT_EVENTS)) {
+        LOGE("Could not initialize SDL: %s", SDL_GetError());
+        return false;
+    }
+
+    atexit(SDL_Quit);
+#endif
+
+    return true;
+}
+
+void
+sc_events_destroy(void) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        sc_internal_destroy();
+    }
+#endif
+    // With SDL, SDL_Quit() is called on exit
+}
+
+bool
+sc_events_internal(void) {
+    return sc_events_use_internal;
+}
+
+bool
+sc_wait_event(struct sc_event *event) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        return sc_internal_wait(event);
+    }
+#endif
+
+#ifdef HAVE_SDL
+    if (!SDL_WaitEvent(&event->sdl)) {
+        LOGE("SDL_WaitEvent() error: %s", SDL_GetError());
+        return false;
+    }
+
+    event->type = event->sdl.type;
+    event->run = event->sdl.user.data1;
+    event->userdata = event->sdl.user.data2;
+    return true;
+#else
+    assert(!"unreachable");
+    return false;
+#endif
+}
+
+bool
+sc_poll_event(struct sc_event *event) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        return sc_internal_poll(event);
+    }
+#endif
+
+#ifdef HAVE_SDL
+    if (!SDL_PollEvent(&event->sdl)) {
+        return false;
+    }
+
+    event->type = event->sdl.type;
+    event->run = event->sdl.user.data1;
+    event->userdata = event->sdl.user.data2;
+    return true;
+#else
+    assert(!"unreachable");
+    return false;
+#endif
+}
+
 bool
 sc_push_event_impl(uint32_t type, const char *name) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        struct sc_internal_event ie = {
+            .type = type,
+        };
+        if (!sc_internal_push(&ie)) {
+            LOGE("Could not post %s event: %s", name, strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+#endif
+
+#ifdef HAVE_SDL
     SDL_Event event;
     event.type = type;
     int ret = SDL_PushEvent(&event);
@@ -19,10 +303,45 @@ sc_push_event_impl(uint32_t type, const char *name) {
     }
 
     return true;
+#else
+    (void) type;
+    (void) name;
+    assert(!"unreachable");
+    return false;
+#endif
 }
 
 bool
 sc_post_to_main_thread(sc_runnable_fn run, void *userdata) {
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        sc_mutex_lock(&sc_event_runnables_mutex);
+        if (sc_event_reject_runnables) {
+            sc_mutex_unlock(&sc_event_runnables_mutex);
+            // this is expected on exit, log in debug mode
+            LOGD("Could not post runnable to main thread (rejected)");
+            return false;
+        }
+
+        struct sc_internal_event ie = {
+            .type = SC_EVENT_RUN_ON_MAIN_THREAD,
+            .run = run,
+            .userdata = userdata,
+        };
+        bool ok = sc_internal_push(&ie);
+        int err = errno;
+        sc_mutex_unlock(&sc_event_runnables_mutex);
+
+        if (!ok) {
+            LOGW("Could not post runnable to main thread: %s", strerror(err));
+            return false;
+        }
+
+        return true;
+    }
+#endif
+
+#ifdef HAVE_SDL
     SDL_Event event = {
         .user = {
             .type = SC_EVENT_RUN_ON_MAIN_THREAD,
@@ -46,8 +365,15 @@ sc_post_to_main_thread(sc_runnable_fn run, void *userdata) {
     }
 
     return true;
+#else
+    (void) run;
+    (void) userdata;
+    assert(!"unreachable");
+    return false;
+#endif
 }
 
+#ifdef HAVE_SDL
 static int SDLCALL
 task_event_filter(void *userdata, SDL_Event *event) {
     (void) userdata;
@@ -59,10 +385,23 @@ task_event_filter(void *userdata, SDL_Event *event) {
 
     return 1;
 }
+#endif
 
 void
 sc_reject_new_runnables(void) {
     assert(sc_thread_get_id() == SC_MAIN_THREAD_ID);
 
+#ifdef SC_EVENTS_HAS_INTERNAL_LOOP
+    if (sc_events_use_internal) {
+        // The runnables already in the pipe are still run by the caller
+        sc_mutex_lock(&sc_event_runnables_mutex);
+        sc_event_reject_runnables = true;
+        sc_mutex_unlock(&sc_event_runnables_mutex);
+        return;
+    }
+#endif
+
+#ifdef HAVE_SDL
     SDL_SetEventFilter(task_event_filter, NULL);
+#endif
 }
@@ -5,10 +5,20 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <SDL2/SDL_events.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL_events.h>
+#endif
+
+#ifdef HAVE_SDL
+# define SC_EVENT_QUIT SDL_QUIT
+# define SC_EVENT_USER_FIRST SDL_USEREVENT
+#else
+# define SC_EVENT_QUIT 0x100 // same value as SDL_QUIT
+# define SC_EVENT_USER_FIRST 0x8000 // same value as SDL_USEREVENT
+#endif
 
 enum {
-    SC_EVENT_NEW_FRAME = SDL_USEREVENT,
+    SC_EVENT_NEW_FRAME = SC_EVENT_USER_FIRST,
     SC_EVENT_RUN_ON_MAIN_THREAD,
     SC_EVENT_DEVICE_DISCONNECTED,
     SC_EVENT_SERVER_CONNECTION_FAILED,
@@ -20,15 +30,56 @@ enum {
     SC_EVENT_TIME_LIMIT_REACHED,
     SC_EVENT_CONTROLLER_ERROR,
     SC_EVENT_AOA_OPEN_ERROR,
+    SC_EVENT_LATENCY_TEST_COMPLETED,
+    SC_EVENT_LATENCY_TEST_ERROR,
+};
+
+typedef void (*sc_runnable_fn)(void *userdata);
+
+struct sc_event {
+    uint32_t type;
+    // For SC_EVENT_RUN_ON_MAIN_THREAD
+    sc_runnable_fn run;
+    void *userdata;
+#ifdef HAVE_SDL
+    // The original event, for the SDL event loop only
+    SDL_Event sdl;
+#endif
 };
 
+/**
+ * Initialize the event loop of the main thread
+ *
+ * If internal is true, the events are dispatched by a lightweight internal
+ * loop instead of SDL (SDL must then not be initialized at all). Without SDL,
+ * internal must be true.
+ *
+ * The internal loop also converts SIGINT and SIGTERM to SC_EVENT_QUIT (like
+ * SDL does).
+ */
+bool
+sc_events_init(bool internal);
+
+void
+sc_events_destroy(void);
+
+// Return true if the events are dispatched by the internal loop
+bool
+sc_events_internal(void);
+
+// Wait for the next event (return false on error)
+bool
+sc_wait_event(struct sc_event *event);
+
+// Return false if there is no pending event
+bool
+sc_poll_event(struct sc_event *event);
+
 bool
 sc_push_event_impl(uint32_t type, const char *name);
 
 #define sc_push_event(TYPE) sc_push_event_impl(TYPE, # TYPE)
 
-typedef void (*sc_runnable_fn)(void *userdata);
-
 bool
 sc_post_to_main_thread(sc_runnable_fn run, void *userdata);
 
@@ -0,0 +1,597 @@
+#include "fmp4_server.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+
+#include "metrics.h"
+#include "rtp.h"
+#include "util/log.h"
+#include "util/str.h"
+#include "util/strbuf.h"
+
+/** Downcast recorder to fmp4 server */
+#define DOWNCAST(RECORDER) \
+    container_of(RECORDER, struct sc_fmp4_server, recorder)
+
+#define SC_FMP4_STREAM_PATH "/stream.mp4"
+
+// Minimal Media Source Extensions player, staying close to the live edge
+static const char SC_FMP4_PLAYER_HTML[] =
+    "<!DOCTYPE html>\n"
+    "<html>\n"
+    "<head>\n"
+    "<meta charset=\"utf-8\">\n"
+    "<title>scrcpy</title>\n"
+    "<style>\n"
+    "body { margin: 0; background: #000; }\n"
+    "video { width: 100vw; height: 100vh; }\n"
+    "</style>\n"
+    "</head>\n"
+    "<body>\n"
+    "<video id=\"video\" autoplay muted playsinline controls></video>\n"
+    "<script>\n"
+    "const mime = '%s';\n"
+    "const video = document.getElementById('video');\n"
+    "if (!window.MediaSource || !MediaSource.isTypeSupported(mime)) {\n"
+    "    document.body.style.color = '#fff';\n"
+    "    document.body.textContent = 'Unsupported stream: ' + mime;\n"
+    "} else {\n"
+    "    const ms = new MediaSource();\n"
+    "    video.src = URL.createObjectURL(ms);\n"
+    "    ms.addEventListener('sourceopen', async () => {\n"
+    "        const sb = ms.addSourceBuffer(mime);\n"
+    "        const queue = [];\n"
+    "        const next = () => {\n"
+    "            if (sb.updating) return;\n"
+    "            const b = sb.buffered;\n"
+    "            if (b.length && video.currentTime - b.start(0) > 30) {\n"
+    "                sb.remove(0, video.currentTime - 10);\n"
+    "            } else if (queue.length) {\n"
+    "                sb.appendBuffer(queue.shift());\n"
+    "            }\n"
+    "            if (b.length && b.end(b.length - 1) - video.currentTime > 1)"
+            " {\n"
+    "                video.currentTime = b.end(b.length - 1) - 0.1;\n"
+    "            }\n"
+    "        };\n"
+    "        sb.addEventListener('updateend', next);\n"
+    "        const res = await fetch('" SC_FMP4_STREAM_PATH "');\n"
+    "        const reader = res.body.getReader();\n"
+    "        for (;;) {\n"
+    "            const { done, value } = await reader.read();\n"
+    "            if (done) break;\n"
+    "            queue.push(value);\n"
+    "            next();\n"
+    "        }\n"
+    "    });\n"
+    "}\n"
+    "</script>\n"
+    "</body>\n"
+    "</html>\n";
+
+static struct sc_fmp4_fragment *
+sc_fmp4_fragment_new(const uint8_t *data, size_t len) {
+    struct sc_fmp4_fragment *fragment = malloc(sizeof(*fragment) + len);
+    if (!fragment) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    fragment->refs = 1;
+    fragment->len = len;
+    memcpy(fragment->data, data, len);
+    return fragment;
+}
+
+// Must be called with the server mutex locked
+static void
+sc_fmp4_fragment_unref(struct sc_fmp4_fragment *fragment) {
+    assert(fragment->refs);
+    if (!--fragment->refs) {
+        free(fragment);
+    }
+}
+
+// Must be called with the server mutex locked
+static void
+sc_fmp4_server_clear_gop(struct sc_fmp4_server *server) {
+    for (size_t i = 0; i < server->gop.size; ++i) {
+        sc_fmp4_fragment_unref(server->gop.data[i]);
+    }
+    server->gop_first_seq += server->gop.size;
+    sc_vector_clear(&server->gop);
+}
+
+static bool
+sc_fmp4_append_h264_codec(struct sc_strbuf *buf, const uint8_t *data,
+                          size_t len) {
+    const uint8_t *end = data + len;
+    size_t nal_len;
+    const uint8_t *nal;
+    while ((nal = sc_rtp_next_nal(&data, end, &nal_len))) {
+        if ((nal[0] & 0x1f) == 7 && nal_len >= 4) {
+            // SPS: profile_idc, constraint flags, level_idc
+            char codec[16];
+            snprintf(codec, sizeof(codec), "avc1.%02X%02X%02X", nal[1],
+                     nal[2], nal[3]);
+            return sc_strbuf_append_str(buf, codec);
+        }
+    }
+
+    return sc_strbuf_append_staticstr(buf, "avc1");
+}
+
+static bool
+sc_fmp4_append_h265_codec(struct sc_strbuf *buf, const uint8_t *data,
+                          size_t len) {
+    const uint8_t *end = data + len;
+    size_t nal_len;
+    const uint8_t *nal;
+    while ((nal = sc_rtp_next_nal(&data, end, &nal_len))) {
+        if (((nal[0] >> 1) & 0x3f) != 33) {
+            continue;
+        }
+
+        // SPS: read the profile_tier_level() bytes (after the 2-byte NAL unit
+        // header and the first byte), removing emulation prevention bytes
+        uint8_t ptl[12];
+        size_t n = 0;
+        unsigned zeros = 0;
+        for (size_t i = 3; i < nal_len && n < sizeof(ptl); ++i) {
+            if (zeros == 2 && nal[i] == 3) {
+                zeros = 0;
+                continue;
+            }
+            zeros = nal[i] ? 0 : zeros + 1;
+            ptl[n++] = nal[i];
+        }
+
+        if (n < sizeof(ptl)) {
+            break;
+        }
+
+        uint8_t profile_space = ptl[0] >> 6;
+        bool tier = ptl[0] & 0x20;
+        uint8_t profile_idc = ptl[0] & 0x1f;
+        // The compatibility flags are written in reverse bit order
+        uint32_t flags = ((uint32_t) ptl[1] << 24) | ((uint32_t) ptl[2] << 16)
+                       | ((uint32_t) ptl[3] << 8) | ptl[4];
+        uint32_t reversed = 0;
+        for (unsigned i = 0; i < 32; ++i) {
+            reversed |= ((flags >> i) & 1) << (31 - i);
+        }
+        uint8_t level_idc = ptl[11];
+
+        static const char *const profile_spaces[] = {"", "A", "B", "C"};
+        char codec[64];
+        int w = snprintf(codec, sizeof(codec), "hev1.%s%u.%" PRIX32 ".%c%u",
+                         profile_spaces[profile_space], profile_idc, reversed,
+                         tier ? 'H' : 'L', level_idc);
+
+        // Constraint flags bytes, trailing zero bytes omitted
+        unsigned constraints = 6;
+        while (constraints && !ptl[4 + constraints]) {
+            --constraints;
+        }
+        for (unsigned i = 0; i < constraints; ++i) {
+            w += snprintf(codec + w, sizeof(codec) - w, ".%02X", ptl[5 + i]);
+        }
+
+        return sc_strbuf_append_str(buf, codec);
+    }
+
+    return sc_strbuf_append_staticstr(buf, "hev1");
+}
+
+static bool
+sc_fmp4_append_codec(struct sc_strbuf *buf, const AVCodecParameters *par) {
+    switch (par->codec_id) {
+        case AV_CODEC_ID_H264:
+            return sc_fmp4_append_h264_codec(buf, par->extradata,
+                                             par->extradata_size);
+        case AV_CODEC_ID_HEVC:
+            return sc_fmp4_append_h265_codec(buf, par->extradata,
+                                             par->extradata_size);
+        case AV_CODEC_ID_AV1:
+            // Would require to parse the sequence header OBU
+            return sc_strbuf_append_staticstr(buf, "av01");
+        case AV_CODEC_ID_OPUS:
+            return sc_strbuf_append_staticstr(buf, "opus");
+        case AV_CODEC_ID_AAC:
+            return sc_strbuf_append_staticstr(buf, "mp4a.40.2");
+        case AV_CODEC_ID_FLAC:
+            return sc_strbuf_append_staticstr(buf, "flac");
+        default:
+            LOGW("fMP4: unknown MIME codec for %s",
+                 avcodec_get_name(par->codec_id));
+            return true;
+    }
+}
+
+// Called from the recorder thread
+static void
+sc_fmp4_server_build_mime_type(struct sc_fmp4_server *server) {
+    struct sc_recorder *recorder = &server->recorder;
+
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 64)) {
+        LOG_OOM();
+        return;
+    }
+
+    int indexes[] = {
+        recorder->video ? recorder->video_stream.index : -1,
+        recorder->audio ? recorder->audio_stream.index : -1,
+    };
+
+    bool ok = sc_strbuf_append_str(&buf, indexes[0] >= 0 ? "video/mp4"
+                                                          : "audio/mp4")
+           && sc_strbuf_append_staticstr(&buf, "; codecs=\"");
+    bool first = true;
+    for (unsigned i = 0; ok && i < ARRAY_LEN(indexes); ++i) {
+        if (indexes[i] < 0) {
+            continue;
+        }
+
+        AVStream *stream = recorder->ctx->streams[indexes[i]];
+        ok = (first || sc_strbuf_append_staticstr(&buf, ", "))
+          && sc_fmp4_append_codec(&buf, stream->codecpar);
+        first = false;
+    }
+    ok = ok && sc_strbuf_append_char(&buf, '"');
+
+    if (!ok) {
+        LOG_OOM();
+        free(buf.s);
+        return;
+    }
+
+    sc_mutex_lock(&server->mutex);
+    sc_strncpy(server->mime_type, buf.s, sizeof(server->mime_type));
+    sc_mutex_unlock(&server->mutex);
+
+    LOGI("fMP4: %s", buf.s);
+    free(buf.s);
+}
+
+static bool
+sc_fmp4_server_on_init_segment(struct sc_recorder *recorder,
+                               const uint8_t *data, size_t len,
+                               void *userdata) {
+    (void) userdata;
+    struct sc_fmp4_server *server = DOWNCAST(recorder);
+
+    sc_fmp4_server_build_mime_type(server);
+
+    struct sc_fmp4_fragment *init = sc_fmp4_fragment_new(data, len);
+    if (!init) {
+        return false;
+    }
+
+    sc_mutex_lock(&server->mutex);
+    if (server->init_segment) {
+        // New segment (the video size changed): the previous fragments could
+        // not be played with the new init segment
+        sc_fmp4_fragment_unref(server->init_segment);
+        sc_fmp4_server_clear_gop(server);
+    }
+    server->init_segment = init;
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+
+    return true;
+}
+
+static bool
+sc_fmp4_server_on_fragment(struct sc_recorder *recorder, const uint8_t *data,
+                           size_t len, bool key_frame, void *userdata) {
+    (void) userdata;
+    struct sc_fmp4_server *server = DOWNCAST(recorder);
+
+    struct sc_fmp4_fragment *fragment = sc_fmp4_fragment_new(data, len);
+    if (!fragment) {
+        return false;
+    }
+
+    sc_mutex_lock(&server->mutex);
+
+    if (key_frame) {
+        // New clients will start from this fragment
+        sc_fmp4_server_clear_gop(server);
+    }
+
+    bool ok = sc_vector_push(&server->gop, fragment);
+    if (!ok) {
+        LOG_OOM();
+        sc_fmp4_fragment_unref(fragment);
+        sc_mutex_unlock(&server->mutex);
+        return false;
+    }
+
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+
+    return true;
+}
+
+static void
+sc_fmp4_server_on_recorder_ended(struct sc_recorder *recorder, bool success,
+                                 void *userdata) {
+    (void) success;
+    (void) userdata;
+    struct sc_fmp4_server *server = DOWNCAST(recorder);
+
+    sc_mutex_lock(&server->mutex);
+    server->ended = true;
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+}
+
+static bool
+sc_fmp4_send_chunk(sc_socket socket, const uint8_t *data, size_t len) {
+    char header[32];
+    int n = snprintf(header, sizeof(header), "%" SC_PRIsizet "x\r\n", len);
+    assert(n > 0 && (size_t) n < sizeof(header));
+    return sc_http_send(socket, header, n)
+        && sc_http_send(socket, data, len)
+        && sc_http_send(socket, "\r\n", 2);
+}
+
+// Wait for the init segment, and return a reference to it (or NULL if the
+// server is stopped)
+static struct sc_fmp4_fragment *
+sc_fmp4_server_wait_init_segment(struct sc_fmp4_server *server,
+                                 uint64_t *seq) {
+    sc_mutex_lock(&server->mutex);
+    while (!server->stopped && !server->ended && !server->init_segment) {
+        sc_cond_wait(&server->cond, &server->mutex);
+    }
+
+    struct sc_fmp4_fragment *init = NULL;
+    if (!server->stopped && server->init_segment) {
+        init = server->init_segment;
+        ++init->refs;
+        *seq = server->gop_first_seq;
+    }
+    sc_mutex_unlock(&server->mutex);
+
+    return init;
+}
+
+static void
+sc_fmp4_server_serve_player(struct sc_fmp4_server *server, sc_socket socket) {
+    uint64_t seq;
+    struct sc_fmp4_fragment *init =
+        sc_fmp4_server_wait_init_segment(server, &seq);
+    if (!init) {
+        return;
+    }
+
+    char page[sizeof(SC_FMP4_PLAYER_HTML) + sizeof(server->mime_type)];
+    sc_mutex_lock(&server->mutex);
+    snprintf(page, sizeof(page), SC_FMP4_PLAYER_HTML, server->mime_type);
+    sc_fmp4_fragment_unref(init);
+    sc_mutex_unlock(&server->mutex);
+
+    sc_http_send_response(socket, "200 OK", "text/html; charset=utf-8", page,
+                          strlen(page));
+}
+
+static void
+sc_fmp4_server_serve_stream(struct sc_fmp4_server *server, sc_socket socket) {
+    uint64_t seq;
+    struct sc_fmp4_fragment *init =
+        sc_fmp4_server_wait_init_segment(server, &seq);
+    if (!init) {
+        return;
+    }
+
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: video/mp4\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    bool ok = sc_http_send(socket, header, sizeof(header) - 1)
+           && sc_fmp4_send_chunk(socket, init->data, init->len);
+
+    LOGI("fMP4: client started streaming");
+    sc_metrics_add(SC_METRIC_FMP4_CLIENTS, 1);
+
+    while (ok) {
+        sc_mutex_lock(&server->mutex);
+        while (!server->stopped && !server->ended
+                && seq >= server->gop_first_seq + server->gop.size) {
+            sc_cond_wait(&server->cond, &server->mutex);
+        }
+
+        if (server->stopped) {
+            sc_mutex_unlock(&server->mutex);
+            break;
+        }
+
+        if (server->init_segment != init) {
+            // A new segment started, MSE accepts a new init segment in the
+            // same stream
+            sc_fmp4_fragment_unref(init);
+            init = server->init_segment;
+            ++init->refs;
+            if (seq < server->gop_first_seq) {
+                seq = server->gop_first_seq;
+            }
+            sc_mutex_unlock(&server->mutex);
+
+            ok = sc_fmp4_send_chunk(socket, init->data, init->len);
+            continue;
+        }
+
+        if (seq >= server->gop_first_seq + server->gop.size) {
+            assert(server->ended);
+            sc_mutex_unlock(&server->mutex);
+            // Last chunk
+            sc_http_send(socket, "0\r\n\r\n", 5);
+            break;
+        }
+
+        if (seq < server->gop_first_seq) {
+            // The client is too slow, skip to the last key frame
+            LOGD("fMP4: client too slow, %" PRIu64 " fragments skipped",
+                 server->gop_first_seq - seq);
+            seq = server->gop_first_seq;
+        }
+
+        struct sc_fmp4_fragment *fragment =
+            server->gop.data[seq - server->gop_first_seq];
+        ++fragment->refs;
+        sc_mutex_unlock(&server->mutex);
+
+        ok = sc_fmp4_send_chunk(socket, fragment->data, fragment->len);
+
+        sc_mutex_lock(&server->mutex);
+        sc_fmp4_fragment_unref(fragment);
+        sc_mutex_unlock(&server->mutex);
+
+        ++seq;
+    }
+
+    sc_mutex_lock(&server->mutex);
+    sc_fmp4_fragment_unref(init);
+    sc_mutex_unlock(&server->mutex);
+
+    sc_metrics_add(SC_METRIC_FMP4_CLIENTS, -1);
+}
+
+static void
+sc_fmp4_server_on_request(struct sc_http_server *http, sc_socket socket,
+                          const char *path, void *userdata) {
+    (void) http;
+    struct sc_fmp4_server *server = userdata;
+
+    if (!strcmp(path, "/") || !strcmp(path, "/index.html")) {
+        sc_fmp4_server_serve_player(server, socket);
+    } else if (!strcmp(path, SC_FMP4_STREAM_PATH)) {
+        sc_fmp4_server_serve_stream(server, socket);
+    } else {
+        static const char body[] = "Not Found\n";
+        sc_http_send_response(socket, "404 Not Found", "text/plain", body,
+                              sizeof(body) - 1);
+    }
+}
+
+bool
+sc_fmp4_server_init(struct sc_fmp4_server *server, uint16_t port, bool video,
+                    bool audio) {
+    static const struct sc_recorder_callbacks recorder_cbs = {
+        .on_ended = sc_fmp4_server_on_recorder_ended,
+        .on_init_segment = sc_fmp4_server_on_init_segment,
+        .on_fragment = sc_fmp4_server_on_fragment,
+    };
+
+    // A NULL filename means in-memory fragmented MP4
+    bool ok = sc_recorder_init(&server->recorder, NULL, SC_RECORD_FORMAT_MP4,
+                               video, audio, SC_ORIENTATION_0, &recorder_cbs,
+                               NULL);
+    if (!ok) {
+        return false;
+    }
+
+    const struct sc_http_server_params params = {
+        .name = "fMP4",
+        .thread_name = "fmp4-server",
+        .client_thread_name = "fmp4-client",
+        .port = port,
+        .max_clients = SC_HTTP_SERVER_MAX_CLIENTS,
+    };
+
+    static const struct sc_http_server_callbacks http_cbs = {
+        .on_request = sc_fmp4_server_on_request,
+    };
+
+    ok = sc_http_server_init(&server->http, &params, &http_cbs, server);
+    if (!ok) {
+        goto error_destroy_recorder;
+    }
+
+    ok = sc_mutex_init(&server->mutex);
+    if (!ok) {
+        goto error_destroy_http;
+    }
+
+    ok = sc_cond_init(&server->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    server->stopped = false;
+    server->ended = false;
+    server->init_segment = NULL;
+    server->mime_type[0] = '\0';
+    sc_vector_init(&server->gop);
+    server->gop_first_seq = 0;
+
+    return true;
+
+error_mutex_destroy:
+    sc_mutex_destroy(&server->mutex);
+error_destroy_http:
+    sc_http_server_destroy(&server->http);
+error_destroy_recorder:
+    sc_recorder_destroy(&server->recorder);
+
+    return false;
+}
+
+bool
+sc_fmp4_server_start(struct sc_fmp4_server *server) {
+    if (!sc_recorder_start(&server->recorder)) {
+        return false;
+    }
+
+    if (!sc_http_server_start(&server->http)) {
+        sc_recorder_stop(&server->recorder);
+        sc_recorder_join(&server->recorder);
+        return false;
+    }
+
+    LOGI("fMP4 server listening on http://127.0.0.1:%" PRIu16 "/",
+         server->http.params.port);
+    return true;
+}
+
+void
+sc_fmp4_server_stop(struct sc_fmp4_server *server) {
+    sc_recorder_stop(&server->recorder);
+
+    sc_mutex_lock(&server->mutex);
+    server->stopped = true;
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+
+    sc_http_server_stop(&server->http);
+}
+
+void
+sc_fmp4_server_join(struct sc_fmp4_server *server) {
+    sc_http_server_join(&server->http);
+    sc_recorder_join(&server->recorder);
+}
+
+void
+sc_fmp4_server_destroy(struct sc_fmp4_server *server) {
+    sc_fmp4_server_clear_gop(server);
+    sc_vector_destroy(&server->gop);
+    if (server->init_segment) {
+        sc_fmp4_fragment_unref(server->init_segment);
+    }
+
+    sc_cond_destroy(&server->cond);
+    sc_mutex_destroy(&server->mutex);
+    sc_http_server_destroy(&server->http);
+    sc_recorder_destroy(&server->recorder);
+}
@@ -0,0 +1,74 @@
+#ifndef SC_FMP4_SERVER_H
+#define SC_FMP4_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "recorder.h"
+#include "util/http_server.h"
+#include "util/thread.h"
+#include "util/vector.h"
+
+/**
+ * Muxed data (init segment or fragment), shared by all the clients
+ */
+struct sc_fmp4_fragment {
+    unsigned refs; // protected by the server mutex
+    size_t len;
+    uint8_t data[];
+};
+
+struct sc_fmp4_fragment_vec SC_VECTOR(struct sc_fmp4_fragment *);
+
+/**
+ * HTTP server streaming the video and audio as fragmented MP4, playable by a
+ * browser via Media Source Extensions.
+ *
+ * The streams are muxed once by a recorder (writing in memory), and the
+ * resulting fragments are shared by all the clients.
+ */
+struct sc_fmp4_server {
+    // The packet sinks to register are recorder.video_packet_sink and
+    // recorder.audio_packet_sink
+    struct sc_recorder recorder;
+
+    struct sc_http_server http;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+    // Set once the recorder has ended (no more fragments)
+    bool ended;
+
+    // NULL until available, replaced when a new segment starts (when the
+    // video size changes)
+    struct sc_fmp4_fragment *init_segment;
+    // MIME type with codecs, for MediaSource.addSourceBuffer()
+    char mime_type[128];
+
+    // Fragments since the last key frame, so that a new client can start
+    // playing immediately
+    struct sc_fmp4_fragment_vec gop;
+    // Sequence number of gop.data[0]
+    uint64_t gop_first_seq;
+};
+
+bool
+sc_fmp4_server_init(struct sc_fmp4_server *server, uint16_t port, bool video,
+                    bool audio);
+
+bool
+sc_fmp4_server_start(struct sc_fmp4_server *server);
+
+void
+sc_fmp4_server_stop(struct sc_fmp4_server *server);
+
+void
+sc_fmp4_server_join(struct sc_fmp4_server *server);
+
+void
+sc_fmp4_server_destroy(struct sc_fmp4_server *server);
+
+#endif
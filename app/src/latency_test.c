@@ -0,0 +1,414 @@
+#include "latency_test.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavutil/pixdesc.h>
+
+#include "control_msg.h"
+#include "util/latency_stats.h"
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_latency_test */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_latency_test, frame_sink)
+
+// Minimal change of the mean luma of the region to detect the event
+#define SC_LATENCY_TEST_THRESHOLD 32
+
+// Delay between the detection and the next injection, to let the device
+// settle, plus a random part, so that the injections are not in phase with
+// the device frames
+#define SC_LATENCY_TEST_INTERVAL SC_TICK_FROM_MS(200)
+#define SC_LATENCY_TEST_INTERVAL_JITTER_MS 100
+
+// An event is considered lost if the region does not change within this delay
+#define SC_LATENCY_TEST_TIMEOUT SC_TICK_FROM_SEC(2)
+
+#define SC_LATENCY_TEST_HISTOGRAM_BUCKETS 10
+#define SC_LATENCY_TEST_HISTOGRAM_WIDTH 40
+
+// Return false if the region is empty once clipped to the frame
+static bool
+sc_latency_test_get_region(const struct sc_latency_test *test,
+                           unsigned frame_width, unsigned frame_height,
+                           unsigned *x, unsigned *y, unsigned *width,
+                           unsigned *height) {
+    unsigned rx, ry, rw, rh;
+    if (test->region.width) {
+        rx = test->region.x;
+        ry = test->region.y;
+        rw = test->region.width;
+        rh = test->region.height;
+    } else {
+        // Inside the marker drawn by the fake device server (1/8 of the
+        // smallest dimension)
+        rx = 0;
+        ry = 0;
+        rw = MAX(MIN(frame_width, frame_height) / 16, 1);
+        rh = rw;
+    }
+
+    if (rx >= frame_width || ry >= frame_height) {
+        return false;
+    }
+
+    *x = rx;
+    *y = ry;
+    *width = MIN(rw, frame_width - rx);
+    *height = MIN(rh, frame_height - ry);
+    return true;
+}
+
+// Return the mean luma of the region, or -1 if the region is out of the frame
+static int
+sc_latency_test_region_luma(const struct sc_latency_test *test,
+                            const AVFrame *frame) {
+    unsigned x, y, w, h;
+    if (!sc_latency_test_get_region(test, frame->width, frame->height, &x, &y,
+                                    &w, &h)) {
+        return -1;
+    }
+
+    // For the supported formats, the first plane is the 8-bit luma
+    uint64_t sum = 0;
+    for (unsigned row = y; row < y + h; ++row) {
+        const uint8_t *line = frame->data[0] + row * frame->linesize[0] + x;
+        for (unsigned col = 0; col < w; ++col) {
+            sum += line[col];
+        }
+    }
+
+    return sum / ((uint64_t) w * h);
+}
+
+static bool
+sc_latency_test_frame_sink_open(struct sc_frame_sink *sink,
+                                const AVCodecContext *ctx) {
+    (void) sink;
+
+    if (ctx->pix_fmt != AV_PIX_FMT_YUV420P
+            && ctx->pix_fmt != AV_PIX_FMT_YUVJ420P
+            && ctx->pix_fmt != AV_PIX_FMT_NV12) {
+        LOGE("Latency test: unsupported pixel format: %s",
+             av_get_pix_fmt_name(ctx->pix_fmt));
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_latency_test_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+    // Nothing to do, the events injected from now on will time out
+}
+
+static bool
+sc_latency_test_frame_sink_push(struct sc_frame_sink *sink,
+                                const AVFrame *frame) {
+    struct sc_latency_test *test = DOWNCAST(sink);
+
+    // The frame is considered received once decoded
+    sc_tick now = sc_tick_now();
+    int luma = sc_latency_test_region_luma(test, frame);
+
+    sc_mutex_lock(&test->mutex);
+    bool first = test->luma == -1;
+    test->frame_width = frame->width;
+    test->frame_height = frame->height;
+    test->luma = luma;
+    if (test->armed && luma != -1
+            && abs(luma - test->baseline) >= SC_LATENCY_TEST_THRESHOLD) {
+        test->armed = false;
+        test->detected = now;
+        sc_cond_signal(&test->cond);
+    } else if (first && luma != -1) {
+        // The test thread waits for the first frame
+        sc_cond_signal(&test->cond);
+    }
+    sc_mutex_unlock(&test->mutex);
+
+    return true;
+}
+
+static bool
+sc_latency_test_inject(struct sc_latency_test *test, uint16_t frame_width,
+                       uint16_t frame_height) {
+    struct sc_control_msg msgs[2];
+
+    for (unsigned i = 0; i < 2; ++i) {
+        struct sc_control_msg *msg = &msgs[i];
+        bool down = i == 0;
+
+        if (test->event == SC_LATENCY_TEST_EVENT_TOUCH) {
+            unsigned x, y, w, h;
+            bool ok = sc_latency_test_get_region(test, frame_width,
+                                                 frame_height, &x, &y, &w,
+                                                 &h);
+            // The luma of the region in the last frame has been computed
+            assert(ok);
+            (void) ok;
+
+            msg->type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT;
+            msg->inject_touch_event.action = down ? AMOTION_EVENT_ACTION_DOWN
+                                                  : AMOTION_EVENT_ACTION_UP;
+            msg->inject_touch_event.action_button = 0;
+            msg->inject_touch_event.buttons = 0;
+            msg->inject_touch_event.pointer_id = SC_POINTER_ID_GENERIC_FINGER;
+            msg->inject_touch_event.position.screen_size.width = frame_width;
+            msg->inject_touch_event.position.screen_size.height = frame_height;
+            msg->inject_touch_event.position.point.x = x + w / 2;
+            msg->inject_touch_event.position.point.y = y + h / 2;
+            msg->inject_touch_event.pressure = down ? 1.f : 0.f;
+        } else {
+            assert(test->event == SC_LATENCY_TEST_EVENT_KEY);
+            msg->type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE;
+            msg->inject_keycode.action = down ? AKEY_EVENT_ACTION_DOWN
+                                              : AKEY_EVENT_ACTION_UP;
+            msg->inject_keycode.keycode = AKEYCODE_SPACE;
+            msg->inject_keycode.repeat = 0;
+            msg->inject_keycode.metastate = 0;
+        }
+    }
+
+    for (unsigned i = 0; i < 2; ++i) {
+        if (!sc_controller_push_msg(test->controller, &msgs[i])) {
+            LOGW("Latency test: could not inject event");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+sc_latency_test_log_histogram(const sc_tick *samples, unsigned count) {
+    // The samples are sorted
+    sc_tick min_ms = SC_TICK_TO_MS(samples[0]);
+    sc_tick max_ms = SC_TICK_TO_MS(samples[count - 1]);
+
+    // Bucket width of 1, 2 or 5 times a power of 10 milliseconds
+    sc_tick range = max_ms - min_ms + 1;
+    sc_tick bucket_ms = 1;
+    for (unsigned i = 0; bucket_ms * SC_LATENCY_TEST_HISTOGRAM_BUCKETS < range;
+            ++i) {
+        bucket_ms = (i % 3 == 1) ? bucket_ms * 5 / 2 : bucket_ms * 2;
+    }
+
+    sc_tick first_ms = min_ms - min_ms % bucket_ms;
+    unsigned counts[SC_LATENCY_TEST_HISTOGRAM_BUCKETS + 1] = {0};
+    unsigned max_count = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        size_t bucket = (SC_TICK_TO_MS(samples[i]) - first_ms) / bucket_ms;
+        assert(bucket < ARRAY_LEN(counts));
+        if (++counts[bucket] > max_count) {
+            max_count = counts[bucket];
+        }
+    }
+
+    char bar[SC_LATENCY_TEST_HISTOGRAM_WIDTH + 1];
+    for (size_t i = 0; i < ARRAY_LEN(counts); ++i) {
+        sc_tick from = first_ms + i * bucket_ms;
+        if (from > max_ms) {
+            break;
+        }
+
+        unsigned len = (uint64_t) counts[i] * SC_LATENCY_TEST_HISTOGRAM_WIDTH
+                     / max_count;
+        memset(bar, '#', len);
+        bar[len] = '\0';
+        LOGI("  %5" PRItick " - %5" PRItick " ms: %5u %s", from,
+             from + bucket_ms, counts[i], bar);
+    }
+}
+
+static void
+sc_latency_test_report(struct sc_latency_test *test) {
+    unsigned total = test->sample_count + test->missed;
+    if (!test->sample_count) {
+        LOGE("Latency test: no change detected in the region (%u events)",
+             total);
+        return;
+    }
+
+    struct sc_latency_stats stats;
+    sc_latency_stats_compute(test->samples, test->sample_count, &stats);
+
+#define MS(tick) ((double) (tick) / SC_TICK_FROM_MS(1))
+    LOGI("Latency test: %u/%u events detected", stats.count, total);
+    LOGI("Latency (ms): min=%.1f mean=%.1f p50=%.1f p90=%.1f p95=%.1f "
+         "p99=%.1f max=%.1f", MS(stats.min), MS(stats.mean), MS(stats.p50),
+         MS(stats.p90), MS(stats.p95), MS(stats.p99), MS(stats.max));
+#undef MS
+
+    sc_latency_test_log_histogram(test->samples, test->sample_count);
+}
+
+static int
+run_latency_test(void *data) {
+    struct sc_latency_test *test = data;
+
+    sc_mutex_lock(&test->mutex);
+
+    for (unsigned i = 0; i < test->count && !test->stopped; ++i) {
+        sc_tick jitter = SC_TICK_FROM_MS(sc_rand_u32(&test->rand)
+                                         % SC_LATENCY_TEST_INTERVAL_JITTER_MS);
+        sc_tick deadline = sc_tick_now() + SC_LATENCY_TEST_INTERVAL + jitter;
+        bool timed_out = false;
+        while (!test->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&test->cond, &test->mutex,
+                                           deadline);
+        }
+
+        // The device may not produce any frame while its screen is static:
+        // the last frame is the baseline
+        while (!test->stopped && test->luma == -1) {
+            sc_cond_wait(&test->cond, &test->mutex);
+        }
+
+        if (test->stopped) {
+            break;
+        }
+
+        test->baseline = test->luma;
+        test->armed = true;
+        uint16_t frame_width = test->frame_width;
+        uint16_t frame_height = test->frame_height;
+        sc_mutex_unlock(&test->mutex);
+
+        sc_tick start = sc_tick_now();
+        bool injected =
+            sc_latency_test_inject(test, frame_width, frame_height);
+
+        sc_mutex_lock(&test->mutex);
+        deadline = start + SC_LATENCY_TEST_TIMEOUT;
+        timed_out = false;
+        while (injected && !test->stopped && test->armed && !timed_out) {
+            timed_out = !sc_cond_timedwait(&test->cond, &test->mutex,
+                                           deadline);
+        }
+
+        if (test->stopped) {
+            break;
+        }
+
+        if (injected && !test->armed) {
+            sc_tick latency = test->detected - start;
+            test->samples[test->sample_count++] = latency;
+            LOGD("Latency test: %u/%u: %" PRItick " ms", i + 1, test->count,
+                 SC_TICK_TO_MS(latency));
+        } else {
+            if (injected) {
+                LOGW("Latency test: %u/%u: no change detected in the region",
+                     i + 1, test->count);
+            }
+            ++test->missed;
+        }
+        test->armed = false;
+    }
+
+    bool stopped = test->stopped;
+    sc_mutex_unlock(&test->mutex);
+
+    if (!stopped) {
+        sc_latency_test_report(test);
+        test->cbs->on_completed(test, test->sample_count > 0,
+                                test->cbs_userdata);
+    }
+
+    return 0;
+}
+
+bool
+sc_latency_test_init(struct sc_latency_test *test,
+                     struct sc_controller *controller, unsigned count,
+                     enum sc_latency_test_event event,
+                     const struct sc_latency_test_region *region) {
+    assert(controller);
+    assert(count);
+
+    test->samples = malloc(count * sizeof(*test->samples));
+    if (!test->samples) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&test->mutex);
+    if (!ok) {
+        free(test->samples);
+        return false;
+    }
+
+    ok = sc_cond_init(&test->cond);
+    if (!ok) {
+        sc_mutex_destroy(&test->mutex);
+        free(test->samples);
+        return false;
+    }
+
+    test->controller = controller;
+    test->count = count;
+    test->event = event;
+    test->region = *region;
+    test->stopped = false;
+    test->frame_width = 0;
+    test->frame_height = 0;
+    test->luma = -1;
+    test->armed = false;
+    test->baseline = 0;
+    test->detected = 0;
+    test->sample_count = 0;
+    test->missed = 0;
+    sc_rand_init(&test->rand);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_latency_test_frame_sink_open,
+        .close = sc_latency_test_frame_sink_close,
+        .push = sc_latency_test_frame_sink_push,
+    };
+
+    test->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_latency_test_destroy(struct sc_latency_test *test) {
+    sc_cond_destroy(&test->cond);
+    sc_mutex_destroy(&test->mutex);
+    free(test->samples);
+}
+
+bool
+sc_latency_test_start(struct sc_latency_test *test,
+                      const struct sc_latency_test_callbacks *cbs,
+                      void *cbs_userdata) {
+    assert(cbs && cbs->on_completed);
+    test->cbs = cbs;
+    test->cbs_userdata = cbs_userdata;
+
+    LOGI("Latency test: %u %s events", test->count,
+         test->event == SC_LATENCY_TEST_EVENT_TOUCH ? "touch" : "key");
+
+    bool ok = sc_thread_create(&test->thread, run_latency_test,
+                               "scrcpy-latency", test);
+    if (!ok) {
+        LOGE("Latency test: could not start thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_latency_test_stop(struct sc_latency_test *test) {
+    sc_mutex_lock(&test->mutex);
+    test->stopped = true;
+    sc_cond_signal(&test->cond);
+    sc_mutex_unlock(&test->mutex);
+}
+
+void
+sc_latency_test_join(struct sc_latency_test *test) {
+    sc_thread_join(&test->thread, NULL);
+}
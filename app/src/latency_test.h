@@ -0,0 +1,86 @@
+#ifndef SC_LATENCY_TEST_H
+#define SC_LATENCY_TEST_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "controller.h"
+#include "options.h"
+#include "trait/frame_sink.h"
+#include "util/rand.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Motion-to-photon latency measurement
+ *
+ * The test repeatedly injects an input event (a tap or a key press) via the
+ * controller, then watches the decoded video frames (as a frame sink) until
+ * the mean luma of a region changes.
+ *
+ * The measured latency is the time between the injection and the reception
+ * of the first changed frame by the sink: it includes the device (input
+ * dispatch, rendering, capture and encoding), the transport and the decoding,
+ * but not the rendering on the computer screen.
+ */
+struct sc_latency_test {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_controller *controller;
+    enum sc_latency_test_event event;
+    struct sc_latency_test_region region;
+    unsigned count;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+
+    // Written by the frame sink (protected by the mutex)
+    uint16_t frame_width;
+    uint16_t frame_height;
+    int luma; // mean luma of the region in the last frame, -1 if none
+    bool armed; // a change from the baseline is expected
+    int baseline;
+    sc_tick detected; // reception time of the changed frame
+
+    // Accessed only from the test thread
+    sc_tick *samples;
+    unsigned sample_count;
+    unsigned missed;
+    struct sc_rand rand;
+
+    const struct sc_latency_test_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_latency_test_callbacks {
+    // Called from the test thread once all the events have been injected
+    // (not called if the test is stopped before)
+    void (*on_completed)(struct sc_latency_test *test, bool success,
+                         void *userdata);
+};
+
+bool
+sc_latency_test_init(struct sc_latency_test *test,
+                     struct sc_controller *controller, unsigned count,
+                     enum sc_latency_test_event event,
+                     const struct sc_latency_test_region *region);
+
+void
+sc_latency_test_destroy(struct sc_latency_test *test);
+
+bool
+sc_latency_test_start(struct sc_latency_test *test,
+                      const struct sc_latency_test_callbacks *cbs,
+                      void *cbs_userdata);
+
+void
+sc_latency_test_stop(struct sc_latency_test *test);
+
+void
+sc_latency_test_join(struct sc_latency_test *test);
+
+#endif
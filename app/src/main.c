@@ -5,8 +5,10 @@
 #ifdef HAVE_V4L2
 # include <libavdevice/avdevice.h>
 #endif
-#define SDL_MAIN_HANDLED // avoid link error on Linux Windows Subsystem
-#include <SDL2/SDL.h>
+#ifdef HAVE_SDL
+# define SDL_MAIN_HANDLED // avoid link error on Linux Windows Subsystem
+# include <SDL2/SDL.h>
+#endif
 
 #include "cli.h"
 #include "options.h"
@@ -15,6 +17,7 @@
 #include "util/log.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/thread_policy.h"
 #include "version.h"
 
 #ifdef _WIN32
@@ -46,6 +49,7 @@ main_scrcpy(int argc, char *argv[]) {
 #endif
 
     enum scrcpy_exit_code ret;
+    bool log_async_started = false;
 
     if (!scrcpy_parse_args(&args, argc, argv)) {
         ret = SCRCPY_EXIT_FAILURE;
@@ -69,6 +73,17 @@ main_scrcpy(int argc, char *argv[]) {
     // The current thread is the main thread
     SC_MAIN_THREAD_ID = sc_thread_get_id();
 
+    // The executable owns the process signal disposition
+    args.opts.trace_signal = true;
+
+    // Before any thread is created
+    sc_thread_policy_configure(args.opts.thread_policies,
+                               args.opts.thread_policy_count);
+    const struct sc_thread_policy *main_policy = sc_thread_policy_find("main");
+    if (main_policy) {
+        sc_thread_policy_apply(main_policy);
+    }
+
 #ifdef SCRCPY_LAVF_REQUIRES_REGISTER_ALL
     av_register_all();
 #endif
@@ -86,12 +101,20 @@ main_scrcpy(int argc, char *argv[]) {
 
     sc_log_configure();
 
+    // Never block the media threads on a slow terminal (if the log thread
+    // could not be started, the messages are just written synchronously)
+    log_async_started = sc_log_async_start();
+
 #ifdef HAVE_USB
     ret = args.opts.otg ? scrcpy_otg(&args.opts) : scrcpy(&args.opts);
 #else
     ret = scrcpy(&args.opts);
 #endif
 
+    if (log_async_started) {
+        sc_log_async_stop();
+    }
+
 end:
     if (args.pause_on_exit == SC_PAUSE_ON_EXIT_TRUE ||
             (args.pause_on_exit == SC_PAUSE_ON_EXIT_IF_ERROR &&
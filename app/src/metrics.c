@@ -0,0 +1,218 @@
+#include "metrics.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+enum sc_metric_type {
+    SC_METRIC_TYPE_COUNTER,
+    SC_METRIC_TYPE_GAUGE,
+};
+
+struct sc_metric_desc {
+    const char *name;
+    const char *labels; // may be NULL
+    enum sc_metric_type type;
+    const char *help;
+};
+
+// The metrics sharing the same name (with different labels) must be
+// consecutive, their HELP and TYPE lines are written only once
+static const struct sc_metric_desc sc_metric_descs[] = {
+    [SC_METRIC_DEMUXER_VIDEO_PACKETS] = {
+        "scrcpy_demuxer_packets_total", "stream=\"video\"",
+        SC_METRIC_TYPE_COUNTER, "Packets received from the device",
+    },
+    [SC_METRIC_DEMUXER_AUDIO_PACKETS] = {
+        "scrcpy_demuxer_packets_total", "stream=\"audio\"",
+        SC_METRIC_TYPE_COUNTER, "Packets received from the device",
+    },
+    [SC_METRIC_DEMUXER_VIDEO_BYTES] = {
+        "scrcpy_demuxer_bytes_total", "stream=\"video\"",
+        SC_METRIC_TYPE_COUNTER, "Packet bytes received from the device",
+    },
+    [SC_METRIC_DEMUXER_AUDIO_BYTES] = {
+        "scrcpy_demuxer_bytes_total", "stream=\"audio\"",
+        SC_METRIC_TYPE_COUNTER, "Packet bytes received from the device",
+    },
+    [SC_METRIC_DECODER_VIDEO_FRAMES] = {
+        "scrcpy_decoder_frames_total", "stream=\"video\"",
+        SC_METRIC_TYPE_COUNTER, "Decoded frames",
+    },
+    [SC_METRIC_DECODER_AUDIO_FRAMES] = {
+        "scrcpy_decoder_frames_total", "stream=\"audio\"",
+        SC_METRIC_TYPE_COUNTER, "Decoded frames",
+    },
+    [SC_METRIC_DECODER_VIDEO_SKIPPED_PACKETS] = {
+        "scrcpy_decoder_skipped_packets_total", "stream=\"video\"",
+        SC_METRIC_TYPE_COUNTER,
+        "Packets not decoded because no sink consumed the frames",
+    },
+    [SC_METRIC_DECODER_AUDIO_SKIPPED_PACKETS] = {
+        "scrcpy_decoder_skipped_packets_total", "stream=\"audio\"",
+        SC_METRIC_TYPE_COUNTER,
+        "Packets not decoded because no sink consumed the frames",
+    },
+    [SC_METRIC_SCREEN_RENDERED_FRAMES] = {
+        "scrcpy_screen_rendered_frames_total", NULL,
+        SC_METRIC_TYPE_COUNTER, "Frames rendered on the screen",
+    },
+    [SC_METRIC_SCREEN_SKIPPED_FRAMES] = {
+        "scrcpy_screen_skipped_frames_total", NULL,
+        SC_METRIC_TYPE_COUNTER,
+        "Decoded frames skipped because a more recent frame was available",
+    },
+    [SC_METRIC_AUDIO_UNDERFLOW_SAMPLES] = {
+        "scrcpy_audio_underflow_samples_total", NULL,
+        SC_METRIC_TYPE_COUNTER, "Silence samples inserted on buffer underflow",
+    },
+    [SC_METRIC_AUDIO_DROPPED_SAMPLES] = {
+        "scrcpy_audio_dropped_samples_total", NULL,
+        SC_METRIC_TYPE_COUNTER,
+        "Samples dropped because the buffering threshold was exceeded",
+    },
+    [SC_METRIC_CONTROLLER_QUEUE] = {
+        "scrcpy_controller_queue_messages", NULL,
+        SC_METRIC_TYPE_GAUGE, "Control messages waiting to be sent",
+    },
+    [SC_METRIC_CONTROLLER_DROPPED] = {
+        "scrcpy_controller_dropped_messages_total", NULL,
+        SC_METRIC_TYPE_COUNTER, "Control messages dropped (queue full)",
+    },
+    [SC_METRIC_RECORDER_VIDEO_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"recorder\",stream=\"video\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_RECORDER_AUDIO_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"recorder\",stream=\"audio\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_FMP4_VIDEO_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"fmp4\",stream=\"video\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_FMP4_AUDIO_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"fmp4\",stream=\"audio\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_TCP_SINK_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"tcp\",stream=\"video\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_RTSP_QUEUE] = {
+        "scrcpy_sink_queue_packets", "sink=\"rtsp\",stream=\"all\"",
+        SC_METRIC_TYPE_GAUGE, "Packets waiting in a sink queue",
+    },
+    [SC_METRIC_TCP_SINK_DROPPED] = {
+        "scrcpy_sink_dropped_total", "sink=\"tcp\"",
+        SC_METRIC_TYPE_COUNTER, "Packets (or frames) dropped by a sink",
+    },
+    [SC_METRIC_RTSP_DROPPED] = {
+        "scrcpy_sink_dropped_total", "sink=\"rtsp\"",
+        SC_METRIC_TYPE_COUNTER, "Packets (or frames) dropped by a sink",
+    },
+    [SC_METRIC_MJPEG_DROPPED] = {
+        "scrcpy_sink_dropped_total", "sink=\"mjpeg\"",
+        SC_METRIC_TYPE_COUNTER, "Packets (or frames) dropped by a sink",
+    },
+    [SC_METRIC_TCP_SINK_CLIENTS] = {
+        "scrcpy_restream_clients", "server=\"tcp\"",
+        SC_METRIC_TYPE_GAUGE, "Connected restream clients",
+    },
+    [SC_METRIC_RTSP_CLIENTS] = {
+        "scrcpy_restream_clients", "server=\"rtsp\"",
+        SC_METRIC_TYPE_GAUGE, "Connected restream clients",
+    },
+    [SC_METRIC_FMP4_CLIENTS] = {
+        "scrcpy_restream_clients", "server=\"fmp4\"",
+        SC_METRIC_TYPE_GAUGE, "Connected restream clients",
+    },
+    [SC_METRIC_MJPEG_CLIENTS] = {
+        "scrcpy_restream_clients", "server=\"mjpeg\"",
+        SC_METRIC_TYPE_GAUGE, "Connected restream clients",
+    },
+    [SC_METRIC_TCP_SINK_SENT_PACKETS] = {
+        "scrcpy_restream_sent_packets_total", "server=\"tcp\"",
+        SC_METRIC_TYPE_COUNTER, "Packets sent to the restream client",
+    },
+    [SC_METRIC_TCP_SINK_SEND_TIME] = {
+        "scrcpy_restream_send_microseconds_total", "server=\"tcp\"",
+        SC_METRIC_TYPE_COUNTER,
+        "Time spent sending the packets to the restream client (including "
+        "pacing)",
+    },
+    [SC_METRIC_TCP_SINK_PACING_WAIT] = {
+        "scrcpy_restream_pacing_wait_microseconds_total", "server=\"tcp\"",
+        SC_METRIC_TYPE_COUNTER,
+        "Time spent waiting for the pacing rate before sending",
+    },
+    [SC_METRIC_RESUMES] = {
+        "scrcpy_resumes_total", NULL,
+        SC_METRIC_TYPE_COUNTER, "Streams resumed after a connection loss",
+    },
+    [SC_METRIC_RENDITIONS_COMPUTED] = {
+        "scrcpy_renditions_total", "result=\"computed\"",
+        SC_METRIC_TYPE_COUNTER, "Frame renditions requested by the consumers",
+    },
+    [SC_METRIC_RENDITIONS_SHARED] = {
+        "scrcpy_renditions_total", "result=\"shared\"",
+        SC_METRIC_TYPE_COUNTER, "Frame renditions requested by the consumers",
+    },
+};
+
+static_assert(ARRAY_LEN(sc_metric_descs) == SC_METRIC_COUNT_,
+              "A metric description is missing");
+
+atomic_int_least64_t sc_metrics_values[SC_METRIC_COUNT_];
+
+void
+sc_metrics_reset(void) {
+    for (unsigned i = 0; i < SC_METRIC_COUNT_; ++i) {
+        sc_metrics_set(i, 0);
+    }
+}
+
+static const char *
+sc_metric_type_name(enum sc_metric_type type) {
+    return type == SC_METRIC_TYPE_COUNTER ? "counter" : "gauge";
+}
+
+bool
+sc_metrics_format(struct sc_strbuf *buf) {
+    const char *previous_name = NULL;
+
+    for (unsigned i = 0; i < SC_METRIC_COUNT_; ++i) {
+        const struct sc_metric_desc *desc = &sc_metric_descs[i];
+        assert(desc->name);
+
+        char line[256];
+        int n;
+
+        if (!previous_name || strcmp(desc->name, previous_name)) {
+            n = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n",
+                         desc->name, desc->help, desc->name,
+                         sc_metric_type_name(desc->type));
+            assert(n > 0 && (size_t) n < sizeof(line));
+            if (!sc_strbuf_append(buf, line, n)) {
+                return false;
+            }
+            previous_name = desc->name;
+        }
+
+        int64_t value = sc_metrics_get(i);
+        if (desc->labels) {
+            n = snprintf(line, sizeof(line), "%s{%s} %" PRIi64 "\n",
+                         desc->name, desc->labels, value);
+        } else {
+            n = snprintf(line, sizeof(line), "%s %" PRIi64 "\n", desc->name,
+                         value);
+        }
+        assert(n > 0 && (size_t) n < sizeof(line));
+        if (!sc_strbuf_append(buf, line, n)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/strbuf.h"
+
+/**
+ * Pipeline metrics, exposed in the Prometheus text format by the metrics
+ * server.
+ *
+ * The values are stored in a global table of atomics, so that any component
+ * may update them from any thread without locking (the cost is negligible
+ * even if the metrics are never served).
+ */
+enum sc_metric {
+    SC_METRIC_DEMUXER_VIDEO_PACKETS,
+    SC_METRIC_DEMUXER_AUDIO_PACKETS,
+    SC_METRIC_DEMUXER_VIDEO_BYTES,
+    SC_METRIC_DEMUXER_AUDIO_BYTES,
+    SC_METRIC_DECODER_VIDEO_FRAMES,
+    SC_METRIC_DECODER_AUDIO_FRAMES,
+    SC_METRIC_DECODER_VIDEO_SKIPPED_PACKETS,
+    SC_METRIC_DECODER_AUDIO_SKIPPED_PACKETS,
+    SC_METRIC_SCREEN_RENDERED_FRAMES,
+    SC_METRIC_SCREEN_SKIPPED_FRAMES,
+    SC_METRIC_AUDIO_UNDERFLOW_SAMPLES,
+    SC_METRIC_AUDIO_DROPPED_SAMPLES,
+    SC_METRIC_CONTROLLER_QUEUE,
+    SC_METRIC_CONTROLLER_DROPPED,
+    SC_METRIC_RECORDER_VIDEO_QUEUE,
+    SC_METRIC_RECORDER_AUDIO_QUEUE,
+    SC_METRIC_FMP4_VIDEO_QUEUE,
+    SC_METRIC_FMP4_AUDIO_QUEUE,
+    SC_METRIC_TCP_SINK_QUEUE,
+    SC_METRIC_RTSP_QUEUE,
+    SC_METRIC_TCP_SINK_DROPPED,
+    SC_METRIC_RTSP_DROPPED,
+    SC_METRIC_MJPEG_DROPPED,
+    SC_METRIC_TCP_SINK_CLIENTS,
+    SC_METRIC_RTSP_CLIENTS,
+    SC_METRIC_FMP4_CLIENTS,
+    SC_METRIC_MJPEG_CLIENTS,
+    SC_METRIC_TCP_SINK_SENT_PACKETS,
+    SC_METRIC_TCP_SINK_SEND_TIME,
+    SC_METRIC_TCP_SINK_PACING_WAIT,
+    SC_METRIC_RESUMES,
+    SC_METRIC_RENDITIONS_COMPUTED,
+    SC_METRIC_RENDITIONS_SHARED,
+    SC_METRIC_COUNT_,
+};
+
+extern atomic_int_least64_t sc_metrics_values[SC_METRIC_COUNT_];
+
+static inline void
+sc_metrics_add(enum sc_metric metric, int64_t value) {
+    atomic_fetch_add_explicit(&sc_metrics_values[metric], value,
+                              memory_order_relaxed);
+}
+
+static inline void
+sc_metrics_set(enum sc_metric metric, int64_t value) {
+    atomic_store_explicit(&sc_metrics_values[metric], value,
+                          memory_order_relaxed);
+}
+
+static inline int64_t
+sc_metrics_get(enum sc_metric metric) {
+    return atomic_load_explicit(&sc_metrics_values[metric],
+                                memory_order_relaxed);
+}
+
+/**
+ * Reset all the values to 0
+ */
+void
+sc_metrics_reset(void);
+
+/**
+ * Append all the metrics in the Prometheus text exposition format
+ */
+bool
+sc_metrics_format(struct sc_strbuf *buf);
+
+#endif
@@ -0,0 +1,88 @@
+#include "metrics_server.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "util/log.h"
+#include "util/strbuf.h"
+
+#define SC_METRICS_PATH "/metrics"
+// A scrape is short, a few concurrent clients are sufficient
+#define SC_METRICS_SERVER_MAX_CLIENTS 4
+
+static void
+sc_metrics_server_on_request(struct sc_http_server *http, sc_socket socket,
+                             const char *path, void *userdata) {
+    (void) http;
+    (void) userdata;
+
+    if (strcmp(path, SC_METRICS_PATH)) {
+        static const char body[] = "Not found\n";
+        sc_http_send_response(socket, "404 Not Found",
+                              "text/plain; charset=utf-8", body,
+                              sizeof(body) - 1);
+        return;
+    }
+
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 4096)) {
+        LOG_OOM();
+        return;
+    }
+
+    if (!sc_metrics_format(&buf)) {
+        LOG_OOM();
+        free(buf.s);
+        return;
+    }
+
+    sc_http_send_response(socket, "200 OK",
+                          "text/plain; version=0.0.4; charset=utf-8",
+                          buf.s, buf.len);
+    free(buf.s);
+}
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *server, uint16_t port) {
+    const struct sc_http_server_params params = {
+        .name = "Metrics",
+        .thread_name = "metrics-server",
+        .client_thread_name = "metrics-client",
+        .port = port,
+        .max_clients = SC_METRICS_SERVER_MAX_CLIENTS,
+    };
+
+    static const struct sc_http_server_callbacks http_cbs = {
+        .on_request = sc_metrics_server_on_request,
+    };
+
+    return sc_http_server_init(&server->http, &params, &http_cbs, server);
+}
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *server) {
+    if (!sc_http_server_start(&server->http)) {
+        return false;
+    }
+
+    LOGI("Metrics server listening on http://127.0.0.1:%" PRIu16
+         SC_METRICS_PATH, server->http.params.port);
+    return true;
+}
+
+void
+sc_metrics_server_stop(struct sc_metrics_server *server) {
+    sc_http_server_stop(&server->http);
+}
+
+void
+sc_metrics_server_join(struct sc_metrics_server *server) {
+    sc_http_server_join(&server->http);
+}
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *server) {
+    sc_http_server_destroy(&server->http);
+}
@@ -0,0 +1,34 @@
+#ifndef SC_METRICS_SERVER_H
+#define SC_METRICS_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/http_server.h"
+
+/**
+ * HTTP server exposing the metrics (see metrics.h) on /metrics, in the
+ * Prometheus text format.
+ */
+struct sc_metrics_server {
+    struct sc_http_server http;
+};
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *server, uint16_t port);
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *server);
+
+void
+sc_metrics_server_stop(struct sc_metrics_server *server);
+
+void
+sc_metrics_server_join(struct sc_metrics_server *server);
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *server);
+
+#endif
@@ -0,0 +1,615 @@
+#include "mjpeg_server.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavutil/cpu.h>
+#include <libavutil/pixdesc.h>
+
+#include "metrics.h"
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_mjpeg_server */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_mjpeg_server, frame_sink)
+
+#define SC_MJPEG_BOUNDARY "scrcpyframe"
+#define SC_MJPEG_SNAPSHOT_PATH "/snapshot.jpg"
+
+// JPEG quantizer scale (2 = best quality, 31 = worst quality)
+#define SC_MJPEG_QSCALE 5
+
+static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
+
+static struct sc_mjpeg_frame *
+sc_mjpeg_frame_new(const uint8_t *data, size_t len) {
+    struct sc_mjpeg_frame *image = malloc(sizeof(*image) + len);
+    if (!image) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    image->refs = 1;
+    image->len = len;
+    memcpy(image->data, data, len);
+    return image;
+}
+
+// Must be called with the server mutex locked
+static void
+sc_mjpeg_frame_unref(struct sc_mjpeg_frame *image) {
+    assert(image->refs);
+    if (!--image->refs) {
+        free(image);
+    }
+}
+
+static void
+sc_mjpeg_server_get_rendition_spec(struct sc_mjpeg_server *server,
+                                   struct sc_rendition_spec *spec) {
+    spec->width = 0;
+    spec->height = 0;
+    spec->max_size = server->max_size;
+    spec->format = AV_PIX_FMT_YUV420P;
+}
+
+// (Re)create the encoder for the input frame size
+static bool
+sc_mjpeg_worker_configure(struct sc_mjpeg_worker *worker, unsigned input_width,
+                          unsigned input_height,
+                          enum AVColorRange color_range) {
+    avcodec_free_context(&worker->encoder_ctx);
+    // Retry on the next frame on failure
+    worker->input_width = 0;
+    worker->input_height = 0;
+
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        LOGE("MJPEG encoder not found");
+        return false;
+    }
+
+    struct sc_rendition_spec spec;
+    sc_mjpeg_server_get_rendition_spec(worker->server, &spec);
+
+    unsigned width;
+    unsigned height;
+    bool ok = sc_rendition_compute_size(&spec, input_width, input_height,
+                                        &width, &height);
+    assert(ok); // only max_size is set, it never upscales
+    (void) ok;
+
+    worker->encoder_ctx = avcodec_alloc_context3(codec);
+    if (!worker->encoder_ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    AVCodecContext *encoder_ctx = worker->encoder_ctx;
+    encoder_ctx->width = width;
+    encoder_ctx->height = height;
+    encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder_ctx->color_range = color_range;
+    // Accept limited range YUV (not "full range" as required by JFIF)
+    encoder_ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+    encoder_ctx->time_base = SCRCPY_TIME_BASE;
+    encoder_ctx->flags |= AV_CODEC_FLAG_QSCALE;
+    encoder_ctx->global_quality = FF_QP2LAMBDA * SC_MJPEG_QSCALE;
+    // The frames are encoded in parallel by the workers
+    encoder_ctx->thread_count = 1;
+
+    if (avcodec_open2(encoder_ctx, codec, NULL) < 0) {
+        LOGE("MJPEG: could not open encoder");
+        avcodec_free_context(&worker->encoder_ctx);
+        return false;
+    }
+
+    worker->input_width = input_width;
+    worker->input_height = input_height;
+    return true;
+}
+
+static struct sc_mjpeg_frame *
+sc_mjpeg_worker_encode(struct sc_mjpeg_worker *worker) {
+    AVCodecContext *ctx = worker->encoder_ctx;
+    AVFrame *frame = worker->frame;
+
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        LOGW("MJPEG: unsupported frame format: %d", frame->format);
+        return NULL;
+    }
+
+    if ((unsigned) frame->width != worker->input_width
+            || (unsigned) frame->height != worker->input_height) {
+        // The video size changed (new session on the device)
+        if (!sc_mjpeg_worker_configure(worker, frame->width, frame->height,
+                                       frame->color_range)) {
+            return NULL;
+        }
+        ctx = worker->encoder_ctx;
+    }
+
+    // The scaled frame may be shared with the other consumers of the same
+    // rendition (or be the decoded frame itself if no scaling is needed)
+    struct sc_rendition_spec spec;
+    sc_mjpeg_server_get_rendition_spec(worker->server, &spec);
+    if (!sc_rendition_cache_get(worker->server->renditions, frame, &spec,
+                                worker->rendition)) {
+        return NULL;
+    }
+    frame = worker->rendition;
+
+    // With AV_CODEC_FLAG_QSCALE, the quantizer is read from the frame
+    frame->quality = ctx->global_quality;
+
+    int ret = avcodec_send_frame(ctx, frame);
+    av_frame_unref(frame);
+    if (ret < 0) {
+        LOGE("MJPEG: could not send frame: %d", ret);
+        return NULL;
+    }
+
+    AVPacket *packet = worker->packet;
+    ret = avcodec_receive_packet(ctx, packet);
+    if (ret < 0) {
+        LOGE("MJPEG: could not receive packet: %d", ret);
+        return NULL;
+    }
+
+    struct sc_mjpeg_frame *image = sc_mjpeg_frame_new(packet->data,
+                                                      packet->size);
+    av_packet_unref(packet);
+    return image;
+}
+
+static int
+run_mjpeg_worker(void *data) {
+    struct sc_mjpeg_worker *worker = data;
+    struct sc_mjpeg_server *server = worker->server;
+
+    sc_mutex_lock(&server->mutex);
+    for (;;) {
+        while (!server->ended && !worker->busy) {
+            sc_cond_wait(&server->pool_cond, &server->mutex);
+        }
+
+        if (server->ended) {
+            break;
+        }
+
+        sc_mutex_unlock(&server->mutex);
+
+        struct sc_mjpeg_frame *image = sc_mjpeg_worker_encode(worker);
+        av_frame_unref(worker->frame);
+
+        sc_mutex_lock(&server->mutex);
+
+        // Publish in order: wait for the workers encoding the previous frames
+        while (!server->ended && server->publish_seq != worker->seq) {
+            sc_cond_wait(&server->pool_cond, &server->mutex);
+        }
+
+        if (image) {
+            if (server->ended) {
+                sc_mjpeg_frame_unref(image);
+            } else {
+                if (server->image) {
+                    sc_mjpeg_frame_unref(server->image);
+                }
+                server->image = image;
+                ++server->image_count;
+                sc_cond_broadcast(&server->cond);
+            }
+        }
+
+        ++server->publish_seq;
+        worker->busy = false;
+        sc_cond_broadcast(&server->pool_cond);
+    }
+    sc_mutex_unlock(&server->mutex);
+
+    LOGD("MJPEG worker thread ended");
+    return 0;
+}
+
+static void
+sc_mjpeg_worker_destroy(struct sc_mjpeg_worker *worker) {
+    av_packet_free(&worker->packet);
+    av_frame_free(&worker->rendition);
+    av_frame_free(&worker->frame);
+    avcodec_free_context(&worker->encoder_ctx);
+}
+
+static bool
+sc_mjpeg_worker_init(struct sc_mjpeg_worker *worker,
+                     const AVCodecContext *ctx) {
+    worker->encoder_ctx = NULL;
+    worker->frame = av_frame_alloc();
+    worker->rendition = av_frame_alloc();
+    worker->packet = av_packet_alloc();
+    if (!worker->frame || !worker->rendition || !worker->packet) {
+        LOG_OOM();
+        goto error;
+    }
+
+    if (!sc_mjpeg_worker_configure(worker, ctx->width, ctx->height,
+                                   ctx->color_range)) {
+        goto error;
+    }
+
+    worker->busy = false;
+    worker->seq = 0;
+    return true;
+
+error:
+    sc_mjpeg_worker_destroy(worker);
+    return false;
+}
+
+static void
+sc_mjpeg_server_stop_workers(struct sc_mjpeg_server *server,
+                             unsigned count) {
+    sc_mutex_lock(&server->mutex);
+    server->ended = true;
+    sc_cond_broadcast(&server->pool_cond);
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+
+    for (unsigned i = 0; i < count; ++i) {
+        sc_thread_join(&server->workers[i].thread, NULL);
+    }
+}
+
+static bool
+sc_mjpeg_frame_sink_open(struct sc_frame_sink *sink,
+                         const AVCodecContext *ctx) {
+    struct sc_mjpeg_server *server = DOWNCAST(sink);
+
+    if (ctx->pix_fmt != AV_PIX_FMT_YUV420P) {
+        LOGE("MJPEG: unsupported pixel format: %s",
+             av_get_pix_fmt_name(ctx->pix_fmt));
+        return false;
+    }
+
+    unsigned count = server->worker_count;
+    unsigned i;
+    for (i = 0; i < count; ++i) {
+        struct sc_mjpeg_worker *worker = &server->workers[i];
+        if (!sc_mjpeg_worker_init(worker, ctx)) {
+            goto error;
+        }
+
+        bool ok = sc_thread_create(&worker->thread, run_mjpeg_worker,
+                                   "mjpeg-worker", worker);
+        if (!ok) {
+            LOGE("MJPEG: could not start worker thread");
+            sc_mjpeg_worker_destroy(worker);
+            goto error;
+        }
+    }
+
+    server->workers_started = true;
+
+    LOGI("MJPEG: encoding %dx%d frames with %u workers",
+         server->workers[0].encoder_ctx->width,
+         server->workers[0].encoder_ctx->height, count);
+    return true;
+
+error:
+    sc_mjpeg_server_stop_workers(server, i);
+    while (i--) {
+        sc_mjpeg_worker_destroy(&server->workers[i]);
+    }
+    return false;
+}
+
+static void
+sc_mjpeg_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_mjpeg_server *server = DOWNCAST(sink);
+    assert(server->workers_started);
+
+    sc_mjpeg_server_stop_workers(server, server->worker_count);
+    for (unsigned i = 0; i < server->worker_count; ++i) {
+        sc_mjpeg_worker_destroy(&server->workers[i]);
+    }
+    server->workers_started = false;
+}
+
+static bool
+sc_mjpeg_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_mjpeg_server *server = DOWNCAST(sink);
+
+    sc_mutex_lock(&server->mutex);
+
+    sc_tick now = sc_tick_now();
+    if (server->max_fps && server->next_seq
+            && now - server->last_frame_tick
+                    < SC_TICK_FREQ / server->max_fps) {
+        // Frame rate limited
+        sc_mutex_unlock(&server->mutex);
+        return true;
+    }
+
+    // Frames are assigned to the workers in turn, so that the images are
+    // published in order
+    struct sc_mjpeg_worker *worker =
+        &server->workers[server->next_seq % server->worker_count];
+    if (worker->busy) {
+        // All the workers are busy, drop the frame
+        sc_mutex_unlock(&server->mutex);
+        sc_metrics_add(SC_METRIC_MJPEG_DROPPED, 1);
+        LOGV("MJPEG: frame dropped");
+        return true;
+    }
+
+    if (av_frame_ref(worker->frame, frame)) {
+        sc_mutex_unlock(&server->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    worker->seq = server->next_seq++;
+    worker->busy = true;
+    server->last_frame_tick = now;
+    sc_cond_broadcast(&server->pool_cond);
+
+    sc_mutex_unlock(&server->mutex);
+    return true;
+}
+
+static bool
+sc_mjpeg_frame_sink_wants_frames(struct sc_frame_sink *sink) {
+    struct sc_mjpeg_server *server = DOWNCAST(sink);
+
+    sc_mutex_lock(&server->mutex);
+    bool wants_frames = server->consumers;
+    sc_mutex_unlock(&server->mutex);
+
+    return wants_frames;
+}
+
+// Wait for an image more recent than the image number *count, and return a
+// reference to it (or NULL if the server is stopped or ended)
+static struct sc_mjpeg_frame *
+sc_mjpeg_server_wait_image(struct sc_mjpeg_server *server, uint64_t *count) {
+    sc_mutex_lock(&server->mutex);
+    while (!server->stopped && !server->ended
+            && server->image_count == *count) {
+        sc_cond_wait(&server->cond, &server->mutex);
+    }
+
+    struct sc_mjpeg_frame *image = NULL;
+    if (!server->stopped && server->image_count != *count) {
+        assert(server->image);
+        image = server->image;
+        ++image->refs;
+        *count = server->image_count;
+    }
+    sc_mutex_unlock(&server->mutex);
+
+    return image;
+}
+
+static void
+sc_mjpeg_server_release_image(struct sc_mjpeg_server *server,
+                              struct sc_mjpeg_frame *image) {
+    sc_mutex_lock(&server->mutex);
+    sc_mjpeg_frame_unref(image);
+    sc_mutex_unlock(&server->mutex);
+}
+
+// Register a client waiting for images, and return the number of the image
+// to wait after (the last image is only recent if frames were being decoded)
+static uint64_t
+sc_mjpeg_server_add_consumer(struct sc_mjpeg_server *server) {
+    sc_mutex_lock(&server->mutex);
+    uint64_t count = server->consumers++ ? 0 : server->image_count;
+    sc_mutex_unlock(&server->mutex);
+    return count;
+}
+
+static void
+sc_mjpeg_server_remove_consumer(struct sc_mjpeg_server *server) {
+    sc_mutex_lock(&server->mutex);
+    assert(server->consumers);
+    --server->consumers;
+    sc_mutex_unlock(&server->mutex);
+}
+
+static void
+sc_mjpeg_server_serve_snapshot(struct sc_mjpeg_server *server,
+                               sc_socket socket) {
+    uint64_t count = sc_mjpeg_server_add_consumer(server);
+    struct sc_mjpeg_frame *image = sc_mjpeg_server_wait_image(server, &count);
+    sc_mjpeg_server_remove_consumer(server);
+    if (!image) {
+        return;
+    }
+
+    sc_http_send_response(socket, "200 OK", "image/jpeg", image->data,
+                          image->len);
+    sc_mjpeg_server_release_image(server, image);
+}
+
+static void
+sc_mjpeg_server_serve_stream(struct sc_mjpeg_server *server,
+                             sc_socket socket) {
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: multipart/x-mixed-replace; boundary="
+            SC_MJPEG_BOUNDARY "\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    bool ok = sc_http_send(socket, header, sizeof(header) - 1);
+
+    LOGI("MJPEG: client started streaming");
+    sc_metrics_add(SC_METRIC_MJPEG_CLIENTS, 1);
+
+    uint64_t count = sc_mjpeg_server_add_consumer(server);
+    while (ok) {
+        struct sc_mjpeg_frame *image =
+            sc_mjpeg_server_wait_image(server, &count);
+        if (!image) {
+            break;
+        }
+
+        char part[128];
+        int n = snprintf(part, sizeof(part),
+                         "--" SC_MJPEG_BOUNDARY "\r\n"
+                         "Content-Type: image/jpeg\r\n"
+                         "Content-Length: %" SC_PRIsizet "\r\n"
+                         "\r\n", image->len);
+        assert(n > 0 && (size_t) n < sizeof(part));
+        ok = sc_http_send(socket, part, n)
+          && sc_http_send(socket, image->data, image->len)
+          && sc_http_send(socket, "\r\n", 2);
+
+        sc_mjpeg_server_release_image(server, image);
+    }
+
+    sc_mjpeg_server_remove_consumer(server);
+    sc_metrics_add(SC_METRIC_MJPEG_CLIENTS, -1);
+}
+
+static void
+sc_mjpeg_server_on_request(struct sc_http_server *http, sc_socket socket,
+                           const char *path, void *userdata) {
+    (void) http;
+    struct sc_mjpeg_server *server = userdata;
+
+    if (!strcmp(path, SC_MJPEG_SNAPSHOT_PATH)) {
+        sc_mjpeg_server_serve_snapshot(server, socket);
+    } else {
+        // Any other path serves the stream, so that the server URL can be
+        // used directly
+        sc_mjpeg_server_serve_stream(server, socket);
+    }
+}
+
+bool
+sc_mjpeg_server_init(struct sc_mjpeg_server *server, uint16_t port,
+                     struct sc_rendition_cache *renditions,
+                     uint16_t max_size, uint16_t max_fps,
+                     unsigned worker_count) {
+    const struct sc_http_server_params params = {
+        .name = "MJPEG",
+        .thread_name = "mjpeg-server",
+        .client_thread_name = "mjpeg-client",
+        .port = port,
+        .max_clients = SC_HTTP_SERVER_MAX_CLIENTS,
+    };
+
+    static const struct sc_http_server_callbacks http_cbs = {
+        .on_request = sc_mjpeg_server_on_request,
+    };
+
+    bool ok = sc_http_server_init(&server->http, &params, &http_cbs, server);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_mutex_init(&server->mutex);
+    if (!ok) {
+        goto error_destroy_http;
+    }
+
+    ok = sc_cond_init(&server->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    ok = sc_cond_init(&server->pool_cond);
+    if (!ok) {
+        goto error_cond_destroy;
+    }
+
+    if (!worker_count) {
+        int cpus = av_cpu_count();
+        worker_count = cpus > 0 ? cpus : 1;
+    }
+    if (worker_count > SC_MJPEG_SERVER_MAX_WORKERS) {
+        worker_count = SC_MJPEG_SERVER_MAX_WORKERS;
+    }
+
+    server->renditions = renditions;
+    server->max_size = max_size;
+    server->max_fps = max_fps;
+    server->worker_count = worker_count;
+    server->stopped = false;
+    server->ended = false;
+    server->workers_started = false;
+    server->next_seq = 0;
+    server->publish_seq = 0;
+    server->last_frame_tick = 0;
+    server->image = NULL;
+    server->image_count = 0;
+    server->consumers = 0;
+
+    for (unsigned i = 0; i < SC_MJPEG_SERVER_MAX_WORKERS; ++i) {
+        server->workers[i].server = server;
+    }
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_mjpeg_frame_sink_open,
+        .close = sc_mjpeg_frame_sink_close,
+        .push = sc_mjpeg_frame_sink_push,
+        .wants_frames = sc_mjpeg_frame_sink_wants_frames,
+    };
+
+    server->frame_sink.ops = &ops;
+
+    return true;
+
+error_cond_destroy:
+    sc_cond_destroy(&server->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&server->mutex);
+error_destroy_http:
+    sc_http_server_destroy(&server->http);
+
+    return false;
+}
+
+bool
+sc_mjpeg_server_start(struct sc_mjpeg_server *server) {
+    if (!sc_http_server_start(&server->http)) {
+        return false;
+    }
+
+    LOGI("MJPEG server listening on http://127.0.0.1:%" PRIu16 "/",
+         server->http.params.port);
+    return true;
+}
+
+void
+sc_mjpeg_server_stop(struct sc_mjpeg_server *server) {
+    sc_mutex_lock(&server->mutex);
+    server->stopped = true;
+    sc_cond_broadcast(&server->cond);
+    sc_mutex_unlock(&server->mutex);
+
+    sc_http_server_stop(&server->http);
+}
+
+void
+sc_mjpeg_server_join(struct sc_mjpeg_server *server) {
+    sc_http_server_join(&server->http);
+}
+
+void
+sc_mjpeg_server_destroy(struct sc_mjpeg_server *server) {
+    // The frame sink must be closed
+    assert(!server->workers_started);
+
+    if (server->image) {
+        sc_mjpeg_frame_unref(server->image);
+    }
+
+    sc_cond_destroy(&server->pool_cond);
+    sc_cond_destroy(&server->cond);
+    sc_mutex_destroy(&server->mutex);
+    sc_http_server_destroy(&server->http);
+}
@@ -0,0 +1,114 @@
+#ifndef SC_MJPEG_SERVER_H
+#define SC_MJPEG_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "rendition_cache.h"
+#include "trait/frame_sink.h"
+#include "util/http_server.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_MJPEG_SERVER_MAX_WORKERS 16
+
+/**
+ * Encoded JPEG image, shared by all the clients
+ */
+struct sc_mjpeg_frame {
+    unsigned refs; // protected by the server mutex
+    size_t len;
+    uint8_t data[];
+};
+
+struct sc_mjpeg_worker {
+    struct sc_mjpeg_server *server;
+    sc_thread thread;
+
+    // Only accessed from the worker thread once started (except frame, which
+    // is set by the frame sink while the worker is not busy)
+    AVCodecContext *encoder_ctx;
+    AVFrame *frame; // reference to the decoded frame to encode
+    AVFrame *rendition; // reference to the (scaled) frame to encode
+    AVPacket *packet;
+    // Size of the input frames the encoder is configured for (the encoder is
+    // reconfigured when the video size changes)
+    unsigned input_width;
+    unsigned input_height;
+
+    // Protected by the server mutex
+    bool busy; // a frame is assigned to this worker
+    uint64_t seq; // sequence number of the assigned frame
+};
+
+/**
+ * HTTP server streaming the decoded frames as multipart MJPEG.
+ *
+ * The frames are encoded to JPEG in parallel by a pool of workers (one frame
+ * per worker), and published in order. The last published image is shared by
+ * all the clients (a slow client just skips the intermediate images).
+ */
+struct sc_mjpeg_server {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    struct sc_http_server http;
+
+    // To get the scaled frames (shared with the other frame consumers)
+    struct sc_rendition_cache *renditions;
+    uint16_t max_size; // 0 for no scaling
+    uint16_t max_fps; // 0 for no limit
+    unsigned worker_count;
+
+    sc_mutex mutex;
+    // Signaled when a new image is published (or on stop/end)
+    sc_cond cond;
+    // Signaled when a frame is assigned to a worker, or when an image is
+    // published (workers wait for their turn to publish)
+    sc_cond pool_cond;
+    bool stopped;
+    // Set once the frame sink is closed (no more images)
+    bool ended;
+
+    bool workers_started;
+    uint64_t next_seq; // sequence number of the next frame to encode
+    uint64_t publish_seq; // sequence number of the next image to publish
+    sc_tick last_frame_tick; // to limit the frame rate
+
+    struct sc_mjpeg_frame *image; // last published image, may be NULL
+    uint64_t image_count; // number of images published
+    // Number of clients waiting for images (streams and pending snapshots):
+    // if there are none, the frames are not decoded
+    unsigned consumers;
+
+    struct sc_mjpeg_worker workers[SC_MJPEG_SERVER_MAX_WORKERS];
+};
+
+/**
+ * Initialize the server
+ *
+ * The server frame sink must be a sink of the rendition cache.
+ *
+ * If worker_count is 0, use one worker per CPU core.
+ */
+bool
+sc_mjpeg_server_init(struct sc_mjpeg_server *server, uint16_t port,
+                     struct sc_rendition_cache *renditions,
+                     uint16_t max_size, uint16_t max_fps,
+                     unsigned worker_count);
+
+bool
+sc_mjpeg_server_start(struct sc_mjpeg_server *server);
+
+void
+sc_mjpeg_server_stop(struct sc_mjpeg_server *server);
+
+void
+sc_mjpeg_server_join(struct sc_mjpeg_server *server);
+
+void
+sc_mjpeg_server_destroy(struct sc_mjpeg_server *server);
+
+#endif
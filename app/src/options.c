@@ -106,8 +106,15 @@ const struct scrcpy_options scrcpy_options_default = {
     .camera_high_speed = false,
     .list = 0,
     .window = true,
+#ifdef HAVE_SDL
+    .headless = false,
+#else
+    .headless = true,
+#endif
+    .resume = false,
     .mouse_hover = true,
     .audio_dup = false,
+    .audio_raw_aggregation = 0,
     .new_display = NULL,
     .start_app = NULL,
     .angle = NULL,
@@ -115,6 +122,22 @@ const struct scrcpy_options scrcpy_options_default = {
     .vd_system_decorations = true,
     .tcp_restream_port = 0,
     .tcp_control_forwarding_port = 0,
+    .tcp_websocket = false,
+    .tcp_timeshift = 0,
+    .tcp_pacing_rate = 0,
+    .rtsp_port = 0,
+    .fmp4_port = 0,
+    .mjpeg_port = 0,
+    .mjpeg_max_size = 0,
+    .mjpeg_max_fps = 0,
+    .mjpeg_workers = 0,
+    .metrics_port = 0,
+    .trace_filename = NULL,
+    .trace_signal = false,
+    .latency_test = 0,
+    .latency_test_event = SC_LATENCY_TEST_EVENT_TOUCH,
+    .latency_test_region = {0},
+    .thread_policy_count = 0,
 };
 
 enum sc_orientation
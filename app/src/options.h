@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "util/thread_policy.h"
 #include "util/tick.h"
 
 enum sc_log_level {
@@ -225,6 +226,19 @@ struct sc_port_range {
     uint16_t last;
 };
 
+enum sc_latency_test_event {
+    SC_LATENCY_TEST_EVENT_TOUCH,
+    SC_LATENCY_TEST_EVENT_KEY,
+};
+
+// In video frame coordinates
+struct sc_latency_test_region {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width; // 0 for the default region
+    uint16_t height;
+};
+
 #define SC_WINDOW_POSITION_UNDEFINED (-0x8000)
 
 struct scrcpy_options {
@@ -321,14 +335,34 @@ struct scrcpy_options {
 #define SC_OPTION_LIST_APPS 0x10
     uint8_t list;
     bool window;
+    bool headless; // no SDL at all (always true without SDL)
+    bool resume; // resume the streams when the device connection is lost
     bool mouse_hover;
     bool audio_dup;
+    uint16_t audio_raw_aggregation; // in milliseconds, 0 to disable
     const char *new_display; // [<width>x<height>][/<dpi>] parsed by the server
     const char *start_app;
     bool vd_destroy_content;
     bool vd_system_decorations;
     uint16_t tcp_restream_port; // 0 = disabled
     uint16_t tcp_control_forwarding_port; // 0 = disabled
+    bool tcp_websocket;
+    sc_tick tcp_timeshift; // 0 = disabled
+    uint32_t tcp_pacing_rate; // bits per second, 0 = unlimited
+    uint16_t rtsp_port; // 0 = disabled
+    uint16_t fmp4_port; // 0 = disabled
+    uint16_t mjpeg_port; // 0 = disabled
+    uint16_t mjpeg_max_size; // 0 = unlimited
+    uint16_t mjpeg_max_fps; // 0 = unlimited
+    unsigned mjpeg_workers; // 0 = one per CPU core
+    uint16_t metrics_port; // 0 = disabled
+    const char *trace_filename;
+    bool trace_signal; // dump the trace on SIGUSR1 (set by the executable)
+    unsigned latency_test; // number of measurements, 0 = disabled
+    enum sc_latency_test_event latency_test_event;
+    struct sc_latency_test_region latency_test_region;
+    struct sc_thread_policy thread_policies[SC_THREAD_POLICY_MAX];
+    unsigned thread_policy_count;
 };
 
 extern const struct scrcpy_options scrcpy_options_default;
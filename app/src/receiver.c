@@ -2,7 +2,11 @@
 
 #include <assert.h>
 #include <inttypes.h>
-#include <SDL2/SDL_clipboard.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL.h>
+#endif
 
 #include "device_msg.h"
 #include "events.h"
@@ -10,12 +14,14 @@
 #include "util/str.h"
 #include "util/thread.h"
 
+#ifdef HAVE_SDL
 struct sc_uhid_output_task_data {
     struct sc_uhid_devices *uhid_devices;
     uint16_t id;
     uint16_t size;
     uint8_t *data;
 };
+#endif
 
 bool
 sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
@@ -47,6 +53,14 @@ task_set_clipboard(void *userdata) {
 
     char *text = userdata;
 
+#ifdef HAVE_SDL
+    if (!SDL_WasInit(SDL_INIT_VIDEO)) {
+        // No clipboard (e.g. in headless mode)
+        LOGD("Device clipboard ignored (no computer clipboard)");
+        free(text);
+        return;
+    }
+
     char *current = SDL_GetClipboardText();
     bool same = current && !strcmp(current, text);
     SDL_free(current);
@@ -56,10 +70,14 @@ task_set_clipboard(void *userdata) {
         LOGI("Device clipboard copied");
         SDL_SetClipboardText(text);
     }
+#else
+    LOGD("Device clipboard ignored (no computer clipboard)");
+#endif
 
     free(text);
 }
 
+#ifdef HAVE_SDL
 static void
 task_uhid_output(void *userdata) {
     assert(sc_thread_get_id() == SC_MAIN_THREAD_ID);
@@ -72,6 +90,7 @@ task_uhid_output(void *userdata) {
     free(data->data);
     free(data);
 }
+#endif
 
 static void
 process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
@@ -126,6 +145,7 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
                 return;
             }
 
+#ifdef HAVE_SDL
             struct sc_uhid_output_task_data *data = malloc(sizeof(*data));
             if (!data) {
                 LOG_OOM();
@@ -148,6 +168,11 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
                 free(data);
                 return;
             }
+#else
+            // Without SDL, there are no UHID devices
+            assert(!"unexpected UHID devices");
+            sc_device_msg_destroy(msg);
+#endif
 
             break;
     }
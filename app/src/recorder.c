@@ -9,7 +9,10 @@
 #include <libavutil/time.h>
 #include <libavutil/display.h>
 
+#include "metrics.h"
+#include "util/binary.h"
 #include "util/log.h"
+#include "util/trace.h"
 #include "util/str.h"
 
 /** Downcast packet sinks to recorder */
@@ -20,6 +23,11 @@
 
 static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
 
+#define SC_RECORDER_AVIO_BUFFER_SIZE 65536
+
+// Session marker payload: video width and height (4 bytes each)
+#define SC_RECORDER_SESSION_MARKER_SIZE 8
+
 static const AVOutputFormat *
 find_muxer(const char *name) {
 #ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
@@ -53,6 +61,37 @@ sc_recorder_packet_ref(const AVPacket *packet) {
     return p;
 }
 
+// A session marker is queued in the video queue to start a new segment on the
+// next config packet (in-memory output only): it is a packet without PTS
+// flagged as key frame (which a config packet never is), containing the new
+// video size
+static AVPacket *
+sc_recorder_session_marker_new(const AVCodecContext *ctx) {
+    AVPacket *p = av_packet_alloc();
+    if (!p) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (av_new_packet(p, SC_RECORDER_SESSION_MARKER_SIZE)) {
+        LOG_OOM();
+        av_packet_free(&p);
+        return NULL;
+    }
+
+    sc_write32be(p->data, ctx->width);
+    sc_write32be(p->data + 4, ctx->height);
+    p->pts = AV_NOPTS_VALUE;
+    p->dts = AV_NOPTS_VALUE;
+    p->flags |= AV_PKT_FLAG_KEY;
+    return p;
+}
+
+static inline bool
+sc_recorder_is_session_marker(const AVPacket *packet) {
+    return packet->pts == AV_NOPTS_VALUE && packet->flags & AV_PKT_FLAG_KEY;
+}
+
 static void
 sc_recorder_queue_clear(struct sc_recorder_queue *queue) {
     while (!sc_vecdeque_is_empty(queue)) {
@@ -103,6 +142,23 @@ sc_recorder_rescale_packet(AVStream *stream, AVPacket *packet) {
     av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, stream->time_base);
 }
 
+static inline bool
+sc_recorder_is_in_memory(struct sc_recorder *recorder) {
+    return !recorder->filename;
+}
+
+// Must be called with the mutex locked
+static void
+sc_recorder_update_queue_metrics(struct sc_recorder *recorder) {
+    bool in_memory = sc_recorder_is_in_memory(recorder);
+    sc_metrics_set(in_memory ? SC_METRIC_FMP4_VIDEO_QUEUE
+                             : SC_METRIC_RECORDER_VIDEO_QUEUE,
+                   sc_vecdeque_size(&recorder->video_queue));
+    sc_metrics_set(in_memory ? SC_METRIC_FMP4_AUDIO_QUEUE
+                             : SC_METRIC_RECORDER_AUDIO_QUEUE,
+                   sc_vecdeque_size(&recorder->audio_queue));
+}
+
 static bool
 sc_recorder_write_stream(struct sc_recorder *recorder,
                          struct sc_recorder_stream *st, AVPacket *packet) {
@@ -117,7 +173,71 @@ sc_recorder_write_stream(struct sc_recorder *recorder,
     } else {
         st->last_pts = packet->pts;
     }
-    return av_interleaved_write_frame(recorder->ctx, packet) >= 0;
+
+    sc_trace_begin("recorder write");
+    int ret;
+    if (sc_recorder_is_in_memory(recorder)) {
+        // Each fragment is flushed immediately, the packets must not be
+        // retained for interleaving
+        ret = av_write_frame(recorder->ctx, packet);
+    } else {
+        ret = av_interleaved_write_frame(recorder->ctx, packet);
+    }
+    sc_trace_end("recorder write");
+
+    return ret >= 0;
+}
+
+#ifdef SCRCPY_LAVF_HAS_AVIO_WRITE_CONST_BUFFER
+static int
+sc_recorder_avio_write(void *opaque, const uint8_t *buf, int buf_size) {
+#else
+static int
+sc_recorder_avio_write(void *opaque, uint8_t *buf, int buf_size) {
+#endif
+    struct sc_recorder *recorder = opaque;
+
+    bool ok = sc_vector_push_all(&recorder->buffer, buf, buf_size);
+    if (!ok) {
+        LOG_OOM();
+        return AVERROR(ENOMEM);
+    }
+
+    return buf_size;
+}
+
+static bool
+sc_recorder_flush_init_segment(struct sc_recorder *recorder) {
+    assert(sc_recorder_is_in_memory(recorder));
+
+    avio_flush(recorder->ctx->pb);
+    bool ok = recorder->cbs->on_init_segment(recorder, recorder->buffer.data,
+                                             recorder->buffer.size,
+                                             recorder->cbs_userdata);
+    recorder->buffer.size = 0;
+    return ok;
+}
+
+static bool
+sc_recorder_flush_fragment(struct sc_recorder *recorder, bool key_frame) {
+    assert(sc_recorder_is_in_memory(recorder));
+
+    // With movflags=frag_custom, writing a NULL packet flushes the fragment
+    if (av_write_frame(recorder->ctx, NULL) < 0) {
+        return false;
+    }
+
+    avio_flush(recorder->ctx->pb);
+    if (!recorder->buffer.size) {
+        // Nothing to flush
+        return true;
+    }
+
+    bool ok = recorder->cbs->on_fragment(recorder, recorder->buffer.data,
+                                         recorder->buffer.size, key_frame,
+                                         recorder->cbs_userdata);
+    recorder->buffer.size = 0;
+    return ok;
 }
 
 static inline bool
@@ -130,8 +250,50 @@ sc_recorder_write_audio(struct sc_recorder *recorder, AVPacket *packet) {
     return sc_recorder_write_stream(recorder, &recorder->audio_stream, packet);
 }
 
+static bool
+sc_recorder_open_output_memory(struct sc_recorder *recorder) {
+    const AVOutputFormat *format = find_muxer("mp4");
+    if (!format) {
+        LOGE("Could not find muxer");
+        return false;
+    }
+
+    recorder->ctx = avformat_alloc_context();
+    if (!recorder->ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    uint8_t *buffer = av_malloc(SC_RECORDER_AVIO_BUFFER_SIZE);
+    if (!buffer) {
+        LOG_OOM();
+        avformat_free_context(recorder->ctx);
+        return false;
+    }
+
+    recorder->ctx->pb = avio_alloc_context(buffer,
+                                           SC_RECORDER_AVIO_BUFFER_SIZE, 1,
+                                           recorder, NULL,
+                                           sc_recorder_avio_write, NULL);
+    if (!recorder->ctx->pb) {
+        LOG_OOM();
+        av_free(buffer);
+        avformat_free_context(recorder->ctx);
+        return false;
+    }
+
+    // See sc_recorder_open_output_file()
+    recorder->ctx->oformat = (AVOutputFormat *) format;
+
+    return true;
+}
+
 static bool
 sc_recorder_open_output_file(struct sc_recorder *recorder) {
+    if (sc_recorder_is_in_memory(recorder)) {
+        return sc_recorder_open_output_memory(recorder);
+    }
+
     const char *format_name = sc_recorder_get_format_name(recorder->format);
     assert(format_name);
     const AVOutputFormat *format = find_muxer(format_name);
@@ -175,7 +337,12 @@ sc_recorder_open_output_file(struct sc_recorder *recorder) {
 
 static void
 sc_recorder_close_output_file(struct sc_recorder *recorder) {
-    avio_close(recorder->ctx->pb);
+    if (sc_recorder_is_in_memory(recorder)) {
+        av_freep(&recorder->ctx->pb->buffer);
+        avio_context_free(&recorder->ctx->pb);
+    } else {
+        avio_close(recorder->ctx->pb);
+    }
     avformat_free_context(recorder->ctx);
 }
 
@@ -196,6 +363,129 @@ sc_recorder_must_wait_for_config_packets(struct sc_recorder *recorder) {
     return false;
 }
 
+// If discontinuous is true, the fragments are timestamped from the packets
+// PTS rather than from 0 (for a new segment following a previous one)
+static bool
+sc_recorder_write_header(struct sc_recorder *recorder, bool discontinuous) {
+    if (!sc_recorder_is_in_memory(recorder)) {
+        bool ok = avformat_write_header(recorder->ctx, NULL) >= 0;
+        if (!ok) {
+            LOGE("Failed to write header to %s", recorder->filename);
+        }
+        return ok;
+    }
+
+    // Fragmented MP4, suitable for Media Source Extensions: an empty moov in
+    // the init segment, then fragments flushed explicitly
+    const char *movflags = discontinuous
+        ? "frag_custom+empty_moov+default_base_moof+frag_discont"
+        : "frag_custom+empty_moov+default_base_moof";
+    AVDictionary *opts = NULL;
+    av_dict_set(&opts, "movflags", movflags, 0);
+    bool ok = avformat_write_header(recorder->ctx, &opts) >= 0;
+    av_dict_free(&opts);
+    if (!ok) {
+        LOGE("Failed to write fragmented MP4 header");
+        return false;
+    }
+
+    return sc_recorder_flush_init_segment(recorder);
+}
+
+// Restart the in-memory muxer for a new video session, so that a new init
+// segment (with the new video size and codec extradata) is delivered before
+// the next fragments
+static bool
+sc_recorder_start_segment(struct sc_recorder *recorder,
+                          const AVPacket *config_packet, unsigned width,
+                          unsigned height) {
+    assert(sc_recorder_is_in_memory(recorder));
+    // In-memory output is never rotated, the orientation needs not be restored
+    assert(recorder->orientation == SC_ORIENTATION_0);
+
+    AVFormatContext *ctx = recorder->ctx;
+    assert(ctx->nb_streams <= 2);
+    unsigned stream_count = ctx->nb_streams;
+
+    AVCodecParameters *params[2] = {NULL, NULL};
+    AVRational time_bases[2];
+
+    bool ok = false;
+
+    for (unsigned i = 0; i < stream_count; ++i) {
+        params[i] = avcodec_parameters_alloc();
+        if (!params[i]
+                || avcodec_parameters_copy(params[i],
+                                           ctx->streams[i]->codecpar) < 0) {
+            LOG_OOM();
+            goto end;
+        }
+        time_bases[i] = ctx->streams[i]->time_base;
+    }
+
+    // Terminate the current segment (the trailer is useless for a live
+    // fragmented stream, it is not delivered)
+    if (!sc_recorder_flush_fragment(recorder, false)) {
+        goto end;
+    }
+    av_write_trailer(ctx);
+    recorder->buffer.size = 0;
+    sc_recorder_close_output_file(recorder);
+
+    if (!sc_recorder_open_output_memory(recorder)) {
+        recorder->ctx = NULL;
+        goto end;
+    }
+
+    ctx = recorder->ctx;
+    for (unsigned i = 0; i < stream_count; ++i) {
+        AVStream *stream = avformat_new_stream(ctx, NULL);
+        if (!stream
+                || avcodec_parameters_copy(stream->codecpar, params[i]) < 0) {
+            LOG_OOM();
+            goto end;
+        }
+        assert(stream->index == (int) i);
+
+        if ((int) i == recorder->video_stream.index) {
+            stream->codecpar->width = width;
+            stream->codecpar->height = height;
+            av_freep(&stream->codecpar->extradata);
+            stream->codecpar->extradata_size = 0;
+            if (!sc_recorder_set_extradata(stream, config_packet)) {
+                goto end;
+            }
+        }
+    }
+
+    if (!sc_recorder_write_header(recorder, true)) {
+        goto end;
+    }
+
+    // The muxer may have chosen other time bases
+    struct sc_recorder_stream *streams[] = {
+        &recorder->video_stream,
+        &recorder->audio_stream,
+    };
+    for (unsigned i = 0; i < ARRAY_LEN(streams); ++i) {
+        struct sc_recorder_stream *st = streams[i];
+        if (st->index >= 0 && st->last_pts != AV_NOPTS_VALUE) {
+            st->last_pts = av_rescale_q(st->last_pts, time_bases[st->index],
+                                        ctx->streams[st->index]->time_base);
+        }
+    }
+
+    LOGI("Recording: new segment (%ux%u)", width, height);
+    ok = true;
+
+end:
+    for (unsigned i = 0; i < stream_count; ++i) {
+        avcodec_parameters_free(&params[i]);
+    }
+
+    return ok;
+}
+
 static bool
 sc_recorder_process_header(struct sc_recorder *recorder) {
     sc_mutex_lock(&recorder->mutex);
@@ -262,13 +552,7 @@ sc_recorder_process_header(struct sc_recorder *recorder) {
         }
     }
 
-    bool ok = avformat_write_header(recorder->ctx, NULL) >= 0;
-    if (!ok) {
-        LOGE("Failed to write header to %s", recorder->filename);
-        goto end;
-    }
-
-    ret = true;
+    ret = sc_recorder_write_header(recorder, false);
 
 end:
     if (video_pkt) {
@@ -297,6 +581,12 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
     // we can set its duration (next_pts - current_pts)
     AVPacket *video_pkt_previous = NULL;
 
+    // Set by a session marker: a new segment must be started on the next
+    // video config packet
+    bool segment_pending = false;
+    unsigned segment_width = 0;
+    unsigned segment_height = 0;
+
     bool error = false;
 
     for (;;) {
@@ -346,8 +636,47 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
 
         assert(video_pkt || audio_pkt); // at least one
 
+        sc_recorder_update_queue_metrics(recorder);
         sc_mutex_unlock(&recorder->mutex);
 
+        if (video_pkt && sc_recorder_is_session_marker(video_pkt)) {
+            segment_pending = true;
+            segment_width = sc_read32be(video_pkt->data);
+            segment_height = sc_read32be(video_pkt->data + 4);
+            av_packet_free(&video_pkt);
+            video_pkt = NULL;
+        }
+
+        if (segment_pending && video_pkt && video_pkt->pts == AV_NOPTS_VALUE) {
+            // The config packet of the new session provides the extradata
+            segment_pending = false;
+
+            if (video_pkt_previous) {
+                // The next packet belongs to the new segment, assign an
+                // arbitrary duration to the last packet of this segment
+                video_pkt_previous->duration = 100000;
+                bool key_frame = video_pkt_previous->flags & AV_PKT_FLAG_KEY;
+                bool ok = sc_recorder_write_video(recorder, video_pkt_previous);
+                av_packet_free(&video_pkt_previous);
+                if (ok) {
+                    ok = sc_recorder_flush_fragment(recorder, key_frame);
+                }
+                if (!ok) {
+                    LOGE("Could not record video packet");
+                    error = true;
+                    goto end;
+                }
+            }
+
+            bool ok = sc_recorder_start_segment(recorder, video_pkt,
+                                                segment_width, segment_height);
+            if (!ok) {
+                LOGE("Could not start a new segment");
+                error = true;
+                goto end;
+            }
+        }
+
         // Ignore further config packets (e.g. on device orientation
         // change). The next non-config packet will have the config packet
         // data prepended.
@@ -361,6 +690,11 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
             audio_pkt = NULL;
         }
 
+        if (!video_pkt && !audio_pkt) {
+            // The packets were consumed (session marker or config packet)
+            continue;
+        }
+
         if (pts_origin == AV_NOPTS_VALUE) {
             if (!recorder->audio) {
                 assert(video_pkt);
@@ -397,8 +731,13 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
                 video_pkt_previous->duration = video_pkt->pts
                                              - video_pkt_previous->pts;
 
+                bool key_frame = video_pkt_previous->flags & AV_PKT_FLAG_KEY;
                 bool ok = sc_recorder_write_video(recorder, video_pkt_previous);
                 av_packet_free(&video_pkt_previous);
+                if (ok && sc_recorder_is_in_memory(recorder)) {
+                    // One fragment per video frame
+                    ok = sc_recorder_flush_fragment(recorder, key_frame);
+                }
                 if (!ok) {
                     LOGE("Could not record video packet");
                     error = true;
@@ -415,6 +754,10 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
             audio_pkt->dts = audio_pkt->pts;
 
             bool ok = sc_recorder_write_audio(recorder, audio_pkt);
+            if (ok && !recorder->video && sc_recorder_is_in_memory(recorder)) {
+                // Without video, one fragment per audio packet
+                ok = sc_recorder_flush_fragment(recorder, true);
+            }
             if (!ok) {
                 LOGE("Could not record audio packet");
                 error = true;
@@ -441,10 +784,19 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
         av_packet_free(&last);
     }
 
-    int ret = av_write_trailer(recorder->ctx);
-    if (ret < 0) {
-        LOGE("Failed to write trailer to %s", recorder->filename);
-        error = false;
+    if (sc_recorder_is_in_memory(recorder)) {
+        // The trailer is useless for a live fragmented stream (it would
+        // contain an mfra box), just flush the pending samples
+        if (!sc_recorder_flush_fragment(recorder, false)) {
+            LOGW("Could not flush the last fragment");
+        }
+        av_write_trailer(recorder->ctx);
+    } else {
+        int ret = av_write_trailer(recorder->ctx);
+        if (ret < 0) {
+            LOGE("Failed to write trailer to %s", recorder->filename);
+            error = false;
+        }
     }
 
 end:
@@ -466,7 +818,10 @@ sc_recorder_record(struct sc_recorder *recorder) {
     }
 
     ok = sc_recorder_process_packets(recorder);
-    sc_recorder_close_output_file(recorder);
+    // The context is NULL if a new segment could not be opened
+    if (recorder->ctx) {
+        sc_recorder_close_output_file(recorder);
+    }
     return ok;
 }
 
@@ -488,7 +843,11 @@ run_recorder(void *data) {
     sc_recorder_queue_clear(&recorder->audio_queue);
     sc_mutex_unlock(&recorder->mutex);
 
-    if (success) {
+    if (sc_recorder_is_in_memory(recorder)) {
+        if (!success) {
+            LOGE("Fragmented MP4 muxing failed");
+        }
+    } else if (success) {
         const char *format_name = sc_recorder_get_format_name(recorder->format);
         LOGI("Recording complete to %s file: %s", format_name,
                                                   recorder->filename);
@@ -627,6 +986,49 @@ sc_recorder_video_packet_sink_push(struct sc_packet_sink *sink,
         return false;
     }
 
+    sc_recorder_update_queue_metrics(recorder);
+    sc_cond_signal(&recorder->cond);
+
+    sc_mutex_unlock(&recorder->mutex);
+    return true;
+}
+
+static bool
+sc_recorder_video_packet_sink_session(struct sc_packet_sink *sink,
+                                      const AVCodecContext *ctx) {
+    struct sc_recorder *recorder = DOWNCAST_VIDEO(sink);
+    // only written from this thread, no need to lock
+    assert(recorder->video_init);
+
+    if (!sc_recorder_is_in_memory(recorder)) {
+        // The file header is written only once: the container keeps the
+        // initial video size, the new parameter sets are provided in-band
+        LOGI("Recording: video size changed to %dx%d", ctx->width,
+             ctx->height);
+        return true;
+    }
+
+    sc_mutex_lock(&recorder->mutex);
+
+    if (recorder->stopped) {
+        sc_mutex_unlock(&recorder->mutex);
+        return false;
+    }
+
+    AVPacket *marker = sc_recorder_session_marker_new(ctx);
+    if (!marker) {
+        sc_mutex_unlock(&recorder->mutex);
+        return false;
+    }
+
+    bool ok = sc_vecdeque_push(&recorder->video_queue, marker);
+    if (!ok) {
+        LOG_OOM();
+        av_packet_free(&marker);
+        sc_mutex_unlock(&recorder->mutex);
+        return false;
+    }
+
     sc_cond_signal(&recorder->cond);
 
     sc_mutex_unlock(&recorder->mutex);
@@ -714,6 +1116,7 @@ sc_recorder_audio_packet_sink_push(struct sc_packet_sink *sink,
         return false;
     }
 
+    sc_recorder_update_queue_metrics(recorder);
     sc_cond_signal(&recorder->cond);
 
     sc_mutex_unlock(&recorder->mutex);
@@ -749,11 +1152,19 @@ sc_recorder_init(struct sc_recorder *recorder, const char *filename,
                  const struct sc_recorder_callbacks *cbs, void *cbs_userdata) {
     assert(!sc_orientation_is_mirror(orientation));
 
-    recorder->filename = strdup(filename);
-    if (!recorder->filename) {
-        LOG_OOM();
-        return false;
+    if (filename) {
+        recorder->filename = strdup(filename);
+        if (!recorder->filename) {
+            LOG_OOM();
+            return false;
+        }
+    } else {
+        // In-memory fragmented MP4
+        assert(format == SC_RECORD_FORMAT_MP4);
+        assert(cbs && cbs->on_init_segment && cbs->on_fragment);
+        recorder->filename = NULL;
     }
+    sc_vector_init(&recorder->buffer);
 
     bool ok = sc_mutex_init(&recorder->mutex);
     if (!ok) {
@@ -794,6 +1205,7 @@ sc_recorder_init(struct sc_recorder *recorder, const char *filename,
             .open = sc_recorder_video_packet_sink_open,
             .close = sc_recorder_video_packet_sink_close,
             .push = sc_recorder_video_packet_sink_push,
+            .session = sc_recorder_video_packet_sink_session,
         };
 
         recorder->video_packet_sink.ops = &video_ops;
@@ -849,5 +1261,6 @@ void
 sc_recorder_destroy(struct sc_recorder *recorder) {
     sc_cond_destroy(&recorder->cond);
     sc_mutex_destroy(&recorder->mutex);
+    sc_vector_destroy(&recorder->buffer);
     free(recorder->filename);
 }
@@ -12,8 +12,10 @@
 #include "trait/packet_sink.h"
 #include "util/thread.h"
 #include "util/vecdeque.h"
+#include "util/vector.h"
 
 struct sc_recorder_queue SC_VECDEQUE(AVPacket *);
+struct sc_recorder_buffer SC_VECTOR(uint8_t);
 
 struct sc_recorder_stream {
     int index;
@@ -37,10 +39,14 @@ struct sc_recorder {
 
     enum sc_orientation orientation;
 
+    // NULL for in-memory fragmented MP4 output
     char *filename;
     enum sc_record_format format;
     AVFormatContext *ctx;
 
+    // Muxed data not delivered yet (only for in-memory output)
+    struct sc_recorder_buffer buffer;
+
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
@@ -65,8 +71,28 @@ struct sc_recorder {
 struct sc_recorder_callbacks {
     void (*on_ended)(struct sc_recorder *recorder, bool success,
                      void *userdata);
+
+    // Only for in-memory output (filename == NULL), called from the recorder
+    // thread with the init segment (ftyp + moov), before any fragment
+    bool (*on_init_segment)(struct sc_recorder *recorder, const uint8_t *data,
+                            size_t len, void *userdata);
+
+    // Only for in-memory output (filename == NULL), called from the recorder
+    // thread for each fragment (moof + mdat)
+    //
+    // If key_frame is true, then the fragment starts with a video key frame
+    // (a client may start playing from there).
+    bool (*on_fragment)(struct sc_recorder *recorder, const uint8_t *data,
+                        size_t len, bool key_frame, void *userdata);
 };
 
+/**
+ * Initialize a recorder
+ *
+ * If filename is NULL, then the recording is not written to a file: a
+ * fragmented MP4 (one fragment per video frame) is muxed in memory and
+ * delivered via cbs->on_init_segment() and cbs->on_fragment().
+ */
 bool
 sc_recorder_init(struct sc_recorder *recorder, const char *filename,
                  enum sc_record_format format, bool video, bool audio,
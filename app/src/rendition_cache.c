@@ -0,0 +1,414 @@
+#include "rendition_cache.h"
+
+#include <assert.h>
+#include <libavutil/pixdesc.h>
+
+#include "metrics.h"
+#include "util/log.h"
+#include "util/pixconv.h"
+#include "util/scale.h"
+
+/** Downcast frame_sink to sc_rendition_cache */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_rendition_cache, frame_sink)
+
+bool
+sc_rendition_compute_size(const struct sc_rendition_spec *spec,
+                          unsigned width, unsigned height,
+                          unsigned *out_width, unsigned *out_height) {
+    if (spec->width) {
+        assert(spec->height);
+        if (spec->width > width || spec->height > height) {
+            return false;
+        }
+
+        *out_width = spec->width;
+        *out_height = spec->height;
+        return true;
+    }
+
+    sc_scale_compute_size(width, height, spec->max_size, out_width,
+                          out_height);
+    return true;
+}
+
+static AVFrame *
+sc_rendition_alloc(const AVFrame *frame, unsigned width, unsigned height,
+                   enum AVPixelFormat format) {
+    AVFrame *rendition = av_frame_alloc();
+    if (!rendition) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    rendition->format = format;
+    rendition->width = width;
+    rendition->height = height;
+    if (av_frame_get_buffer(rendition, 0) < 0
+            || av_frame_copy_props(rendition, frame) < 0) {
+        LOG_OOM();
+        av_frame_free(&rendition);
+        return NULL;
+    }
+
+    return rendition;
+}
+
+// Scale the frame to YUV420P, or only its luma plane to GRAY8
+static AVFrame *
+sc_rendition_scale(const AVFrame *frame, unsigned width, unsigned height,
+                   enum AVPixelFormat format) {
+    assert(format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_GRAY8);
+
+    AVFrame *rendition;
+    if (format == AV_PIX_FMT_YUV420P && width == (unsigned) frame->width
+            && height == (unsigned) frame->height) {
+        // Nothing to compute, share the decoded frame
+        rendition = av_frame_clone(frame);
+        if (!rendition) {
+            LOG_OOM();
+        }
+        return rendition;
+    }
+
+    rendition = sc_rendition_alloc(frame, width, height, format);
+    if (!rendition) {
+        return NULL;
+    }
+
+    unsigned planes = format == AV_PIX_FMT_GRAY8 ? 1 : 3;
+    for (unsigned i = 0; i < planes; ++i) {
+        // Planes 1 and 2 are the chroma planes (subsampled in YUV420P)
+        unsigned shift = i ? 1 : 0;
+        unsigned src_w = (frame->width + shift) >> shift;
+        unsigned src_h = (frame->height + shift) >> shift;
+        unsigned dst_w = (width + shift) >> shift;
+        unsigned dst_h = (height + shift) >> shift;
+        sc_scale_plane_down(frame->data[i], frame->linesize[i], src_w, src_h,
+                            rendition->data[i], rendition->linesize[i], dst_w,
+                            dst_h);
+    }
+
+    return rendition;
+}
+
+static AVFrame *
+sc_rendition_compute(struct sc_rendition_cache *cache, const AVFrame *frame,
+                     unsigned width, unsigned height,
+                     enum AVPixelFormat format) {
+    if (format == AV_PIX_FMT_YUV420P) {
+        return sc_rendition_scale(frame, width, height, format);
+    }
+
+    if (format == AV_PIX_FMT_GRAY8) {
+        // The (scaled) luma plane, expanded to full range in place
+        AVFrame *rendition = sc_rendition_scale(frame, width, height, format);
+        if (rendition) {
+            sc_pixconv_to_gray(rendition->data[0], rendition->linesize[0],
+                               width, height, rendition->data[0],
+                               rendition->linesize[0]);
+            rendition->color_range = AVCOL_RANGE_JPEG;
+        }
+        return rendition;
+    }
+
+    // Converted from the YUV420P rendition of the same size (itself cached)
+    struct sc_rendition_spec yuv_spec = {
+        .width = width,
+        .height = height,
+        .max_size = 0,
+        .format = AV_PIX_FMT_YUV420P,
+    };
+
+    AVFrame *yuv = av_frame_alloc();
+    if (!yuv) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (!sc_rendition_cache_get(cache, frame, &yuv_spec, yuv)) {
+        av_frame_free(&yuv);
+        return NULL;
+    }
+
+    AVFrame *rendition = sc_rendition_alloc(frame, width, height, format);
+    if (!rendition) {
+        av_frame_free(&yuv);
+        return NULL;
+    }
+
+    struct sc_pixconv_yuv420p src = {
+        .data = {yuv->data[0], yuv->data[1], yuv->data[2]},
+        .linesize = {yuv->linesize[0], yuv->linesize[1], yuv->linesize[2]},
+        .width = width,
+        .height = height,
+    };
+
+    if (format == AV_PIX_FMT_RGB24) {
+        sc_pixconv_to_rgb24(&src, rendition->data[0], rendition->linesize[0]);
+        rendition->color_range = AVCOL_RANGE_JPEG;
+    } else {
+        assert(format == AV_PIX_FMT_NV12);
+        sc_pixconv_to_nv12(&src, rendition->data[0], rendition->linesize[0],
+                           rendition->data[1], rendition->linesize[1]);
+    }
+
+    av_frame_free(&yuv);
+    return rendition;
+}
+
+// Must be called with the mutex locked
+static void
+sc_rendition_slot_reset(struct sc_rendition_slot *slot) {
+    for (unsigned i = 0; i < slot->count; ++i) {
+        // A pending rendition is released by the thread computing it, which
+        // detects the reset by the sequence number
+        av_frame_free(&slot->renditions[i].frame);
+    }
+    slot->count = 0;
+    av_frame_unref(slot->frame);
+}
+
+// Must be called with the mutex locked
+static struct sc_rendition_slot *
+sc_rendition_cache_find_slot(struct sc_rendition_cache *cache,
+                             const AVFrame *frame) {
+    for (unsigned i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        struct sc_rendition_slot *slot = &cache->slots[i];
+        // The slot holds a reference, so the data cannot belong to another
+        // frame
+        if (slot->frame->buf[0] && slot->frame->data[0] == frame->data[0]) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static struct sc_rendition *
+sc_rendition_slot_find(struct sc_rendition_slot *slot, unsigned width,
+                       unsigned height, enum AVPixelFormat format) {
+    for (unsigned i = 0; i < slot->count; ++i) {
+        struct sc_rendition *r = &slot->renditions[i];
+        if (r->width == width && r->height == height && r->format == format) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+bool
+sc_rendition_cache_get(struct sc_rendition_cache *cache, const AVFrame *frame,
+                       const struct sc_rendition_spec *spec, AVFrame *out) {
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        LOGW("Rendition: unsupported frame format: %s",
+             av_get_pix_fmt_name(frame->format));
+        return false;
+    }
+
+    if (spec->format != AV_PIX_FMT_YUV420P
+            && spec->format != AV_PIX_FMT_GRAY8
+            && spec->format != AV_PIX_FMT_RGB24
+            && spec->format != AV_PIX_FMT_NV12) {
+        LOGE("Rendition: unsupported pixel format: %s",
+             av_get_pix_fmt_name(spec->format));
+        return false;
+    }
+
+    unsigned width;
+    unsigned height;
+    if (!sc_rendition_compute_size(spec, frame->width, frame->height, &width,
+                                   &height)) {
+        LOGE("Rendition: could not upscale %dx%d to %ux%u", frame->width,
+             frame->height, (unsigned) spec->width, (unsigned) spec->height);
+        return false;
+    }
+
+    sc_mutex_lock(&cache->mutex);
+
+    // The rendition to compute and store in the cache, if any
+    struct sc_rendition *r = NULL;
+    uint64_t seq = 0;
+
+    struct sc_rendition_slot *slot =
+        sc_rendition_cache_find_slot(cache, frame);
+    if (slot) {
+        seq = slot->seq;
+        r = sc_rendition_slot_find(slot, width, height, spec->format);
+        if (r) {
+            while (slot->seq == seq && r->pending) {
+                sc_cond_wait(&cache->cond, &cache->mutex);
+            }
+
+            if (slot->seq == seq && r->frame) {
+                int ret = av_frame_ref(out, r->frame);
+                sc_mutex_unlock(&cache->mutex);
+                if (ret) {
+                    LOG_OOM();
+                    return false;
+                }
+
+                sc_metrics_add(SC_METRIC_RENDITIONS_SHARED, 1);
+                return true;
+            }
+
+            // The frame has been evicted meanwhile, or the rendition could not
+            // be computed: compute it without caching
+            r = NULL;
+        } else if (slot->count < SC_RENDITION_CACHE_MAX_RENDITIONS) {
+            r = &slot->renditions[slot->count++];
+            r->width = width;
+            r->height = height;
+            r->format = spec->format;
+            r->frame = NULL;
+            r->pending = true;
+        }
+    }
+
+    sc_mutex_unlock(&cache->mutex);
+
+    // Computed out of the lock, the other renditions are not blocked
+    AVFrame *rendition = sc_rendition_compute(cache, frame, width, height,
+                                              spec->format);
+    bool ok = false;
+    if (rendition) {
+        sc_metrics_add(SC_METRIC_RENDITIONS_COMPUTED, 1);
+        ok = !av_frame_ref(out, rendition);
+        if (!ok) {
+            LOG_OOM();
+        }
+    }
+
+    if (r) {
+        sc_mutex_lock(&cache->mutex);
+        if (slot->seq == seq) {
+            // Still cached (on failure, store NULL so that the waiting threads
+            // compute it themselves)
+            assert(r->pending);
+            r->frame = rendition;
+            r->pending = false;
+            rendition = NULL;
+            sc_cond_broadcast(&cache->cond);
+        }
+        sc_mutex_unlock(&cache->mutex);
+    }
+
+    av_frame_free(&rendition);
+    return ok;
+}
+
+static bool
+sc_rendition_cache_frame_sink_open(struct sc_frame_sink *sink,
+                                   const AVCodecContext *ctx) {
+    struct sc_rendition_cache *cache = DOWNCAST(sink);
+    return sc_frame_source_sinks_open(&cache->frame_source, ctx);
+}
+
+static void
+sc_rendition_cache_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_rendition_cache *cache = DOWNCAST(sink);
+    sc_frame_source_sinks_close(&cache->frame_source);
+
+    // Release the decoded frames
+    sc_mutex_lock(&cache->mutex);
+    for (unsigned i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        struct sc_rendition_slot *slot = &cache->slots[i];
+        sc_rendition_slot_reset(slot);
+        slot->seq = cache->next_seq++;
+    }
+    sc_cond_broadcast(&cache->cond);
+    sc_mutex_unlock(&cache->mutex);
+}
+
+static bool
+sc_rendition_cache_frame_sink_push(struct sc_frame_sink *sink,
+                                   const AVFrame *frame) {
+    struct sc_rendition_cache *cache = DOWNCAST(sink);
+
+    sc_mutex_lock(&cache->mutex);
+    // Evict the oldest frame
+    struct sc_rendition_slot *slot =
+        &cache->slots[cache->next_seq % SC_RENDITION_CACHE_FRAMES];
+    sc_rendition_slot_reset(slot);
+    slot->seq = cache->next_seq++;
+    int ret = av_frame_ref(slot->frame, frame);
+    // Wake up the threads waiting for a rendition of the evicted frame
+    sc_cond_broadcast(&cache->cond);
+    sc_mutex_unlock(&cache->mutex);
+
+    if (ret) {
+        LOG_OOM();
+        return false;
+    }
+
+    return sc_frame_source_sinks_push(&cache->frame_source, frame);
+}
+
+static bool
+sc_rendition_cache_frame_sink_wants_frames(struct sc_frame_sink *sink) {
+    struct sc_rendition_cache *cache = DOWNCAST(sink);
+    return sc_frame_source_sinks_want_frames(&cache->frame_source);
+}
+
+bool
+sc_rendition_cache_init(struct sc_rendition_cache *cache) {
+    bool ok = sc_mutex_init(&cache->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&cache->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    unsigned i;
+    for (i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        struct sc_rendition_slot *slot = &cache->slots[i];
+        slot->frame = av_frame_alloc();
+        if (!slot->frame) {
+            LOG_OOM();
+            goto error_free_frames;
+        }
+        slot->seq = 0;
+        slot->count = 0;
+    }
+
+    // The first frame gets a sequence number different from the free slots
+    cache->next_seq = 1;
+
+    sc_frame_source_init(&cache->frame_source);
+
+    static const struct sc_frame_sink_ops ops = {
+        .open = sc_rendition_cache_frame_sink_open,
+        .close = sc_rendition_cache_frame_sink_close,
+        .push = sc_rendition_cache_frame_sink_push,
+        .wants_frames = sc_rendition_cache_frame_sink_wants_frames,
+    };
+
+    cache->frame_sink.ops = &ops;
+
+    return true;
+
+error_free_frames:
+    while (i--) {
+        av_frame_free(&cache->slots[i].frame);
+    }
+    sc_cond_destroy(&cache->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&cache->mutex);
+
+    return false;
+}
+
+void
+sc_rendition_cache_destroy(struct sc_rendition_cache *cache) {
+    for (unsigned i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        struct sc_rendition_slot *slot = &cache->slots[i];
+        sc_rendition_slot_reset(slot);
+        av_frame_free(&slot->frame);
+    }
+
+    sc_cond_destroy(&cache->cond);
+    sc_mutex_destroy(&cache->mutex);
+}
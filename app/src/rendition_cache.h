@@ -0,0 +1,105 @@
+#ifndef SC_RENDITION_CACHE_H
+#define SC_RENDITION_CACHE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#include "trait/frame_sink.h"
+#include "trait/frame_source.h"
+#include "util/thread.h"
+
+// Number of recent frames for which the renditions are kept
+#define SC_RENDITION_CACHE_FRAMES 4
+// Maximum number of distinct renditions kept per frame
+#define SC_RENDITION_CACHE_MAX_RENDITIONS 8
+
+/**
+ * Rendition (size and pixel format) of a decoded frame
+ */
+struct sc_rendition_spec {
+    // Exact size (the aspect ratio is not preserved), or 0x0 to use max_size
+    uint16_t width;
+    uint16_t height;
+    // Largest dimension, preserving the aspect ratio (0 for the frame size)
+    uint16_t max_size;
+    // AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_RGB24 (full range) or
+    // AV_PIX_FMT_GRAY8 (full range)
+    enum AVPixelFormat format;
+};
+
+struct sc_rendition {
+    // Resolved size and format (two specs may resolve to the same rendition)
+    unsigned width;
+    unsigned height;
+    enum AVPixelFormat format;
+    // NULL while the rendition is computed (by the thread which requested it
+    // first), or if it could not be computed
+    AVFrame *frame;
+    bool pending;
+};
+
+struct sc_rendition_slot {
+    // Reference to a decoded frame (unreferenced if the slot is free): the
+    // decoder cannot reuse its buffers, so frame->data[0] identifies it
+    AVFrame *frame;
+    uint64_t seq; // sequence number of the frame, to detect slot reuse
+    struct sc_rendition renditions[SC_RENDITION_CACHE_MAX_RENDITIONS];
+    unsigned count;
+};
+
+/**
+ * Frame processing stage between the video decoder and the frame consumers
+ * needing scaled or converted copies of the frames.
+ *
+ * The frames are forwarded as is to the sinks. From push() (or later, from any
+ * thread, as long as it holds a reference to the frame), a sink requests a
+ * rendition by sc_rendition_cache_get(): each rendition is computed only once
+ * per frame, on the first request, and shared (by reference) by all the
+ * consumers requesting it.
+ */
+struct sc_rendition_cache {
+    struct sc_frame_source frame_source; // frame source trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    sc_mutex mutex;
+    // Signaled when a pending rendition is computed (or dropped)
+    sc_cond cond;
+
+    struct sc_rendition_slot slots[SC_RENDITION_CACHE_FRAMES];
+    uint64_t next_seq;
+};
+
+bool
+sc_rendition_cache_init(struct sc_rendition_cache *cache);
+
+void
+sc_rendition_cache_destroy(struct sc_rendition_cache *cache);
+
+/**
+ * Compute the size of a rendition of a width x height frame
+ *
+ * Return false if the rendition would be larger than the frame (upscaling is
+ * not supported).
+ */
+bool
+sc_rendition_compute_size(const struct sc_rendition_spec *spec,
+                          unsigned width, unsigned height,
+                          unsigned *out_width, unsigned *out_height);
+
+/**
+ * Reference the requested rendition of a frame into out (which must be
+ * unreferenced)
+ *
+ * The frame must be a decoded YUV420P frame pushed to the cache (or a
+ * reference to it). If the frame is not (or no longer) cached, the rendition
+ * is computed without being cached.
+ */
+bool
+sc_rendition_cache_get(struct sc_rendition_cache *cache, const AVFrame *frame,
+                       const struct sc_rendition_spec *spec, AVFrame *out);
+
+#endif
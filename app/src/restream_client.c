@@ -0,0 +1,663 @@
+// Standalone library: do not include common.h (it depends on SDL headers)
+#include "config.h"
+
+#include "restream_client.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# include <winsock2.h>
+# include <ws2tcpip.h>
+# include <windows.h>
+#else
+# include <netdb.h>
+# include <sys/socket.h>
+# include <time.h>
+# include <unistd.h>
+#endif
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+
+#ifdef _WIN32
+typedef SOCKET sc_rc_socket;
+# define SC_RC_SOCKET_NONE INVALID_SOCKET
+# define SC_RC_SHUT_RDWR SD_BOTH
+# define sc_rc_closesocket closesocket
+#else
+typedef int sc_rc_socket;
+# define SC_RC_SOCKET_NONE -1
+# define SC_RC_SHUT_RDWR SHUT_RDWR
+# define sc_rc_closesocket close
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+#define SC_RC_PACKET_FLAG_CONFIG    (UINT64_C(1) << 63)
+#define SC_RC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+#define SC_RC_PACKET_PTS_MASK       (SC_RC_PACKET_FLAG_KEY_FRAME - 1)
+
+#define SC_RC_HEADER_SIZE 12
+#define SC_RC_CODEC_INFO_SIZE 12
+#define SC_RC_SEEK_REQUEST_SIZE 12
+
+// Reject corrupted packet sizes instead of allocating gigabytes
+#define SC_RC_MAX_PACKET_SIZE (1 << 26)
+
+// Read-ahead buffer, to receive the headers and the small packets in a few
+// recv() calls (larger payloads are received directly in the packet buffer)
+#define SC_RC_READ_BUFFER_SIZE 0x10000
+
+#define SC_RC_MIN_RECONNECT_DELAY_MS 100
+#define SC_RC_DEFAULT_MAX_RECONNECT_DELAY_MS 2000
+
+struct sc_restream_client {
+    char *host;
+    uint16_t port;
+    bool reconnect;
+    uint32_t max_reconnect_delay_ms;
+    bool decode;
+
+    // Accessed by sc_restream_client_interrupt() from another thread
+    _Atomic(sc_rc_socket) socket;
+    atomic_bool interrupted;
+
+    struct sc_restream_info info;
+    struct sc_restream_stats stats;
+
+    // Skip the packets until the next key frame
+    bool syncing;
+
+    uint8_t read_buf[SC_RC_READ_BUFFER_SIZE];
+    size_t read_head;
+    size_t read_len;
+
+    // Packet buffer, reused (and grown) for all the packets
+    uint8_t *buf;
+    size_t buf_size;
+
+    AVCodecContext *codec_ctx;
+    AVPacket *av_packet;
+    AVFrame *av_frame;
+    bool has_frame;
+
+    // Contiguous copy of the last frame, reused for all the frames
+    uint8_t *packed;
+    size_t packed_size;
+};
+
+static uint32_t
+sc_rc_read32be(const uint8_t *buf) {
+    return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+}
+
+static uint64_t
+sc_rc_read64be(const uint8_t *buf) {
+    return ((uint64_t) sc_rc_read32be(buf) << 32) | sc_rc_read32be(&buf[4]);
+}
+
+static void
+sc_rc_write32be(uint8_t *buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static void
+sc_rc_write64be(uint8_t *buf, uint64_t value) {
+    sc_rc_write32be(buf, value >> 32);
+    sc_rc_write32be(&buf[4], (uint32_t) value);
+}
+
+static void
+sc_rc_sleep_ms(uint32_t ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (ms % 1000) * 1000000L,
+    };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Receive at least min_len bytes (and at most len bytes), return the number of
+// bytes received, or 0 on error or end of stream
+static size_t
+sc_rc_recv(struct sc_restream_client *client, uint8_t *buf, size_t min_len,
+           size_t len) {
+    assert(min_len && min_len <= len);
+
+    sc_rc_socket sock = atomic_load(&client->socket);
+    size_t received = 0;
+    while (received < min_len) {
+        size_t remaining = len - received;
+#ifdef _WIN32
+        int chunk = remaining > INT32_MAX ? INT32_MAX : (int) remaining;
+        int r = recv(sock, (char *) buf + received, chunk, 0);
+#else
+        ssize_t r = recv(sock, buf + received, remaining, 0);
+#endif
+        if (r <= 0) {
+            return 0;
+        }
+        received += r;
+    }
+    return received;
+}
+
+static bool
+sc_rc_read(struct sc_restream_client *client, uint8_t *buf, size_t len) {
+    size_t n = len < client->read_len ? len : client->read_len;
+    memcpy(buf, &client->read_buf[client->read_head], n);
+    client->read_head += n;
+    client->read_len -= n;
+    buf += n;
+    len -= n;
+
+    if (!len) {
+        return true;
+    }
+
+    assert(!client->read_len);
+    if (len >= SC_RC_READ_BUFFER_SIZE / 2) {
+        // Large payload, avoid a copy
+        return sc_rc_recv(client, buf, len, len);
+    }
+
+    size_t r = sc_rc_recv(client, client->read_buf, len,
+                          SC_RC_READ_BUFFER_SIZE);
+    if (!r) {
+        return false;
+    }
+
+    memcpy(buf, client->read_buf, len);
+    client->read_head = len;
+    client->read_len = r - len;
+    return true;
+}
+
+static bool
+sc_rc_send_all(struct sc_restream_client *client, const uint8_t *buf,
+               size_t len) {
+    sc_rc_socket sock = atomic_load(&client->socket);
+    while (len) {
+#ifdef _WIN32
+        int r = send(sock, (const char *) buf, (int) len, 0);
+#else
+        ssize_t r = send(sock, buf, len, MSG_NOSIGNAL);
+#endif
+        if (r <= 0) {
+            return false;
+        }
+        buf += r;
+        len -= r;
+    }
+    return true;
+}
+
+static sc_rc_socket
+sc_rc_connect(const char *host, uint16_t port) {
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned) port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result;
+    if (getaddrinfo(host, service, &hints, &result)) {
+        return SC_RC_SOCKET_NONE;
+    }
+
+    sc_rc_socket sock = SC_RC_SOCKET_NONE;
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock == SC_RC_SOCKET_NONE) {
+            continue;
+        }
+        if (!connect(sock, ai->ai_addr, ai->ai_addrlen)) {
+            break;
+        }
+        sc_rc_closesocket(sock);
+        sock = SC_RC_SOCKET_NONE;
+    }
+
+    freeaddrinfo(result);
+    return sock;
+}
+
+static void
+sc_rc_close_socket(struct sc_restream_client *client) {
+    sc_rc_socket sock = atomic_exchange(&client->socket, SC_RC_SOCKET_NONE);
+    if (sock != SC_RC_SOCKET_NONE) {
+        sc_rc_closesocket(sock);
+    }
+}
+
+static bool
+sc_rc_open_decoder(struct sc_restream_client *client) {
+    enum AVCodecID codec_id = client->info.codec_id == SC_RESTREAM_CODEC_ID_H264
+                            ? AV_CODEC_ID_H264
+                            : AV_CODEC_ID_HEVC;
+    const AVCodec *codec = avcodec_find_decoder(codec_id);
+    if (!codec) {
+        return false;
+    }
+
+    client->codec_ctx = avcodec_alloc_context3(codec);
+    if (!client->codec_ctx) {
+        return false;
+    }
+
+    client->codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+
+    if (avcodec_open2(client->codec_ctx, codec, NULL) < 0) {
+        avcodec_free_context(&client->codec_ctx);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_rc_apply_codec_info(struct sc_restream_client *client, const uint8_t *buf) {
+    uint32_t codec_id = sc_rc_read32be(buf);
+    if (codec_id != SC_RESTREAM_CODEC_ID_H264
+            && codec_id != SC_RESTREAM_CODEC_ID_H265) {
+        return false;
+    }
+
+    bool codec_changed = codec_id != client->info.codec_id;
+
+    client->info.codec_id = codec_id;
+    client->info.width = sc_rc_read32be(&buf[4]);
+    client->info.height = sc_rc_read32be(&buf[8]);
+    ++client->info.session;
+
+    // The next packets start with a config packet and a key frame (for a new
+    // session or a new client), but after a reconnection the previous packets
+    // must not be mixed with the new ones
+    client->syncing = true;
+
+    if (client->decode) {
+        if (client->has_frame) {
+            av_frame_unref(client->av_frame);
+            client->has_frame = false;
+        }
+        if (codec_changed && client->codec_ctx) {
+            avcodec_free_context(&client->codec_ctx);
+        }
+        if (client->codec_ctx) {
+            avcodec_flush_buffers(client->codec_ctx);
+        } else if (!sc_rc_open_decoder(client)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_rc_connect_stream(struct sc_restream_client *client) {
+    sc_rc_socket sock = sc_rc_connect(client->host, client->port);
+    if (sock == SC_RC_SOCKET_NONE) {
+        return false;
+    }
+
+    atomic_store(&client->socket, sock);
+    client->read_head = 0;
+    client->read_len = 0;
+
+    if (atomic_load(&client->interrupted)) {
+        // sc_restream_client_interrupt() may have been called before the
+        // socket was published
+        sc_rc_close_socket(client);
+        return false;
+    }
+
+    uint8_t buf[SC_RC_CODEC_INFO_SIZE];
+    if (!sc_rc_read(client, buf, sizeof(buf))
+            || !sc_rc_apply_codec_info(client, buf)) {
+        sc_rc_close_socket(client);
+        return false;
+    }
+
+    return true;
+}
+
+static enum sc_restream_status
+sc_rc_reconnect(struct sc_restream_client *client) {
+    sc_rc_close_socket(client);
+
+    if (atomic_load(&client->interrupted)) {
+        return SC_RESTREAM_INTERRUPTED;
+    }
+
+    if (!client->reconnect) {
+        return SC_RESTREAM_EOS;
+    }
+
+    uint32_t delay = SC_RC_MIN_RECONNECT_DELAY_MS;
+    for (;;) {
+        if (sc_rc_connect_stream(client)) {
+            ++client->stats.reconnections;
+            return SC_RESTREAM_OK;
+        }
+
+        // Wait by small steps to react quickly to an interruption
+        for (uint32_t t = 0; t < delay; t += 50) {
+            if (atomic_load(&client->interrupted)) {
+                return SC_RESTREAM_INTERRUPTED;
+            }
+            sc_rc_sleep_ms(50);
+        }
+
+        delay *= 2;
+        if (delay > client->max_reconnect_delay_ms) {
+            delay = client->max_reconnect_delay_ms;
+        }
+    }
+}
+
+static bool
+sc_rc_reserve_buffer(struct sc_restream_client *client, size_t size) {
+    // The decoder requires zeroed padding after the packet data
+    size_t needed = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    if (needed > client->buf_size) {
+        size_t new_size = client->buf_size ? client->buf_size : 4096;
+        while (new_size < needed) {
+            new_size *= 2;
+        }
+        uint8_t *buf = realloc(client->buf, new_size);
+        if (!buf) {
+            return false;
+        }
+        client->buf = buf;
+        client->buf_size = new_size;
+    }
+
+    memset(&client->buf[size], 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    return true;
+}
+
+struct sc_restream_client *
+sc_restream_client_open(const struct sc_restream_client_params *params) {
+    assert(params->host);
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa)) {
+        return NULL;
+    }
+#endif
+
+    struct sc_restream_client *client = calloc(1, sizeof(*client));
+    if (!client) {
+        goto error_cleanup_wsa;
+    }
+
+    client->host = strdup(params->host);
+    if (!client->host) {
+        goto error_free_client;
+    }
+
+    client->port = params->port;
+    client->reconnect = params->reconnect;
+    client->max_reconnect_delay_ms = params->max_reconnect_delay_ms
+                                   ? params->max_reconnect_delay_ms
+                                   : SC_RC_DEFAULT_MAX_RECONNECT_DELAY_MS;
+    client->decode = params->decode;
+    atomic_init(&client->socket, SC_RC_SOCKET_NONE);
+    atomic_init(&client->interrupted, false);
+
+    if (client->decode) {
+        client->av_packet = av_packet_alloc();
+        if (!client->av_packet) {
+            goto error_free_host;
+        }
+
+        client->av_frame = av_frame_alloc();
+        if (!client->av_frame) {
+            goto error_free_packet;
+        }
+    }
+
+    if (!sc_rc_connect_stream(client)) {
+        goto error_free_frame;
+    }
+
+    return client;
+
+error_free_frame:
+    av_frame_free(&client->av_frame);
+error_free_packet:
+    av_packet_free(&client->av_packet);
+error_free_host:
+    free(client->host);
+error_free_client:
+    avcodec_free_context(&client->codec_ctx);
+    free(client);
+error_cleanup_wsa:
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return NULL;
+}
+
+void
+sc_restream_client_close(struct sc_restream_client *client) {
+    sc_rc_close_socket(client);
+
+    avcodec_free_context(&client->codec_ctx);
+    av_frame_free(&client->av_frame);
+    av_packet_free(&client->av_packet);
+    free(client->packed);
+    free(client->buf);
+    free(client->host);
+    free(client);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+enum sc_restream_status
+sc_restream_client_read_packet(struct sc_restream_client *client,
+                               struct sc_restream_packet *packet) {
+    for (;;) {
+        if (atomic_load(&client->interrupted)) {
+            return SC_RESTREAM_INTERRUPTED;
+        }
+
+        uint8_t header[SC_RC_HEADER_SIZE];
+        if (!sc_rc_read(client, header, sizeof(header))) {
+            goto reconnect;
+        }
+
+        uint64_t pts_flags = sc_rc_read64be(header);
+        uint32_t size = sc_rc_read32be(&header[8]);
+        if (size > SC_RC_MAX_PACKET_SIZE) {
+            // Protocol error, the stream cannot be resynchronized
+            goto reconnect;
+        }
+
+        if (!sc_rc_reserve_buffer(client, size)) {
+            return SC_RESTREAM_ERROR;
+        }
+
+        if (size && !sc_rc_read(client, client->buf, size)) {
+            goto reconnect;
+        }
+
+        bool config = pts_flags & SC_RC_PACKET_FLAG_CONFIG;
+        bool key_frame = pts_flags & SC_RC_PACKET_FLAG_KEY_FRAME;
+
+        if (config && key_frame) {
+            // Session packet: the codec info changed
+            if (size != SC_RC_CODEC_INFO_SIZE
+                    || !sc_rc_apply_codec_info(client, client->buf)) {
+                goto reconnect;
+            }
+            continue;
+        }
+
+        ++client->stats.packets;
+        client->stats.bytes += size;
+
+        if (client->syncing && !config) {
+            if (!key_frame) {
+                ++client->stats.skipped;
+                continue;
+            }
+            client->syncing = false;
+        }
+
+        packet->data = client->buf;
+        packet->size = size;
+        packet->pts = config ? -1 : (int64_t) (pts_flags & SC_RC_PACKET_PTS_MASK);
+        packet->config = config;
+        packet->key_frame = key_frame;
+        return SC_RESTREAM_OK;
+
+reconnect:;
+        enum sc_restream_status status = sc_rc_reconnect(client);
+        if (status != SC_RESTREAM_OK) {
+            return status;
+        }
+    }
+}
+
+enum sc_restream_status
+sc_restream_client_read_frame(struct sc_restream_client *client,
+                              struct sc_restream_frame *frame) {
+    assert(client->decode);
+
+    if (client->has_frame) {
+        av_frame_unref(client->av_frame);
+        client->has_frame = false;
+    }
+
+    for (;;) {
+        int r = avcodec_receive_frame(client->codec_ctx, client->av_frame);
+        if (!r) {
+            break;
+        }
+
+        if (r != AVERROR(EAGAIN)) {
+            // Decoding error, restart on the next key frame
+            avcodec_flush_buffers(client->codec_ctx);
+            client->syncing = true;
+        }
+
+        struct sc_restream_packet packet;
+        enum sc_restream_status status =
+            sc_restream_client_read_packet(client, &packet);
+        if (status != SC_RESTREAM_OK) {
+            return status;
+        }
+
+        AVPacket *av_packet = client->av_packet;
+        av_packet->data = (uint8_t *) packet.data;
+        av_packet->size = packet.size;
+        av_packet->pts = packet.config ? AV_NOPTS_VALUE : packet.pts;
+        av_packet->dts = av_packet->pts;
+        av_packet->flags = packet.key_frame ? AV_PKT_FLAG_KEY : 0;
+
+        r = avcodec_send_packet(client->codec_ctx, av_packet);
+        if (r < 0 && r != AVERROR(EAGAIN)) {
+            avcodec_flush_buffers(client->codec_ctx);
+            client->syncing = true;
+        }
+    }
+
+    client->has_frame = true;
+    ++client->stats.frames;
+
+    AVFrame *av_frame = client->av_frame;
+    for (int i = 0; i < 4; ++i) {
+        frame->data[i] = av_frame->data[i];
+        frame->linesize[i] = av_frame->linesize[i];
+    }
+    frame->width = av_frame->width;
+    frame->height = av_frame->height;
+    frame->format = av_frame->format;
+    frame->pts = av_frame->pts;
+    return SC_RESTREAM_OK;
+}
+
+const uint8_t *
+sc_restream_client_pack_frame(struct sc_restream_client *client,
+                              size_t *size) {
+    if (!client->has_frame) {
+        return NULL;
+    }
+
+    AVFrame *av_frame = client->av_frame;
+    int len = av_image_get_buffer_size(av_frame->format, av_frame->width,
+                                       av_frame->height, 1);
+    if (len < 0) {
+        return NULL;
+    }
+
+    if ((size_t) len > client->packed_size) {
+        uint8_t *packed = realloc(client->packed, len);
+        if (!packed) {
+            return NULL;
+        }
+        client->packed = packed;
+        client->packed_size = len;
+    }
+
+    int r = av_image_copy_to_buffer(client->packed, len,
+                                    (const uint8_t *const *) av_frame->data,
+                                    av_frame->linesize, av_frame->format,
+                                    av_frame->width, av_frame->height, 1);
+    if (r < 0) {
+        return NULL;
+    }
+
+    *size = len;
+    return client->packed;
+}
+
+bool
+sc_restream_client_seek(struct sc_restream_client *client, int64_t offset_us,
+                        uint32_t speed) {
+    assert(offset_us <= 0);
+
+    uint8_t buf[SC_RC_SEEK_REQUEST_SIZE];
+    sc_rc_write64be(buf, (uint64_t) offset_us);
+    sc_rc_write32be(&buf[8], speed);
+    return sc_rc_send_all(client, buf, sizeof(buf));
+}
+
+void
+sc_restream_client_interrupt(struct sc_restream_client *client) {
+    atomic_store(&client->interrupted, true);
+
+    // Wake up a blocking recv() (the socket is closed by the reading thread)
+    sc_rc_socket sock = atomic_load(&client->socket);
+    if (sock != SC_RC_SOCKET_NONE) {
+        shutdown(sock, SC_RC_SHUT_RDWR);
+    }
+}
+
+void
+sc_restream_client_get_info(struct sc_restream_client *client,
+                            struct sc_restream_info *info) {
+    *info = client->info;
+}
+
+void
+sc_restream_client_get_stats(struct sc_restream_client *client,
+                             struct sc_restream_stats *stats) {
+    *stats = client->stats;
+}
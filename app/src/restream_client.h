@@ -0,0 +1,159 @@
+#ifndef SC_RESTREAM_CLIENT_H
+#define SC_RESTREAM_CLIENT_H
+
+/**
+ * Client library for the TCP restream (scrcpy --tcp-restream)
+ *
+ * It handles the framing, the reconnection and the synchronization on key
+ * frames, and optionally decodes the video. The returned packets and frames
+ * point to memory owned by the client, reused for the next ones (they are
+ * valid until the next call).
+ *
+ * It does not depend on SDL nor on the rest of scrcpy, so that it can be
+ * built as a standalone shared library (libscrcpy-restream), to be used from
+ * other languages (see scrcpy_restream.py).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SC_RESTREAM_CODEC_ID_H264 UINT32_C(0x68323634) // "h264" in ASCII
+#define SC_RESTREAM_CODEC_ID_H265 UINT32_C(0x68323635) // "h265" in ASCII
+
+enum sc_restream_status {
+    SC_RESTREAM_OK,
+    // The connection is closed (and reconnection is disabled)
+    SC_RESTREAM_EOS,
+    // sc_restream_client_interrupt() was called
+    SC_RESTREAM_INTERRUPTED,
+    SC_RESTREAM_ERROR,
+};
+
+struct sc_restream_client_params {
+    const char *host;
+    uint16_t port;
+    // Reconnect transparently if the connection is lost (the stream resumes
+    // on the next key frame)
+    bool reconnect;
+    // Maximum delay between reconnection attempts, in milliseconds (0 for
+    // the default, 2 seconds)
+    uint32_t max_reconnect_delay_ms;
+    // Decode the video (required for sc_restream_client_read_frame())
+    bool decode;
+};
+
+struct sc_restream_info {
+    uint32_t codec_id;
+    uint32_t width;
+    uint32_t height;
+    // Incremented on each (re)connection and on each session change
+    uint32_t session;
+};
+
+struct sc_restream_packet {
+    const uint8_t *data;
+    size_t size;
+    int64_t pts; // in microseconds, -1 if none (config packets)
+    bool config;
+    bool key_frame;
+};
+
+struct sc_restream_frame {
+    // Planes of the decoded frame (zero-copy, owned by the decoder)
+    const uint8_t *data[4];
+    int linesize[4];
+    int width;
+    int height;
+    // enum AVPixelFormat (usually AV_PIX_FMT_YUV420P)
+    int format;
+    int64_t pts;
+};
+
+struct sc_restream_stats {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t frames;
+    // Packets skipped while waiting for a key frame
+    uint64_t skipped;
+    uint64_t reconnections;
+};
+
+struct sc_restream_client;
+
+/**
+ * Connect to the restream server and read the codec info
+ *
+ * Return NULL on error.
+ */
+struct sc_restream_client *
+sc_restream_client_open(const struct sc_restream_client_params *params);
+
+void
+sc_restream_client_close(struct sc_restream_client *client);
+
+/**
+ * Read the next packet
+ *
+ * After (re)connection or a session change, the packets preceding the first
+ * key frame are skipped (except config packets). Session packets are handled
+ * internally (see sc_restream_client_get_info()).
+ */
+enum sc_restream_status
+sc_restream_client_read_packet(struct sc_restream_client *client,
+                               struct sc_restream_packet *packet);
+
+/**
+ * Read packets until a frame is decoded
+ *
+ * The client must have been opened with params->decode set.
+ */
+enum sc_restream_status
+sc_restream_client_read_frame(struct sc_restream_client *client,
+                              struct sc_restream_frame *frame);
+
+/**
+ * Copy the planes of the last frame contiguously (without padding), into a
+ * buffer owned by the client, reused for the next frames
+ *
+ * Return NULL on error.
+ */
+const uint8_t *
+sc_restream_client_pack_frame(struct sc_restream_client *client,
+                              size_t *size);
+
+/**
+ * Request to replay the stream from offset_us (<= 0) relative to live, at
+ * speed percent of the real-time rate (0 for as fast as possible)
+ *
+ * The server must run with --tcp-timeshift.
+ */
+bool
+sc_restream_client_seek(struct sc_restream_client *client, int64_t offset_us,
+                        uint32_t speed);
+
+/**
+ * Interrupt a blocking read (it may be called from another thread)
+ *
+ * The current and further reads return SC_RESTREAM_INTERRUPTED.
+ */
+void
+sc_restream_client_interrupt(struct sc_restream_client *client);
+
+void
+sc_restream_client_get_info(struct sc_restream_client *client,
+                            struct sc_restream_info *info);
+
+void
+sc_restream_client_get_stats(struct sc_restream_client *client,
+                             struct sc_restream_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+#include "rtp.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+#define SC_RTP_H264_NAL_TYPE_FU_A 28
+#define SC_RTP_H265_NAL_TYPE_FU 49
+
+#define SC_RTP_FU_START 0x80
+#define SC_RTP_FU_END 0x40
+
+bool
+sc_rtp_is_supported(enum AVCodecID codec_id) {
+    switch (codec_id) {
+        case AV_CODEC_ID_H264:
+        case AV_CODEC_ID_HEVC:
+        case AV_CODEC_ID_OPUS:
+        case AV_CODEC_ID_AAC:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void
+sc_rtp_packetizer_init(struct sc_rtp_packetizer *p, enum AVCodecID codec_id,
+                       uint8_t payload_type, uint32_t clock_rate,
+                       uint32_t ssrc, uint16_t initial_seq,
+                       uint32_t ts_offset) {
+    assert(sc_rtp_is_supported(codec_id));
+    assert(payload_type < 128);
+    assert(clock_rate);
+
+    p->codec_id = codec_id;
+    p->payload_type = payload_type;
+    p->clock_rate = clock_rate;
+    p->ssrc = ssrc;
+    p->seq = initial_seq;
+    p->ts_offset = ts_offset;
+}
+
+uint32_t
+sc_rtp_timestamp(const struct sc_rtp_packetizer *p, int64_t pts) {
+    assert(pts >= 0);
+    // The RTP timestamp wraps around (this is expected)
+    uint64_t ts = (uint64_t) pts * p->clock_rate / 1000000;
+    return p->ts_offset + (uint32_t) ts;
+}
+
+static inline uint8_t *
+sc_rtp_payload(struct sc_rtp_packetizer *p) {
+    return &p->buf[SC_RTP_INTERLEAVED_HEADER_SIZE + SC_RTP_HEADER_SIZE];
+}
+
+static bool
+sc_rtp_send(struct sc_rtp_packetizer *p, size_t payload_len, bool marker,
+            uint32_t ts, sc_rtp_packet_cb cb, void *userdata) {
+    assert(payload_len <= SC_RTP_MAX_PAYLOAD_SIZE);
+
+    uint8_t *header = &p->buf[SC_RTP_INTERLEAVED_HEADER_SIZE];
+    header[0] = 0x80; // version 2, no padding, no extension, no CSRC
+    header[1] = (marker ? 0x80 : 0) | p->payload_type;
+    sc_write16be(&header[2], p->seq++);
+    sc_write32be(&header[4], ts);
+    sc_write32be(&header[8], p->ssrc);
+
+    return cb(header, SC_RTP_HEADER_SIZE + payload_len, userdata);
+}
+
+static const uint8_t *
+sc_rtp_find_start_code(const uint8_t *p, const uint8_t *end) {
+    while (end - p >= 3) {
+        if (p[2] > 1) {
+            // p[2] can neither be the '1' nor a '0' of a start code
+            p += 3;
+        } else if (!p[0] && !p[1] && p[2] == 1) {
+            return p;
+        } else {
+            ++p;
+        }
+    }
+    return end;
+}
+
+const uint8_t *
+sc_rtp_next_nal(const uint8_t **data, const uint8_t *end, size_t *nal_len) {
+    const uint8_t *p = *data;
+    for (;;) {
+        p = sc_rtp_find_start_code(p, end);
+        if (p == end) {
+            *data = end;
+            return NULL;
+        }
+
+        const uint8_t *nal = p + 3;
+        const uint8_t *next = sc_rtp_find_start_code(nal, end);
+
+        // Trailing zero bytes belong to the next start code (4-byte start
+        // codes) or are trailing_zero_8bits
+        const uint8_t *nal_end = next;
+        while (nal_end > nal && !nal_end[-1]) {
+            --nal_end;
+        }
+
+        p = next;
+        if (nal_end > nal) {
+            *data = next;
+            *nal_len = nal_end - nal;
+            return nal;
+        }
+        // Empty NAL unit, ignore it
+    }
+}
+
+static bool
+sc_rtp_packetize_nal(struct sc_rtp_packetizer *p, const uint8_t *nal,
+                     size_t len, bool last, uint32_t ts, sc_rtp_packet_cb cb,
+                     void *userdata) {
+    uint8_t *payload = sc_rtp_payload(p);
+
+    if (len <= SC_RTP_MAX_PAYLOAD_SIZE) {
+        // Single NAL unit packet
+        memcpy(payload, nal, len);
+        return sc_rtp_send(p, len, last, ts, cb, userdata);
+    }
+
+    // Fragmentation units
+    bool hevc = p->codec_id == AV_CODEC_ID_HEVC;
+    size_t nal_header_size = hevc ? 2 : 1;
+    size_t fu_header_size = nal_header_size + 1;
+    if (len <= nal_header_size) {
+        // Cannot happen (len > SC_RTP_MAX_PAYLOAD_SIZE)
+        assert(false);
+        return false;
+    }
+
+    uint8_t fu_type;
+    if (hevc) {
+        // Payload header: the NAL unit header with the type replaced by FU
+        payload[0] = (nal[0] & 0x81) | (SC_RTP_H265_NAL_TYPE_FU << 1);
+        payload[1] = nal[1];
+        fu_type = (nal[0] >> 1) & 0x3f;
+    } else {
+        // FU indicator: F and NRI bits from the NAL unit header
+        payload[0] = (nal[0] & 0xe0) | SC_RTP_H264_NAL_TYPE_FU_A;
+        fu_type = nal[0] & 0x1f;
+    }
+
+    const uint8_t *data = nal + nal_header_size;
+    size_t remaining = len - nal_header_size;
+    size_t max_chunk = SC_RTP_MAX_PAYLOAD_SIZE - fu_header_size;
+    bool start = true;
+
+    while (remaining) {
+        size_t chunk = MIN(remaining, max_chunk);
+        bool end = chunk == remaining;
+
+        payload[nal_header_size] = fu_type
+                                 | (start ? SC_RTP_FU_START : 0)
+                                 | (end ? SC_RTP_FU_END : 0);
+        memcpy(&payload[fu_header_size], data, chunk);
+
+        bool ok = sc_rtp_send(p, fu_header_size + chunk, last && end, ts, cb,
+                              userdata);
+        if (!ok) {
+            return false;
+        }
+
+        data += chunk;
+        remaining -= chunk;
+        start = false;
+    }
+
+    return true;
+}
+
+static bool
+sc_rtp_packetize_h26x(struct sc_rtp_packetizer *p, const uint8_t *data,
+                      size_t len, uint32_t ts, sc_rtp_packet_cb cb,
+                      void *userdata) {
+    const uint8_t *end = data + len;
+
+    // Look ahead one NAL unit, to know which one is the last of the access
+    // unit (it must have the marker bit set)
+    size_t nal_len;
+    const uint8_t *nal = sc_rtp_next_nal(&data, end, &nal_len);
+    while (nal) {
+        size_t next_len;
+        const uint8_t *next = sc_rtp_next_nal(&data, end, &next_len);
+
+        bool ok = sc_rtp_packetize_nal(p, nal, nal_len, !next, ts, cb,
+                                       userdata);
+        if (!ok) {
+            return false;
+        }
+
+        nal = next;
+        nal_len = next_len;
+    }
+
+    return true;
+}
+
+static bool
+sc_rtp_packetize_aac(struct sc_rtp_packetizer *p, const uint8_t *data,
+                     size_t len, uint32_t ts, sc_rtp_packet_cb cb,
+                     void *userdata) {
+    // The AU-size is 13 bits
+    if (len >= (1 << 13)) {
+        LOGW("RTP: AAC frame too large (%" SC_PRIsizet " bytes), dropped",
+             len);
+        return true;
+    }
+
+    uint8_t *payload = sc_rtp_payload(p);
+
+    // AU-headers-length (in bits), then a single AU-header: 13 bits for the
+    // AU-size, 3 bits for the AU-index (always 0)
+    sc_write16be(&payload[0], 16);
+    sc_write16be(&payload[2], len << 3);
+
+    // An AU larger than the payload is fragmented, each fragment carrying the
+    // same AU-header (RFC 3640 section 3.2.3)
+    size_t max_chunk = SC_RTP_MAX_PAYLOAD_SIZE - 4;
+    while (len) {
+        size_t chunk = MIN(len, max_chunk);
+        bool end = chunk == len;
+        memcpy(&payload[4], data, chunk);
+
+        bool ok = sc_rtp_send(p, 4 + chunk, end, ts, cb, userdata);
+        if (!ok) {
+            return false;
+        }
+
+        data += chunk;
+        len -= chunk;
+    }
+
+    return true;
+}
+
+static bool
+sc_rtp_packetize_opus(struct sc_rtp_packetizer *p, const uint8_t *data,
+                      size_t len, uint32_t ts, sc_rtp_packet_cb cb,
+                      void *userdata) {
+    // An Opus packet must not be fragmented (RFC 7587 section 4.2)
+    if (len > SC_RTP_MAX_PAYLOAD_SIZE) {
+        LOGW("RTP: Opus packet too large (%" SC_PRIsizet " bytes), dropped",
+             len);
+        return true;
+    }
+
+    memcpy(sc_rtp_payload(p), data, len);
+    return sc_rtp_send(p, len, false, ts, cb, userdata);
+}
+
+bool
+sc_rtp_packetize(struct sc_rtp_packetizer *p, const uint8_t *data, size_t len,
+                 int64_t pts, sc_rtp_packet_cb cb, void *userdata) {
+    uint32_t ts = sc_rtp_timestamp(p, pts);
+
+    switch (p->codec_id) {
+        case AV_CODEC_ID_H264:
+        case AV_CODEC_ID_HEVC:
+            return sc_rtp_packetize_h26x(p, data, len, ts, cb, userdata);
+        case AV_CODEC_ID_AAC:
+            return sc_rtp_packetize_aac(p, data, len, ts, cb, userdata);
+        case AV_CODEC_ID_OPUS:
+            return sc_rtp_packetize_opus(p, data, len, ts, cb, userdata);
+        default:
+            assert(!"Unexpected codec");
+            return false;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef SC_RTP_H
+#define SC_RTP_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#define SC_RTP_HEADER_SIZE 12
+
+// Each RTP packet is built with some reserved bytes before it, so that it can
+// be sent interleaved in the RTSP connection (RFC 2326 section 10.12) without
+// any copy.
+#define SC_RTP_INTERLEAVED_HEADER_SIZE 4
+
+// Keep RTP packets (and the UDP datagrams carrying them) below a typical
+// Ethernet MTU
+#define SC_RTP_MAX_PAYLOAD_SIZE 1400
+
+/**
+ * RTP packetizer for H.264 (RFC 6184), H.265 (RFC 7798), Opus (RFC 7587) and
+ * AAC (RFC 3640, AAC-hbr mode).
+ *
+ * H.26x access units are split into NAL units, sent as single NAL unit
+ * packets, or as fragmentation units (FU-A for H.264, FU for H.265) if they
+ * exceed the maximum payload size.
+ */
+struct sc_rtp_packetizer {
+    enum AVCodecID codec_id;
+    uint8_t payload_type;
+    uint32_t clock_rate;
+    uint32_t ssrc;
+    uint16_t seq;
+    uint32_t ts_offset;
+
+    uint8_t buf[SC_RTP_INTERLEAVED_HEADER_SIZE + SC_RTP_HEADER_SIZE
+                + SC_RTP_MAX_PAYLOAD_SIZE];
+};
+
+/**
+ * Callback called for each RTP packet
+ *
+ * The SC_RTP_INTERLEAVED_HEADER_SIZE bytes before `packet` may be written.
+ */
+typedef bool (*sc_rtp_packet_cb)(uint8_t *packet, size_t len, void *userdata);
+
+/**
+ * Return true if the codec can be packetized
+ */
+bool
+sc_rtp_is_supported(enum AVCodecID codec_id);
+
+void
+sc_rtp_packetizer_init(struct sc_rtp_packetizer *p, enum AVCodecID codec_id,
+                       uint8_t payload_type, uint32_t clock_rate,
+                       uint32_t ssrc, uint16_t initial_seq,
+                       uint32_t ts_offset);
+
+/**
+ * Convert a PTS (in microseconds) to an RTP timestamp
+ */
+uint32_t
+sc_rtp_timestamp(const struct sc_rtp_packetizer *p, int64_t pts);
+
+/**
+ * Packetize a media packet (an access unit for video) into RTP packets
+ *
+ * The callback is called synchronously for each packet. If it returns false,
+ * packetization stops and this function returns false.
+ */
+bool
+sc_rtp_packetize(struct sc_rtp_packetizer *p, const uint8_t *data, size_t len,
+                 int64_t pts, sc_rtp_packet_cb cb, void *userdata);
+
+/**
+ * Find the next NAL unit in an Annex B byte stream
+ *
+ * On input, `*data` points to the current position. On output, it is moved
+ * after the returned NAL unit.
+ *
+ * Return a pointer to the NAL unit (after its start code) and write its size
+ * in `*nal_len`, or return NULL if there is no more NAL unit.
+ */
+const uint8_t *
+sc_rtp_next_nal(const uint8_t **data, const uint8_t *end, size_t *nal_len);
+
+#endif
@@ -0,0 +1,1476 @@
+#include "rtsp_sink.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/str.h"
+#include "util/strbuf.h"
+
+/** Downcast packet sinks to rtsp sink */
+#define DOWNCAST_VIDEO(SINK) \
+    container_of(SINK, struct sc_rtsp_sink, video_packet_sink)
+#define DOWNCAST_AUDIO(SINK) \
+    container_of(SINK, struct sc_rtsp_sink, audio_packet_sink)
+
+#define SC_RTSP_PAYLOAD_TYPE_VIDEO 96
+#define SC_RTSP_PAYLOAD_TYPE_AUDIO 97
+
+#define SC_RTSP_SESSION_TIMEOUT SC_TICK_FROM_SEC(60)
+
+struct sc_rtsp_request {
+    char method[16];
+    char url[256];
+    long cseq;
+    char transport[256];
+    char session[64];
+    size_t content_length;
+};
+
+struct sc_rtsp_send_context {
+    struct sc_rtsp_sink *sink;
+    enum sc_rtsp_track_id track_id;
+};
+
+static AVPacket *
+sc_rtsp_sink_packet_ref(const AVPacket *packet) {
+    AVPacket *p = av_packet_alloc();
+    if (!p) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (av_packet_ref(p, packet)) {
+        av_packet_free(&p);
+        return NULL;
+    }
+
+    return p;
+}
+
+static void
+sc_rtsp_sink_queue_clear(struct sc_rtsp_sink_queue *queue) {
+    while (!sc_vecdeque_is_empty(queue)) {
+        AVPacket *p = sc_vecdeque_pop(queue);
+        av_packet_free(&p);
+    }
+}
+
+static bool
+sc_rtsp_append_base64(struct sc_strbuf *buf, const uint8_t *data, size_t len) {
+    char *b64 = sc_str_to_base64(data, len);
+    if (!b64) {
+        return false;
+    }
+
+    bool ok = sc_strbuf_append_str(buf, b64);
+    free(b64);
+    return ok;
+}
+
+// Build the SDP fmtp parameters from a H.264 config packet (SPS and PPS)
+static bool
+sc_rtsp_build_h264_fmtp(struct sc_strbuf *buf, const uint8_t *data,
+                        size_t len) {
+    const uint8_t *end = data + len;
+    const uint8_t *sps = NULL;
+    size_t sps_len = 0;
+    const uint8_t *pps = NULL;
+    size_t pps_len = 0;
+
+    size_t nal_len;
+    const uint8_t *nal;
+    while ((nal = sc_rtp_next_nal(&data, end, &nal_len))) {
+        uint8_t type = nal[0] & 0x1f;
+        if (type == 7 && !sps) {
+            sps = nal;
+            sps_len = nal_len;
+        } else if (type == 8 && !pps) {
+            pps = nal;
+            pps_len = nal_len;
+        }
+    }
+
+    bool ok = sc_strbuf_append_staticstr(buf, "packetization-mode=1");
+    if (!ok) {
+        return false;
+    }
+
+    if (sps && sps_len >= 4) {
+        char profile[32];
+        snprintf(profile, sizeof(profile), ";profile-level-id=%02X%02X%02X",
+                 sps[1], sps[2], sps[3]);
+        ok = sc_strbuf_append_str(buf, profile);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    if (sps && pps) {
+        ok = sc_strbuf_append_staticstr(buf, ";sprop-parameter-sets=")
+          && sc_rtsp_append_base64(buf, sps, sps_len)
+          && sc_strbuf_append_char(buf, ',')
+          && sc_rtsp_append_base64(buf, pps, pps_len);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Build the SDP fmtp parameters from a H.265 config packet (VPS, SPS and PPS)
+static bool
+sc_rtsp_build_h265_fmtp(struct sc_strbuf *buf, const uint8_t *data,
+                        size_t len) {
+    static const char *const names[] = {
+        "sprop-vps", "sprop-sps", "sprop-pps",
+    };
+
+    const uint8_t *end = data + len;
+    const uint8_t *nals[3] = {0};
+    size_t nal_lens[3] = {0};
+
+    size_t nal_len;
+    const uint8_t *nal;
+    while ((nal = sc_rtp_next_nal(&data, end, &nal_len))) {
+        uint8_t type = (nal[0] >> 1) & 0x3f;
+        // VPS = 32, SPS = 33, PPS = 34
+        if (type >= 32 && type <= 34 && !nals[type - 32]) {
+            nals[type - 32] = nal;
+            nal_lens[type - 32] = nal_len;
+        }
+    }
+
+    bool first = true;
+    for (unsigned i = 0; i < 3; ++i) {
+        if (!nals[i]) {
+            continue;
+        }
+
+        bool ok = (first || sc_strbuf_append_char(buf, ';'))
+               && sc_strbuf_append_str(buf, names[i])
+               && sc_strbuf_append_char(buf, '=')
+               && sc_rtsp_append_base64(buf, nals[i], nal_lens[i]);
+        if (!ok) {
+            return false;
+        }
+        first = false;
+    }
+
+    return true;
+}
+
+// Build the SDP fmtp parameters from an AAC config packet
+// (AudioSpecificConfig)
+static bool
+sc_rtsp_build_aac_fmtp(struct sc_strbuf *buf, const uint8_t *data,
+                       size_t len) {
+    bool ok = sc_strbuf_append_staticstr(buf,
+            "streamtype=5;profile-level-id=1;mode=AAC-hbr;sizelength=13;"
+            "indexlength=3;indexdeltalength=3;config=");
+    if (!ok) {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", data[i]);
+        if (!sc_strbuf_append(buf, hex, 2)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static char *
+sc_rtsp_build_fmtp(enum AVCodecID codec_id, const uint8_t *data, size_t len) {
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 128)) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    bool ok;
+    switch (codec_id) {
+        case AV_CODEC_ID_H264:
+            ok = sc_rtsp_build_h264_fmtp(&buf, data, len);
+            break;
+        case AV_CODEC_ID_HEVC:
+            ok = sc_rtsp_build_h265_fmtp(&buf, data, len);
+            break;
+        case AV_CODEC_ID_AAC:
+            ok = sc_rtsp_build_aac_fmtp(&buf, data, len);
+            break;
+        default:
+            assert(!"Unexpected codec");
+            ok = false;
+    }
+
+    if (!ok) {
+        LOG_OOM();
+        free(buf.s);
+        return NULL;
+    }
+
+    return buf.s;
+}
+
+static const char *
+sc_rtsp_get_rtpmap(enum AVCodecID codec_id) {
+    switch (codec_id) {
+        case AV_CODEC_ID_H264:
+            return "H264/90000";
+        case AV_CODEC_ID_HEVC:
+            return "H265/90000";
+        case AV_CODEC_ID_OPUS:
+            return "opus/48000/2";
+        case AV_CODEC_ID_AAC:
+            return "mpeg4-generic/48000/2";
+        default:
+            assert(!"Unexpected codec");
+            return NULL;
+    }
+}
+
+// Must be called with sink->mutex locked
+static char *
+sc_rtsp_sink_build_sdp(struct sc_rtsp_sink *sink) {
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 512)) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "o=- %" PRIu32 " 1 IN IP4 127.0.0.1\r\n",
+             sc_rand_u32(&sink->rand));
+
+    bool ok = sc_strbuf_append_staticstr(&buf, "v=0\r\n")
+           && sc_strbuf_append_str(&buf, line)
+           && sc_strbuf_append_staticstr(&buf, "s=scrcpy\r\n"
+                                               "c=IN IP4 0.0.0.0\r\n"
+                                               "t=0 0\r\n"
+                                               "a=control:*\r\n");
+
+    for (unsigned i = 0; ok && i < SC_RTSP_TRACK_COUNT; ++i) {
+        struct sc_rtsp_track *track = &sink->tracks[i];
+        if (track->state != SC_RTSP_TRACK_STATE_READY) {
+            continue;
+        }
+
+        bool video = i == SC_RTSP_TRACK_VIDEO;
+        unsigned pt = video ? SC_RTSP_PAYLOAD_TYPE_VIDEO
+                            : SC_RTSP_PAYLOAD_TYPE_AUDIO;
+
+        snprintf(line, sizeof(line), "m=%s 0 RTP/AVP %u\r\n"
+                                     "a=rtpmap:%u %s\r\n",
+                 video ? "video" : "audio", pt, pt,
+                 sc_rtsp_get_rtpmap(track->codec_id));
+        ok = sc_strbuf_append_str(&buf, line);
+
+        const char *fmtp = track->codec_id == AV_CODEC_ID_OPUS
+                         ? "sprop-stereo=1" : track->fmtp;
+        if (ok && fmtp) {
+            snprintf(line, sizeof(line), "a=fmtp:%u ", pt);
+            ok = sc_strbuf_append_str(&buf, line)
+              && sc_strbuf_append_str(&buf, fmtp)
+              && sc_strbuf_append_staticstr(&buf, "\r\n");
+        }
+
+        if (ok) {
+            snprintf(line, sizeof(line), "a=control:trackID=%u\r\n", i);
+            ok = sc_strbuf_append_str(&buf, line);
+        }
+    }
+
+    if (!ok) {
+        LOG_OOM();
+        free(buf.s);
+        return NULL;
+    }
+
+    return buf.s;
+}
+
+// Append data to the client send buffer, or return false if there is not
+// enough space (must be called with client->mutex locked)
+static bool
+sc_rtsp_client_write_locked(struct sc_rtsp_client *client, const void *data,
+                            size_t len) {
+    struct sc_audiobuf *buf = &client->send_buf;
+    uint32_t space = sc_audiobuf_capacity(buf) - sc_audiobuf_can_read(buf);
+    if (len > space) {
+        return false;
+    }
+
+    // Only the writer thread reads concurrently, so the space cannot shrink
+    uint32_t w = sc_audiobuf_write(buf, data, len);
+    assert(w == len);
+    (void) w;
+
+    sc_cond_broadcast(&client->cond);
+    return true;
+}
+
+static bool
+sc_rtsp_client_send(struct sc_rtsp_client *client, const char *data,
+                    size_t len) {
+    assert(len <= SC_RTSP_CLIENT_BUFFER_SIZE);
+
+    sc_mutex_lock(&client->mutex);
+    // The responses are never dropped: wait for enough space
+    while (!client->write_failed
+            && !sc_rtsp_client_write_locked(client, data, len)) {
+        sc_cond_wait(&client->cond, &client->mutex);
+    }
+    bool ok = !client->write_failed;
+    sc_mutex_unlock(&client->mutex);
+
+    return ok;
+}
+
+static bool
+sc_rtsp_client_respond(struct sc_rtsp_client *client,
+                       const struct sc_rtsp_request *req, const char *status,
+                       const char *headers, const char *body) {
+    char buf[1024];
+    int len = snprintf(buf, sizeof(buf),
+                       "RTSP/1.0 %s\r\n"
+                       "CSeq: %ld\r\n"
+                       "Server: scrcpy/" SCRCPY_VERSION "\r\n"
+                       "%s",
+                       status, req->cseq, headers ? headers : "");
+    if (len < 0 || (size_t) len >= sizeof(buf) - 32) {
+        LOGE("RTSP: response too large");
+        return false;
+    }
+
+    size_t body_len = body ? strlen(body) : 0;
+    if (body_len) {
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "Content-Length: %" SC_PRIsizet "\r\n", body_len);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+    assert((size_t) len < sizeof(buf));
+
+    LOGD("RTSP: %s %s -> %s", req->method, req->url, status);
+
+    if (!sc_rtsp_client_send(client, buf, len)) {
+        return false;
+    }
+
+    return !body_len || sc_rtsp_client_send(client, body, body_len);
+}
+
+static void
+sc_rtsp_client_consume(struct sc_rtsp_client *client, size_t len) {
+    assert(len <= client->buf_len);
+    memmove(client->buf, client->buf + len, client->buf_len - len);
+    client->buf_len -= len;
+}
+
+static bool
+sc_rtsp_client_recv(struct sc_rtsp_client *client) {
+    size_t avail = sizeof(client->buf) - client->buf_len;
+    if (!avail) {
+        LOGW("RTSP: request too large");
+        return false;
+    }
+
+    ssize_t r = net_recv(client->socket, client->buf + client->buf_len, avail);
+    if (r <= 0) {
+        return false;
+    }
+
+    client->buf_len += r;
+
+    sc_mutex_lock(&client->mutex);
+    client->last_activity = sc_tick_now();
+    sc_mutex_unlock(&client->mutex);
+
+    return true;
+}
+
+static bool
+sc_rtsp_client_skip(struct sc_rtsp_client *client, size_t len) {
+    while (len) {
+        if (!client->buf_len && !sc_rtsp_client_recv(client)) {
+            return false;
+        }
+
+        size_t n = MIN(len, client->buf_len);
+        sc_rtsp_client_consume(client, n);
+        len -= n;
+    }
+
+    return true;
+}
+
+static const char *
+sc_rtsp_find_header_end(const char *buf, size_t len) {
+    for (size_t i = 0; i + 4 <= len; ++i) {
+        if (!memcmp(&buf[i], "\r\n\r\n", 4)) {
+            return &buf[i];
+        }
+    }
+    return NULL;
+}
+
+// Split the next line (terminated by CRLF or LF) and return it, or return NULL
+// if there is no more line
+static char *
+sc_rtsp_next_line(char **data) {
+    char *line = *data;
+    if (!*line) {
+        return NULL;
+    }
+
+    size_t len = strcspn(line, "\n");
+    *data = line[len] ? &line[len + 1] : &line[len];
+    if (len && line[len - 1] == '\r') {
+        --len;
+    }
+    line[len] = '\0';
+    return line;
+}
+
+static bool
+sc_rtsp_parse_request(char *data, struct sc_rtsp_request *req) {
+    memset(req, 0, sizeof(*req));
+    req->cseq = -1;
+
+    char *line = sc_rtsp_next_line(&data);
+    if (!line) {
+        return false;
+    }
+
+    // Request line: <method> <url> RTSP/1.0
+    int r = sscanf(line, "%15s %255s", req->method, req->url);
+    if (r != 2) {
+        return false;
+    }
+
+    while ((line = sc_rtsp_next_line(&data))) {
+        const char *value;
+        if ((value = sc_str_header_value(line, "CSeq"))) {
+            req->cseq = strtol(value, NULL, 10);
+        } else if ((value = sc_str_header_value(line, "Transport"))) {
+            sc_strncpy(req->transport, value, sizeof(req->transport));
+        } else if ((value = sc_str_header_value(line, "Session"))) {
+            sc_strncpy(req->session, value, sizeof(req->session));
+        } else if ((value = sc_str_header_value(line, "Content-Length"))) {
+            req->content_length = strtoul(value, NULL, 10);
+        }
+    }
+
+    return req->cseq >= 0;
+}
+
+static bool
+sc_rtsp_client_read_request(struct sc_rtsp_client *client,
+                            struct sc_rtsp_request *req) {
+    for (;;) {
+        if (client->buf_len && client->buf[0] == '$') {
+            // Interleaved binary data (typically RTCP receiver reports)
+            if (client->buf_len < 4) {
+                if (!sc_rtsp_client_recv(client)) {
+                    return false;
+                }
+                continue;
+            }
+
+            size_t len = 4 + sc_read16be((uint8_t *) &client->buf[2]);
+            if (!sc_rtsp_client_skip(client, len)) {
+                return false;
+            }
+            continue;
+        }
+
+        const char *end =
+            sc_rtsp_find_header_end(client->buf, client->buf_len);
+        if (!end) {
+            if (!sc_rtsp_client_recv(client)) {
+                return false;
+            }
+            continue;
+        }
+
+        size_t header_len = end - client->buf + 4;
+        client->buf[header_len - 2] = '\0';
+        bool ok = sc_rtsp_parse_request(client->buf, req);
+        sc_rtsp_client_consume(client, header_len);
+        if (!ok) {
+            LOGW("RTSP: invalid request");
+            return false;
+        }
+
+        // Ignore any request body
+        return sc_rtsp_client_skip(client, req->content_length);
+    }
+}
+
+static int
+sc_rtsp_request_track(const struct sc_rtsp_request *req) {
+    const char *s = strstr(req->url, "trackID=");
+    if (!s) {
+        return -1;
+    }
+
+    long track = strtol(s + 8, NULL, 10);
+    if (track < 0 || track >= SC_RTSP_TRACK_COUNT) {
+        return -1;
+    }
+
+    return track;
+}
+
+static bool
+sc_rtsp_client_check_session(struct sc_rtsp_client *client,
+                             const struct sc_rtsp_request *req) {
+    size_t len = strlen(client->session_id);
+    return !strncmp(req->session, client->session_id, len)
+        && (req->session[len] == '\0' || req->session[len] == ';');
+}
+
+static bool
+sc_rtsp_client_handle_describe(struct sc_rtsp_client *client,
+                               const struct sc_rtsp_request *req) {
+    struct sc_rtsp_sink *sink = client->sink;
+
+    sc_mutex_lock(&sink->mutex);
+    // The SDP requires the codec configuration
+    while (!sink->stopped
+            && (sink->tracks[0].state == SC_RTSP_TRACK_STATE_PENDING
+             || sink->tracks[1].state == SC_RTSP_TRACK_STATE_PENDING)) {
+        sc_cond_wait(&sink->cond, &sink->mutex);
+    }
+
+    if (sink->stopped) {
+        sc_mutex_unlock(&sink->mutex);
+        return false;
+    }
+
+    bool has_track = false;
+    for (unsigned i = 0; i < SC_RTSP_TRACK_COUNT; ++i) {
+        has_track |= sink->tracks[i].state == SC_RTSP_TRACK_STATE_READY;
+    }
+
+    char *sdp = has_track ? sc_rtsp_sink_build_sdp(sink) : NULL;
+    sc_mutex_unlock(&sink->mutex);
+
+    if (!has_track) {
+        return sc_rtsp_client_respond(client, req, "404 Not Found", NULL,
+                                      NULL);
+    }
+
+    if (!sdp) {
+        return false;
+    }
+
+    char headers[384];
+    snprintf(headers, sizeof(headers), "Content-Type: application/sdp\r\n"
+                                       "Content-Base: %s/\r\n", req->url);
+
+    bool ok = sc_rtsp_client_respond(client, req, "200 OK", headers, sdp);
+    free(sdp);
+    return ok;
+}
+
+static bool
+sc_rtsp_client_handle_setup(struct sc_rtsp_client *client,
+                            const struct sc_rtsp_request *req) {
+    struct sc_rtsp_sink *sink = client->sink;
+
+    int track_id = sc_rtsp_request_track(req);
+    if (track_id < 0) {
+        return sc_rtsp_client_respond(client, req, "404 Not Found", NULL,
+                                      NULL);
+    }
+
+    sc_mutex_lock(&sink->mutex);
+    bool ready = sink->tracks[track_id].state == SC_RTSP_TRACK_STATE_READY;
+    sc_mutex_unlock(&sink->mutex);
+
+    if (!ready) {
+        return sc_rtsp_client_respond(client, req, "404 Not Found", NULL,
+                                      NULL);
+    }
+
+    if (req->session[0] && !sc_rtsp_client_check_session(client, req)) {
+        return sc_rtsp_client_respond(client, req, "454 Session Not Found",
+                                      NULL, NULL);
+    }
+
+    const char *transport = req->transport;
+    if (strstr(transport, "multicast")) {
+        return sc_rtsp_client_respond(client, req,
+                                      "461 Unsupported Transport", NULL, NULL);
+    }
+
+    struct sc_rtsp_client_track track = {
+        .setup = true,
+    };
+
+    // In seconds
+    int timeout = sink->session_timeout / SC_TICK_FROM_SEC(1);
+
+    char headers[256];
+    const char *s;
+    if (strstr(transport, "RTP/AVP/TCP") || strstr(transport, "interleaved=")) {
+        unsigned long channel = 2 * track_id;
+        if ((s = strstr(transport, "interleaved="))) {
+            channel = strtoul(s + 12, NULL, 10);
+        }
+        if (channel > 254) {
+            return sc_rtsp_client_respond(client, req, "400 Bad Request", NULL,
+                                          NULL);
+        }
+
+        track.interleaved = true;
+        track.channel = channel;
+        snprintf(headers, sizeof(headers),
+                 "Transport: RTP/AVP/TCP;unicast;interleaved=%lu-%lu\r\n"
+                 "Session: %s;timeout=%d\r\n",
+                 channel, channel + 1, client->session_id, timeout);
+    } else {
+        s = strstr(transport, "client_port=");
+        unsigned long port = s ? strtoul(s + 12, NULL, 10) : 0;
+        if (!port || port > 0xFFFE) {
+            return sc_rtsp_client_respond(client, req,
+                                          "461 Unsupported Transport", NULL,
+                                          NULL);
+        }
+
+        uint16_t server_port = sink->tracks[track_id].udp_port;
+        track.client_port = port;
+        snprintf(headers, sizeof(headers),
+                 "Transport: RTP/AVP;unicast;client_port=%lu-%lu;"
+                 "server_port=%u-%u\r\n"
+                 "Session: %s;timeout=%d\r\n",
+                 port, port + 1, server_port, server_port + 1,
+                 client->session_id, timeout);
+    }
+
+    sc_mutex_lock(&client->mutex);
+    client->tracks[track_id] = track;
+    sc_mutex_unlock(&client->mutex);
+
+    return sc_rtsp_client_respond(client, req, "200 OK", headers, NULL);
+}
+
+static bool
+sc_rtsp_client_set_playing(struct sc_rtsp_client *client, bool playing,
+                           bool *counted) {
+    struct sc_rtsp_sink *sink = client->sink;
+
+    sc_mutex_lock(&client->mutex);
+    bool has_track = false;
+    for (unsigned i = 0; i < SC_RTSP_TRACK_COUNT; ++i) {
+        has_track |= client->tracks[i].setup;
+    }
+    if (playing && !has_track) {
+        sc_mutex_unlock(&client->mutex);
+        return false;
+    }
+    client->playing = playing;
+    // A new client must start on a key frame
+    client->waiting_key_frame = true;
+    sc_mutex_unlock(&client->mutex);
+
+    if (playing != *counted) {
+        sc_mutex_lock(&sink->mutex);
+        if (playing) {
+            ++sink->playing_count;
+        } else {
+            assert(sink->playing_count);
+            --sink->playing_count;
+        }
+        sc_metrics_set(SC_METRIC_RTSP_CLIENTS, sink->playing_count);
+        sc_mutex_unlock(&sink->mutex);
+        *counted = playing;
+    }
+
+    return true;
+}
+
+// Return false if the connection must be closed
+static bool
+sc_rtsp_client_handle_request(struct sc_rtsp_client *client,
+                              const struct sc_rtsp_request *req,
+                              bool *counted) {
+    const char *method = req->method;
+    char headers[128];
+
+    if (!strcmp(method, "OPTIONS")) {
+        return sc_rtsp_client_respond(client, req, "200 OK",
+                "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, "
+                        "GET_PARAMETER, SET_PARAMETER\r\n", NULL);
+    }
+
+    if (!strcmp(method, "DESCRIBE")) {
+        return sc_rtsp_client_handle_describe(client, req);
+    }
+
+    if (!strcmp(method, "SETUP")) {
+        return sc_rtsp_client_handle_setup(client, req);
+    }
+
+    if (!strcmp(method, "GET_PARAMETER") || !strcmp(method, "SET_PARAMETER")) {
+        // Typically used as keep-alive
+        return sc_rtsp_client_respond(client, req, "200 OK", NULL, NULL);
+    }
+
+    if (strcmp(method, "PLAY") && strcmp(method, "PAUSE")
+            && strcmp(method, "TEARDOWN")) {
+        return sc_rtsp_client_respond(client, req, "501 Not Implemented",
+                                      NULL, NULL);
+    }
+
+    if (!sc_rtsp_client_check_session(client, req)) {
+        return sc_rtsp_client_respond(client, req, "454 Session Not Found",
+                                      NULL, NULL);
+    }
+
+    snprintf(headers, sizeof(headers), "Session: %s\r\n", client->session_id);
+
+    if (!strcmp(method, "TEARDOWN")) {
+        sc_rtsp_client_set_playing(client, false, counted);
+        sc_rtsp_client_respond(client, req, "200 OK", headers, NULL);
+        return false;
+    }
+
+    bool play = !strcmp(method, "PLAY");
+    if (!sc_rtsp_client_set_playing(client, play, counted)) {
+        return sc_rtsp_client_respond(client, req,
+                                      "455 Method Not Valid in This State",
+                                      NULL, NULL);
+    }
+
+    if (play) {
+        LOGI("RTSP: client started playing");
+        size_t len = strlen(headers);
+        snprintf(headers + len, sizeof(headers) - len, "Range: npt=now-\r\n");
+    }
+
+    return sc_rtsp_client_respond(client, req, "200 OK", headers, NULL);
+}
+
+static int
+run_rtsp_client_writer(void *data) {
+    struct sc_rtsp_client *client = data;
+    struct sc_audiobuf *buf = &client->send_buf;
+
+    sc_tick timeout = client->sink->session_timeout;
+
+    for (;;) {
+        sc_mutex_lock(&client->mutex);
+        bool expired;
+        for (;;) {
+            sc_tick deadline = client->last_activity + timeout;
+            expired = sc_tick_now() >= deadline;
+            if (expired || client->closing || sc_audiobuf_can_read(buf)) {
+                break;
+            }
+            sc_cond_timedwait(&client->cond, &client->mutex, deadline);
+        }
+
+        if (expired) {
+            client->playing = false;
+            sc_mutex_unlock(&client->mutex);
+            LOGI("RTSP: session timeout");
+            // Wake up the client thread, which will close the socket
+            net_interrupt(client->socket);
+            break;
+        }
+        sc_mutex_unlock(&client->mutex);
+
+        // Only this thread reads from the buffer
+        uint32_t r = sc_audiobuf_read(buf, client->chunk,
+                                      sizeof(client->chunk));
+        if (!r) {
+            // Closing, and all the data has been sent
+            break;
+        }
+
+        sc_mutex_lock(&client->mutex);
+        // Wake up the client thread if it waits for space
+        sc_cond_broadcast(&client->cond);
+        sc_mutex_unlock(&client->mutex);
+
+        ssize_t w = net_send_all(client->socket, client->chunk, r);
+        if (w < 0 || (size_t) w != r) {
+            LOGD("RTSP: could not send to client");
+            sc_mutex_lock(&client->mutex);
+            client->write_failed = true;
+            client->playing = false;
+            sc_cond_broadcast(&client->cond);
+            sc_mutex_unlock(&client->mutex);
+            // Wake up the client thread, which will close the socket
+            net_interrupt(client->socket);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static int
+run_rtsp_client(void *data) {
+    struct sc_rtsp_client *client = data;
+    struct sc_rtsp_sink *sink = client->sink;
+
+    // Whether this client is counted in sink->playing_count
+    bool counted = false;
+
+    bool writer = sc_thread_create(&client->writer_thread,
+                                   run_rtsp_client_writer, "rtsp-writer",
+                                   client);
+    if (writer) {
+        struct sc_rtsp_request req;
+        while (sc_rtsp_client_read_request(client, &req)) {
+            if (!sc_rtsp_client_handle_request(client, &req, &counted)) {
+                break;
+            }
+        }
+    } else {
+        LOGE("RTSP: could not start client writer thread");
+    }
+
+    if (counted) {
+        sc_mutex_lock(&sink->mutex);
+        assert(sink->playing_count);
+        --sink->playing_count;
+        sc_metrics_set(SC_METRIC_RTSP_CLIENTS, sink->playing_count);
+        sc_mutex_unlock(&sink->mutex);
+    }
+
+    sc_mutex_lock(&client->mutex);
+    client->playing = false;
+    // Let the writer thread send the remaining data (typically the TEARDOWN
+    // response)
+    client->closing = true;
+    sc_cond_broadcast(&client->cond);
+    sc_mutex_unlock(&client->mutex);
+
+    if (writer) {
+        sc_thread_join(&client->writer_thread, NULL);
+    }
+
+    sc_mutex_lock(&client->mutex);
+    net_close(client->socket);
+    client->socket = SC_SOCKET_NONE;
+    sc_audiobuf_destroy(&client->send_buf);
+    client->ended = true;
+    sc_mutex_unlock(&client->mutex);
+
+    LOGI("RTSP: client disconnected");
+    return 0;
+}
+
+static bool
+sc_rtsp_sink_on_rtp_packet(uint8_t *packet, size_t len, void *userdata) {
+    struct sc_rtsp_send_context *ctx = userdata;
+    struct sc_rtsp_sink *sink = ctx->sink;
+    enum sc_rtsp_track_id track_id = ctx->track_id;
+    struct sc_rtsp_track *track = &sink->tracks[track_id];
+
+    for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        struct sc_rtsp_client *client = &sink->clients[i];
+        struct sc_rtsp_client_track *ct = &client->tracks[track_id];
+
+        sc_mutex_lock(&client->mutex);
+        bool send = client->playing && ct->setup
+                 && (track_id != SC_RTSP_TRACK_VIDEO
+                    || !client->waiting_key_frame);
+        if (send) {
+            if (ct->interleaved) {
+                // RFC 2326 section 10.12
+                uint8_t *header = packet - SC_RTP_INTERLEAVED_HEADER_SIZE;
+                header[0] = '$';
+                header[1] = ct->channel;
+                sc_write16be(&header[2], len);
+                size_t total = SC_RTP_INTERLEAVED_HEADER_SIZE + len;
+                // Never block on the socket: the writer thread sends the data
+                if (!sc_rtsp_client_write_locked(client, header, total)) {
+                    // The client does not read fast enough, drop the packet
+                    if (sc_tick_now() >= client->last_activity
+                                         + sink->session_timeout) {
+                        // The writer thread may be blocked on send() forever
+                        LOGI("RTSP: session timeout");
+                        client->playing = false;
+                        net_interrupt(client->socket);
+                    } else if (track_id == SC_RTSP_TRACK_VIDEO) {
+                        LOGD("RTSP: client too slow, video skipped until the "
+                             "next key frame");
+                        client->waiting_key_frame = true;
+                    }
+                    sc_metrics_add(SC_METRIC_RTSP_DROPPED, 1);
+                }
+            } else {
+                // Ignore errors, datagrams may be lost anyway
+                net_sendto(track->udp_socket, packet, len, client->addr,
+                           ct->client_port);
+            }
+        }
+        sc_mutex_unlock(&client->mutex);
+    }
+
+    return true;
+}
+
+static void
+sc_rtsp_sink_send_packet(struct sc_rtsp_sink *sink, const AVPacket *packet) {
+    enum sc_rtsp_track_id track_id = packet->stream_index;
+    assert(track_id < SC_RTSP_TRACK_COUNT);
+
+    if (track_id == SC_RTSP_TRACK_VIDEO && packet->flags & AV_PKT_FLAG_KEY) {
+        // Clients waiting for a key frame may start receiving the video
+        for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+            struct sc_rtsp_client *client = &sink->clients[i];
+            sc_mutex_lock(&client->mutex);
+            if (client->playing) {
+                client->waiting_key_frame = false;
+            }
+            sc_mutex_unlock(&client->mutex);
+        }
+    }
+
+    struct sc_rtsp_send_context ctx = {
+        .sink = sink,
+        .track_id = track_id,
+    };
+
+    struct sc_rtp_packetizer *p = &sink->tracks[track_id].packetizer;
+    sc_rtp_packetize(p, packet->data, packet->size, packet->pts,
+                     sc_rtsp_sink_on_rtp_packet, &ctx);
+}
+
+static int
+run_rtsp_sender(void *data) {
+    struct sc_rtsp_sink *sink = data;
+
+    for (;;) {
+        sc_mutex_lock(&sink->mutex);
+
+        while (!sink->stopped && sc_vecdeque_is_empty(&sink->queue)) {
+            sc_cond_wait(&sink->cond, &sink->mutex);
+        }
+
+        if (sink->stopped) {
+            sc_mutex_unlock(&sink->mutex);
+            break;
+        }
+
+        AVPacket *packet = sc_vecdeque_pop(&sink->queue);
+        sc_metrics_set(SC_METRIC_RTSP_QUEUE, sc_vecdeque_size(&sink->queue));
+        sc_mutex_unlock(&sink->mutex);
+
+        sc_rtsp_sink_send_packet(sink, packet);
+        av_packet_free(&packet);
+    }
+
+    LOGD("RTSP sender thread ended");
+    return 0;
+}
+
+static struct sc_rtsp_client *
+sc_rtsp_sink_get_free_client(struct sc_rtsp_sink *sink) {
+    for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        struct sc_rtsp_client *client = &sink->clients[i];
+
+        sc_mutex_lock(&client->mutex);
+        bool used = client->used;
+        bool ended = client->ended;
+        sc_mutex_unlock(&client->mutex);
+
+        if (!used) {
+            return client;
+        }
+
+        if (ended) {
+            sc_thread_join(&client->thread, NULL);
+            sc_mutex_lock(&client->mutex);
+            client->used = false;
+            sc_mutex_unlock(&client->mutex);
+            return client;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+run_rtsp_server(void *data) {
+    struct sc_rtsp_sink *sink = data;
+
+    for (;;) {
+        sc_socket socket = net_accept(sink->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            sc_mutex_lock(&sink->mutex);
+            bool stopped = sink->stopped;
+            sc_mutex_unlock(&sink->mutex);
+            if (stopped) {
+                break;
+            }
+            LOGW("RTSP: failed to accept client connection");
+            continue;
+        }
+
+        uint32_t addr;
+        if (!net_get_peer_addr(socket, &addr)) {
+            net_close(socket);
+            continue;
+        }
+
+        struct sc_rtsp_client *client = sc_rtsp_sink_get_free_client(sink);
+        if (!client) {
+            LOGW("RTSP: too many clients, connection refused");
+            net_close(socket);
+            continue;
+        }
+
+        // Lock the sink mutex so that sc_rtsp_sink_stop() cannot miss the new
+        // client socket
+        sc_mutex_lock(&sink->mutex);
+        if (sink->stopped) {
+            sc_mutex_unlock(&sink->mutex);
+            net_close(socket);
+            break;
+        }
+
+        uint32_t id_msb = sc_rand_u32(&sink->rand);
+        uint32_t id_lsb = sc_rand_u32(&sink->rand);
+
+        sc_mutex_lock(&client->mutex);
+        if (!sc_audiobuf_init(&client->send_buf, 1,
+                              SC_RTSP_CLIENT_BUFFER_SIZE)) {
+            sc_mutex_unlock(&client->mutex);
+            sc_mutex_unlock(&sink->mutex);
+            net_close(socket);
+            continue;
+        }
+
+        client->socket = socket;
+        client->addr = addr;
+        client->ended = false;
+        client->closing = false;
+        client->write_failed = false;
+        client->last_activity = sc_tick_now();
+        client->playing = false;
+        client->waiting_key_frame = true;
+        memset(client->tracks, 0, sizeof(client->tracks));
+        client->buf_len = 0;
+        snprintf(client->session_id, sizeof(client->session_id),
+                 "%08" PRIX32 "%08" PRIX32, id_msb, id_lsb);
+
+        bool ok = sc_thread_create(&client->thread, run_rtsp_client,
+                                   "rtsp-client", client);
+        if (ok) {
+            client->used = true;
+        } else {
+            LOGE("RTSP: could not start client thread");
+            net_close(socket);
+            client->socket = SC_SOCKET_NONE;
+            sc_audiobuf_destroy(&client->send_buf);
+        }
+        sc_mutex_unlock(&client->mutex);
+        sc_mutex_unlock(&sink->mutex);
+
+        if (ok) {
+            LOGI("RTSP: client connected");
+        }
+    }
+
+    LOGD("RTSP server thread ended");
+    return 0;
+}
+
+static bool
+sc_rtsp_sink_open(struct sc_rtsp_sink *sink, enum sc_rtsp_track_id track_id,
+                  AVCodecContext *ctx) {
+    bool video = track_id == SC_RTSP_TRACK_VIDEO;
+
+    sc_mutex_lock(&sink->mutex);
+
+    struct sc_rtsp_track *track = &sink->tracks[track_id];
+    if (!sc_rtp_is_supported(ctx->codec_id)) {
+        LOGW("RTSP: unsupported %s codec, %s not served (supported: %s)",
+             video ? "video" : "audio", video ? "video" : "audio",
+             video ? "h264, h265" : "opus, aac");
+        track->state = SC_RTSP_TRACK_STATE_DISABLED;
+        sc_cond_broadcast(&sink->cond);
+        sc_mutex_unlock(&sink->mutex);
+        return true;
+    }
+
+    track->codec_id = ctx->codec_id;
+
+    uint8_t pt = video ? SC_RTSP_PAYLOAD_TYPE_VIDEO
+                       : SC_RTSP_PAYLOAD_TYPE_AUDIO;
+    uint32_t clock_rate = video ? 90000 : 48000;
+    uint32_t ssrc = sc_rand_u32(&sink->rand);
+    uint16_t seq = sc_rand_u32(&sink->rand);
+    uint32_t ts_offset = sc_rand_u32(&sink->rand);
+    sc_rtp_packetizer_init(&track->packetizer, ctx->codec_id, pt, clock_rate,
+                           ssrc, seq, ts_offset);
+
+    if (ctx->codec_id == AV_CODEC_ID_OPUS) {
+        // No configuration is needed in the SDP
+        track->state = SC_RTSP_TRACK_STATE_READY;
+        sc_cond_broadcast(&sink->cond);
+    }
+
+    sc_mutex_unlock(&sink->mutex);
+    return true;
+}
+
+static void
+sc_rtsp_sink_close(struct sc_rtsp_sink *sink, enum sc_rtsp_track_id track_id) {
+    sc_mutex_lock(&sink->mutex);
+    sink->tracks[track_id].state = SC_RTSP_TRACK_STATE_DISABLED;
+    sc_cond_broadcast(&sink->cond);
+    sc_mutex_unlock(&sink->mutex);
+}
+
+static bool
+sc_rtsp_sink_push(struct sc_rtsp_sink *sink, enum sc_rtsp_track_id track_id,
+                  const AVPacket *packet) {
+    sc_mutex_lock(&sink->mutex);
+
+    if (sink->stopped) {
+        sc_mutex_unlock(&sink->mutex);
+        return false;
+    }
+
+    struct sc_rtsp_track *track = &sink->tracks[track_id];
+    if (track->state == SC_RTSP_TRACK_STATE_DISABLED) {
+        sc_mutex_unlock(&sink->mutex);
+        return true;
+    }
+
+    if (packet->pts == AV_NOPTS_VALUE) {
+        // Config packets are not sent over RTP: they are provided in the SDP,
+        // and H.26x config packets are also prepended to the next key frame
+        if (track->codec_id != AV_CODEC_ID_OPUS) {
+            char *fmtp = sc_rtsp_build_fmtp(track->codec_id, packet->data,
+                                            packet->size);
+            if (!fmtp) {
+                sc_mutex_unlock(&sink->mutex);
+                return false;
+            }
+
+            free(track->fmtp);
+            track->fmtp = fmtp;
+        }
+
+        if (track->state == SC_RTSP_TRACK_STATE_PENDING) {
+            track->state = SC_RTSP_TRACK_STATE_READY;
+            sc_cond_broadcast(&sink->cond);
+        }
+
+        sc_mutex_unlock(&sink->mutex);
+        return true;
+    }
+
+    if (!sink->playing_count) {
+        // Nobody is playing, drop the packet
+        sc_mutex_unlock(&sink->mutex);
+        sc_metrics_add(SC_METRIC_RTSP_DROPPED, 1);
+        return true;
+    }
+
+    AVPacket *pkt = sc_rtsp_sink_packet_ref(packet);
+    if (!pkt) {
+        sc_mutex_unlock(&sink->mutex);
+        return false;
+    }
+
+    pkt->stream_index = track_id;
+
+    bool ok = sc_vecdeque_push(&sink->queue, pkt);
+    if (!ok) {
+        LOG_OOM();
+        av_packet_free(&pkt);
+        sc_mutex_unlock(&sink->mutex);
+        return false;
+    }
+
+    sc_metrics_set(SC_METRIC_RTSP_QUEUE, sc_vecdeque_size(&sink->queue));
+    sc_cond_signal(&sink->cond);
+    sc_mutex_unlock(&sink->mutex);
+
+    return true;
+}
+
+static void
+sc_rtsp_sink_disable(struct sc_rtsp_sink *sink,
+                     enum sc_rtsp_track_id track_id) {
+    sc_rtsp_sink_close(sink, track_id);
+}
+
+static bool
+sc_rtsp_sink_video_packet_sink_open(struct sc_packet_sink *sink,
+                                    AVCodecContext *ctx) {
+    return sc_rtsp_sink_open(DOWNCAST_VIDEO(sink), SC_RTSP_TRACK_VIDEO, ctx);
+}
+
+static void
+sc_rtsp_sink_video_packet_sink_close(struct sc_packet_sink *sink) {
+    sc_rtsp_sink_close(DOWNCAST_VIDEO(sink), SC_RTSP_TRACK_VIDEO);
+}
+
+static bool
+sc_rtsp_sink_video_packet_sink_push(struct sc_packet_sink *sink,
+                                    const AVPacket *packet) {
+    return sc_rtsp_sink_push(DOWNCAST_VIDEO(sink), SC_RTSP_TRACK_VIDEO,
+                             packet);
+}
+
+static bool
+sc_rtsp_sink_audio_packet_sink_open(struct sc_packet_sink *sink,
+                                    AVCodecContext *ctx) {
+    return sc_rtsp_sink_open(DOWNCAST_AUDIO(sink), SC_RTSP_TRACK_AUDIO, ctx);
+}
+
+static void
+sc_rtsp_sink_audio_packet_sink_close(struct sc_packet_sink *sink) {
+    sc_rtsp_sink_close(DOWNCAST_AUDIO(sink), SC_RTSP_TRACK_AUDIO);
+}
+
+static bool
+sc_rtsp_sink_audio_packet_sink_push(struct sc_packet_sink *sink,
+                                    const AVPacket *packet) {
+    return sc_rtsp_sink_push(DOWNCAST_AUDIO(sink), SC_RTSP_TRACK_AUDIO,
+                             packet);
+}
+
+static void
+sc_rtsp_sink_audio_packet_sink_disable(struct sc_packet_sink *sink) {
+    sc_rtsp_sink_disable(DOWNCAST_AUDIO(sink), SC_RTSP_TRACK_AUDIO);
+}
+
+bool
+sc_rtsp_sink_init(struct sc_rtsp_sink *sink, uint16_t port, bool video,
+                  bool audio) {
+    assert(video || audio);
+
+    sink->port = port;
+    sink->session_timeout = SC_RTSP_SESSION_TIMEOUT;
+    sink->server_socket = SC_SOCKET_NONE;
+    sink->stopped = false;
+    sink->playing_count = 0;
+    sc_rand_init(&sink->rand);
+
+    bool ok = sc_mutex_init(&sink->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&sink->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    unsigned i;
+    for (i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        struct sc_rtsp_client *client = &sink->clients[i];
+        if (!sc_mutex_init(&client->mutex)) {
+            goto error_clients_destroy;
+        }
+        if (!sc_cond_init(&client->cond)) {
+            sc_mutex_destroy(&client->mutex);
+            goto error_clients_destroy;
+        }
+        client->sink = sink;
+        client->socket = SC_SOCKET_NONE;
+        client->used = false;
+        client->ended = false;
+        client->playing = false;
+        memset(client->tracks, 0, sizeof(client->tracks));
+    }
+
+    bool enabled[SC_RTSP_TRACK_COUNT] = {
+        [SC_RTSP_TRACK_VIDEO] = video,
+        [SC_RTSP_TRACK_AUDIO] = audio,
+    };
+    for (unsigned t = 0; t < SC_RTSP_TRACK_COUNT; ++t) {
+        struct sc_rtsp_track *track = &sink->tracks[t];
+        track->state = enabled[t] ? SC_RTSP_TRACK_STATE_PENDING
+                                  : SC_RTSP_TRACK_STATE_DISABLED;
+        track->codec_id = AV_CODEC_ID_NONE;
+        track->fmtp = NULL;
+        track->udp_socket = SC_SOCKET_NONE;
+        track->udp_port = 0;
+    }
+
+    sc_vecdeque_init(&sink->queue);
+
+    static const struct sc_packet_sink_ops video_ops = {
+        .open = sc_rtsp_sink_video_packet_sink_open,
+        .close = sc_rtsp_sink_video_packet_sink_close,
+        .push = sc_rtsp_sink_video_packet_sink_push,
+    };
+
+    sink->video_packet_sink.ops = &video_ops;
+
+    static const struct sc_packet_sink_ops audio_ops = {
+        .open = sc_rtsp_sink_audio_packet_sink_open,
+        .close = sc_rtsp_sink_audio_packet_sink_close,
+        .push = sc_rtsp_sink_audio_packet_sink_push,
+        .disable = sc_rtsp_sink_audio_packet_sink_disable,
+    };
+
+    sink->audio_packet_sink.ops = &audio_ops;
+
+    return true;
+
+error_clients_destroy:
+    while (i) {
+        struct sc_rtsp_client *client = &sink->clients[--i];
+        sc_cond_destroy(&client->cond);
+        sc_mutex_destroy(&client->mutex);
+    }
+    sc_cond_destroy(&sink->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&sink->mutex);
+
+    return false;
+}
+
+static bool
+sc_rtsp_sink_open_udp_sockets(struct sc_rtsp_sink *sink) {
+    for (unsigned i = 0; i < SC_RTSP_TRACK_COUNT; ++i) {
+        struct sc_rtsp_track *track = &sink->tracks[i];
+        if (track->state == SC_RTSP_TRACK_STATE_DISABLED) {
+            continue;
+        }
+
+        track->udp_socket = net_udp_socket();
+        if (track->udp_socket == SC_SOCKET_NONE) {
+            return false;
+        }
+
+        if (!net_bind(track->udp_socket, IPV4_LOCALHOST, 0)
+                || !net_get_local_port(track->udp_socket, &track->udp_port)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+sc_rtsp_sink_start(struct sc_rtsp_sink *sink) {
+    if (!sc_rtsp_sink_open_udp_sockets(sink)) {
+        LOGE("RTSP: could not open UDP sockets");
+        return false;
+    }
+
+    sink->server_socket = net_socket();
+    if (sink->server_socket == SC_SOCKET_NONE) {
+        LOGE("RTSP: could not create server socket");
+        return false;
+    }
+
+    if (!net_listen(sink->server_socket, IPV4_LOCALHOST, sink->port,
+                    SC_RTSP_SINK_MAX_CLIENTS)) {
+        LOGE("RTSP: could not listen on port %" PRIu16, sink->port);
+        return false;
+    }
+
+    if (!sink->port
+            && !net_get_local_port(sink->server_socket, &sink->port)) {
+        LOGE("RTSP: could not get the listening port");
+        return false;
+    }
+
+    bool ok = sc_thread_create(&sink->sender_thread, run_rtsp_sender,
+                               "rtsp-sink", sink);
+    if (!ok) {
+        LOGE("RTSP: could not start sender thread");
+        return false;
+    }
+
+    ok = sc_thread_create(&sink->server_thread, run_rtsp_server,
+                          "rtsp-server", sink);
+    if (!ok) {
+        LOGE("RTSP: could not start server thread");
+        sc_mutex_lock(&sink->mutex);
+        sink->stopped = true;
+        sc_cond_broadcast(&sink->cond);
+        sc_mutex_unlock(&sink->mutex);
+        sc_thread_join(&sink->sender_thread, NULL);
+        return false;
+    }
+
+    LOGI("RTSP server listening on rtsp://127.0.0.1:%" PRIu16 "/",
+         sink->port);
+    return true;
+}
+
+void
+sc_rtsp_sink_stop(struct sc_rtsp_sink *sink) {
+    sc_mutex_lock(&sink->mutex);
+    sink->stopped = true;
+    sc_cond_broadcast(&sink->cond);
+
+    // Interrupt the client sockets to unblock recv() and send()
+    for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        struct sc_rtsp_client *client = &sink->clients[i];
+        sc_mutex_lock(&client->mutex);
+        if (client->socket != SC_SOCKET_NONE) {
+            net_interrupt(client->socket);
+        }
+        sc_mutex_unlock(&client->mutex);
+    }
+    sc_mutex_unlock(&sink->mutex);
+
+    // Interrupt the server socket to unblock accept()
+    net_interrupt(sink->server_socket);
+}
+
+void
+sc_rtsp_sink_join(struct sc_rtsp_sink *sink) {
+    sc_thread_join(&sink->server_thread, NULL);
+    sc_thread_join(&sink->sender_thread, NULL);
+
+    for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        struct sc_rtsp_client *client = &sink->clients[i];
+        if (client->used) {
+            sc_thread_join(&client->thread, NULL);
+            client->used = false;
+        }
+    }
+}
+
+void
+sc_rtsp_sink_destroy(struct sc_rtsp_sink *sink) {
+    if (sink->server_socket != SC_SOCKET_NONE) {
+        net_close(sink->server_socket);
+    }
+
+    for (unsigned i = 0; i < SC_RTSP_TRACK_COUNT; ++i) {
+        struct sc_rtsp_track *track = &sink->tracks[i];
+        if (track->udp_socket != SC_SOCKET_NONE) {
+            net_close(track->udp_socket);
+        }
+        free(track->fmtp);
+    }
+
+    for (unsigned i = 0; i < SC_RTSP_SINK_MAX_CLIENTS; ++i) {
+        sc_cond_destroy(&sink->clients[i].cond);
+        sc_mutex_destroy(&sink->clients[i].mutex);
+    }
+
+    sc_rtsp_sink_queue_clear(&sink->queue);
+    sc_vecdeque_destroy(&sink->queue);
+    sc_cond_destroy(&sink->cond);
+    sc_mutex_destroy(&sink->mutex);
+}
@@ -0,0 +1,136 @@
+#ifndef SC_RTSP_SINK_H
+#define SC_RTSP_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "rtp.h"
+#include "trait/packet_sink.h"
+#include "util/audiobuf.h"
+#include "util/net.h"
+#include "util/rand.h"
+#include "util/thread.h"
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+#define SC_RTSP_SINK_MAX_CLIENTS 8
+#define SC_RTSP_REQUEST_MAX_SIZE 4096
+// Data (interleaved RTP packets and RTSP responses) waiting to be sent to a
+// client; when full, the RTP packets are dropped
+#define SC_RTSP_CLIENT_BUFFER_SIZE (1 << 20)
+#define SC_RTSP_CLIENT_SEND_CHUNK_SIZE 16384
+
+enum sc_rtsp_track_id {
+    SC_RTSP_TRACK_VIDEO,
+    SC_RTSP_TRACK_AUDIO,
+    SC_RTSP_TRACK_COUNT,
+};
+
+enum sc_rtsp_track_state {
+    // Waiting for the codec and its configuration (needed for the SDP)
+    SC_RTSP_TRACK_STATE_PENDING,
+    SC_RTSP_TRACK_STATE_READY,
+    // Not captured, not supported, or disabled by the device
+    SC_RTSP_TRACK_STATE_DISABLED,
+};
+
+struct sc_rtsp_track {
+    enum sc_rtsp_track_state state;
+    enum AVCodecID codec_id;
+    // SDP fmtp parameters, may be NULL
+    char *fmtp;
+
+    // Only accessed from the sender thread once the sink is started
+    struct sc_rtp_packetizer packetizer;
+
+    sc_socket udp_socket;
+    uint16_t udp_port;
+};
+
+struct sc_rtsp_client_track {
+    bool setup;
+    bool interleaved;
+    uint8_t channel; // if interleaved
+    uint16_t client_port; // if !interleaved
+};
+
+struct sc_rtsp_client {
+    struct sc_rtsp_sink *sink;
+
+    sc_thread thread;
+    // Only this thread writes to the socket, so that a client which does not
+    // read never blocks the sender thread (nor the other clients)
+    sc_thread writer_thread;
+    // protects the fields below
+    sc_mutex mutex;
+    // signaled when data is written to or read from send_buf
+    sc_cond cond;
+
+    sc_socket socket;
+    uint32_t addr;
+    bool used; // a thread has been started for this slot (must be joined)
+    bool ended; // the thread has ended
+    bool closing; // the writer thread must send the remaining data and exit
+    bool write_failed;
+    // Last data received (request or interleaved RTCP), to expire the session
+    sc_tick last_activity;
+    struct sc_audiobuf send_buf; // 1-byte samples
+    bool playing;
+    // Do not send video until the next key frame
+    bool waiting_key_frame;
+    char session_id[17];
+    struct sc_rtsp_client_track tracks[SC_RTSP_TRACK_COUNT];
+
+    // Only accessed from the client thread
+    char buf[SC_RTSP_REQUEST_MAX_SIZE];
+    size_t buf_len;
+
+    // Only accessed from the writer thread
+    uint8_t chunk[SC_RTSP_CLIENT_SEND_CHUNK_SIZE];
+};
+
+struct sc_rtsp_sink_queue SC_VECDEQUE(AVPacket *);
+
+struct sc_rtsp_sink {
+    struct sc_packet_sink video_packet_sink;
+    struct sc_packet_sink audio_packet_sink;
+
+    uint16_t port;
+    // A client which sends nothing during this delay is disconnected
+    sc_tick session_timeout;
+
+    sc_socket server_socket;
+    sc_thread server_thread;
+    sc_thread sender_thread;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+    unsigned playing_count;
+    struct sc_rtsp_sink_queue queue;
+    struct sc_rtsp_track tracks[SC_RTSP_TRACK_COUNT];
+    struct sc_rand rand;
+
+    struct sc_rtsp_client clients[SC_RTSP_SINK_MAX_CLIENTS];
+};
+
+bool
+sc_rtsp_sink_init(struct sc_rtsp_sink *sink, uint16_t port, bool video,
+                  bool audio);
+
+bool
+sc_rtsp_sink_start(struct sc_rtsp_sink *sink);
+
+void
+sc_rtsp_sink_stop(struct sc_rtsp_sink *sink);
+
+void
+sc_rtsp_sink_join(struct sc_rtsp_sink *sink);
+
+void
+sc_rtsp_sink_destroy(struct sc_rtsp_sink *sink);
+
+#endif
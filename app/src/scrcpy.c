@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <SDL2/SDL.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL.h>
+#endif
 
 #ifdef _WIN32
 // not needed here, but winsock2.h must never be included AFTER windows.h
@@ -14,7 +16,9 @@
 # include <windows.h>
 #endif
 
-#include "audio_player.h"
+#ifdef HAVE_SDL
+# include "audio_player.h"
+#endif
 #include "controller.h"
 #include "control_forwarder.h"
 #include "decoder.h"
@@ -22,15 +26,27 @@
 #include "demuxer.h"
 #include "events.h"
 #include "file_pusher.h"
-#include "keyboard_sdk.h"
-#include "mouse_sdk.h"
+#include "fmp4_server.h"
+#include "latency_test.h"
+#include "mjpeg_server.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#ifdef HAVE_SDL
+# include "keyboard_sdk.h"
+# include "mouse_sdk.h"
+#endif
 #include "recorder.h"
-#include "screen.h"
+#ifdef HAVE_SDL
+# include "screen.h"
+#endif
+#include "rtsp_sink.h"
 #include "tcp_sink.h"
 #include "server.h"
-#include "uhid/gamepad_uhid.h"
-#include "uhid/keyboard_uhid.h"
-#include "uhid/mouse_uhid.h"
+#ifdef HAVE_SDL
+# include "uhid/gamepad_uhid.h"
+# include "uhid/keyboard_uhid.h"
+# include "uhid/mouse_uhid.h"
+#endif
 #ifdef HAVE_USB
 # include "usb/aoa_hid.h"
 # include "usb/gamepad_aoa.h"
@@ -41,7 +57,9 @@
 #include "util/acksync.h"
 #include "util/log.h"
 #include "util/rand.h"
+#include "util/thread.h"
 #include "util/timeout.h"
+#include "util/trace.h"
 #include "util/tick.h"
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
@@ -49,14 +67,21 @@
 
 struct scrcpy {
     struct sc_server server;
+#ifdef HAVE_SDL
     struct sc_screen screen;
     struct sc_audio_player audio_player;
+#endif
     struct sc_demuxer video_demuxer;
     struct sc_demuxer audio_demuxer;
     struct sc_decoder video_decoder;
     struct sc_decoder audio_decoder;
+    struct sc_rendition_cache video_renditions;
     struct sc_recorder recorder;
     struct sc_tcp_sink tcp_sink;
+    struct sc_rtsp_sink rtsp_sink;
+    struct sc_fmp4_server fmp4_server;
+    struct sc_mjpeg_server mjpeg_server;
+    struct sc_metrics_server metrics_server;
     struct sc_control_forwarder control_forwarder;
     struct sc_delay_buffer video_buffer;
 #ifdef HAVE_V4L2
@@ -64,6 +89,7 @@ struct scrcpy {
     struct sc_delay_buffer v4l2_buffer;
 #endif
     struct sc_controller controller;
+    struct sc_latency_test latency_test;
     struct sc_file_pusher file_pusher;
 #ifdef HAVE_USB
     struct sc_usb usb;
@@ -71,6 +97,7 @@ struct scrcpy {
     // sequence/ack helper to synchronize clipboard and Ctrl+v via HID
     struct sc_acksync acksync;
 #endif
+#ifdef HAVE_SDL
     struct sc_uhid_devices uhid_devices;
     union {
         struct sc_keyboard_sdk keyboard_sdk;
@@ -92,19 +119,24 @@ struct scrcpy {
         struct sc_gamepad_aoa gamepad_aoa;
 #endif
     };
+#endif
     struct sc_timeout timeout;
 };
 
+// For scrcpy_get_video_rendition(), set while the rendition cache exists
+static struct sc_rendition_cache *scrcpy_video_renditions;
+
 #ifdef _WIN32
 static BOOL WINAPI windows_ctrl_handler(DWORD ctrl_type) {
     if (ctrl_type == CTRL_C_EVENT || ctrl_type == CTRL_BREAK_EVENT) {
-        sc_push_event(SDL_QUIT);
+        sc_push_event(SC_EVENT_QUIT);
         return TRUE;
     }
     return FALSE;
 }
 #endif // _WIN32
 
+#ifdef HAVE_SDL
 static void
 sdl_set_hints(const char *render_driver) {
     if (render_driver && !SDL_SetHint(SDL_HINT_RENDER_DRIVER, render_driver)) {
@@ -178,11 +210,16 @@ sdl_configure(bool video_playback, bool disable_screensaver) {
         SDL_EnableScreenSaver();
     }
 }
+#endif
 
 static enum scrcpy_exit_code
 event_loop(struct scrcpy *s, bool has_screen) {
-    SDL_Event event;
-    while (SDL_WaitEvent(&event)) {
+#ifndef HAVE_SDL
+    (void) s;
+    assert(!has_screen);
+#endif
+    struct sc_event event;
+    while (sc_wait_event(&event)) {
         switch (event.type) {
             case SC_EVENT_DEVICE_DISCONNECTED:
                 LOGW("Device disconnected");
@@ -202,19 +239,25 @@ event_loop(struct scrcpy *s, bool has_screen) {
             case SC_EVENT_TIME_LIMIT_REACHED:
                 LOGI("Time limit reached");
                 return SCRCPY_EXIT_SUCCESS;
-            case SDL_QUIT:
+            case SC_EVENT_LATENCY_TEST_COMPLETED:
+                LOGD("Latency test completed");
+                return SCRCPY_EXIT_SUCCESS;
+            case SC_EVENT_LATENCY_TEST_ERROR:
+                LOGE("Latency test failed");
+                return SCRCPY_EXIT_FAILURE;
+            case SC_EVENT_QUIT:
                 LOGD("User requested to quit");
                 return SCRCPY_EXIT_SUCCESS;
-            case SC_EVENT_RUN_ON_MAIN_THREAD: {
-                sc_runnable_fn run = event.user.data1;
-                void *userdata = event.user.data2;
-                run(userdata);
+            case SC_EVENT_RUN_ON_MAIN_THREAD:
+                event.run(event.userdata);
                 break;
-            }
             default:
-                if (has_screen && !sc_screen_handle_event(&s->screen, &event)) {
+#ifdef HAVE_SDL
+                if (has_screen
+                        && !sc_screen_handle_event(&s->screen, &event.sdl)) {
                     return SCRCPY_EXIT_FAILURE;
                 }
+#endif
                 break;
         }
     }
@@ -225,13 +268,11 @@ static void
 terminate_event_loop(void) {
     sc_reject_new_runnables();
 
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
+    struct sc_event event;
+    while (sc_poll_event(&event)) {
         if (event.type == SC_EVENT_RUN_ON_MAIN_THREAD) {
             // Make sure all posted runnables are run, to avoid memory leaks
-            sc_runnable_fn run = event.user.data1;
-            void *userdata = event.user.data2;
-            run(userdata);
+            event.run(event.userdata);
         }
     }
 }
@@ -239,10 +280,17 @@ terminate_event_loop(void) {
 // Return true on success, false on error
 static bool
 await_for_server(bool *connected) {
-    SDL_Event event;
-    while (SDL_WaitEvent(&event)) {
+    struct sc_event event;
+    while (sc_wait_event(&event)) {
         switch (event.type) {
-            case SDL_QUIT:
+            case SC_EVENT_TIME_LIMIT_REACHED:
+                // Only possible while resuming
+                LOGI("Time limit reached");
+                // fall through
+            case SC_EVENT_LATENCY_TEST_COMPLETED:
+                // Only possible while resuming
+                // fall through
+            case SC_EVENT_QUIT:
                 if (connected) {
                     *connected = false;
                 }
@@ -254,12 +302,31 @@ await_for_server(bool *connected) {
                     *connected = true;
                 }
                 return true;
+            // The other components only run while resuming
+            case SC_EVENT_DEMUXER_ERROR:
+                LOGE("Demuxer error");
+                return false;
+            case SC_EVENT_CONTROLLER_ERROR:
+                LOGE("Controller error");
+                return false;
+            case SC_EVENT_RECORDER_ERROR:
+                LOGE("Recorder error");
+                return false;
+            case SC_EVENT_AOA_OPEN_ERROR:
+                LOGE("AOA open error");
+                return false;
+            case SC_EVENT_LATENCY_TEST_ERROR:
+                LOGE("Latency test failed");
+                return false;
+            case SC_EVENT_RUN_ON_MAIN_THREAD:
+                event.run(event.userdata);
+                break;
             default:
+                // Including the disconnection events from the lost connection
                 break;
         }
     }
 
-    LOGE("SDL_WaitEvent() error: %s", SDL_GetError());
     return false;
 }
 
@@ -308,6 +375,30 @@ sc_audio_demuxer_on_ended(struct sc_demuxer *demuxer,
     }
 }
 
+static void
+sc_video_decoder_on_resync(struct sc_decoder *decoder, void *userdata) {
+    (void) decoder;
+
+    struct scrcpy *s = userdata;
+
+    // Resetting the video restarts the encoder, so the other packet sinks
+    // (recorder, restream, servers...) would receive a new session: in that
+    // case, wait for the next key frame
+    if (s->video_demuxer.packet_source.sink_count > 1) {
+        LOGD("Video decoder resync: waiting for the next key frame");
+        return;
+    }
+
+    // Request a new key frame, instead of waiting for the next one (there may
+    // be several seconds between key frames)
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_RESET_VIDEO;
+
+    if (!sc_controller_push_msg(&s->controller, &msg)) {
+        LOGW("Could not request reset video");
+    }
+}
+
 static void
 sc_controller_on_ended(struct sc_controller *controller, bool error,
                        void *userdata) {
@@ -357,6 +448,27 @@ sc_timeout_on_timeout(struct sc_timeout *timeout, void *userdata) {
     sc_push_event(SC_EVENT_TIME_LIMIT_REACHED);
 }
 
+static void
+sc_latency_test_on_completed(struct sc_latency_test *test, bool success,
+                             void *userdata) {
+    (void) test;
+    (void) userdata;
+
+    sc_push_event(success ? SC_EVENT_LATENCY_TEST_COMPLETED
+                          : SC_EVENT_LATENCY_TEST_ERROR);
+}
+
+static void
+scrcpy_turn_screen_off(struct sc_controller *controller) {
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+    msg.set_display_power.on = false;
+
+    if (!sc_controller_push_msg(controller, &msg)) {
+        LOGW("Could not request 'set display power'");
+    }
+}
+
 // Generate a scrcpy id to differentiate multiple running scrcpy instances
 static uint32_t
 scrcpy_generate_scid(void) {
@@ -366,6 +478,7 @@ scrcpy_generate_scid(void) {
     return sc_rand_u32(&rand) & 0x7FFFFFFF;
 }
 
+#ifdef HAVE_SDL
 static void
 init_sdl_gamepads(void) {
     // Trigger a SDL_CONTROLLERDEVICEADDED event for all gamepads already
@@ -380,9 +493,15 @@ init_sdl_gamepads(void) {
         }
     }
 }
+#endif
 
 enum scrcpy_exit_code
-scrcpy(struct scrcpy_options *options) {
+scrcpy_run(struct scrcpy_options *options, const struct scrcpy_sinks *sinks) {
+    static const struct scrcpy_sinks no_sinks = {0};
+    if (!sinks) {
+        sinks = &no_sinks;
+    }
+
     static struct scrcpy scrcpy;
 #ifndef NDEBUG
     // Detect missing initializations
@@ -390,14 +509,23 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     struct scrcpy *s = &scrcpy;
 
-    // Minimal SDL initialization
-    if (SDL_Init(SDL_INIT_EVENTS)) {
-        LOGE("Could not initialize SDL: %s", SDL_GetError());
+    // The current thread runs the event loop
+    SC_MAIN_THREAD_ID = sc_thread_get_id();
+
+#ifndef HAVE_SDL
+    // Without SDL, only the headless mode is available
+    assert(options->headless);
+#endif
+    // Nothing may require SDL in headless mode
+    assert(!options->headless || (!options->window && !options->audio_playback
+        && options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_DISABLED));
+
+    // In headless mode, SDL is not initialized at all: the events are
+    // dispatched by an internal loop
+    if (!sc_events_init(options->headless)) {
         return SCRCPY_EXIT_FAILURE;
     }
 
-    atexit(SDL_Quit);
-
     enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
 
     bool server_started = false;
@@ -406,12 +534,23 @@ scrcpy(struct scrcpy_options *options) {
     bool recorder_started = false;
     bool tcp_sink_initialized = false;
     bool tcp_sink_started = false;
+    bool rtsp_sink_initialized = false;
+    bool rtsp_sink_started = false;
+    bool fmp4_server_initialized = false;
+    bool fmp4_server_started = false;
+    bool video_renditions_initialized = false;
+    bool mjpeg_server_initialized = false;
+    bool mjpeg_server_started = false;
+    bool metrics_server_initialized = false;
+    bool metrics_server_started = false;
     bool control_forwarder_initialized = false;
     bool control_forwarder_started = false;
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
+    bool video_demuxer_initialized = false;
     bool video_demuxer_started = false;
+    bool audio_demuxer_initialized = false;
     bool audio_demuxer_started = false;
 #ifdef HAVE_USB
     bool aoa_hid_initialized = false;
@@ -421,9 +560,14 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
+    bool latency_test_initialized = false;
+    bool latency_test_started = false;
+#ifdef HAVE_SDL
     bool screen_initialized = false;
+#endif
     bool timeout_initialized = false;
     bool timeout_started = false;
+    bool trace_initialized = false;
 
     struct sc_acksync *acksync = NULL;
 
@@ -459,6 +603,7 @@ scrcpy(struct scrcpy_options *options) {
         .video = options->video,
         .audio = options->audio,
         .audio_dup = options->audio_dup,
+        .audio_raw_aggregation = options->audio_raw_aggregation,
         .show_touches = options->show_touches,
         .stay_awake = options->stay_awake,
         .video_codec_options = options->video_codec_options,
@@ -490,14 +635,26 @@ scrcpy(struct scrcpy_options *options) {
         .on_disconnected = sc_server_on_disconnected,
     };
     if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
+        sc_events_destroy();
         return SCRCPY_EXIT_FAILURE;
     }
 
+    if (options->trace_filename) {
+        // Must be initialized before starting any thread
+        if (!sc_trace_init(options->trace_filename,
+                           options->trace_signal)) {
+            goto end;
+        }
+        trace_initialized = true;
+    }
+
+#ifdef HAVE_SDL
     if (options->window) {
         // Set hints before starting the server thread to avoid race conditions
         // in SDL
         sdl_set_hints(options->render_driver);
     }
+#endif
 
     if (!sc_server_start(&s->server)) {
         goto end;
@@ -515,6 +672,7 @@ scrcpy(struct scrcpy_options *options) {
     assert(!options->video_playback || options->video);
     assert(!options->audio_playback || options->audio);
 
+#ifdef HAVE_SDL
     if (options->window ||
             (options->control && options->clipboard_autosync)) {
         // Initialize the video subsystem even if --no-video or
@@ -547,6 +705,7 @@ scrcpy(struct scrcpy_options *options) {
     }
 
     sdl_configure(options->video_playback, options->disable_screensaver);
+#endif
 
     // Await for server without blocking Ctrl+C handling
     bool connected;
@@ -587,6 +746,8 @@ scrcpy(struct scrcpy_options *options) {
         };
         sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
                         &video_demuxer_cbs, NULL);
+        sc_demuxer_set_resumable(&s->video_demuxer, options->resume);
+        video_demuxer_initialized = true;
     }
 
     if (options->audio) {
@@ -595,6 +756,8 @@ scrcpy(struct scrcpy_options *options) {
         };
         sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
                         &audio_demuxer_cbs, options);
+        sc_demuxer_set_resumable(&s->audio_demuxer, options->resume);
+        audio_demuxer_initialized = true;
     }
 
     bool needs_video_decoder = options->video_playback;
@@ -602,13 +765,25 @@ scrcpy(struct scrcpy_options *options) {
 #ifdef HAVE_V4L2
     needs_video_decoder |= !!options->v4l2_device;
 #endif
+    needs_video_decoder |= options->video && options->mjpeg_port;
+    needs_video_decoder |= options->video && sinks->video_frame_sink;
+    needs_video_decoder |= options->video && options->latency_test;
+    needs_audio_decoder |= options->audio && sinks->audio_frame_sink;
     if (needs_video_decoder) {
-        sc_decoder_init(&s->video_decoder, "video");
+        static const struct sc_decoder_callbacks video_decoder_cbs = {
+            .on_resync = sc_video_decoder_on_resync,
+        };
+        // Without control, the decoder waits for the next key frame on resync
+        if (options->control) {
+            sc_decoder_init(&s->video_decoder, "video", &video_decoder_cbs, s);
+        } else {
+            sc_decoder_init(&s->video_decoder, "video", NULL, NULL);
+        }
         sc_packet_source_add_sink(&s->video_demuxer.packet_source,
                                   &s->video_decoder.packet_sink);
     }
     if (needs_audio_decoder) {
-        sc_decoder_init(&s->audio_decoder, "audio");
+        sc_decoder_init(&s->audio_decoder, "audio", NULL, NULL);
         sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
                                   &s->audio_decoder.packet_sink);
     }
@@ -641,7 +816,10 @@ scrcpy(struct scrcpy_options *options) {
     }
 
     if (options->tcp_restream_port) {
-        if (!sc_tcp_sink_init(&s->tcp_sink, options->tcp_restream_port)) {
+        if (!sc_tcp_sink_init(&s->tcp_sink, options->tcp_restream_port,
+                              options->tcp_websocket,
+                              options->tcp_timeshift,
+                              options->tcp_pacing_rate)) {
             goto end;
         }
         tcp_sink_initialized = true;
@@ -659,10 +837,67 @@ scrcpy(struct scrcpy_options *options) {
         LOGI("TCP restream enabled on port %u", options->tcp_restream_port);
     }
 
+    if (options->rtsp_port) {
+        if (!sc_rtsp_sink_init(&s->rtsp_sink, options->rtsp_port,
+                               options->video, options->audio)) {
+            goto end;
+        }
+        rtsp_sink_initialized = true;
+
+        if (!sc_rtsp_sink_start(&s->rtsp_sink)) {
+            goto end;
+        }
+        rtsp_sink_started = true;
+
+        if (options->video) {
+            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                      &s->rtsp_sink.video_packet_sink);
+        }
+        if (options->audio) {
+            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                      &s->rtsp_sink.audio_packet_sink);
+        }
+    }
+
+    if (options->fmp4_port) {
+        if (!sc_fmp4_server_init(&s->fmp4_server, options->fmp4_port,
+                                 options->video, options->audio)) {
+            goto end;
+        }
+        fmp4_server_initialized = true;
+
+        if (!sc_fmp4_server_start(&s->fmp4_server)) {
+            goto end;
+        }
+        fmp4_server_started = true;
+
+        // The server muxes the streams via its own recorder
+        struct sc_recorder *fmp4_recorder = &s->fmp4_server.recorder;
+        if (options->video) {
+            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                      &fmp4_recorder->video_packet_sink);
+        }
+        if (options->audio) {
+            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                      &fmp4_recorder->audio_packet_sink);
+        }
+    }
+
+    if (options->video && sinks->video_packet_sink) {
+        sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                  sinks->video_packet_sink);
+    }
+    if (options->audio && sinks->audio_packet_sink) {
+        sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
+                                  sinks->audio_packet_sink);
+    }
+
     struct sc_controller *controller = NULL;
+#ifdef HAVE_SDL
     struct sc_key_processor *kp = NULL;
     struct sc_mouse_processor *mp = NULL;
     struct sc_gamepad_processor *gp = NULL;
+#endif
 
     if (options->control) {
         static const struct sc_controller_callbacks controller_cbs = {
@@ -774,6 +1009,7 @@ aoa_complete:
         assert(options->mouse_input_mode != SC_MOUSE_INPUT_MODE_AOA);
 #endif
 
+#ifdef HAVE_SDL
         struct sc_keyboard_uhid *uhid_keyboard = NULL;
 
         if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_SDK) {
@@ -813,6 +1049,11 @@ aoa_complete:
             sc_uhid_devices_init(&s->uhid_devices, uhid_keyboard);
             uhid_devices = &s->uhid_devices;
         }
+#else
+        // Without SDL, there is no input device on the computer: the control
+        // messages only come from the control forwarder
+        struct sc_uhid_devices *uhid_devices = NULL;
+#endif
 
         sc_controller_configure(&s->controller, acksync, uhid_devices);
 
@@ -824,7 +1065,9 @@ aoa_complete:
         // Start control forwarder if requested
         if (options->tcp_control_forwarding_port) {
             if (!sc_control_forwarder_init(&s->control_forwarder,
-                                           options->tcp_control_forwarding_port)) {
+                                           options->tcp_control_forwarding_port,
+                                           options->tcp_websocket,
+                                           options->resume)) {
                 goto end;
             }
             control_forwarder_initialized = true;
@@ -842,6 +1085,7 @@ aoa_complete:
     // There is a controller if and only if control is enabled
     assert(options->control == !!controller);
 
+#ifdef HAVE_SDL
     if (options->window) {
         const char *window_title =
             options->window_title ? options->window_title : info->device_name;
@@ -894,6 +1138,13 @@ aoa_complete:
         sc_frame_source_add_sink(&s->audio_decoder.frame_source,
                                  &s->audio_player.frame_sink);
     }
+#else
+    // Without SDL, there is no window and no audio playback
+    assert(!options->window);
+    assert(!options->audio_playback);
+    (void) info;
+    (void) fp;
+#endif
 
 #ifdef HAVE_V4L2
     if (options->v4l2_device) {
@@ -914,6 +1165,82 @@ aoa_complete:
     }
 #endif
 
+    // The consumers which may need scaled frames share the renditions
+    if (options->video && (options->mjpeg_port || sinks->video_frame_sink)) {
+        if (!sc_rendition_cache_init(&s->video_renditions)) {
+            goto end;
+        }
+        video_renditions_initialized = true;
+        scrcpy_video_renditions = &s->video_renditions;
+
+        sc_frame_source_add_sink(&s->video_decoder.frame_source,
+                                 &s->video_renditions.frame_sink);
+    }
+
+    if (options->video && options->mjpeg_port) {
+        if (!sc_mjpeg_server_init(&s->mjpeg_server, options->mjpeg_port,
+                                  &s->video_renditions,
+                                  options->mjpeg_max_size,
+                                  options->mjpeg_max_fps,
+                                  options->mjpeg_workers)) {
+            goto end;
+        }
+        mjpeg_server_initialized = true;
+
+        if (!sc_mjpeg_server_start(&s->mjpeg_server)) {
+            goto end;
+        }
+        mjpeg_server_started = true;
+
+        sc_frame_source_add_sink(&s->video_renditions.frame_source,
+                                 &s->mjpeg_server.frame_sink);
+    }
+
+    if (options->video && sinks->video_frame_sink) {
+        sc_frame_source_add_sink(&s->video_renditions.frame_source,
+                                 sinks->video_frame_sink);
+    }
+    if (options->audio && sinks->audio_frame_sink) {
+        sc_frame_source_add_sink(&s->audio_decoder.frame_source,
+                                 sinks->audio_frame_sink);
+    }
+
+    if (options->video && options->latency_test) {
+        assert(controller);
+        if (!sc_latency_test_init(&s->latency_test, controller,
+                                  options->latency_test,
+                                  options->latency_test_event,
+                                  &options->latency_test_region)) {
+            goto end;
+        }
+        latency_test_initialized = true;
+
+        sc_frame_source_add_sink(&s->video_decoder.frame_source,
+                                 &s->latency_test.frame_sink);
+
+        static const struct sc_latency_test_callbacks latency_test_cbs = {
+            .on_completed = sc_latency_test_on_completed,
+        };
+        if (!sc_latency_test_start(&s->latency_test, &latency_test_cbs,
+                                   NULL)) {
+            goto end;
+        }
+        latency_test_started = true;
+    }
+
+    if (options->metrics_port) {
+        if (!sc_metrics_server_init(&s->metrics_server,
+                                    options->metrics_port)) {
+            goto end;
+        }
+        metrics_server_initialized = true;
+
+        if (!sc_metrics_server_start(&s->metrics_server)) {
+            goto end;
+        }
+        metrics_server_started = true;
+    }
+
     // Now that the header values have been consumed, the socket(s) will
     // receive the stream(s). Start the demuxer(s).
 
@@ -934,13 +1261,7 @@ aoa_complete:
     // If the device screen is to be turned off, send the control message after
     // everything is set up
     if (options->control && options->turn_screen_off) {
-        struct sc_control_msg msg;
-        msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
-        msg.set_display_power.on = false;
-
-        if (!sc_controller_push_msg(&s->controller, &msg)) {
-            LOGW("Could not request 'set display power'");
-        }
+        scrcpy_turn_screen_off(&s->controller);
     }
 
     if (options->time_limit) {
@@ -964,10 +1285,12 @@ aoa_complete:
         timeout_started = true;
     }
 
+#ifdef HAVE_SDL
     if (options->control
             && options->gamepad_input_mode != SC_GAMEPAD_INPUT_MODE_DISABLED) {
         init_sdl_gamepads();
     }
+#endif
 
     if (options->control && options->start_app) {
         assert(controller);
@@ -988,16 +1311,102 @@ aoa_complete:
         }
     }
 
-    ret = event_loop(s, options->window);
+    for (;;) {
+        ret = event_loop(s, options->window);
+        if (ret != SCRCPY_EXIT_DISCONNECTED || !options->resume) {
+            break;
+        }
+
+        LOGW("Device connection lost, resuming...");
+        sc_tick resume_start = sc_tick_now();
+
+        // Kill the server and join the components using the sockets of the
+        // lost connection (the demuxers keep their sinks open, and the
+        // controller keeps its pending messages)
+        sc_server_suspend(&s->server);
+        if (video_demuxer_started) {
+            sc_demuxer_join(&s->video_demuxer);
+            video_demuxer_started = false;
+        }
+        if (audio_demuxer_started) {
+            sc_demuxer_join(&s->audio_demuxer);
+            audio_demuxer_started = false;
+        }
+        if (controller_started) {
+            sc_controller_stop(&s->controller);
+            sc_controller_join(&s->controller);
+            controller_started = false;
+        }
+        sc_server_join(&s->server);
+        server_started = false;
+
+        sc_server_resume(&s->server);
+        if (!sc_server_start(&s->server)) {
+            ret = SCRCPY_EXIT_FAILURE;
+            break;
+        }
+        server_started = true;
+
+        // The server retries until the device is reachable again
+        bool connected;
+        if (!await_for_server(&connected)) {
+            LOGE("Server connection failed");
+            ret = SCRCPY_EXIT_FAILURE;
+            break;
+        }
+
+        if (!connected) {
+            ret = SCRCPY_EXIT_SUCCESS;
+            break;
+        }
+
+        // A stream disabled by the device (or failed) is not resumed
+        if (options->video && sc_demuxer_can_resume(&s->video_demuxer)) {
+            if (!sc_demuxer_resume(&s->video_demuxer,
+                                   s->server.video_socket)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            video_demuxer_started = true;
+        }
+
+        if (options->audio && sc_demuxer_can_resume(&s->audio_demuxer)) {
+            if (!sc_demuxer_resume(&s->audio_demuxer,
+                                   s->server.audio_socket)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            audio_demuxer_started = true;
+        }
+
+        if (options->control) {
+            if (!sc_controller_resume(&s->controller,
+                                      s->server.control_socket)) {
+                ret = SCRCPY_EXIT_FAILURE;
+                break;
+            }
+            controller_started = true;
+
+            if (options->turn_screen_off) {
+                scrcpy_turn_screen_off(&s->controller);
+            }
+        }
+
+        sc_metrics_add(SC_METRIC_RESUMES, 1);
+        LOGI("Resumed in %" PRItick " ms",
+             SC_TICK_TO_MS(sc_tick_now() - resume_start));
+    }
     terminate_event_loop();
     LOGD("quit...");
 
+#ifdef HAVE_SDL
     if (options->video_playback) {
         // Close the window immediately on closing, because screen_destroy()
         // may only be called once the video demuxer thread is joined (it may
         // take time)
         sc_screen_hide_window(&s->screen);
     }
+#endif
 
 end:
     if (timeout_started) {
@@ -1027,6 +1436,9 @@ end:
     if (controller_started) {
         sc_controller_stop(&s->controller);
     }
+    if (latency_test_started) {
+        sc_latency_test_stop(&s->latency_test);
+    }
     if (file_pusher_initialized) {
         sc_file_pusher_stop(&s->file_pusher);
     }
@@ -1036,12 +1448,26 @@ end:
     if (tcp_sink_started) {
         sc_tcp_sink_stop(&s->tcp_sink);
     }
+    if (rtsp_sink_started) {
+        sc_rtsp_sink_stop(&s->rtsp_sink);
+    }
+    if (fmp4_server_started) {
+        sc_fmp4_server_stop(&s->fmp4_server);
+    }
+    if (mjpeg_server_started) {
+        sc_mjpeg_server_stop(&s->mjpeg_server);
+    }
+    if (metrics_server_started) {
+        sc_metrics_server_stop(&s->metrics_server);
+    }
     if (control_forwarder_started) {
         sc_control_forwarder_stop(&s->control_forwarder);
     }
+#ifdef HAVE_SDL
     if (screen_initialized) {
         sc_screen_interrupt(&s->screen);
     }
+#endif
 
     if (server_started) {
         // shutdown the sockets and kill the server
@@ -1065,6 +1491,15 @@ end:
         sc_demuxer_join(&s->audio_demuxer);
     }
 
+    // The sinks may only be closed once the demuxers are joined (they remain
+    // open on end-of-stream with --resume)
+    if (video_demuxer_initialized) {
+        sc_demuxer_destroy(&s->video_demuxer);
+    }
+    if (audio_demuxer_initialized) {
+        sc_demuxer_destroy(&s->audio_demuxer);
+    }
+
 #ifdef HAVE_V4L2
     if (v4l2_sink_initialized) {
         sc_v4l2_sink_destroy(&s->v4l2_sink);
@@ -1084,10 +1519,20 @@ end:
     // Destroy the screen only after the video demuxer is guaranteed to be
     // finished, because otherwise the screen could receive new frames after
     // destruction
+#ifdef HAVE_SDL
     if (screen_initialized) {
         sc_screen_join(&s->screen);
         sc_screen_destroy(&s->screen);
     }
+#endif
+
+    // The latency test injects events via the controller
+    if (latency_test_started) {
+        sc_latency_test_join(&s->latency_test);
+    }
+    if (latency_test_initialized) {
+        sc_latency_test_destroy(&s->latency_test);
+    }
 
     if (controller_started) {
         sc_controller_join(&s->controller);
@@ -1109,6 +1554,39 @@ end:
     if (tcp_sink_initialized) {
         sc_tcp_sink_destroy(&s->tcp_sink);
     }
+
+    if (rtsp_sink_started) {
+        sc_rtsp_sink_join(&s->rtsp_sink);
+    }
+    if (rtsp_sink_initialized) {
+        sc_rtsp_sink_destroy(&s->rtsp_sink);
+    }
+
+    if (fmp4_server_started) {
+        sc_fmp4_server_join(&s->fmp4_server);
+    }
+    if (fmp4_server_initialized) {
+        sc_fmp4_server_destroy(&s->fmp4_server);
+    }
+
+    if (mjpeg_server_started) {
+        sc_mjpeg_server_join(&s->mjpeg_server);
+    }
+    if (mjpeg_server_initialized) {
+        sc_mjpeg_server_destroy(&s->mjpeg_server);
+    }
+
+    if (video_renditions_initialized) {
+        scrcpy_video_renditions = NULL;
+        sc_rendition_cache_destroy(&s->video_renditions);
+    }
+
+    if (metrics_server_started) {
+        sc_metrics_server_join(&s->metrics_server);
+    }
+    if (metrics_server_initialized) {
+        sc_metrics_server_destroy(&s->metrics_server);
+    }
     
     if (control_forwarder_started) {
         sc_control_forwarder_join(&s->control_forwarder);
@@ -1128,5 +1606,30 @@ end:
 
     sc_server_destroy(&s->server);
 
+    if (trace_initialized) {
+        sc_trace_destroy();
+    }
+
+    sc_events_destroy();
+
     return ret;
 }
+
+bool
+scrcpy_get_video_rendition(const AVFrame *frame,
+                           const struct sc_rendition_spec *spec,
+                           AVFrame *out) {
+    // Only set while the video frame sink may receive frames
+    assert(scrcpy_video_renditions);
+    return sc_rendition_cache_get(scrcpy_video_renditions, frame, spec, out);
+}
+
+bool
+scrcpy_interrupt(void) {
+    return sc_push_event(SC_EVENT_QUIT);
+}
+
+enum scrcpy_exit_code
+scrcpy(struct scrcpy_options *options) {
+    return scrcpy_run(options, NULL);
+}
@@ -4,6 +4,9 @@
 #include "common.h"
 
 #include "options.h"
+#include "rendition_cache.h"
+#include "trait/frame_sink.h"
+#include "trait/packet_sink.h"
 
 enum scrcpy_exit_code {
     // Normal program termination
@@ -16,6 +19,57 @@ enum scrcpy_exit_code {
     SCRCPY_EXIT_DISCONNECTED,
 };
 
+/**
+ * Additional consumers of the session streams, for applications embedding
+ * scrcpy (libscrcpy)
+ *
+ * Each sink is optional (it may be NULL). The packet sinks receive the encoded
+ * packets as soon as they are received from the device, and the frame sinks
+ * receive the decoded frames (setting a frame sink enables the corresponding
+ * decoder). They are called from the demuxer threads, so they must not block.
+ */
+struct scrcpy_sinks {
+    struct sc_packet_sink *video_packet_sink;
+    struct sc_packet_sink *audio_packet_sink;
+    struct sc_frame_sink *video_frame_sink;
+    struct sc_frame_sink *audio_frame_sink;
+};
+
+/**
+ * Get a scaled (and/or grayscale) copy of a frame received by the video frame
+ * sink
+ *
+ * It may be called from push(), or later from any thread while the frame is
+ * referenced, until the sink is closed. Each rendition is computed once per
+ * frame, and shared with the other consumers (including the MJPEG server)
+ * requesting the same size and format. The result is referenced into out
+ * (which must be unreferenced by the caller).
+ */
+bool
+scrcpy_get_video_rendition(const AVFrame *frame,
+                           const struct sc_rendition_spec *spec,
+                           AVFrame *out);
+
+/**
+ * Run a session until the device is disconnected, an error occurs or
+ * scrcpy_interrupt() is called
+ *
+ * The calling thread runs the event loop (it becomes the "main" thread). Only
+ * one session may run per process.
+ */
+enum scrcpy_exit_code
+scrcpy_run(struct scrcpy_options *options, const struct scrcpy_sinks *sinks);
+
+/**
+ * Request the running session to stop (scrcpy_run() will return)
+ *
+ * It may be called from any thread, once the session is started (for example
+ * from a sink open() callback).
+ */
+bool
+scrcpy_interrupt(void);
+
+// Run a session with the sinks configured by the options only
 enum scrcpy_exit_code
 scrcpy(struct scrcpy_options *options);
 
@@ -6,8 +6,10 @@
 
 #include "events.h"
 #include "icon.h"
+#include "metrics.h"
 #include "options.h"
 #include "util/log.h"
+#include "util/trace.h"
 
 #define DISPLAY_MARGINS 96
 
@@ -213,8 +215,10 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
         sc_screen_update_content_rect(screen);
     }
 
+    sc_trace_begin("render");
     enum sc_display_result res =
         sc_display_render(&screen->display, &screen->rect, screen->orientation);
+    sc_trace_end("render");
     (void) res; // any error already logged
 }
 
@@ -309,6 +313,7 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
 
     if (previous_skipped) {
         sc_fps_counter_add_skipped_frame(&screen->fps_counter);
+        sc_metrics_add(SC_METRIC_SCREEN_SKIPPED_FRAMES, 1);
         // The SC_EVENT_NEW_FRAME triggered for the previous frame will consume
         // this new frame instead
     } else {
@@ -322,6 +327,12 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     return true;
 }
 
+static bool
+sc_screen_frame_sink_wants_frames(struct sc_frame_sink *sink) {
+    struct sc_screen *screen = DOWNCAST(sink);
+    return atomic_load_explicit(&screen->wants_frames, memory_order_relaxed);
+}
+
 bool
 sc_screen_init(struct sc_screen *screen,
                const struct sc_screen_params *params) {
@@ -332,6 +343,7 @@ sc_screen_init(struct sc_screen *screen,
     screen->minimized = false;
     screen->paused = false;
     screen->resume_frame = NULL;
+    atomic_init(&screen->wants_frames, true);
     screen->orientation = SC_ORIENTATION_0;
 
     screen->video = params->video;
@@ -457,6 +469,7 @@ sc_screen_init(struct sc_screen *screen,
         .open = sc_screen_frame_sink_open,
         .close = sc_screen_frame_sink_close,
         .push = sc_screen_frame_sink_push,
+        .wants_frames = sc_screen_frame_sink_wants_frames,
     };
 
     screen->frame_sink.ops = &ops;
@@ -646,6 +659,7 @@ sc_screen_apply_frame(struct sc_screen *screen) {
     assert(screen->video);
 
     sc_fps_counter_add_rendered_frame(&screen->fps_counter);
+    sc_metrics_add(SC_METRIC_SCREEN_RENDERED_FRAMES, 1);
 
     AVFrame *frame = screen->frame;
     struct sc_size new_frame_size = {frame->width, frame->height};
@@ -696,12 +710,16 @@ sc_screen_update_frame(struct sc_screen *screen) {
         } else {
             av_frame_unref(screen->resume_frame);
         }
+        sc_trace_begin("frame buffer consume");
         sc_frame_buffer_consume(&screen->fb, screen->resume_frame);
+        sc_trace_end("frame buffer consume");
         return true;
     }
 
     av_frame_unref(screen->frame);
+    sc_trace_begin("frame buffer consume");
     sc_frame_buffer_consume(&screen->fb, screen->frame);
+    sc_trace_end("frame buffer consume");
     return sc_screen_apply_frame(screen);
 }
 
@@ -732,6 +750,12 @@ sc_screen_set_paused(struct sc_screen *screen, bool paused) {
     }
 
     screen->paused = paused;
+
+    // While paused, the frames received would only replace the frame to
+    // display on resume: stop decoding them (the decoder will resync on
+    // resume)
+    atomic_store_explicit(&screen->wants_frames, !paused,
+                          memory_order_relaxed);
 }
 
 void
@@ -3,6 +3,7 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <SDL2/SDL.h>
@@ -69,6 +70,9 @@ struct sc_screen {
 
     bool paused;
     AVFrame *resume_frame;
+    // Read by the decoder thread, so that it does not decode frames while
+    // the screen is paused
+    atomic_bool wants_frames;
 };
 
 struct sc_screen_params {
@@ -13,6 +13,7 @@
 #include "util/log.h"
 #include "util/net_intr.h"
 #include "util/process.h"
+#include "util/rand.h"
 #include "util/str.h"
 
 #define SC_SERVER_FILENAME "scrcpy-server"
@@ -23,6 +24,8 @@
 #define SC_ADB_PORT_DEFAULT 5555
 #define SC_SOCKET_NAME_PREFIX "scrcpy_"
 
+#define SC_SERVER_RESUME_RETRY_DELAY SC_TICK_FROM_MS(500)
+
 static char *
 get_server_path(void) {
     char *server_path = sc_get_env("SCRCPY_SERVER_PATH");
@@ -298,6 +301,10 @@ execute_server(struct sc_server *server,
     if (params->audio_dup) {
         ADD_PARAM("audio_dup=true");
     }
+    if (params->audio_raw_aggregation) {
+        ADD_PARAM("audio_raw_aggregation=%" PRIu16,
+                  params->audio_raw_aggregation);
+    }
     if (params->max_size) {
         ADD_PARAM("max_size=%" PRIu16, params->max_size);
     }
@@ -551,6 +558,8 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
     server->serial = NULL;
     server->device_socket_name = NULL;
     server->stopped = false;
+    server->suspended = false;
+    server->resumed = false;
 
     server->video_socket = SC_SOCKET_NONE;
     server->audio_socket = SC_SOCKET_NONE;
@@ -930,17 +939,20 @@ sc_server_configure_tcpip_unknown_address(struct sc_server *server,
 
 static void
 sc_server_kill_adb_if_requested(struct sc_server *server) {
-    if (server->params.kill_adb_on_close) {
+    // Keep the adb server if the connection is to be resumed
+    sc_mutex_lock(&server->mutex);
+    bool suspended = server->suspended;
+    sc_mutex_unlock(&server->mutex);
+
+    if (server->params.kill_adb_on_close && !suspended) {
         LOGI("Killing adb server...");
         unsigned flags = SC_ADB_NO_STDOUT | SC_ADB_NO_STDERR | SC_ADB_NO_LOGERR;
         sc_adb_kill_server(&server->intr, flags);
     }
 }
 
-static int
-run_server(void *data) {
-    struct sc_server *server = data;
-
+static bool
+sc_server_select_device(struct sc_server *server) {
     const struct sc_server_params *params = &server->params;
 
     // Execute "adb start-server" before "adb devices" so that daemon starting
@@ -949,7 +961,7 @@ run_server(void *data) {
     bool ok = sc_adb_start_server(&server->intr, 0);
     if (!ok) {
         LOGE("Could not start adb server");
-        goto error_connection_failed;
+        return false;
     }
 
     // params->tcpip_dst implies params->tcpip
@@ -992,7 +1004,7 @@ run_server(void *data) {
         struct sc_adb_device device;
         ok = sc_adb_select_device(&server->intr, &selector, 0, &device);
         if (!ok) {
-            goto error_connection_failed;
+            return false;
         }
 
         if (params->tcpip) {
@@ -1001,7 +1013,7 @@ run_server(void *data) {
                                                            device.serial);
             sc_adb_device_destroy(&device);
             if (!ok) {
-                goto error_connection_failed;
+                return false;
             }
             assert(server->serial);
         } else {
@@ -1020,47 +1032,39 @@ run_server(void *data) {
         }
         ok = sc_server_configure_tcpip_known_address(server, tcpip_dst, plus);
         if (!ok) {
-            goto error_connection_failed;
+            return false;
         }
     }
 
-    const char *serial = server->serial;
-    assert(serial);
-    LOGD("Device serial: %s", serial);
+    return true;
+}
 
-    ok = push_server(&server->intr, serial);
-    if (!ok) {
-        goto error_connection_failed;
-    }
+// Execute the server on the device and connect to it
+static bool
+sc_server_launch(struct sc_server *server, sc_pid *ppid,
+                 struct sc_process_observer *observer) {
+    const struct sc_server_params *params = &server->params;
+    const char *serial = server->serial;
 
-    // If --list-* is passed, then the server just prints the requested data
-    // then exits.
-    if (params->list) {
-        sc_pid pid = execute_server(server, params);
-        if (pid == SC_PROCESS_NONE) {
-            goto error_connection_failed;
-        }
-        sc_process_wait(pid, NULL); // ignore exit code
-        sc_process_close(pid);
-        // Wake up await_for_server()
-        server->cbs->on_connected(server, server->cbs_userdata);
-        return 0;
-    }
+    // The socket name depends on the scid, which changes on resume
+    free(server->device_socket_name);
+    server->device_socket_name = NULL;
 
     int r = asprintf(&server->device_socket_name, SC_SOCKET_NAME_PREFIX "%08x",
                      params->scid);
     if (r == -1) {
         LOG_OOM();
-        goto error_connection_failed;
+        server->device_socket_name = NULL;
+        return false;
     }
     assert(r == sizeof(SC_SOCKET_NAME_PREFIX) - 1 + 8);
     assert(server->device_socket_name);
 
-    ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
-                            server->device_socket_name, params->port_range,
-                            params->force_adb_forward);
+    bool ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
+                                 server->device_socket_name,
+                                 params->port_range, params->force_adb_forward);
     if (!ok) {
-        goto error_connection_failed;
+        return false;
     }
 
     // server will connect to our server socket
@@ -1068,20 +1072,19 @@ run_server(void *data) {
     if (pid == SC_PROCESS_NONE) {
         sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
                             server->device_socket_name);
-        goto error_connection_failed;
+        return false;
     }
 
     static const struct sc_process_listener listener = {
         .on_terminated = sc_server_on_terminated,
     };
-    struct sc_process_observer observer;
-    ok = sc_process_observer_init(&observer, pid, &listener, server);
+    ok = sc_process_observer_init(observer, pid, &listener, server);
     if (!ok) {
         sc_process_terminate(pid);
         sc_process_wait(pid, true); // ignore exit code
         sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
                             server->device_socket_name);
-        goto error_connection_failed;
+        return false;
     }
 
     ok = sc_server_connect_to(server, &server->info);
@@ -1089,9 +1092,100 @@ run_server(void *data) {
     if (!ok) {
         sc_process_terminate(pid);
         sc_process_wait(pid, true); // ignore exit code
-        sc_process_observer_join(&observer);
-        sc_process_observer_destroy(&observer);
-        goto error_connection_failed;
+        sc_process_observer_join(observer);
+        sc_process_observer_destroy(observer);
+        return false;
+    }
+
+    *ppid = pid;
+    return true;
+}
+
+// Launch the server again on the already selected device, until it succeeds or
+// the server is stopped
+static bool
+sc_server_relaunch(struct sc_server *server, sc_pid *pid,
+                   struct sc_process_observer *observer) {
+    const char *serial = server->serial;
+    assert(serial);
+
+    bool tcpip = sc_adb_device_get_type(serial) == SC_ADB_DEVICE_TYPE_TCPIP;
+
+    struct sc_rand rand;
+    sc_rand_init(&rand);
+
+    for (;;) {
+        // The previous server may still be running on the device: never
+        // reuse its socket name (only use 31 bits, like the initial scid)
+        server->params.scid = sc_rand_u32(&rand) & 0x7FFFFFFF;
+
+        // The adb connection itself may have been lost (e.g. on a Wi-Fi
+        // hiccup)
+        bool ok = !tcpip || sc_server_connect_to_tcpip(server, serial, false);
+        if (ok && server->params.cleanup) {
+            // The server removed itself from the device on exit
+            ok = push_server(&server->intr, serial);
+        }
+        if (ok && sc_server_launch(server, pid, observer)) {
+            return true;
+        }
+
+        sc_tick deadline = sc_tick_now() + SC_SERVER_RESUME_RETRY_DELAY;
+        if (!sc_server_sleep(server, deadline)) {
+            return false;
+        }
+
+        LOGI("Retrying to connect to the device...");
+    }
+}
+
+static int
+run_server(void *data) {
+    struct sc_server *server = data;
+
+    const struct sc_server_params *params = &server->params;
+
+    sc_pid pid;
+    struct sc_process_observer observer;
+
+    if (server->resumed) {
+        // The device is already selected, only the server must be restarted
+        if (!sc_server_relaunch(server, &pid, &observer)) {
+            goto error_connection_failed;
+        }
+    } else {
+        bool ok = sc_server_select_device(server);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+
+        const char *serial = server->serial;
+        assert(serial);
+        LOGD("Device serial: %s", serial);
+
+        ok = push_server(&server->intr, serial);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+
+        // If --list-* is passed, then the server just prints the requested
+        // data then exits.
+        if (params->list) {
+            pid = execute_server(server, params);
+            if (pid == SC_PROCESS_NONE) {
+                goto error_connection_failed;
+            }
+            sc_process_wait(pid, NULL); // ignore exit code
+            sc_process_close(pid);
+            // Wake up await_for_server()
+            server->cbs->on_connected(server, server->cbs_userdata);
+            return 0;
+        }
+
+        ok = sc_server_launch(server, &pid, &observer);
+        if (!ok) {
+            goto error_connection_failed;
+        }
     }
 
     // Now connected
@@ -1102,6 +1196,7 @@ run_server(void *data) {
     while (!server->stopped) {
         sc_cond_wait(&server->cond_stopped, &server->mutex);
     }
+    bool suspended = server->suspended;
     sc_mutex_unlock(&server->mutex);
 
     // Interrupt sockets to wake up socket blocking calls on the server
@@ -1121,9 +1216,11 @@ run_server(void *data) {
         net_interrupt(server->control_socket);
     }
 
-    // Give some delay for the server to terminate properly
+    // Give some delay for the server to terminate properly (unless it is
+    // suspended: the connection is lost, so do not delay the resume)
 #define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
-    sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
+    sc_tick delay = suspended ? 0 : WATCHDOG_DELAY;
+    sc_tick deadline = sc_tick_now() + delay;
     bool terminated = sc_process_observer_timedwait(&observer, deadline);
 
     // After this delay, kill the server if it's not dead already.
@@ -1133,7 +1230,9 @@ run_server(void *data) {
         // The process may have terminated since the check, but it is not
         // reaped (closed) yet, so its PID is still valid, and it is ok to call
         // sc_process_terminate() even in that case.
-        LOGW("Killing the server...");
+        if (!suspended) {
+            LOGW("Killing the server...");
+        }
         sc_process_terminate(pid);
     }
 
@@ -1164,15 +1263,55 @@ sc_server_start(struct sc_server *server) {
     return true;
 }
 
-void
-sc_server_stop(struct sc_server *server) {
+static void
+sc_server_request_stop(struct sc_server *server, bool suspend) {
     sc_mutex_lock(&server->mutex);
     server->stopped = true;
+    server->suspended = suspend;
     sc_cond_signal(&server->cond_stopped);
     sc_intr_interrupt(&server->intr);
     sc_mutex_unlock(&server->mutex);
 }
 
+void
+sc_server_stop(struct sc_server *server) {
+    sc_server_request_stop(server, false);
+}
+
+void
+sc_server_suspend(struct sc_server *server) {
+    sc_server_request_stop(server, true);
+}
+
+void
+sc_server_resume(struct sc_server *server) {
+    // The device must have been selected by the initial connection
+    assert(server->serial);
+
+    // The sockets of the lost connection are not used anymore (the server
+    // thread and the components reading them are joined)
+    if (server->video_socket != SC_SOCKET_NONE) {
+        net_close(server->video_socket);
+        server->video_socket = SC_SOCKET_NONE;
+    }
+    if (server->audio_socket != SC_SOCKET_NONE) {
+        net_close(server->audio_socket);
+        server->audio_socket = SC_SOCKET_NONE;
+    }
+    if (server->control_socket != SC_SOCKET_NONE) {
+        net_close(server->control_socket);
+        server->control_socket = SC_SOCKET_NONE;
+    }
+
+    sc_intr_reset(&server->intr);
+    sc_adb_tunnel_init(&server->tunnel);
+
+    // Keep suspended set until the next stop, so that a failed attempt does
+    // not kill the adb server
+    server->stopped = false;
+    server->resumed = true;
+}
+
 void
 sc_server_join(struct sc_server *server) {
     sc_thread_join(&server->thread, NULL);
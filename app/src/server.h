@@ -54,6 +54,7 @@ struct sc_server_params {
     bool video;
     bool audio;
     bool audio_dup;
+    uint16_t audio_raw_aggregation;
     bool show_touches;
     bool stay_awake;
     bool force_adb_forward;
@@ -85,6 +86,10 @@ struct sc_server {
     sc_mutex mutex;
     sc_cond cond_stopped;
     bool stopped;
+    bool suspended; // stopped by sc_server_suspend()
+
+    // Set by sc_server_resume(): the device is already selected
+    bool resumed;
 
     struct sc_intr intr;
     struct sc_adb_tunnel tunnel;
@@ -130,6 +135,15 @@ sc_server_start(struct sc_server *server);
 void
 sc_server_stop(struct sc_server *server);
 
+// disconnect and kill the server process, so that it can be resumed
+void
+sc_server_suspend(struct sc_server *server);
+
+// prepare a suspended (and joined) server to be started again on the same
+// device, with new sockets
+void
+sc_server_resume(struct sc_server *server);
+
 // join the server thread
 void
 sc_server_join(struct sc_server *server);
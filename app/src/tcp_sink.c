@@ -1,11 +1,14 @@
 #include "tcp_sink.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "metrics.h"
 #include "util/binary.h"
 #include "util/log.h"
+#include "util/websocket.h"
 
 #define DOWNCAST(SINK) container_of(SINK, struct sc_tcp_sink, packet_sink)
 
@@ -16,6 +19,11 @@
 #define SC_PACKET_FLAG_CONFIG    (UINT64_C(1) << 63)
 #define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
 
+// When pacing, the bursts last at most 2 ms at the pacing rate (but are not
+// smaller than 16 KiB, so that small packets are sent at once)
+#define SC_TCP_SINK_PACING_BURST_MS 2
+#define SC_TCP_SINK_PACING_MIN_BURST 0x4000
+
 static AVPacket *
 sc_tcp_sink_packet_ref(const AVPacket *packet) {
     AVPacket *p = av_packet_alloc();
@@ -40,28 +48,177 @@ sc_tcp_sink_queue_clear(struct sc_tcp_sink_queue *queue) {
     }
 }
 
+// Wait until the pacing rate allows to send len bytes
+//
+// Return false if the sink is stopped meanwhile.
+static bool
+sc_tcp_sink_pace(struct sc_tcp_sink *sink, size_t len) {
+    sc_tick now = sc_tick_now();
+    sc_tick deadline = sc_token_bucket_take(&sink->pacer, len, now);
+    if (deadline <= now) {
+        return true;
+    }
+
+    sc_metrics_add(SC_METRIC_TCP_SINK_PACING_WAIT,
+                   SC_TICK_TO_US(deadline - now));
+
+    sc_mutex_lock(&sink->mutex);
+    while (!sink->stopped && sc_tick_now() < deadline) {
+        sc_cond_timedwait(&sink->cond, &sink->mutex, deadline);
+    }
+    bool stopped = sink->stopped;
+    sc_mutex_unlock(&sink->mutex);
+
+    return !stopped;
+}
+
+// Send the buffers in bursts of at most pacing_burst bytes, at the pacing rate
+static bool
+sc_tcp_sink_send_paced(struct sc_tcp_sink *sink,
+                       const struct sc_net_buf *bufs, unsigned count) {
+    // Position of the next byte to send
+    unsigned i = 0;
+    size_t offset = 0;
+
+    for (;;) {
+        struct sc_net_buf burst[SC_NET_SENDV_MAX];
+        unsigned n = 0;
+        size_t burst_len = 0;
+        while (i < count && burst_len < sink->pacing_burst) {
+            size_t len = bufs[i].len - offset;
+            if (len > sink->pacing_burst - burst_len) {
+                len = sink->pacing_burst - burst_len;
+            }
+            if (len) {
+                burst[n].data = (const uint8_t *) bufs[i].data + offset;
+                burst[n].len = len;
+                ++n;
+                burst_len += len;
+                offset += len;
+            }
+            if (offset == bufs[i].len) {
+                ++i;
+                offset = 0;
+            }
+        }
+
+        if (!burst_len) {
+            return true;
+        }
+
+        if (!sc_tcp_sink_pace(sink, burst_len)) {
+            return false;
+        }
+
+        ssize_t w = net_sendv_all(sink->client_socket, burst, n);
+        if (w < 0 || (size_t) w != burst_len) {
+            return false;
+        }
+    }
+}
+
+// Send a message (a header followed by data), in a single binary frame in
+// WebSocket mode
+static bool
+sc_tcp_sink_send_message(struct sc_tcp_sink *sink, const uint8_t *header,
+                         size_t header_len, const uint8_t *data, size_t len) {
+    if (!sink->pacing_rate) {
+        if (sink->websocket) {
+            sc_mutex_lock(&sink->send_mutex);
+            bool ok = sc_websocket_send_binary(sink->client_socket, header,
+                                               header_len, data, len);
+            sc_mutex_unlock(&sink->send_mutex);
+            return ok;
+        }
+
+        // Send the header and the data in a single system call: on separate
+        // send() calls, the small header may be delayed by Nagle's algorithm
+        const struct sc_net_buf bufs[] = {
+            {header, header_len},
+            {data, len},
+        };
+        ssize_t w = net_sendv_all(sink->client_socket, bufs, ARRAY_LEN(bufs));
+        return w >= 0 && (size_t) w == header_len + len;
+    }
+
+    if (!sink->websocket) {
+        const struct sc_net_buf bufs[] = {
+            {header, header_len},
+            {data, len},
+        };
+        return sc_tcp_sink_send_paced(sink, bufs, ARRAY_LEN(bufs));
+    }
+
+    // The frame may be sent in several bursts, the receiver thread must not
+    // send a control frame meanwhile
+    uint8_t frame_header[SC_WEBSOCKET_MAX_HEADER_SIZE];
+    size_t n = sc_websocket_write_frame_header(frame_header,
+                                               SC_WEBSOCKET_OPCODE_BINARY,
+                                               header_len + len);
+    const struct sc_net_buf bufs[] = {
+        {frame_header, n},
+        {header, header_len},
+        {data, len},
+    };
+    sc_mutex_lock(&sink->send_mutex);
+    bool ok = sc_tcp_sink_send_paced(sink, bufs, ARRAY_LEN(bufs));
+    sc_mutex_unlock(&sink->send_mutex);
+    return ok;
+}
+
+// Must be called with the mutex locked
+static void
+sc_tcp_sink_write_codec_info(struct sc_tcp_sink *sink,
+                             uint8_t *buf) {
+    // Codec ID (4 bytes), width and height (8 bytes)
+    sc_write32be(buf, sink->codec_id);
+    sc_write32be(buf + 4, sink->width);
+    sc_write32be(buf + 8, sink->height);
+}
+
 static bool
 sc_tcp_sink_send_codec_info(struct sc_tcp_sink *sink) {
-    uint8_t buf[12];
+    uint8_t buf[SC_TCP_SINK_CODEC_INFO_SIZE];
     
-    // Send codec ID (4 bytes)
-    sc_write32be(buf, sink->codec_id);
-    if (net_send_all(sink->client_socket, buf, 4) < 0) {
-        return false;
-    }
+    sc_mutex_lock(&sink->mutex);
+    sc_tcp_sink_write_codec_info(sink, buf);
+    sc_mutex_unlock(&sink->mutex);
     
-    // Send width and height (8 bytes)
-    sc_write32be(buf, sink->width);
-    sc_write32be(buf + 4, sink->height);
-    if (net_send_all(sink->client_socket, buf, 8) < 0) {
+    if (!sc_tcp_sink_send_message(sink, buf, sizeof(buf), NULL, 0)) {
         return false;
     }
     
-    LOGI("TCP sink: sent codec info to client (codec=%08" PRIx32 ", %ux%u)",
-         sink->codec_id, sink->width, sink->height);
+    LOGI("TCP sink: sent codec info to client (codec=%08" PRIx32 ", %" PRIu32
+         "x%" PRIu32 ")", sc_read32be(buf), sc_read32be(buf + 4),
+         sc_read32be(buf + 8));
     return true;
 }
 
+// A session packet is a config packet flagged as a key frame, containing the
+// new codec info (the same as the stream header)
+//
+// Must be called with the mutex locked
+static AVPacket *
+sc_tcp_sink_session_packet_new(struct sc_tcp_sink *sink) {
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        return NULL;
+    }
+    
+    if (av_new_packet(packet, SC_TCP_SINK_CODEC_INFO_SIZE)) {
+        LOG_OOM();
+        av_packet_free(&packet);
+        return NULL;
+    }
+    
+    sc_tcp_sink_write_codec_info(sink, packet->data);
+    packet->pts = AV_NOPTS_VALUE;
+    packet->dts = AV_NOPTS_VALUE;
+    packet->flags |= AV_PKT_FLAG_KEY;
+    return packet;
+}
+
 static bool
 sc_tcp_sink_send_packet(struct sc_tcp_sink *sink, const AVPacket *packet) {
     uint8_t header[12];
@@ -69,8 +226,11 @@ sc_tcp_sink_send_packet(struct sc_tcp_sink *sink, const AVPacket *packet) {
     // Build PTS with flags
     uint64_t pts_flags;
     if (packet->pts == AV_NOPTS_VALUE) {
-        // Config packet
+        // Config packet (or session packet if also flagged as key frame)
         pts_flags = SC_PACKET_FLAG_CONFIG;
+        if (packet->flags & AV_PKT_FLAG_KEY) {
+            pts_flags |= SC_PACKET_FLAG_KEY_FRAME;
+        }
     } else {
         pts_flags = (uint64_t) packet->pts;
         if (packet->flags & AV_PKT_FLAG_KEY) {
@@ -82,17 +242,186 @@ sc_tcp_sink_send_packet(struct sc_tcp_sink *sink, const AVPacket *packet) {
     sc_write64be(header, pts_flags);
     sc_write32be(header + 8, packet->size);
     
-    // Send header
-    if (net_send_all(sink->client_socket, header, 12) < 0) {
-        return false;
+    // Send header and packet data
+    sc_tick start = sc_tick_now();
+    bool ok = sc_tcp_sink_send_message(sink, header, sizeof(header),
+                                       packet->data, packet->size);
+    if (ok) {
+        sc_metrics_add(SC_METRIC_TCP_SINK_SENT_PACKETS, 1);
+        sc_metrics_add(SC_METRIC_TCP_SINK_SEND_TIME,
+                       SC_TICK_TO_US(sc_tick_now() - start));
     }
+    return ok;
+}
+
+static int
+run_tcp_sink_receiver(void *data) {
+    struct sc_tcp_sink *sink = data;
     
-    // Send packet data
-    if (net_send_all(sink->client_socket, packet->data, packet->size) < 0) {
-        return false;
+    struct sc_websocket_reader ws_reader;
+    if (sink->websocket) {
+        sc_websocket_reader_init(&ws_reader, sink->client_socket);
+        ws_reader.send_mutex = &sink->send_mutex;
     }
     
-    return true;
+    for (;;) {
+        // Read a complete request (it may span several WebSocket frames)
+        uint8_t buf[SC_TCP_SINK_SEEK_REQUEST_SIZE];
+        size_t len = 0;
+        while (len < sizeof(buf)) {
+            ssize_t r = sink->websocket
+                      ? sc_websocket_recv(&ws_reader, buf + len,
+                                          sizeof(buf) - len)
+                      : net_recv(sink->client_socket, buf + len,
+                                 sizeof(buf) - len);
+            if (r <= 0) {
+                goto end;
+            }
+            len += r;
+        }
+        
+        if (!sink->timeshift_duration) {
+            // Live only, there is nothing to seek
+            continue;
+        }
+
+        int64_t offset = (int64_t) sc_read64be(buf);
+        uint32_t speed = sc_read32be(buf + 8);
+        if (offset > 0) {
+            // Cannot seek in the future
+            offset = 0;
+        }
+        
+        LOGI("TCP sink: seek request (offset=%" PRIi64 "ms, speed=%" PRIu32
+             "%%)", offset / 1000, speed);
+        
+        sc_mutex_lock(&sink->mutex);
+        sink->seek_requested = true;
+        sink->seek_offset = offset;
+        sink->seek_speed = speed;
+        sc_cond_signal(&sink->cond);
+        sc_mutex_unlock(&sink->mutex);
+    }
+    
+end:
+    if (sink->websocket) {
+        // The WebSocket connection is closed, stop sending
+        sc_mutex_lock(&sink->mutex);
+        sink->client_disconnected = true;
+        sc_cond_signal(&sink->cond);
+        sc_mutex_unlock(&sink->mutex);
+    }
+    
+    LOGD("TCP sink receiver thread ended");
+    return 0;
+}
+
+// Stream from the time-shift buffer, starting from the last key frame, until
+// the client is disconnected
+static void
+sc_tcp_sink_stream_timeshift(struct sc_tcp_sink *sink) {
+    sc_mutex_lock(&sink->mutex);
+    // Start live (from the last key frame)
+    sink->seek_requested = true;
+    sink->seek_offset = 0;
+    sink->seek_speed = 0;
+    // The codec info sent on connection is up-to-date
+    uint64_t session_count = sink->session_count;
+    sc_mutex_unlock(&sink->mutex);
+    
+    struct sc_timeshift *ts = &sink->timeshift;
+    bool positioned = false;
+    uint64_t seq = 0;
+    
+    // While catching up, the packets are sent at speed% of the real-time rate
+    // (0 for as fast as possible)
+    uint32_t speed = 0;
+    sc_tick pace_tick = 0;
+    int64_t pace_pts = 0;
+    
+    sc_mutex_lock(&sink->mutex);
+    for (;;) {
+        if (sink->stopped || sink->client_disconnected) {
+            break;
+        }
+        
+        if (session_count != sink->session_count) {
+            // The store has been cleared, announce the new session before
+            // sending its packets
+            session_count = sink->session_count;
+            AVPacket *packet = sc_tcp_sink_session_packet_new(sink);
+            sc_mutex_unlock(&sink->mutex);
+            
+            bool ok = packet && sc_tcp_sink_send_packet(sink, packet);
+            av_packet_free(&packet);
+            
+            sc_mutex_lock(&sink->mutex);
+            if (!ok) {
+                LOGI("TCP sink: client disconnected");
+                break;
+            }
+            
+            if (positioned && seq < ts->first_seq) {
+                seq = ts->first_seq;
+            }
+            continue;
+        }
+        
+        if (sink->seek_requested) {
+            uint64_t target;
+            // If the buffer is empty, the request remains pending
+            if (sc_timeshift_seek(ts, sink->seek_offset, &target)) {
+                sink->seek_requested = false;
+                positioned = true;
+                seq = target;
+                speed = sink->seek_offset ? sink->seek_speed : 0;
+                pace_tick = sc_tick_now();
+                pace_pts = sc_timeshift_get(ts, seq)->pts;
+            }
+        }
+        
+        if (!positioned || seq == sc_timeshift_end(ts)) {
+            // Live, the next packets are sent as soon as they are received
+            speed = 0;
+            sc_cond_wait(&sink->cond, &sink->mutex);
+            continue;
+        }
+        
+        if (seq < ts->first_seq) {
+            // The store always starts on a key frame
+            LOGW("TCP sink: client too slow, %" PRIu64 " packets skipped",
+                 ts->first_seq - seq);
+            seq = ts->first_seq;
+            pace_tick = sc_tick_now();
+            pace_pts = sc_timeshift_get(ts, seq)->pts;
+        }
+        
+        const AVPacket *p = sc_timeshift_get(ts, seq);
+        assert(p);
+        
+        if (speed) {
+            sc_tick deadline =
+                pace_tick + (p->pts - pace_pts) * 100 / (sc_tick) speed;
+            if (sc_tick_now() < deadline) {
+                sc_cond_timedwait(&sink->cond, &sink->mutex, deadline);
+                continue;
+            }
+        }
+        
+        AVPacket *packet = sc_tcp_sink_packet_ref(p);
+        ++seq;
+        sc_mutex_unlock(&sink->mutex);
+        
+        bool ok = packet && sc_tcp_sink_send_packet(sink, packet);
+        av_packet_free(&packet);
+        
+        sc_mutex_lock(&sink->mutex);
+        if (!ok) {
+            LOGI("TCP sink: client disconnected");
+            break;
+        }
+    }
+    sc_mutex_unlock(&sink->mutex);
 }
 
 static int
@@ -127,6 +456,19 @@ run_tcp_sink(void *data) {
         }
         
         LOGI("TCP sink: client connected");
+
+        if (sink->pacing_rate) {
+            // Each client starts with a full bucket
+            sc_token_bucket_init(&sink->pacer, sink->pacing_rate,
+                                 sink->pacing_burst, sc_tick_now());
+        }
+        
+        if (sink->websocket && !sc_websocket_accept(sink->client_socket)) {
+            LOGW("TCP sink: WebSocket handshake failed");
+            net_close(sink->client_socket);
+            sink->client_socket = SC_SOCKET_NONE;
+            continue;
+        }
         
         // Send codec info to the new client
         sc_mutex_lock(&sink->mutex);
@@ -153,7 +495,7 @@ run_tcp_sink(void *data) {
                     sink->client_socket = SC_SOCKET_NONE;
                     continue;
                 }
-                LOGI("TCP sink: sent cached config packet to new client");
+                LOGD("TCP sink: sent cached config packet to new client");
             }
         } else {
             // Codec info not yet available, wait for it
@@ -185,16 +527,40 @@ run_tcp_sink(void *data) {
                     sink->client_socket = SC_SOCKET_NONE;
                     continue;
                 }
-                LOGI("TCP sink: sent cached config packet to new client");
+                LOGD("TCP sink: sent cached config packet to new client");
             }
         }
         
         // Process packets for this client
+        sc_metrics_set(SC_METRIC_TCP_SINK_CLIENTS, 1);
         bool client_connected = true;
+
+        sc_mutex_lock(&sink->mutex);
+        sink->client_disconnected = false;
+        sc_mutex_unlock(&sink->mutex);
+
+        // The receiver handles the seek requests in time-shift mode, and the
+        // WebSocket control frames (ping and close) in any mode
+        bool receiver_started = false;
+        if (sink->timeshift_duration || sink->websocket) {
+            receiver_started = sc_thread_create(&sink->receiver_thread,
+                                                run_tcp_sink_receiver,
+                                                "tcp-sink-recv", sink);
+            if (!receiver_started) {
+                LOGE("TCP sink: could not start receiver thread");
+                client_connected = false;
+            }
+        }
+
+        if (client_connected && sink->timeshift_duration) {
+            sc_tcp_sink_stream_timeshift(sink);
+            client_connected = false;
+        }
         while (client_connected && !sink->stopped) {
             sc_mutex_lock(&sink->mutex);
             
-            while (sc_vecdeque_is_empty(&sink->queue) && !sink->stopped) {
+            while (sc_vecdeque_is_empty(&sink->queue) && !sink->stopped
+                    && !sink->client_disconnected) {
                 sc_cond_wait(&sink->cond, &sink->mutex);
             }
             
@@ -202,8 +568,16 @@ run_tcp_sink(void *data) {
                 sc_mutex_unlock(&sink->mutex);
                 break;
             }
+
+            if (sink->client_disconnected) {
+                sc_mutex_unlock(&sink->mutex);
+                LOGI("TCP sink: client disconnected");
+                break;
+            }
             
             AVPacket *packet = sc_vecdeque_pop(&sink->queue);
+            sc_metrics_set(SC_METRIC_TCP_SINK_QUEUE,
+                           sc_vecdeque_size(&sink->queue));
             sc_mutex_unlock(&sink->mutex);
             
             if (!sc_tcp_sink_send_packet(sink, packet)) {
@@ -213,17 +587,25 @@ run_tcp_sink(void *data) {
             
             av_packet_free(&packet);
         }
+
+        if (receiver_started) {
+            // Unblock the receiver thread
+            net_interrupt(sink->client_socket);
+            sc_thread_join(&sink->receiver_thread, NULL);
+        }
         
         // Client disconnected or stopped
         if (sink->client_socket != SC_SOCKET_NONE) {
             net_close(sink->client_socket);
             sink->client_socket = SC_SOCKET_NONE;
         }
+        sc_metrics_set(SC_METRIC_TCP_SINK_CLIENTS, 0);
     }
     
     // Cleanup
     sc_mutex_lock(&sink->mutex);
     sc_tcp_sink_queue_clear(&sink->queue);
+    sc_metrics_set(SC_METRIC_TCP_SINK_QUEUE, 0);
     sc_mutex_unlock(&sink->mutex);
     
     if (sink->server_socket != SC_SOCKET_NONE) {
@@ -267,6 +649,41 @@ sc_tcp_sink_packet_sink_open(struct sc_packet_sink *sink_trait,
     return true;
 }
 
+static bool
+sc_tcp_sink_packet_sink_session(struct sc_packet_sink *sink_trait,
+                                const AVCodecContext *ctx) {
+    struct sc_tcp_sink *sink = DOWNCAST(sink_trait);
+    
+    sc_mutex_lock(&sink->mutex);
+    
+    // New clients will receive the new codec info
+    sink->width = ctx->width;
+    sink->height = ctx->height;
+    
+    bool ok = true;
+    if (sink->timeshift_duration) {
+        // The stored packets could not be decoded with the new codec info
+        sc_timeshift_clear(&sink->timeshift);
+        ++sink->session_count;
+        sc_cond_signal(&sink->cond);
+    } else if (sink->client_socket != SC_SOCKET_NONE) {
+        // Notify the connected client in order
+        AVPacket *packet = sc_tcp_sink_session_packet_new(sink);
+        ok = packet && sc_vecdeque_push(&sink->queue, packet);
+        if (ok) {
+            sc_cond_signal(&sink->cond);
+        } else if (packet) {
+            LOG_OOM();
+            av_packet_free(&packet);
+        }
+    }
+    
+    sc_mutex_unlock(&sink->mutex);
+    
+    LOGI("TCP sink: new session (%dx%d)", ctx->width, ctx->height);
+    return ok;
+}
+
 static void
 sc_tcp_sink_packet_sink_close(struct sc_packet_sink *sink_trait) {
     struct sc_tcp_sink *sink = DOWNCAST(sink_trait);
@@ -296,13 +713,24 @@ sc_tcp_sink_packet_sink_push(struct sc_packet_sink *sink_trait,
             av_packet_free(&sink->config_packet);
         }
         sink->config_packet = sc_tcp_sink_packet_ref(packet);
-        LOGI("TCP sink: cached config packet (size=%d)", packet->size);
+        LOGD("TCP sink: cached config packet (size=%d)", packet->size);
+    }
+    
+    if (sink->timeshift_duration) {
+        // Store the packets even if no client is connected, to be able to
+        // replay them
+        bool ok = packet->pts == AV_NOPTS_VALUE
+               || sc_timeshift_push(&sink->timeshift, packet);
+        sc_cond_signal(&sink->cond);
+        sc_mutex_unlock(&sink->mutex);
+        return ok;
     }
     
     // Only queue packets if a client is connected
     if (sink->client_socket == SC_SOCKET_NONE) {
         // No client connected, drop packet (but we cached config above)
         sc_mutex_unlock(&sink->mutex);
+        sc_metrics_add(SC_METRIC_TCP_SINK_DROPPED, 1);
         return true;
     }
     
@@ -321,6 +749,7 @@ sc_tcp_sink_packet_sink_push(struct sc_packet_sink *sink_trait,
         return false;
     }
     
+    sc_metrics_set(SC_METRIC_TCP_SINK_QUEUE, sc_vecdeque_size(&sink->queue));
     sc_cond_signal(&sink->cond);
     sc_mutex_unlock(&sink->mutex);
     
@@ -328,12 +757,21 @@ sc_tcp_sink_packet_sink_push(struct sc_packet_sink *sink_trait,
 }
 
 bool
-sc_tcp_sink_init(struct sc_tcp_sink *sink, uint16_t port) {
+sc_tcp_sink_init(struct sc_tcp_sink *sink, uint16_t port, bool websocket,
+                 sc_tick timeshift_duration, uint32_t pacing_rate) {
     sink->port = port;
+    sink->websocket = websocket;
+    sink->timeshift_duration = timeshift_duration;
+    sink->pacing_rate = pacing_rate / 8;
+    sink->pacing_burst = sink->pacing_rate * SC_TCP_SINK_PACING_BURST_MS / 1000;
+    if (sink->pacing_burst < SC_TCP_SINK_PACING_MIN_BURST) {
+        sink->pacing_burst = SC_TCP_SINK_PACING_MIN_BURST;
+    }
     sink->server_socket = SC_SOCKET_NONE;
     sink->client_socket = SC_SOCKET_NONE;
     sink->stopped = false;
     sink->codec_sent = false;
+    sink->session_count = 0;
     sink->config_packet = NULL;
     
     bool ok = sc_mutex_init(&sink->mutex);
@@ -347,12 +785,25 @@ sc_tcp_sink_init(struct sc_tcp_sink *sink, uint16_t port) {
         return false;
     }
     
+    ok = sc_mutex_init(&sink->send_mutex);
+    if (!ok) {
+        sc_cond_destroy(&sink->cond);
+        sc_mutex_destroy(&sink->mutex);
+        return false;
+    }
+    
     sc_vecdeque_init(&sink->queue);
+    sc_timeshift_init(&sink->timeshift, timeshift_duration);
+    sink->client_disconnected = false;
+    sink->seek_requested = false;
+    sink->seek_offset = 0;
+    sink->seek_speed = 0;
     
     static const struct sc_packet_sink_ops ops = {
         .open = sc_tcp_sink_packet_sink_open,
         .close = sc_tcp_sink_packet_sink_close,
         .push = sc_tcp_sink_packet_sink_push,
+        .session = sc_tcp_sink_packet_sink_session,
     };
     
     sink->packet_sink.ops = &ops;
@@ -397,6 +848,7 @@ sc_tcp_sink_join(struct sc_tcp_sink *sink) {
 void
 sc_tcp_sink_destroy(struct sc_tcp_sink *sink) {
     sc_tcp_sink_queue_clear(&sink->queue);
+    sc_timeshift_destroy(&sink->timeshift);
     
     // Free cached config packet
     if (sink->config_packet) {
@@ -404,6 +856,7 @@ sc_tcp_sink_destroy(struct sc_tcp_sink *sink) {
         sink->config_packet = NULL;
     }
     
+    sc_mutex_destroy(&sink->send_mutex);
     sc_cond_destroy(&sink->cond);
     sc_mutex_destroy(&sink->mutex);
 }
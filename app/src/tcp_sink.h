@@ -7,16 +7,36 @@
 #include <stdint.h>
 #include <libavcodec/avcodec.h>
 
+#include "timeshift.h"
 #include "trait/packet_sink.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
+#include "util/token_bucket.h"
 #include "util/vecdeque.h"
 
+// Seek request from the client (in time-shift mode): offset relative to live
+// in microseconds (8 bytes, signed, <= 0) and catch-up speed in percent
+// (4 bytes, 0 for as fast as possible)
+#define SC_TCP_SINK_SEEK_REQUEST_SIZE 12
+
+// Codec info sent to the client on connection and in session packets: codec
+// id (4 bytes), width and height (4 bytes each)
+#define SC_TCP_SINK_CODEC_INFO_SIZE 12
+
 struct sc_tcp_sink_queue SC_VECDEQUE(AVPacket *);
 
 struct sc_tcp_sink {
     struct sc_packet_sink packet_sink;
     uint16_t port;
+    // Use the WebSocket protocol (each message in a binary frame)
+    bool websocket;
+    // Duration of the time-shift buffer (0 if disabled)
+    sc_tick timeshift_duration;
+    // Pacing rate in bytes per second (0 if disabled)
+    uint64_t pacing_rate;
+    // Maximum number of bytes sent at once when pacing
+    size_t pacing_burst;
     
     sc_socket server_socket;
     sc_socket client_socket;
@@ -25,22 +45,47 @@ struct sc_tcp_sink {
     sc_mutex mutex;
     sc_cond cond;
     
+    // Time-shift or WebSocket mode only: the receiver thread reads the seek
+    // requests, and may send WebSocket control frames (writes are serialized
+    // by send_mutex)
+    sc_thread receiver_thread;
+    sc_mutex send_mutex;
+    
     bool stopped;
     bool codec_sent;
+    // Set by the receiver thread, protected by the mutex
+    bool client_disconnected;
     
     struct sc_tcp_sink_queue queue;
     
-    // Codec information to send on connection
+    // Time-shift mode only (instead of the queue), protected by the mutex
+    struct sc_timeshift timeshift;
+    bool seek_requested;
+    sc_tick seek_offset;
+    uint32_t seek_speed;
+    
+    // Codec information to send on connection, protected by the mutex
     uint32_t codec_id;
     uint32_t width;
     uint32_t height;
+    // Incremented on each new session (time-shift mode only), protected by
+    // the mutex
+    uint64_t session_count;
     
     // Cached config packet (SPS/PPS) to send to new clients
     AVPacket *config_packet;
+
+    // Pacing of the current client, only accessed by the sender (the sink
+    // thread)
+    struct sc_token_bucket pacer;
 };
 
+// If pacing_rate (in bits per second) is not 0, the packets are sent to the
+// client at this rate, a large packet (typically a key frame) being split
+// into small bursts instead of being sent at once at line rate
 bool
-sc_tcp_sink_init(struct sc_tcp_sink *sink, uint16_t port);
+sc_tcp_sink_init(struct sc_tcp_sink *sink, uint16_t port, bool websocket,
+                 sc_tick timeshift_duration, uint32_t pacing_rate);
 
 bool
 sc_tcp_sink_start(struct sc_tcp_sink *sink);
@@ -0,0 +1,138 @@
+#include "timeshift.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+void
+sc_timeshift_init(struct sc_timeshift *ts, sc_tick duration) {
+    ts->duration = duration;
+    sc_vecdeque_init(&ts->packets);
+    ts->first_seq = 0;
+    sc_vecdeque_init(&ts->key_frames);
+}
+
+void
+sc_timeshift_clear(struct sc_timeshift *ts) {
+    while (!sc_vecdeque_is_empty(&ts->packets)) {
+        AVPacket *packet = sc_vecdeque_pop(&ts->packets);
+        av_packet_free(&packet);
+        ++ts->first_seq;
+    }
+    while (!sc_vecdeque_is_empty(&ts->key_frames)) {
+        (void) sc_vecdeque_popref(&ts->key_frames);
+    }
+}
+
+void
+sc_timeshift_destroy(struct sc_timeshift *ts) {
+    sc_timeshift_clear(ts);
+    sc_vecdeque_destroy(&ts->packets);
+    sc_vecdeque_destroy(&ts->key_frames);
+}
+
+// Drop the oldest GOPs which are not necessary to cover the duration
+static void
+sc_timeshift_evict(struct sc_timeshift *ts, int64_t last_pts) {
+    while (sc_vecdeque_size(&ts->key_frames) >= 2) {
+        struct sc_timeshift_key_frame *next =
+            sc_vecdeque_at(&ts->key_frames, 1);
+        if (last_pts - next->pts < ts->duration) {
+            // The second GOP does not cover the duration, keep the first one
+            break;
+        }
+
+        while (ts->first_seq < next->seq) {
+            AVPacket *packet = sc_vecdeque_pop(&ts->packets);
+            av_packet_free(&packet);
+            ++ts->first_seq;
+        }
+        (void) sc_vecdeque_popref(&ts->key_frames);
+    }
+}
+
+bool
+sc_timeshift_push(struct sc_timeshift *ts, const AVPacket *packet) {
+    assert(packet->pts != AV_NOPTS_VALUE);
+
+    bool key_frame = packet->flags & AV_PKT_FLAG_KEY;
+    if (!key_frame && sc_vecdeque_is_empty(&ts->key_frames)) {
+        // Could not be decoded without the previous packets
+        return true;
+    }
+
+    // Reserve the index entry first, so that pushing the packet and its index
+    // entry cannot fail separately
+    if (key_frame && !sc_vecdeque_reserve(&ts->key_frames,
+                                          ts->key_frames.size + 1)) {
+        LOG_OOM();
+        return false;
+    }
+
+    AVPacket *p = av_packet_alloc();
+    if (!p) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (av_packet_ref(p, packet)) {
+        LOG_OOM();
+        av_packet_free(&p);
+        return false;
+    }
+
+    uint64_t seq = sc_timeshift_end(ts);
+    if (!sc_vecdeque_push(&ts->packets, p)) {
+        LOG_OOM();
+        av_packet_free(&p);
+        return false;
+    }
+
+    if (key_frame) {
+        struct sc_timeshift_key_frame kf = {
+            .seq = seq,
+            .pts = packet->pts,
+        };
+        sc_vecdeque_push_noresize(&ts->key_frames, kf);
+    }
+
+    sc_timeshift_evict(ts, packet->pts);
+    return true;
+}
+
+bool
+sc_timeshift_seek(const struct sc_timeshift *ts, sc_tick offset,
+                  uint64_t *seq) {
+    assert(offset <= 0);
+
+    size_t count = sc_vecdeque_size(&ts->key_frames);
+    if (!count) {
+        return false;
+    }
+
+    const AVPacket *last =
+        *sc_vecdeque_at(&ts->packets, ts->packets.size - 1);
+    int64_t target = last->pts + offset;
+
+    // Search backwards, the most recent positions are the most likely
+    size_t i = count;
+    while (--i) {
+        const struct sc_timeshift_key_frame *kf =
+            sc_vecdeque_at(&ts->key_frames, i);
+        if (kf->pts <= target) {
+            break;
+        }
+    }
+
+    *seq = sc_vecdeque_at(&ts->key_frames, i)->seq;
+    return true;
+}
+
+const AVPacket *
+sc_timeshift_get(const struct sc_timeshift *ts, uint64_t seq) {
+    if (seq < ts->first_seq || seq >= sc_timeshift_end(ts)) {
+        return NULL;
+    }
+
+    return *sc_vecdeque_at(&ts->packets, seq - ts->first_seq);
+}
@@ -0,0 +1,96 @@
+#ifndef SC_TIMESHIFT_H
+#define SC_TIMESHIFT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/tick.h"
+#include "util/vecdeque.h"
+
+struct sc_timeshift_key_frame {
+    uint64_t seq;
+    int64_t pts;
+};
+
+struct sc_timeshift_packet_queue SC_VECDEQUE(AVPacket *);
+struct sc_timeshift_key_frame_queue SC_VECDEQUE(struct sc_timeshift_key_frame);
+
+/**
+ * Time-indexed store of the last video packets, to replay the stream from a
+ * position in the past.
+ *
+ * Each packet is identified by a sequence number (incremented for each stored
+ * packet). The store always starts on a key frame, and keeps at least
+ * `duration` of stream (older GOPs are dropped entirely).
+ *
+ * Config packets are not stored.
+ *
+ * It is not thread-safe.
+ */
+struct sc_timeshift {
+    sc_tick duration;
+
+    struct sc_timeshift_packet_queue packets;
+    uint64_t first_seq; // sequence number of packets[0]
+
+    // Index of the key frames in packets, by PTS
+    struct sc_timeshift_key_frame_queue key_frames;
+};
+
+void
+sc_timeshift_init(struct sc_timeshift *ts, sc_tick duration);
+
+void
+sc_timeshift_destroy(struct sc_timeshift *ts);
+
+/**
+ * Drop all the stored packets
+ *
+ * The sequence numbers are not reset: the next packet pushed gets the next
+ * sequence number.
+ */
+void
+sc_timeshift_clear(struct sc_timeshift *ts);
+
+/**
+ * Store a (non-config) packet
+ *
+ * Packets received before the first key frame are ignored.
+ */
+bool
+sc_timeshift_push(struct sc_timeshift *ts, const AVPacket *packet);
+
+/**
+ * Return the sequence number of the next packet to be pushed
+ */
+static inline uint64_t
+sc_timeshift_end(const struct sc_timeshift *ts) {
+    return ts->first_seq + ts->packets.size;
+}
+
+/**
+ * Find the key frame to start from to play at `offset` relative to the last
+ * packet (offset <= 0)
+ *
+ * Return the sequence number of the last key frame at or before the requested
+ * position (or of the first key frame if the position is before the start of
+ * the store). Return false if the store is empty.
+ */
+bool
+sc_timeshift_seek(const struct sc_timeshift *ts, sc_tick offset,
+                  uint64_t *seq);
+
+/**
+ * Return the packet having the sequence number `seq`, or NULL if it is not
+ * (or no longer) in the store
+ *
+ * The packet is owned by the store (it must be referenced by the caller to be
+ * used after any other call).
+ */
+const AVPacket *
+sc_timeshift_get(const struct sc_timeshift *ts, uint64_t seq);
+
+#endif
@@ -20,6 +20,17 @@ struct sc_frame_sink_ops {
     bool (*open)(struct sc_frame_sink *sink, const AVCodecContext *ctx);
     void (*close)(struct sc_frame_sink *sink);
     bool (*push)(struct sc_frame_sink *sink, const AVFrame *frame);
+
+    /**
+     * Optional: indicate whether the sink currently consumes the frames
+     *
+     * If no sink wants the frames (for example a paused screen), the source
+     * may stop producing them (the decoder stops decoding until a sink wants
+     * them again). If NULL, the sink always wants the frames.
+     *
+     * Called from the source thread, before each frame.
+     */
+    bool (*wants_frames)(struct sc_frame_sink *sink);
 };
 
 #endif
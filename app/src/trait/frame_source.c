@@ -2,6 +2,8 @@
 
 #include <assert.h>
 
+#include "util/trace.h"
+
 void
 sc_frame_source_init(struct sc_frame_source *source) {
     source->sink_count = 0;
@@ -52,10 +54,26 @@ sc_frame_source_sinks_push(struct sc_frame_source *source,
     assert(source->sink_count);
     for (unsigned i = 0; i < source->sink_count; ++i) {
         struct sc_frame_sink *sink = source->sinks[i];
-        if (!sink->ops->push(sink, frame)) {
+        sc_trace_begin("frame sink push");
+        bool ok = sink->ops->push(sink, frame);
+        sc_trace_end("frame sink push");
+        if (!ok) {
             return false;
         }
     }
 
     return true;
 }
+
+bool
+sc_frame_source_sinks_want_frames(struct sc_frame_source *source) {
+    assert(source->sink_count);
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        struct sc_frame_sink *sink = source->sinks[i];
+        if (!sink->ops->wants_frames || sink->ops->wants_frames(sink)) {
+            return true;
+        }
+    }
+
+    return false;
+}
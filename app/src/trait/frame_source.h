@@ -7,7 +7,7 @@
 
 #include "trait/frame_sink.h"
 
-#define SC_FRAME_SOURCE_MAX_SINKS 2
+#define SC_FRAME_SOURCE_MAX_SINKS 4
 
 /**
  * Frame source trait
@@ -37,4 +37,8 @@ bool
 sc_frame_source_sinks_push(struct sc_frame_source *source,
                            const AVFrame *frame);
 
+// Return true if at least one sink wants the frames
+bool
+sc_frame_source_sinks_want_frames(struct sc_frame_source *source);
+
 #endif
@@ -30,6 +30,20 @@ struct sc_packet_sink_ops {
      * finally been disabled because the device could not capture it.
      */
     void (*disable)(struct sc_packet_sink *sink);
+
+    /*/
+     * Called when a new capture session starts on the device with different
+     * stream parameters (for example, the video size changed on rotation).
+     *
+     * The codec context (the same as the one passed to open()) contains the
+     * new parameters (ctx->width and ctx->height). The next packets belong to
+     * the new session: they start with a config packet (if the codec uses
+     * them) followed by a key frame.
+     *
+     * It is optional (it may be NULL) for sinks not depending on these
+     * parameters.
+     */
+    bool (*session)(struct sc_packet_sink *sink, const AVCodecContext *ctx);
 };
 
 #endif
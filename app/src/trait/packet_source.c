@@ -2,6 +2,8 @@
 
 #include <assert.h>
 
+#include "util/trace.h"
+
 void
 sc_packet_source_init(struct sc_packet_source *source) {
     source->sink_count = 0;
@@ -52,7 +54,24 @@ sc_packet_source_sinks_push(struct sc_packet_source *source,
     assert(source->sink_count);
     for (unsigned i = 0; i < source->sink_count; ++i) {
         struct sc_packet_sink *sink = source->sinks[i];
-        if (!sink->ops->push(sink, packet)) {
+        sc_trace_begin("packet sink push");
+        bool ok = sink->ops->push(sink, packet);
+        sc_trace_end("packet sink push");
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+sc_packet_source_sinks_session(struct sc_packet_source *source,
+                               const AVCodecContext *ctx) {
+    assert(source->sink_count);
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        struct sc_packet_sink *sink = source->sinks[i];
+        if (sink->ops->session && !sink->ops->session(sink, ctx)) {
             return false;
         }
     }
@@ -7,7 +7,7 @@
 
 #include "trait/packet_sink.h"
 
-#define SC_PACKET_SOURCE_MAX_SINKS 2
+#define SC_PACKET_SOURCE_MAX_SINKS 8
 
 /**
  * Packet source trait
@@ -37,6 +37,10 @@ bool
 sc_packet_source_sinks_push(struct sc_packet_source *source,
                             const AVPacket *packet);
 
+bool
+sc_packet_source_sinks_session(struct sc_packet_source *source,
+                               const AVCodecContext *ctx);
+
 void
 sc_packet_source_sinks_disable(struct sc_packet_source *source);
 
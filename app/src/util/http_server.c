@@ -0,0 +1,273 @@
+#include "http_server.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/log.h"
+
+bool
+sc_http_send(sc_socket socket, const void *data, size_t len) {
+    ssize_t w = net_send_all(socket, data, len);
+    return w >= 0 && (size_t) w == len;
+}
+
+bool
+sc_http_send_response(sc_socket socket, const char *status,
+                      const char *content_type, const void *body,
+                      size_t len) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %" SC_PRIsizet "\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Connection: close\r\n"
+                     "\r\n",
+                     status, content_type, len);
+    assert(n > 0 && (size_t) n < sizeof(header));
+    return sc_http_send(socket, header, n)
+        && sc_http_send(socket, body, len);
+}
+
+// Read the request, and return its path
+static bool
+sc_http_read_request(struct sc_http_server *server, sc_socket socket,
+                     char *path, size_t path_size) {
+    char buf[SC_HTTP_REQUEST_MAX_SIZE];
+    size_t len = 0;
+
+    for (;;) {
+        if (len == sizeof(buf) - 1) {
+            LOGW("%s: request too large", server->params.name);
+            return false;
+        }
+
+        ssize_t r = net_recv(socket, buf + len, sizeof(buf) - 1 - len);
+        if (r <= 0) {
+            return false;
+        }
+        len += r;
+        buf[len] = '\0';
+
+        if (strstr(buf, "\r\n\r\n")) {
+            break;
+        }
+    }
+
+    char method[8];
+    char fmt[32];
+    snprintf(fmt, sizeof(fmt), "%%7s %%%" SC_PRIsizet "s", path_size - 1);
+    if (sscanf(buf, fmt, method, path) != 2 || strcmp(method, "GET")) {
+        LOGW("%s: unsupported request", server->params.name);
+        return false;
+    }
+
+    // Ignore the query string
+    path[strcspn(path, "?")] = '\0';
+    return true;
+}
+
+static int
+run_http_client(void *data) {
+    struct sc_http_client *client = data;
+    struct sc_http_server *server = client->server;
+
+    char path[SC_HTTP_PATH_MAX_SIZE];
+    if (sc_http_read_request(server, client->socket, path, sizeof(path))) {
+        server->cbs->on_request(server, client->socket, path,
+                                server->cbs_userdata);
+    }
+
+    sc_mutex_lock(&server->mutex);
+    net_close(client->socket);
+    client->socket = SC_SOCKET_NONE;
+    client->ended = true;
+    sc_mutex_unlock(&server->mutex);
+
+    return 0;
+}
+
+static struct sc_http_client *
+sc_http_server_get_free_client(struct sc_http_server *server) {
+    for (unsigned i = 0; i < server->params.max_clients; ++i) {
+        struct sc_http_client *client = &server->clients[i];
+
+        sc_mutex_lock(&server->mutex);
+        bool used = client->used;
+        bool ended = client->ended;
+        sc_mutex_unlock(&server->mutex);
+
+        if (!used) {
+            return client;
+        }
+
+        if (ended) {
+            sc_thread_join(&client->thread, NULL);
+            sc_mutex_lock(&server->mutex);
+            client->used = false;
+            sc_mutex_unlock(&server->mutex);
+            return client;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+run_http_server(void *data) {
+    struct sc_http_server *server = data;
+    const char *name = server->params.name;
+
+    for (;;) {
+        sc_socket socket = net_accept(server->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            sc_mutex_lock(&server->mutex);
+            bool stopped = server->stopped;
+            sc_mutex_unlock(&server->mutex);
+            if (stopped) {
+                break;
+            }
+            LOGW("%s: failed to accept client connection", name);
+            continue;
+        }
+
+        struct sc_http_client *client = sc_http_server_get_free_client(server);
+        if (!client) {
+            LOGW("%s: too many clients, connection refused", name);
+            net_close(socket);
+            continue;
+        }
+
+        // Under the server mutex, so that sc_http_server_stop() cannot miss
+        // the new client socket
+        sc_mutex_lock(&server->mutex);
+        if (server->stopped) {
+            sc_mutex_unlock(&server->mutex);
+            net_close(socket);
+            break;
+        }
+
+        client->socket = socket;
+        client->ended = false;
+        bool ok = sc_thread_create(&client->thread, run_http_client,
+                                   server->params.client_thread_name, client);
+        if (ok) {
+            client->used = true;
+        } else {
+            LOGE("%s: could not start client thread", name);
+            net_close(socket);
+            client->socket = SC_SOCKET_NONE;
+        }
+        sc_mutex_unlock(&server->mutex);
+    }
+
+    LOGD("%s server thread ended", name);
+    return 0;
+}
+
+bool
+sc_http_server_init(struct sc_http_server *server,
+                    const struct sc_http_server_params *params,
+                    const struct sc_http_server_callbacks *cbs,
+                    void *cbs_userdata) {
+    assert(params->max_clients
+            && params->max_clients <= SC_HTTP_SERVER_MAX_CLIENTS);
+    assert(cbs && cbs->on_request);
+
+    bool ok = sc_mutex_init(&server->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    server->params = *params;
+    server->server_socket = SC_SOCKET_NONE;
+    server->stopped = false;
+    server->cbs = cbs;
+    server->cbs_userdata = cbs_userdata;
+
+    for (unsigned i = 0; i < SC_HTTP_SERVER_MAX_CLIENTS; ++i) {
+        struct sc_http_client *client = &server->clients[i];
+        client->server = server;
+        client->socket = SC_SOCKET_NONE;
+        client->used = false;
+        client->ended = false;
+    }
+
+    return true;
+}
+
+bool
+sc_http_server_start(struct sc_http_server *server) {
+    const char *name = server->params.name;
+
+    server->server_socket = net_socket();
+    if (server->server_socket == SC_SOCKET_NONE) {
+        LOGE("%s: could not create server socket", name);
+        return false;
+    }
+
+    if (!net_listen(server->server_socket, IPV4_LOCALHOST, server->params.port,
+                    server->params.max_clients)) {
+        LOGE("%s: could not listen on port %" PRIu16, name,
+             server->params.port);
+        return false;
+    }
+
+    if (!server->params.port
+            && !net_get_local_port(server->server_socket,
+                                   &server->params.port)) {
+        LOGE("%s: could not get the listening port", name);
+        return false;
+    }
+
+    bool ok = sc_thread_create(&server->thread, run_http_server,
+                               server->params.thread_name, server);
+    if (!ok) {
+        LOGE("%s: could not start server thread", name);
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_http_server_stop(struct sc_http_server *server) {
+    sc_mutex_lock(&server->mutex);
+    server->stopped = true;
+
+    // Interrupt the client sockets to unblock recv() and send()
+    for (unsigned i = 0; i < server->params.max_clients; ++i) {
+        struct sc_http_client *client = &server->clients[i];
+        if (client->socket != SC_SOCKET_NONE) {
+            net_interrupt(client->socket);
+        }
+    }
+    sc_mutex_unlock(&server->mutex);
+
+    // Interrupt the server socket to unblock accept()
+    net_interrupt(server->server_socket);
+}
+
+void
+sc_http_server_join(struct sc_http_server *server) {
+    sc_thread_join(&server->thread, NULL);
+
+    for (unsigned i = 0; i < server->params.max_clients; ++i) {
+        struct sc_http_client *client = &server->clients[i];
+        if (client->used) {
+            sc_thread_join(&client->thread, NULL);
+            client->used = false;
+        }
+    }
+}
+
+void
+sc_http_server_destroy(struct sc_http_server *server) {
+    if (server->server_socket != SC_SOCKET_NONE) {
+        net_close(server->server_socket);
+    }
+
+    sc_mutex_destroy(&server->mutex);
+}
@@ -0,0 +1,102 @@
+#ifndef SC_HTTP_SERVER_H
+#define SC_HTTP_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+
+#define SC_HTTP_SERVER_MAX_CLIENTS 16
+#define SC_HTTP_REQUEST_MAX_SIZE 4096
+#define SC_HTTP_PATH_MAX_SIZE 256
+
+struct sc_http_server;
+
+struct sc_http_client {
+    struct sc_http_server *server;
+    sc_thread thread;
+
+    // Protected by the server mutex
+    sc_socket socket;
+    bool used; // a thread has been started for this slot (must be joined)
+    bool ended; // the thread has ended
+};
+
+struct sc_http_server_callbacks {
+    /**
+     * Serve a GET request (the query string is removed from the path)
+     *
+     * Called from the client thread, which closes the socket on return. It
+     * may stream indefinitely: on stop, the client sockets are interrupted
+     * (so the pending and further send() and recv() fail), and the owner must
+     * wake up its own waits.
+     */
+    void (*on_request)(struct sc_http_server *server, sc_socket socket,
+                       const char *path, void *userdata);
+};
+
+struct sc_http_server_params {
+    const char *name; // prefix of the log messages
+    const char *thread_name;
+    const char *client_thread_name;
+    uint16_t port; // 0 to listen on any available port
+    unsigned max_clients; // at most SC_HTTP_SERVER_MAX_CLIENTS
+};
+
+/**
+ * Minimal HTTP/1.1 server on localhost, serving each client (one request per
+ * connection) from its own thread, with a fixed number of client slots.
+ */
+struct sc_http_server {
+    struct sc_http_server_params params;
+
+    sc_socket server_socket;
+    sc_thread thread;
+
+    sc_mutex mutex;
+    bool stopped;
+
+    const struct sc_http_server_callbacks *cbs;
+    void *cbs_userdata;
+
+    struct sc_http_client clients[SC_HTTP_SERVER_MAX_CLIENTS];
+};
+
+bool
+sc_http_server_init(struct sc_http_server *server,
+                    const struct sc_http_server_params *params,
+                    const struct sc_http_server_callbacks *cbs,
+                    void *cbs_userdata);
+
+/**
+ * Listen and start accepting clients
+ *
+ * If params->port is 0, params.port is set to the actual listening port.
+ */
+bool
+sc_http_server_start(struct sc_http_server *server);
+
+void
+sc_http_server_stop(struct sc_http_server *server);
+
+void
+sc_http_server_join(struct sc_http_server *server);
+
+void
+sc_http_server_destroy(struct sc_http_server *server);
+
+bool
+sc_http_send(sc_socket socket, const void *data, size_t len);
+
+/**
+ * Send a complete response, with a body of the given length
+ */
+bool
+sc_http_send_response(sc_socket socket, const char *status,
+                      const char *content_type, const void *body, size_t len);
+
+#endif
@@ -58,6 +58,15 @@ sc_intr_set_process(struct sc_intr *intr, sc_pid socket);
 void
 sc_intr_interrupt(struct sc_intr *intr);
 
+/**
+ * Reset the interrupted state, so that the interruptor may be used again
+ *
+ * No component may be set. Must not be called concurrently with
+ * sc_intr_interrupt().
+ */
+void
+sc_intr_reset(struct sc_intr *intr);
+
 /**
  * Read the interrupted state
  *
@@ -0,0 +1,47 @@
+#include "latency_stats.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static int
+sc_tick_cmp(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+sc_tick
+sc_latency_stats_percentile(const sc_tick *samples, unsigned count,
+                            unsigned percentile) {
+    assert(count);
+    assert(percentile <= 100);
+
+    // Nearest rank: ceil(percentile / 100 * count), starting at 1
+    uint64_t rank = ((uint64_t) percentile * count + 99) / 100;
+    if (!rank) {
+        rank = 1;
+    }
+    return samples[rank - 1];
+}
+
+void
+sc_latency_stats_compute(sc_tick *samples, unsigned count,
+                         struct sc_latency_stats *stats) {
+    assert(count);
+
+    qsort(samples, count, sizeof(*samples), sc_tick_cmp);
+
+    sc_tick sum = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        sum += samples[i];
+    }
+
+    stats->count = count;
+    stats->min = samples[0];
+    stats->max = samples[count - 1];
+    stats->mean = sum / count;
+    stats->p50 = sc_latency_stats_percentile(samples, count, 50);
+    stats->p90 = sc_latency_stats_percentile(samples, count, 90);
+    stats->p95 = sc_latency_stats_percentile(samples, count, 95);
+    stats->p99 = sc_latency_stats_percentile(samples, count, 99);
+}
@@ -0,0 +1,42 @@
+#ifndef SC_LATENCY_STATS_H
+#define SC_LATENCY_STATS_H
+
+#include "common.h"
+
+#include "util/tick.h"
+
+/**
+ * Distribution of a set of latency samples
+ *
+ * The percentiles use the nearest-rank method (each is one of the samples).
+ */
+struct sc_latency_stats {
+    unsigned count;
+    sc_tick min;
+    sc_tick max;
+    sc_tick mean;
+    sc_tick p50;
+    sc_tick p90;
+    sc_tick p95;
+    sc_tick p99;
+};
+
+/**
+ * Compute the distribution of the samples
+ *
+ * The samples are sorted in place. The count must not be 0.
+ */
+void
+sc_latency_stats_compute(sc_tick *samples, unsigned count,
+                         struct sc_latency_stats *stats);
+
+/**
+ * Return the sample at the given percentile (between 0 and 100)
+ *
+ * The samples must be sorted. The count must not be 0.
+ */
+sc_tick
+sc_latency_stats_percentile(const sc_tick *samples, unsigned count,
+                            unsigned percentile);
+
+#endif
@@ -4,42 +4,252 @@
 # include <windows.h>
 #endif
 #include <assert.h>
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifndef _WIN32
+# include <signal.h>
+#endif
+#include <string.h>
 #include <libavutil/log.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL_mutex.h>
+# include <SDL2/SDL_thread.h>
+# include <SDL2/SDL_timer.h>
+#else
+# include <pthread.h>
+# include <time.h>
+#endif
+
+// Must be a power of 2
+#define SC_LOG_RING_CAPACITY 256
+// Longer messages are truncated
+#define SC_LOG_MESSAGE_MAX_SIZE 1024
+
+#ifdef HAVE_SDL
+typedef SDL_LogPriority sc_log_priority;
+# define SC_LOG_PRIORITY_VERBOSE SDL_LOG_PRIORITY_VERBOSE
+# define SC_LOG_PRIORITY_DEBUG SDL_LOG_PRIORITY_DEBUG
+# define SC_LOG_PRIORITY_INFO SDL_LOG_PRIORITY_INFO
+# define SC_LOG_PRIORITY_WARN SDL_LOG_PRIORITY_WARN
+# define SC_LOG_PRIORITY_ERROR SDL_LOG_PRIORITY_ERROR
+# define SC_LOG_PRIORITY_CRITICAL SDL_LOG_PRIORITY_CRITICAL
+# define SC_LOG_PRIORITY_COUNT SDL_NUM_LOG_PRIORITIES
+typedef SDL_mutex *sc_log_mutex;
+typedef SDL_cond *sc_log_cond;
+typedef SDL_Thread *sc_log_thread;
+#else
+// Without SDL, the log functions are implemented here (with the same
+// priorities as SDL)
+typedef enum {
+    SC_LOG_PRIORITY_VERBOSE = 1,
+    SC_LOG_PRIORITY_DEBUG,
+    SC_LOG_PRIORITY_INFO,
+    SC_LOG_PRIORITY_WARN,
+    SC_LOG_PRIORITY_ERROR,
+    SC_LOG_PRIORITY_CRITICAL,
+    SC_LOG_PRIORITY_COUNT,
+} sc_log_priority;
+typedef pthread_mutex_t sc_log_mutex;
+typedef pthread_cond_t sc_log_cond;
+typedef pthread_t sc_log_thread;
+
+static atomic_int sc_log_min_priority = SC_LOG_PRIORITY_INFO;
+#endif
+
+struct sc_log_record {
+    // Bounded MPMC ring sequence number (Vyukov): equals the position when the
+    // slot is free, and the position + 1 when the record is published
+    atomic_size_t seq;
+    sc_log_priority priority;
+    char message[SC_LOG_MESSAGE_MAX_SIZE];
+};
+
+static struct {
+    struct sc_log_record *records;
+    atomic_size_t enqueue_pos;
+    size_t dequeue_pos; // only accessed by the log thread
+
+    atomic_bool started;
+    // Number of threads currently pushing a message (to not lose the messages
+    // pushed concurrently with sc_log_async_stop())
+    atomic_uint pushers;
+    atomic_uint_least64_t dropped;
+
+    // The log thread is (about to be) waiting on cond
+    atomic_bool waiting;
+    sc_log_mutex mutex;
+    sc_log_cond cond;
+    bool stopped; // protected by mutex
+
+    sc_log_thread thread;
+} sc_log_async;
+
+// The log implementation must not log itself, so it does not use util/thread
+// (which may log on error)
+#ifdef HAVE_SDL
+static bool
+sc_log_mutex_init(sc_log_mutex *mutex) {
+    *mutex = SDL_CreateMutex();
+    return *mutex;
+}
+
+static void
+sc_log_mutex_destroy(sc_log_mutex *mutex) {
+    SDL_DestroyMutex(*mutex);
+}
+
+static void
+sc_log_mutex_lock(sc_log_mutex *mutex) {
+    SDL_LockMutex(*mutex);
+}
+
+static void
+sc_log_mutex_unlock(sc_log_mutex *mutex) {
+    SDL_UnlockMutex(*mutex);
+}
+
+static bool
+sc_log_cond_init(sc_log_cond *cond) {
+    *cond = SDL_CreateCond();
+    return *cond;
+}
+
+static void
+sc_log_cond_destroy(sc_log_cond *cond) {
+    SDL_DestroyCond(*cond);
+}
+
+static void
+sc_log_cond_wait(sc_log_cond *cond, sc_log_mutex *mutex) {
+    SDL_CondWait(*cond, *mutex);
+}
+
+static void
+sc_log_cond_signal(sc_log_cond *cond) {
+    SDL_CondSignal(*cond);
+}
+
+static bool
+sc_log_thread_create(sc_log_thread *thread, int (*fn)(void *)) {
+    *thread = SDL_CreateThread(fn, "log", NULL);
+    return *thread;
+}
+
+static void
+sc_log_thread_join(sc_log_thread *thread) {
+    SDL_WaitThread(*thread, NULL);
+}
+
+static void
+sc_log_sleep_1ms(void) {
+    SDL_Delay(1);
+}
+#else
+static bool
+sc_log_mutex_init(sc_log_mutex *mutex) {
+    return !pthread_mutex_init(mutex, NULL);
+}
+
+static void
+sc_log_mutex_destroy(sc_log_mutex *mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+static void
+sc_log_mutex_lock(sc_log_mutex *mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static void
+sc_log_mutex_unlock(sc_log_mutex *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+static bool
+sc_log_cond_init(sc_log_cond *cond) {
+    return !pthread_cond_init(cond, NULL);
+}
+
+static void
+sc_log_cond_destroy(sc_log_cond *cond) {
+    pthread_cond_destroy(cond);
+}
 
-static SDL_LogPriority
-log_level_sc_to_sdl(enum sc_log_level level) {
+static void
+sc_log_cond_wait(sc_log_cond *cond, sc_log_mutex *mutex) {
+    pthread_cond_wait(cond, mutex);
+}
+
+static void
+sc_log_cond_signal(sc_log_cond *cond) {
+    pthread_cond_signal(cond);
+}
+
+static int (*sc_log_thread_fn)(void *);
+
+static void *
+sc_log_run_thread(void *data) {
+# ifdef __APPLE__
+    pthread_setname_np("log");
+# else
+    pthread_setname_np(pthread_self(), "log");
+# endif
+    return (void *) (intptr_t) sc_log_thread_fn(data);
+}
+
+static bool
+sc_log_thread_create(sc_log_thread *thread, int (*fn)(void *)) {
+    sc_log_thread_fn = fn;
+    return !pthread_create(thread, NULL, sc_log_run_thread, NULL);
+}
+
+static void
+sc_log_thread_join(sc_log_thread *thread) {
+    pthread_join(*thread, NULL);
+}
+
+static void
+sc_log_sleep_1ms(void) {
+    struct timespec ts = {0, 1000000};
+    nanosleep(&ts, NULL);
+}
+#endif
+
+static sc_log_priority
+log_level_sc_to_priority(enum sc_log_level level) {
     switch (level) {
         case SC_LOG_LEVEL_VERBOSE:
-            return SDL_LOG_PRIORITY_VERBOSE;
+            return SC_LOG_PRIORITY_VERBOSE;
         case SC_LOG_LEVEL_DEBUG:
-            return SDL_LOG_PRIORITY_DEBUG;
+            return SC_LOG_PRIORITY_DEBUG;
         case SC_LOG_LEVEL_INFO:
-            return SDL_LOG_PRIORITY_INFO;
+            return SC_LOG_PRIORITY_INFO;
         case SC_LOG_LEVEL_WARN:
-            return SDL_LOG_PRIORITY_WARN;
+            return SC_LOG_PRIORITY_WARN;
         case SC_LOG_LEVEL_ERROR:
-            return SDL_LOG_PRIORITY_ERROR;
+            return SC_LOG_PRIORITY_ERROR;
         default:
             assert(!"unexpected log level");
-            return SDL_LOG_PRIORITY_INFO;
+            return SC_LOG_PRIORITY_INFO;
     }
 }
 
 static enum sc_log_level
-log_level_sdl_to_sc(SDL_LogPriority priority) {
+log_level_priority_to_sc(sc_log_priority priority) {
     switch (priority) {
-        case SDL_LOG_PRIORITY_VERBOSE:
+        case SC_LOG_PRIORITY_VERBOSE:
             return SC_LOG_LEVEL_VERBOSE;
-        case SDL_LOG_PRIORITY_DEBUG:
+        case SC_LOG_PRIORITY_DEBUG:
             return SC_LOG_LEVEL_DEBUG;
-        case SDL_LOG_PRIORITY_INFO:
+        case SC_LOG_PRIORITY_INFO:
             return SC_LOG_LEVEL_INFO;
-        case SDL_LOG_PRIORITY_WARN:
+        case SC_LOG_PRIORITY_WARN:
             return SC_LOG_LEVEL_WARN;
-        case SDL_LOG_PRIORITY_ERROR:
+        case SC_LOG_PRIORITY_ERROR:
             return SC_LOG_LEVEL_ERROR;
         default:
             assert(!"unexpected log level");
@@ -47,26 +257,58 @@ log_level_sdl_to_sc(SDL_LogPriority priority) {
     }
 }
 
+static void
+sc_log_print(sc_log_priority priority, const char *message);
+
+#ifndef HAVE_SDL
+static void
+sc_log_message_v(sc_log_priority priority, const char *fmt, va_list ap) {
+    if ((int) priority < atomic_load_explicit(&sc_log_min_priority,
+                                              memory_order_relaxed)) {
+        return;
+    }
+
+    char message[SC_LOG_MESSAGE_MAX_SIZE];
+    vsnprintf(message, sizeof(message), fmt, ap);
+    sc_log_print(priority, message);
+}
+#endif
+
 void
 sc_set_log_level(enum sc_log_level level) {
-    SDL_LogPriority sdl_log = log_level_sc_to_sdl(level);
-    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, sdl_log);
-    SDL_LogSetPriority(SDL_LOG_CATEGORY_CUSTOM, sdl_log);
+    sc_log_priority priority = log_level_sc_to_priority(level);
+#ifdef HAVE_SDL
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, priority);
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_CUSTOM, priority);
+#else
+    atomic_store_explicit(&sc_log_min_priority, priority,
+                          memory_order_relaxed);
+#endif
 }
 
 enum sc_log_level
 sc_get_log_level(void) {
-    SDL_LogPriority sdl_log = SDL_LogGetPriority(SDL_LOG_CATEGORY_APPLICATION);
-    return log_level_sdl_to_sc(sdl_log);
+#ifdef HAVE_SDL
+    sc_log_priority priority =
+        SDL_LogGetPriority(SDL_LOG_CATEGORY_APPLICATION);
+#else
+    sc_log_priority priority =
+        atomic_load_explicit(&sc_log_min_priority, memory_order_relaxed);
+#endif
+    return log_level_priority_to_sc(priority);
 }
 
 void
 sc_log(enum sc_log_level level, const char *fmt, ...) {
-    SDL_LogPriority sdl_level = log_level_sc_to_sdl(level);
+    sc_log_priority priority = log_level_sc_to_priority(level);
 
     va_list ap;
     va_start(ap, fmt);
-    SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, sdl_level, fmt, ap);
+#ifdef HAVE_SDL
+    SDL_LogMessageV(SDL_LOG_CATEGORY_APPLICATION, priority, fmt, ap);
+#else
+    sc_log_message_v(priority, fmt, ap);
+#endif
     va_end(ap);
 }
 
@@ -91,18 +333,18 @@ sc_log_windows_error(const char *prefix, int error) {
 }
 #endif
 
-static SDL_LogPriority
-sdl_priority_from_av_level(int level) {
+static sc_log_priority
+priority_from_av_level(int level) {
     switch (level) {
         case AV_LOG_PANIC:
         case AV_LOG_FATAL:
-            return SDL_LOG_PRIORITY_CRITICAL;
+            return SC_LOG_PRIORITY_CRITICAL;
         case AV_LOG_ERROR:
-            return SDL_LOG_PRIORITY_ERROR;
+            return SC_LOG_PRIORITY_ERROR;
         case AV_LOG_WARNING:
-            return SDL_LOG_PRIORITY_WARN;
+            return SC_LOG_PRIORITY_WARN;
         case AV_LOG_INFO:
-            return SDL_LOG_PRIORITY_INFO;
+            return SC_LOG_PRIORITY_INFO;
     }
     // do not forward others, which are too verbose
     return 0;
@@ -111,7 +353,7 @@ sdl_priority_from_av_level(int level) {
 static void
 sc_av_log_callback(void *avcl, int level, const char *fmt, va_list vl) {
     (void) avcl;
-    SDL_LogPriority priority = sdl_priority_from_av_level(level);
+    sc_log_priority priority = priority_from_av_level(level);
     if (priority == 0) {
         return;
     }
@@ -124,34 +366,234 @@ sc_av_log_callback(void *avcl, int level, const char *fmt, va_list vl) {
     }
     memcpy(local_fmt, "[FFmpeg] ", 9); // do not write the final '\0'
     memcpy(local_fmt + 9, fmt, fmt_len + 1); // include '\0'
+#ifdef HAVE_SDL
     SDL_LogMessageV(SDL_LOG_CATEGORY_CUSTOM, priority, local_fmt, vl);
+#else
+    sc_log_message_v(priority, local_fmt, vl);
+#endif
     free(local_fmt);
 }
 
-static const char *const sc_sdl_log_priority_names[SDL_NUM_LOG_PRIORITIES] = {
-    [SDL_LOG_PRIORITY_VERBOSE] = "VERBOSE",
-    [SDL_LOG_PRIORITY_DEBUG] = "DEBUG",
-    [SDL_LOG_PRIORITY_INFO] = "INFO",
-    [SDL_LOG_PRIORITY_WARN] = "WARN",
-    [SDL_LOG_PRIORITY_ERROR] = "ERROR",
-    [SDL_LOG_PRIORITY_CRITICAL] = "CRITICAL",
+static const char *const sc_log_priority_names[SC_LOG_PRIORITY_COUNT] = {
+    [SC_LOG_PRIORITY_VERBOSE] = "VERBOSE",
+    [SC_LOG_PRIORITY_DEBUG] = "DEBUG",
+    [SC_LOG_PRIORITY_INFO] = "INFO",
+    [SC_LOG_PRIORITY_WARN] = "WARN",
+    [SC_LOG_PRIORITY_ERROR] = "ERROR",
+    [SC_LOG_PRIORITY_CRITICAL] = "CRITICAL",
 };
 
+static void
+sc_log_write(sc_log_priority priority, const char *message) {
+    FILE *out = priority < SC_LOG_PRIORITY_WARN ? stdout : stderr;
+    assert(priority < SC_LOG_PRIORITY_COUNT);
+    const char *prio_name = sc_log_priority_names[priority];
+    fprintf(out, "%s: %s\n", prio_name, message);
+}
+
+static void
+sc_log_write_dropped(void) {
+    uint64_t dropped = atomic_exchange_explicit(&sc_log_async.dropped, 0,
+                                                memory_order_relaxed);
+    if (dropped) {
+        fprintf(stderr, "WARN: %" PRIu64 " log messages dropped\n", dropped);
+    }
+}
+
+static void
+sc_log_async_push(sc_log_priority priority, const char *message) {
+    struct sc_log_record *record;
+    size_t pos = atomic_load_explicit(&sc_log_async.enqueue_pos,
+                                      memory_order_relaxed);
+    for (;;) {
+        record = &sc_log_async.records[pos & (SC_LOG_RING_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (!diff) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &sc_log_async.enqueue_pos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                // The slot is reserved
+                break;
+            }
+        } else if (diff < 0) {
+            // The ring is full, never block the caller
+            atomic_fetch_add_explicit(&sc_log_async.dropped, 1,
+                                      memory_order_relaxed);
+            return;
+        } else {
+            // Another thread reserved this slot
+            pos = atomic_load_explicit(&sc_log_async.enqueue_pos,
+                                       memory_order_relaxed);
+        }
+    }
+
+    record->priority = priority;
+    snprintf(record->message, sizeof(record->message), "%s", message);
+    atomic_store_explicit(&record->seq, pos + 1, memory_order_release);
+
+    // Pairs with the fence in run_log(): either the log thread sees the
+    // record, or this thread sees that it is waiting
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&sc_log_async.waiting, memory_order_relaxed)) {
+        sc_log_mutex_lock(&sc_log_async.mutex);
+        sc_log_cond_signal(&sc_log_async.cond);
+        sc_log_mutex_unlock(&sc_log_async.mutex);
+    }
+}
+
+static void
+sc_log_print(sc_log_priority priority, const char *message) {
+    atomic_fetch_add_explicit(&sc_log_async.pushers, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&sc_log_async.started, memory_order_seq_cst)) {
+        sc_log_async_push(priority, message);
+        atomic_fetch_sub_explicit(&sc_log_async.pushers, 1,
+                                  memory_order_release);
+        return;
+    }
+    atomic_fetch_sub_explicit(&sc_log_async.pushers, 1, memory_order_release);
+
+    sc_log_write(priority, message);
+}
+
+static int
+run_log(void *data) {
+    (void) data;
+
+#ifndef _WIN32
+    // This thread is started early, do not let it receive the signals handled
+    // by other threads
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+    for (;;) {
+        size_t pos = sc_log_async.dequeue_pos;
+        struct sc_log_record *record =
+            &sc_log_async.records[pos & (SC_LOG_RING_CAPACITY - 1)];
+
+        size_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        if (seq == pos + 1) {
+            sc_log_write_dropped();
+            sc_log_write(record->priority, record->message);
+            // Release the slot for the next round
+            atomic_store_explicit(&record->seq, pos + SC_LOG_RING_CAPACITY,
+                                  memory_order_release);
+            ++sc_log_async.dequeue_pos;
+            continue;
+        }
+
+        sc_log_mutex_lock(&sc_log_async.mutex);
+        atomic_store_explicit(&sc_log_async.waiting, true,
+                              memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        if (seq != pos + 1) {
+            if (sc_log_async.stopped) {
+                sc_log_mutex_unlock(&sc_log_async.mutex);
+                break;
+            }
+            sc_log_cond_wait(&sc_log_async.cond, &sc_log_async.mutex);
+        }
+        atomic_store_explicit(&sc_log_async.waiting, false,
+                              memory_order_relaxed);
+        sc_log_mutex_unlock(&sc_log_async.mutex);
+    }
+
+    sc_log_write_dropped();
+    return 0;
+}
+
+bool
+sc_log_async_start(void) {
+    assert(!atomic_load(&sc_log_async.started));
+
+    sc_log_async.records =
+        malloc(SC_LOG_RING_CAPACITY * sizeof(*sc_log_async.records));
+    if (!sc_log_async.records) {
+        LOG_OOM();
+        return false;
+    }
+
+    for (size_t i = 0; i < SC_LOG_RING_CAPACITY; ++i) {
+        atomic_init(&sc_log_async.records[i].seq, i);
+    }
+
+    if (!sc_log_mutex_init(&sc_log_async.mutex)) {
+        LOG_OOM();
+        goto error_free_records;
+    }
+
+    if (!sc_log_cond_init(&sc_log_async.cond)) {
+        LOG_OOM();
+        goto error_destroy_mutex;
+    }
+
+    atomic_init(&sc_log_async.enqueue_pos, 0);
+    sc_log_async.dequeue_pos = 0;
+    atomic_init(&sc_log_async.dropped, 0);
+    atomic_init(&sc_log_async.waiting, false);
+    sc_log_async.stopped = false;
+
+    if (!sc_log_thread_create(&sc_log_async.thread, run_log)) {
+        LOGE("Could not start log thread");
+        goto error_destroy_cond;
+    }
+
+    atomic_store(&sc_log_async.started, true);
+    return true;
+
+error_destroy_cond:
+    sc_log_cond_destroy(&sc_log_async.cond);
+error_destroy_mutex:
+    sc_log_mutex_destroy(&sc_log_async.mutex);
+error_free_records:
+    free(sc_log_async.records);
+
+    return false;
+}
+
+void
+sc_log_async_stop(void) {
+    assert(atomic_load(&sc_log_async.started));
+    atomic_store(&sc_log_async.started, false);
+
+    // Wait for the threads which are pushing a message, so that their
+    // message is written before the log thread terminates
+    while (atomic_load(&sc_log_async.pushers)) {
+        sc_log_sleep_1ms();
+    }
+
+    sc_log_mutex_lock(&sc_log_async.mutex);
+    sc_log_async.stopped = true;
+    sc_log_cond_signal(&sc_log_async.cond);
+    sc_log_mutex_unlock(&sc_log_async.mutex);
+
+    // The remaining messages are written before the thread terminates
+    sc_log_thread_join(&sc_log_async.thread);
+
+    sc_log_cond_destroy(&sc_log_async.cond);
+    sc_log_mutex_destroy(&sc_log_async.mutex);
+    free(sc_log_async.records);
+}
+
+#ifdef HAVE_SDL
 static void SDLCALL
 sc_sdl_log_print(void *userdata, int category, SDL_LogPriority priority,
                  const char *message) {
     (void) userdata;
     (void) category;
 
-    FILE *out = priority < SDL_LOG_PRIORITY_WARN ? stdout : stderr;
-    assert(priority < SDL_NUM_LOG_PRIORITIES);
-    const char *prio_name = sc_sdl_log_priority_names[priority];
-    fprintf(out, "%s: %s\n", prio_name, message);
+    sc_log_print(priority, message);
 }
+#endif
 
 void
 sc_log_configure(void) {
+#ifdef HAVE_SDL
     SDL_LogSetOutputFunction(sc_sdl_log_print, NULL);
-    // Redirect FFmpeg logs to SDL logs
+#endif
+    // Redirect FFmpeg logs to scrcpy logs
     av_log_set_callback(sc_av_log_callback);
 }
@@ -3,18 +3,28 @@
 
 #include "common.h"
 
-#include <SDL2/SDL_log.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL_log.h>
+#endif
 
 #include "options.h"
 
 #define LOG_STR_IMPL_(x) # x
 #define LOG_STR(x) LOG_STR_IMPL_(x)
 
-#define LOGV(...) SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGD(...) SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGI(...) SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGW(...) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
-#define LOGE(...) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+#ifdef HAVE_SDL
+# define LOGV(...) SDL_LogVerbose(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+# define LOGD(...) SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+# define LOGI(...) SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+# define LOGW(...) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+# define LOGE(...) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, __VA_ARGS__)
+#else
+# define LOGV(...) sc_log(SC_LOG_LEVEL_VERBOSE, __VA_ARGS__)
+# define LOGD(...) sc_log(SC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+# define LOGI(...) sc_log(SC_LOG_LEVEL_INFO, __VA_ARGS__)
+# define LOGW(...) sc_log(SC_LOG_LEVEL_WARN, __VA_ARGS__)
+# define LOGE(...) sc_log(SC_LOG_LEVEL_ERROR, __VA_ARGS__)
+#endif
 
 #define LOG_OOM() \
     LOGE("OOM: %s:%d %s()", __FILE__, __LINE__, __func__)
@@ -38,4 +48,24 @@ sc_log_windows_error(const char *prefix, int error);
 void
 sc_log_configure(void);
 
+/**
+ * Write the log messages from a separate thread
+ *
+ * Once started, the calling threads only format the message and push it to a
+ * lock-free ring buffer; they never block on the terminal. If the ring buffer
+ * is full, the message is dropped (and the number of dropped messages is
+ * reported).
+ *
+ * Before it is started (and after it is stopped), the messages are written
+ * synchronously.
+ */
+bool
+sc_log_async_start(void);
+
+/**
+ * Write the pending messages and stop the log thread
+ */
+void
+sc_log_async_stop(void);
+
 #endif
@@ -15,6 +15,7 @@
 # include <unistd.h>
 # include <sys/socket.h>
 # include <sys/types.h>
+# include <sys/uio.h>
 # define SOCKET_ERROR -1
   typedef struct sockaddr_in SOCKADDR_IN;
   typedef struct sockaddr SOCKADDR;
@@ -136,6 +137,25 @@ net_socket(void) {
     return sock;
 }
 
+sc_socket
+net_udp_socket(void) {
+#ifdef HAVE_SOCK_CLOEXEC
+    sc_raw_socket raw_sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+#else
+    sc_raw_socket raw_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (raw_sock != SC_RAW_SOCKET_NONE && !set_cloexec_flag(raw_sock)) {
+        sc_raw_socket_close(raw_sock);
+        return SC_SOCKET_NONE;
+    }
+#endif
+
+    sc_socket sock = wrap(raw_sock);
+    if (sock == SC_SOCKET_NONE) {
+        net_perror("socket");
+    }
+    return sock;
+}
+
 bool
 net_connect(sc_socket socket, uint32_t addr, uint16_t port) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -203,6 +223,53 @@ net_accept(sc_socket server_socket) {
     return wrap(raw_sock);
 }
 
+bool
+net_bind(sc_socket socket, uint32_t addr, uint16_t port) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    SOCKADDR_IN sin;
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(addr);
+    sin.sin_port = htons(port);
+
+    if (bind(raw_sock, (SOCKADDR *) &sin, sizeof(sin)) == SOCKET_ERROR) {
+        net_perror("bind");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_get_local_port(sc_socket socket, uint16_t *port) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    SOCKADDR_IN sin;
+    socklen_t sinsize = sizeof(sin);
+    if (getsockname(raw_sock, (SOCKADDR *) &sin, &sinsize) == SOCKET_ERROR) {
+        net_perror("getsockname");
+        return false;
+    }
+
+    *port = ntohs(sin.sin_port);
+    return true;
+}
+
+bool
+net_get_peer_addr(sc_socket socket, uint32_t *addr) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    SOCKADDR_IN sin;
+    socklen_t sinsize = sizeof(sin);
+    if (getpeername(raw_sock, (SOCKADDR *) &sin, &sinsize) == SOCKET_ERROR) {
+        net_perror("getpeername");
+        return false;
+    }
+
+    *addr = ntohl(sin.sin_addr.s_addr);
+    return true;
+}
+
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -236,6 +303,95 @@ net_send_all(sc_socket socket, const void *buf, size_t len) {
     return copied;
 }
 
+ssize_t
+net_sendv_all(sc_socket socket, const struct sc_net_buf *bufs, unsigned count) {
+    assert(count <= SC_NET_SENDV_MAX);
+
+    sc_raw_socket raw_sock = unwrap(socket);
+
+#ifdef _WIN32
+    WSABUF iov[SC_NET_SENDV_MAX];
+#else
+    struct iovec iov[SC_NET_SENDV_MAX];
+#endif
+
+    size_t total = 0;
+    unsigned n = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        if (!bufs[i].len) {
+            continue;
+        }
+#ifdef _WIN32
+        iov[n].buf = (char *) bufs[i].data;
+        iov[n].len = bufs[i].len;
+#else
+        iov[n].iov_base = (void *) bufs[i].data;
+        iov[n].iov_len = bufs[i].len;
+#endif
+        total += bufs[i].len;
+        ++n;
+    }
+
+    size_t copied = 0;
+    unsigned first = 0;
+    while (copied < total) {
+        ssize_t w;
+#ifdef _WIN32
+        DWORD sent;
+        int ret = WSASend(raw_sock, &iov[first], n - first, &sent, 0, NULL,
+                          NULL);
+        w = ret == SOCKET_ERROR ? -1 : (ssize_t) sent;
+#else
+        struct msghdr msg = {
+            .msg_iov = &iov[first],
+            .msg_iovlen = n - first,
+        };
+        w = sendmsg(raw_sock, &msg, 0);
+#endif
+        if (w == -1) {
+            return copied ? (ssize_t) copied : -1;
+        }
+        copied += w;
+
+        // Skip the buffers fully written, and advance in the partially
+        // written one
+        size_t remaining = w;
+#ifdef _WIN32
+        while (first < n && remaining >= iov[first].len) {
+            remaining -= iov[first].len;
+            ++first;
+        }
+        if (remaining) {
+            iov[first].buf += remaining;
+            iov[first].len -= remaining;
+        }
+#else
+        while (first < n && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            ++first;
+        }
+        if (remaining) {
+            iov[first].iov_base = (char *) iov[first].iov_base + remaining;
+            iov[first].iov_len -= remaining;
+        }
+#endif
+    }
+    return copied;
+}
+
+ssize_t
+net_sendto(sc_socket socket, const void *buf, size_t len, uint32_t addr,
+           uint16_t port) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    SOCKADDR_IN sin;
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(addr);
+    sin.sin_port = htons(port);
+
+    return sendto(raw_sock, buf, len, 0, (SOCKADDR *) &sin, sizeof(sin));
+}
+
 bool
 net_interrupt(sc_socket socket) {
     assert(socket != SC_SOCKET_NONE);
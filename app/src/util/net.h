@@ -51,6 +51,10 @@ net_cleanup(void);
 sc_socket
 net_socket(void);
 
+// Create a UDP socket
+sc_socket
+net_udp_socket(void);
+
 bool
 net_connect(sc_socket socket, uint32_t addr, uint16_t port);
 
@@ -60,6 +64,18 @@ net_listen(sc_socket server_socket, uint32_t addr, uint16_t port, int backlog);
 sc_socket
 net_accept(sc_socket server_socket);
 
+// Bind the socket to addr:port (port 0 selects an ephemeral port)
+bool
+net_bind(sc_socket socket, uint32_t addr, uint16_t port);
+
+// Retrieve the local port the socket is bound to
+bool
+net_get_local_port(sc_socket socket, uint16_t *port);
+
+// Retrieve the IPv4 address of the peer of a connected socket
+bool
+net_get_peer_addr(sc_socket socket, uint32_t *addr);
+
 // the _all versions wait/retry until len bytes have been written/read
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len);
@@ -73,6 +89,23 @@ net_send(sc_socket socket, const void *buf, size_t len);
 ssize_t
 net_send_all(sc_socket socket, const void *buf, size_t len);
 
+struct sc_net_buf {
+    const void *data;
+    size_t len;
+};
+
+#define SC_NET_SENDV_MAX 8
+
+// Send all the buffers in order, like successive net_send_all() calls, but in
+// as few system calls as possible (count must not exceed SC_NET_SENDV_MAX)
+ssize_t
+net_sendv_all(sc_socket socket, const struct sc_net_buf *bufs, unsigned count);
+
+// Send a datagram to addr:port (for UDP sockets)
+ssize_t
+net_sendto(sc_socket socket, const void *buf, size_t len, uint32_t addr,
+           uint16_t port);
+
 // Shutdown the socket (or close on Windows) so that any blocking send() or
 // recv() are interrupted.
 bool
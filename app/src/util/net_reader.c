@@ -0,0 +1,65 @@
+#include "net_reader.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+bool
+sc_net_reader_init(struct sc_net_reader *reader, sc_socket socket) {
+    reader->buf = malloc(SC_NET_READER_BUFFER_SIZE);
+    if (!reader->buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    reader->socket = socket;
+    reader->head = 0;
+    reader->len = 0;
+    return true;
+}
+
+void
+sc_net_reader_destroy(struct sc_net_reader *reader) {
+    free(reader->buf);
+}
+
+bool
+sc_net_reader_read(struct sc_net_reader *reader, void *buf, size_t len) {
+    // Consume the buffered data first
+    size_t n = len < reader->len ? len : reader->len;
+    memcpy(buf, &reader->buf[reader->head], n);
+    reader->head += n;
+    reader->len -= n;
+    buf = (uint8_t *) buf + n;
+    len -= n;
+
+    if (!len) {
+        return true;
+    }
+
+    assert(!reader->len);
+
+    if (len >= SC_NET_READER_BUFFER_SIZE / 2) {
+        // Large read, receive directly into the caller buffer
+        ssize_t r = net_recv_all(reader->socket, buf, len);
+        return r >= 0 && (size_t) r == len;
+    }
+
+    // Receive at least len bytes, and as many more as available
+    size_t received = 0;
+    while (received < len) {
+        ssize_t r = net_recv(reader->socket, &reader->buf[received],
+                             SC_NET_READER_BUFFER_SIZE - received);
+        if (r <= 0) {
+            return false;
+        }
+        received += r;
+    }
+
+    memcpy(buf, reader->buf, len);
+    reader->head = len;
+    reader->len = received - len;
+    return true;
+}
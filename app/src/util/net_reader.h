@@ -0,0 +1,39 @@
+#ifndef SC_NET_READER_H
+#define SC_NET_READER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/net.h"
+
+// Buffered reads from a stream socket
+//
+// The data is read ahead, so that a sequence of small reads (typically a
+// packet header followed by a small packet) is served by a single recv().
+// Large reads are received directly into the caller buffer, to avoid a copy.
+
+#define SC_NET_READER_BUFFER_SIZE 0x10000
+
+struct sc_net_reader {
+    sc_socket socket;
+    uint8_t *buf; // SC_NET_READER_BUFFER_SIZE bytes
+    size_t head; // index of the first buffered byte
+    size_t len; // number of buffered bytes
+};
+
+bool
+sc_net_reader_init(struct sc_net_reader *reader, sc_socket socket);
+
+void
+sc_net_reader_destroy(struct sc_net_reader *reader);
+
+// Read exactly len bytes
+//
+// Return false on error or end of stream.
+bool
+sc_net_reader_read(struct sc_net_reader *reader, void *buf, size_t len);
+
+#endif
@@ -0,0 +1,640 @@
+#include "pixconv.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+# define SC_PIXCONV_HAS_SSE2
+# include <emmintrin.h>
+# ifdef __GNUC__
+// AVX2 kernels are compiled with the target attribute, and only selected at
+// runtime if the CPU supports them
+#  define SC_PIXCONV_HAS_AVX2
+#  define SC_TARGET_AVX2 __attribute__((target("avx2")))
+#  include <immintrin.h>
+# endif
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+# define SC_PIXCONV_HAS_NEON
+# include <arm_neon.h>
+#endif
+
+// BT.601 limited range YUV to full range RGB:
+//   R = 1.164 (Y - 16) + 1.596 (V - 128)
+//   G = 1.164 (Y - 16) - 0.391 (U - 128) - 0.813 (V - 128)
+//   B = 1.164 (Y - 16) + 2.018 (U - 128)
+//
+// The coefficients are in 6-bit fixed point. The luma coefficient (74.5) is
+// applied as 74 Y + Y / 2, so that every intermediate value fits in a signed
+// 16-bit lane (only the blue sum may overflow, in which case the saturated
+// value still clamps to 255).
+#define SC_PIXCONV_YG 74
+// 74.5 * 16, minus the rounding term (32)
+#define SC_PIXCONV_Y_OFFSET 1160
+#define SC_PIXCONV_VR 102
+#define SC_PIXCONV_UG 25
+#define SC_PIXCONV_VG 52
+#define SC_PIXCONV_UB 129
+
+// Limited range luma [16; 235] to full range: 255 / 219 ~= 298 / 256 (every
+// intermediate value fits in an unsigned 16-bit lane)
+#define SC_PIXCONV_GRAY_MUL 298
+
+struct sc_pixconv_kernels {
+    // Convert one row (the chroma rows are not subsampled horizontally yet)
+    void (*rgb24_row)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                      uint8_t *dst, unsigned width);
+    void (*uv_row)(const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                   unsigned chroma_width);
+    void (*gray_row)(const uint8_t *src, uint8_t *dst, unsigned width);
+};
+
+static enum sc_pixconv_impl sc_pixconv_forced_impl = SC_PIXCONV_IMPL_AUTO;
+
+static inline uint8_t
+sc_pixconv_clamp6(int value) {
+    // Like a saturating shift right narrow
+    if (value < 0) {
+        return 0;
+    }
+    value >>= 6;
+    return value > 255 ? 255 : value;
+}
+
+static void
+sc_pixconv_rgb24_row_scalar(const uint8_t *y, const uint8_t *u,
+                            const uint8_t *v, uint8_t *dst, unsigned width) {
+    for (unsigned x = 0; x < width; ++x) {
+        int yy = SC_PIXCONV_YG * y[x] + (y[x] >> 1) - SC_PIXCONV_Y_OFFSET;
+        int cu = u[x >> 1] - 128;
+        int cv = v[x >> 1] - 128;
+
+        dst[3 * x] = sc_pixconv_clamp6(yy + SC_PIXCONV_VR * cv);
+        dst[3 * x + 1] = sc_pixconv_clamp6(yy - SC_PIXCONV_UG * cu
+                                              - SC_PIXCONV_VG * cv);
+        dst[3 * x + 2] = sc_pixconv_clamp6(yy + SC_PIXCONV_UB * cu);
+    }
+}
+
+static void
+sc_pixconv_uv_row_scalar(const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                         unsigned chroma_width) {
+    for (unsigned x = 0; x < chroma_width; ++x) {
+        dst[2 * x] = u[x];
+        dst[2 * x + 1] = v[x];
+    }
+}
+
+static void
+sc_pixconv_gray_row_scalar(const uint8_t *src, uint8_t *dst, unsigned width) {
+    for (unsigned x = 0; x < width; ++x) {
+        unsigned l = src[x] > 16 ? src[x] - 16 : 0;
+        if (l > 219) {
+            l = 219;
+        }
+        dst[x] = (l * SC_PIXCONV_GRAY_MUL + 128) >> 8;
+    }
+}
+
+static const struct sc_pixconv_kernels sc_pixconv_kernels_scalar = {
+    .rgb24_row = sc_pixconv_rgb24_row_scalar,
+    .uv_row = sc_pixconv_uv_row_scalar,
+    .gray_row = sc_pixconv_gray_row_scalar,
+};
+
+#ifdef SC_PIXCONV_HAS_SSE2
+// Pack 4 pixels (RGBX, one per 32-bit lane) to RGB24 into the 12 lowest bytes
+static inline __m128i
+sc_pixconv_sse2_pack_rgb4(__m128i rgbx) {
+    // Each 64-bit lane holds 2 pixels: keep their 24 lowest bits, contiguous
+    const __m128i mask_first = _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff);
+    const __m128i mask_second =
+        _mm_set_epi32(0x0000ffff, (int) 0xff000000, 0x0000ffff,
+                      (int) 0xff000000);
+    __m128i q = _mm_or_si128(_mm_and_si128(rgbx, mask_first),
+                             _mm_and_si128(_mm_srli_epi64(rgbx, 8),
+                                           mask_second));
+    // Move the 6 bytes of the upper 64-bit lane just after the first 6 bytes
+    __m128i upper = _mm_slli_si128(_mm_srli_si128(q, 8), 6);
+    return _mm_or_si128(_mm_move_epi64(q), upper);
+}
+
+// Store the 12 lowest bytes
+static inline void
+sc_pixconv_sse2_store12(uint8_t *dst, __m128i v) {
+    _mm_storel_epi64((__m128i *) dst, v);
+    uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(dst + 8, &last, 4);
+}
+
+static inline void
+sc_pixconv_sse2_rgb(__m128i y, __m128i cu, __m128i cv, __m128i *r,
+                    __m128i *g, __m128i *b) {
+    __m128i yy = _mm_add_epi16(_mm_mullo_epi16(y,
+                                               _mm_set1_epi16(SC_PIXCONV_YG)),
+                               _mm_srli_epi16(y, 1));
+    yy = _mm_sub_epi16(yy, _mm_set1_epi16(SC_PIXCONV_Y_OFFSET));
+
+    __m128i vr = _mm_mullo_epi16(cv, _mm_set1_epi16(SC_PIXCONV_VR));
+    __m128i ug = _mm_mullo_epi16(cu, _mm_set1_epi16(SC_PIXCONV_UG));
+    __m128i vg = _mm_mullo_epi16(cv, _mm_set1_epi16(SC_PIXCONV_VG));
+    __m128i ub = _mm_mullo_epi16(cu, _mm_set1_epi16(SC_PIXCONV_UB));
+
+    *r = _mm_srai_epi16(_mm_adds_epi16(yy, vr), 6);
+    *g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(yy, ug), vg), 6);
+    *b = _mm_srai_epi16(_mm_adds_epi16(yy, ub), 6);
+}
+
+static void
+sc_pixconv_rgb24_row_sse2(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, uint8_t *dst, unsigned width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y8 = _mm_loadu_si128((const __m128i *) (y + x));
+        __m128i u8 = _mm_loadl_epi64((const __m128i *) (u + x / 2));
+        __m128i v8 = _mm_loadl_epi64((const __m128i *) (v + x / 2));
+
+        __m128i cu = _mm_sub_epi16(_mm_unpacklo_epi8(u8, zero), c128);
+        __m128i cv = _mm_sub_epi16(_mm_unpacklo_epi8(v8, zero), c128);
+
+        // Each chroma sample covers 2 pixels
+        __m128i r_lo, g_lo, b_lo;
+        sc_pixconv_sse2_rgb(_mm_unpacklo_epi8(y8, zero),
+                            _mm_unpacklo_epi16(cu, cu),
+                            _mm_unpacklo_epi16(cv, cv), &r_lo, &g_lo, &b_lo);
+        __m128i r_hi, g_hi, b_hi;
+        sc_pixconv_sse2_rgb(_mm_unpackhi_epi8(y8, zero),
+                            _mm_unpackhi_epi16(cu, cu),
+                            _mm_unpackhi_epi16(cv, cv), &r_hi, &g_hi, &b_hi);
+
+        // Saturate to [0; 255]
+        __m128i r8 = _mm_packus_epi16(r_lo, r_hi);
+        __m128i g8 = _mm_packus_epi16(g_lo, g_hi);
+        __m128i b8 = _mm_packus_epi16(b_lo, b_hi);
+
+        __m128i rg_lo = _mm_unpacklo_epi8(r8, g8);
+        __m128i rg_hi = _mm_unpackhi_epi8(r8, g8);
+        __m128i bz_lo = _mm_unpacklo_epi8(b8, zero);
+        __m128i bz_hi = _mm_unpackhi_epi8(b8, zero);
+
+        uint8_t *out = dst + 3 * x;
+        // The 16-byte stores overlap: each one overwrites the 4 unused bytes
+        // of the previous one, and the last one stores 12 bytes exactly
+        _mm_storeu_si128((__m128i *) out, sc_pixconv_sse2_pack_rgb4(
+                                    _mm_unpacklo_epi16(rg_lo, bz_lo)));
+        _mm_storeu_si128((__m128i *) (out + 12), sc_pixconv_sse2_pack_rgb4(
+                                    _mm_unpackhi_epi16(rg_lo, bz_lo)));
+        _mm_storeu_si128((__m128i *) (out + 24), sc_pixconv_sse2_pack_rgb4(
+                                    _mm_unpacklo_epi16(rg_hi, bz_hi)));
+        sc_pixconv_sse2_store12(out + 36, sc_pixconv_sse2_pack_rgb4(
+                                    _mm_unpackhi_epi16(rg_hi, bz_hi)));
+    }
+
+    if (x < width) {
+        // x is even
+        sc_pixconv_rgb24_row_scalar(y + x, u + x / 2, v + x / 2, dst + 3 * x,
+                                    width - x);
+    }
+}
+
+static void
+sc_pixconv_uv_row_sse2(const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                       unsigned chroma_width) {
+    unsigned x = 0;
+    for (; x + 16 <= chroma_width; x += 16) {
+        __m128i u8 = _mm_loadu_si128((const __m128i *) (u + x));
+        __m128i v8 = _mm_loadu_si128((const __m128i *) (v + x));
+        _mm_storeu_si128((__m128i *) (dst + 2 * x), _mm_unpacklo_epi8(u8, v8));
+        _mm_storeu_si128((__m128i *) (dst + 2 * x + 16),
+                         _mm_unpackhi_epi8(u8, v8));
+    }
+
+    if (x < chroma_width) {
+        sc_pixconv_uv_row_scalar(u + x, v + x, dst + 2 * x, chroma_width - x);
+    }
+}
+
+static void
+sc_pixconv_gray_row_sse2(const uint8_t *src, uint8_t *dst, unsigned width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c16 = _mm_set1_epi8(16);
+    const __m128i c219 = _mm_set1_epi8((char) 219);
+    const __m128i mul = _mm_set1_epi16(SC_PIXCONV_GRAY_MUL);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i l = _mm_loadu_si128((const __m128i *) (src + x));
+        l = _mm_min_epu8(_mm_subs_epu8(l, c16), c219);
+
+        // The products fit in unsigned 16 bits
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), mul);
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), mul);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, c128), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, c128), 8);
+
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(lo, hi));
+    }
+
+    if (x < width) {
+        sc_pixconv_gray_row_scalar(src + x, dst + x, width - x);
+    }
+}
+
+static const struct sc_pixconv_kernels sc_pixconv_kernels_sse2 = {
+    .rgb24_row = sc_pixconv_rgb24_row_sse2,
+    .uv_row = sc_pixconv_uv_row_sse2,
+    .gray_row = sc_pixconv_gray_row_sse2,
+};
+#endif
+
+#ifdef SC_PIXCONV_HAS_AVX2
+SC_TARGET_AVX2 static inline void
+sc_pixconv_avx2_rgb(__m256i y, __m256i cu, __m256i cv, __m256i *r,
+                    __m256i *g, __m256i *b) {
+    __m256i yy =
+        _mm256_add_epi16(_mm256_mullo_epi16(y,
+                                            _mm256_set1_epi16(SC_PIXCONV_YG)),
+                         _mm256_srli_epi16(y, 1));
+    yy = _mm256_sub_epi16(yy, _mm256_set1_epi16(SC_PIXCONV_Y_OFFSET));
+
+    __m256i vr = _mm256_mullo_epi16(cv, _mm256_set1_epi16(SC_PIXCONV_VR));
+    __m256i ug = _mm256_mullo_epi16(cu, _mm256_set1_epi16(SC_PIXCONV_UG));
+    __m256i vg = _mm256_mullo_epi16(cv, _mm256_set1_epi16(SC_PIXCONV_VG));
+    __m256i ub = _mm256_mullo_epi16(cu, _mm256_set1_epi16(SC_PIXCONV_UB));
+
+    *r = _mm256_srai_epi16(_mm256_adds_epi16(yy, vr), 6);
+    *g = _mm256_srai_epi16(_mm256_sub_epi16(_mm256_sub_epi16(yy, ug), vg), 6);
+    *b = _mm256_srai_epi16(_mm256_adds_epi16(yy, ub), 6);
+}
+
+SC_TARGET_AVX2 static void
+sc_pixconv_rgb24_row_avx2(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, uint8_t *dst, unsigned width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c128 = _mm256_set1_epi16(128);
+    // Drop the 4th byte of each RGBX pixel (in each 128-bit lane)
+    const __m256i pack_rgb = _mm256_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y8 = _mm_loadu_si128((const __m128i *) (y + x));
+        __m128i u8 = _mm_loadl_epi64((const __m128i *) (u + x / 2));
+        __m128i v8 = _mm_loadl_epi64((const __m128i *) (v + x / 2));
+
+        // Each chroma sample covers 2 pixels
+        __m256i cu = _mm256_sub_epi16(
+                _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8)), c128);
+        __m256i cv = _mm256_sub_epi16(
+                _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8)), c128);
+
+        // Pixels 0-7 in the low 128-bit lane, 8-15 in the high lane
+        __m256i r, g, b;
+        sc_pixconv_avx2_rgb(_mm256_cvtepu8_epi16(y8), cu, cv, &r, &g, &b);
+
+        // Per lane: 8 R then 8 G, and 8 B then 8 zeros (saturated)
+        __m256i rg = _mm256_packus_epi16(r, g);
+        __m256i bz = _mm256_packus_epi16(b, zero);
+
+        __m256i rg_i = _mm256_unpacklo_epi8(rg, _mm256_srli_si256(rg, 8));
+        __m256i bz_i = _mm256_unpacklo_epi8(bz, zero);
+
+        __m256i p_lo = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg_i, bz_i),
+                                           pack_rgb);
+        __m256i p_hi = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg_i, bz_i),
+                                           pack_rgb);
+
+        uint8_t *out = dst + 3 * x;
+        // The 16-byte stores overlap: each one overwrites the 4 unused bytes
+        // of the previous one, and the last one stores 12 bytes exactly
+        _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(p_lo));
+        _mm_storeu_si128((__m128i *) (out + 12),
+                         _mm256_castsi256_si128(p_hi));
+        _mm_storeu_si128((__m128i *) (out + 24),
+                         _mm256_extracti128_si256(p_lo, 1));
+        __m128i last = _mm256_extracti128_si256(p_hi, 1);
+        _mm_storel_epi64((__m128i *) (out + 36), last);
+        uint32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(last, 8));
+        memcpy(out + 44, &tail, 4);
+    }
+
+    if (x < width) {
+        // x is even
+        sc_pixconv_rgb24_row_scalar(y + x, u + x / 2, v + x / 2, dst + 3 * x,
+                                    width - x);
+    }
+}
+
+SC_TARGET_AVX2 static void
+sc_pixconv_uv_row_avx2(const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                       unsigned chroma_width) {
+    unsigned x = 0;
+    for (; x + 32 <= chroma_width; x += 32) {
+        __m256i u8 = _mm256_loadu_si256((const __m256i *) (u + x));
+        __m256i v8 = _mm256_loadu_si256((const __m256i *) (v + x));
+        // Interleaved per 128-bit lane: samples 0-7 and 16-23 in lo, 8-15 and
+        // 24-31 in hi
+        __m256i lo = _mm256_unpacklo_epi8(u8, v8);
+        __m256i hi = _mm256_unpackhi_epi8(u8, v8);
+        _mm256_storeu_si256((__m256i *) (dst + 2 * x),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *) (dst + 2 * x + 32),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    if (x < chroma_width) {
+        sc_pixconv_uv_row_scalar(u + x, v + x, dst + 2 * x, chroma_width - x);
+    }
+}
+
+SC_TARGET_AVX2 static void
+sc_pixconv_gray_row_avx2(const uint8_t *src, uint8_t *dst, unsigned width) {
+    const __m256i c16 = _mm256_set1_epi8(16);
+    const __m256i c219 = _mm256_set1_epi8((char) 219);
+    const __m256i mul = _mm256_set1_epi16(SC_PIXCONV_GRAY_MUL);
+    const __m256i c128 = _mm256_set1_epi16(128);
+
+    unsigned x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i l = _mm256_loadu_si256((const __m256i *) (src + x));
+        l = _mm256_min_epu8(_mm256_subs_epu8(l, c16), c219);
+
+        // The products fit in unsigned 16 bits
+        __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(l));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(l, 1));
+        lo = _mm256_mullo_epi16(lo, mul);
+        hi = _mm256_mullo_epi16(hi, mul);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, c128), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, c128), 8);
+
+        // packus interleaves the 128-bit lanes, restore the order
+        __m256i gray = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi),
+                                                0xD8);
+        _mm256_storeu_si256((__m256i *) (dst + x), gray);
+    }
+
+    if (x < width) {
+        sc_pixconv_gray_row_scalar(src + x, dst + x, width - x);
+    }
+}
+
+static const struct sc_pixconv_kernels sc_pixconv_kernels_avx2 = {
+    .rgb24_row = sc_pixconv_rgb24_row_avx2,
+    .uv_row = sc_pixconv_uv_row_avx2,
+    .gray_row = sc_pixconv_gray_row_avx2,
+};
+#endif
+
+#ifdef SC_PIXCONV_HAS_NEON
+static inline void
+sc_pixconv_neon_rgb(uint8x8_t y8, int16x8_t cu, int16x8_t cv, uint8x8_t *r,
+                    uint8x8_t *g, uint8x8_t *b) {
+    uint16x8_t y = vmovl_u8(y8);
+    int16x8_t yy = vreinterpretq_s16_u16(
+            vaddq_u16(vmulq_n_u16(y, SC_PIXCONV_YG), vshrq_n_u16(y, 1)));
+    yy = vsubq_s16(yy, vdupq_n_s16(SC_PIXCONV_Y_OFFSET));
+
+    int16x8_t rr = vqaddq_s16(yy, vmulq_n_s16(cv, SC_PIXCONV_VR));
+    int16x8_t gg = vsubq_s16(vsubq_s16(yy, vmulq_n_s16(cu, SC_PIXCONV_UG)),
+                             vmulq_n_s16(cv, SC_PIXCONV_VG));
+    int16x8_t bb = vqaddq_s16(yy, vmulq_n_s16(cu, SC_PIXCONV_UB));
+
+    // Saturate to [0; 255]
+    *r = vqshrun_n_s16(rr, 6);
+    *g = vqshrun_n_s16(gg, 6);
+    *b = vqshrun_n_s16(bb, 6);
+}
+
+static void
+sc_pixconv_rgb24_row_neon(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, uint8_t *dst, unsigned width) {
+    const uint8x8_t c128 = vdup_n_u8(128);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t y8 = vld1q_u8(y + x);
+        // The wrapped unsigned difference is the signed difference
+        int16x8_t cu = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(u + x / 2),
+                                                      c128));
+        int16x8_t cv = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(v + x / 2),
+                                                      c128));
+
+        // Each chroma sample covers 2 pixels
+        int16x8x2_t cuz = vzipq_s16(cu, cu);
+        int16x8x2_t cvz = vzipq_s16(cv, cv);
+
+        uint8x8_t r_lo, g_lo, b_lo;
+        sc_pixconv_neon_rgb(vget_low_u8(y8), cuz.val[0], cvz.val[0], &r_lo,
+                            &g_lo, &b_lo);
+        uint8x8_t r_hi, g_hi, b_hi;
+        sc_pixconv_neon_rgb(vget_high_u8(y8), cuz.val[1], cvz.val[1], &r_hi,
+                            &g_hi, &b_hi);
+
+        uint8x16x3_t rgb;
+        rgb.val[0] = vcombine_u8(r_lo, r_hi);
+        rgb.val[1] = vcombine_u8(g_lo, g_hi);
+        rgb.val[2] = vcombine_u8(b_lo, b_hi);
+        vst3q_u8(dst + 3 * x, rgb);
+    }
+
+    if (x < width) {
+        // x is even
+        sc_pixconv_rgb24_row_scalar(y + x, u + x / 2, v + x / 2, dst + 3 * x,
+                                    width - x);
+    }
+}
+
+static void
+sc_pixconv_uv_row_neon(const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                       unsigned chroma_width) {
+    unsigned x = 0;
+    for (; x + 16 <= chroma_width; x += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(u + x);
+        uv.val[1] = vld1q_u8(v + x);
+        vst2q_u8(dst + 2 * x, uv);
+    }
+
+    if (x < chroma_width) {
+        sc_pixconv_uv_row_scalar(u + x, v + x, dst + 2 * x, chroma_width - x);
+    }
+}
+
+static void
+sc_pixconv_gray_row_neon(const uint8_t *src, uint8_t *dst, unsigned width) {
+    const uint8x16_t c16 = vdupq_n_u8(16);
+    const uint8x16_t c219 = vdupq_n_u8(219);
+    const uint16x8_t c128 = vdupq_n_u16(128);
+
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t l = vminq_u8(vqsubq_u8(vld1q_u8(src + x), c16), c219);
+
+        // The products fit in unsigned 16 bits
+        uint16x8_t lo = vmulq_n_u16(vmovl_u8(vget_low_u8(l)),
+                                    SC_PIXCONV_GRAY_MUL);
+        uint16x8_t hi = vmulq_n_u16(vmovl_u8(vget_high_u8(l)),
+                                    SC_PIXCONV_GRAY_MUL);
+        uint8x16_t gray = vcombine_u8(vshrn_n_u16(vaddq_u16(lo, c128), 8),
+                                      vshrn_n_u16(vaddq_u16(hi, c128), 8));
+        vst1q_u8(dst + x, gray);
+    }
+
+    if (x < width) {
+        sc_pixconv_gray_row_scalar(src + x, dst + x, width - x);
+    }
+}
+
+static const struct sc_pixconv_kernels sc_pixconv_kernels_neon = {
+    .rgb24_row = sc_pixconv_rgb24_row_neon,
+    .uv_row = sc_pixconv_uv_row_neon,
+    .gray_row = sc_pixconv_gray_row_neon,
+};
+#endif
+
+bool
+sc_pixconv_supports(enum sc_pixconv_impl impl) {
+    switch (impl) {
+        case SC_PIXCONV_IMPL_AUTO:
+        case SC_PIXCONV_IMPL_SCALAR:
+            return true;
+        case SC_PIXCONV_IMPL_SSE2:
+#ifdef SC_PIXCONV_HAS_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case SC_PIXCONV_IMPL_AVX2:
+#ifdef SC_PIXCONV_HAS_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case SC_PIXCONV_IMPL_NEON:
+#ifdef SC_PIXCONV_HAS_NEON
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool
+sc_pixconv_set_impl(enum sc_pixconv_impl impl) {
+    if (!sc_pixconv_supports(impl)) {
+        return false;
+    }
+
+    sc_pixconv_forced_impl = impl;
+    return true;
+}
+
+enum sc_pixconv_impl
+sc_pixconv_get_impl(void) {
+    if (sc_pixconv_forced_impl != SC_PIXCONV_IMPL_AUTO) {
+        return sc_pixconv_forced_impl;
+    }
+
+    static const enum sc_pixconv_impl preferred[] = {
+        SC_PIXCONV_IMPL_AVX2,
+        SC_PIXCONV_IMPL_SSE2,
+        SC_PIXCONV_IMPL_NEON,
+    };
+    for (size_t i = 0; i < ARRAY_LEN(preferred); ++i) {
+        if (sc_pixconv_supports(preferred[i])) {
+            return preferred[i];
+        }
+    }
+
+    return SC_PIXCONV_IMPL_SCALAR;
+}
+
+const char *
+sc_pixconv_impl_name(enum sc_pixconv_impl impl) {
+    switch (impl) {
+        case SC_PIXCONV_IMPL_AUTO:
+            return "auto";
+        case SC_PIXCONV_IMPL_SCALAR:
+            return "scalar";
+        case SC_PIXCONV_IMPL_SSE2:
+            return "sse2";
+        case SC_PIXCONV_IMPL_AVX2:
+            return "avx2";
+        case SC_PIXCONV_IMPL_NEON:
+            return "neon";
+        default:
+            return "unknown";
+    }
+}
+
+static const struct sc_pixconv_kernels *
+sc_pixconv_get_kernels(void) {
+    switch (sc_pixconv_get_impl()) {
+#ifdef SC_PIXCONV_HAS_SSE2
+        case SC_PIXCONV_IMPL_SSE2:
+            return &sc_pixconv_kernels_sse2;
+#endif
+#ifdef SC_PIXCONV_HAS_AVX2
+        case SC_PIXCONV_IMPL_AVX2:
+            return &sc_pixconv_kernels_avx2;
+#endif
+#ifdef SC_PIXCONV_HAS_NEON
+        case SC_PIXCONV_IMPL_NEON:
+            return &sc_pixconv_kernels_neon;
+#endif
+        default:
+            return &sc_pixconv_kernels_scalar;
+    }
+}
+
+void
+sc_pixconv_to_rgb24(const struct sc_pixconv_yuv420p *src, uint8_t *dst,
+                    size_t dst_linesize) {
+    const struct sc_pixconv_kernels *kernels = sc_pixconv_get_kernels();
+
+    for (unsigned row = 0; row < src->height; ++row) {
+        const uint8_t *y = src->data[0] + row * src->linesize[0];
+        const uint8_t *u = src->data[1] + (row >> 1) * src->linesize[1];
+        const uint8_t *v = src->data[2] + (row >> 1) * src->linesize[2];
+        kernels->rgb24_row(y, u, v, dst + row * dst_linesize, src->width);
+    }
+}
+
+void
+sc_pixconv_to_nv12(const struct sc_pixconv_yuv420p *src, uint8_t *dst_y,
+                   size_t dst_y_linesize, uint8_t *dst_uv,
+                   size_t dst_uv_linesize) {
+    const struct sc_pixconv_kernels *kernels = sc_pixconv_get_kernels();
+
+    for (unsigned row = 0; row < src->height; ++row) {
+        memcpy(dst_y + row * dst_y_linesize,
+               src->data[0] + row * src->linesize[0], src->width);
+    }
+
+    unsigned chroma_width = (src->width + 1) / 2;
+    unsigned chroma_height = (src->height + 1) / 2;
+    for (unsigned row = 0; row < chroma_height; ++row) {
+        const uint8_t *u = src->data[1] + row * src->linesize[1];
+        const uint8_t *v = src->data[2] + row * src->linesize[2];
+        kernels->uv_row(u, v, dst_uv + row * dst_uv_linesize, chroma_width);
+    }
+}
+
+void
+sc_pixconv_to_gray(const uint8_t *src, size_t src_linesize, unsigned width,
+                   unsigned height, uint8_t *dst, size_t dst_linesize) {
+    const struct sc_pixconv_kernels *kernels = sc_pixconv_get_kernels();
+
+    for (unsigned row = 0; row < height; ++row) {
+        kernels->gray_row(src + row * src_linesize, dst + row * dst_linesize,
+                          width);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SC_PIXCONV_H
+#define SC_PIXCONV_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixel format conversions from the YUV420P limited range frames produced by
+ * the device encoder (BT.601 coefficients).
+ *
+ * The conversions use fixed-point arithmetic, and the SIMD kernels (SSE2, AVX2
+ * or NEON, selected at runtime) produce exactly the same output as the scalar
+ * implementation.
+ */
+
+enum sc_pixconv_impl {
+    SC_PIXCONV_IMPL_AUTO, // the fastest implementation supported by the CPU
+    SC_PIXCONV_IMPL_SCALAR,
+    SC_PIXCONV_IMPL_SSE2,
+    SC_PIXCONV_IMPL_AVX2,
+    SC_PIXCONV_IMPL_NEON,
+};
+
+struct sc_pixconv_yuv420p {
+    const uint8_t *data[3];
+    size_t linesize[3];
+    unsigned width;
+    unsigned height;
+};
+
+/**
+ * Convert to packed RGB24 (full range)
+ */
+void
+sc_pixconv_to_rgb24(const struct sc_pixconv_yuv420p *src, uint8_t *dst,
+                    size_t dst_linesize);
+
+/**
+ * Convert to NV12 (the luma plane is copied, the chroma planes are
+ * interleaved)
+ */
+void
+sc_pixconv_to_nv12(const struct sc_pixconv_yuv420p *src, uint8_t *dst_y,
+                   size_t dst_y_linesize, uint8_t *dst_uv,
+                   size_t dst_uv_linesize);
+
+/**
+ * Convert an 8-bit limited range luma plane to full range grayscale
+ *
+ * The source and the destination may be the same plane (in place conversion).
+ */
+void
+sc_pixconv_to_gray(const uint8_t *src, size_t src_linesize, unsigned width,
+                   unsigned height, uint8_t *dst, size_t dst_linesize);
+
+/**
+ * Return true if the implementation is supported by this build and this CPU
+ */
+bool
+sc_pixconv_supports(enum sc_pixconv_impl impl);
+
+/**
+ * Force the implementation used by the conversions (for tests and benchmarks)
+ *
+ * It must not be called while a conversion is running. Return false if the
+ * implementation is not supported.
+ */
+bool
+sc_pixconv_set_impl(enum sc_pixconv_impl impl);
+
+/**
+ * Return the implementation used by the conversions (never AUTO)
+ */
+enum sc_pixconv_impl
+sc_pixconv_get_impl(void);
+
+const char *
+sc_pixconv_impl_name(enum sc_pixconv_impl impl);
+
+#endif
@@ -0,0 +1,63 @@
+#include "scale.h"
+
+#include <assert.h>
+
+void
+sc_scale_plane_down(const uint8_t *src, size_t src_linesize, unsigned src_w,
+                    unsigned src_h, uint8_t *dst, size_t dst_linesize,
+                    unsigned dst_w, unsigned dst_h) {
+    assert(dst_w && dst_w <= src_w);
+    assert(dst_h && dst_h <= src_h);
+
+    for (unsigned y = 0; y < dst_h; ++y) {
+        // Source rows [y0; y1) covered by the destination row
+        unsigned y0 = (uint64_t) y * src_h / dst_h;
+        unsigned y1 = (uint64_t) (y + 1) * src_h / dst_h;
+        assert(y1 > y0);
+
+        uint8_t *out = dst + y * dst_linesize;
+        for (unsigned x = 0; x < dst_w; ++x) {
+            unsigned x0 = (uint64_t) x * src_w / dst_w;
+            unsigned x1 = (uint64_t) (x + 1) * src_w / dst_w;
+            assert(x1 > x0);
+
+            uint32_t sum = 0;
+            for (unsigned sy = y0; sy < y1; ++sy) {
+                const uint8_t *in = src + sy * src_linesize;
+                for (unsigned sx = x0; sx < x1; ++sx) {
+                    sum += in[sx];
+                }
+            }
+
+            uint32_t count = (y1 - y0) * (x1 - x0);
+            // Rounded to the nearest
+            out[x] = (sum + count / 2) / count;
+        }
+    }
+}
+
+void
+sc_scale_compute_size(unsigned width, unsigned height, unsigned max_size,
+                      unsigned *out_width, unsigned *out_height) {
+    if (!max_size || (width <= max_size && height <= max_size)) {
+        *out_width = width;
+        *out_height = height;
+        return;
+    }
+
+    unsigned w;
+    unsigned h;
+    if (width >= height) {
+        w = max_size;
+        h = (uint64_t) height * max_size / width;
+    } else {
+        h = max_size;
+        w = (uint64_t) width * max_size / height;
+    }
+
+    // Round down to even values (required for 4:2:0 chroma subsampling)
+    w &= ~1u;
+    h &= ~1u;
+    *out_width = w ? w : 2;
+    *out_height = h ? h : 2;
+}
@@ -0,0 +1,31 @@
+#ifndef SC_SCALE_H
+#define SC_SCALE_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Downscale an 8-bit plane (for example one plane of a YUV420P frame) by
+ * averaging, for each destination pixel, the source pixels it covers (area
+ * averaging).
+ *
+ * The destination must not be larger than the source in any dimension.
+ */
+void
+sc_scale_plane_down(const uint8_t *src, size_t src_linesize, unsigned src_w,
+                    unsigned src_h, uint8_t *dst, size_t dst_linesize,
+                    unsigned dst_w, unsigned dst_h);
+
+/**
+ * Compute the size of the largest frame fitting in max_size x max_size while
+ * keeping the aspect ratio (the dimensions are rounded to even values)
+ *
+ * If max_size is 0 or if the frame already fits, the size is unchanged.
+ */
+void
+sc_scale_compute_size(unsigned width, unsigned height, unsigned max_size,
+                      unsigned *out_width, unsigned *out_height);
+
+#endif
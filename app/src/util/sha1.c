@@ -0,0 +1,107 @@
+#include "sha1.h"
+
+#include <string.h>
+
+#include "util/binary.h"
+
+// SHA-1 (RFC 3174), required by the WebSocket handshake (RFC 6455)
+
+static inline uint32_t
+sc_sha1_rol(uint32_t value, unsigned bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void
+sc_sha1_process_block(struct sc_sha1 *sha1, const uint8_t *block) {
+    uint32_t w[80];
+    for (unsigned i = 0; i < 16; ++i) {
+        w[i] = sc_read32be(&block[i * 4]);
+    }
+    for (unsigned i = 16; i < 80; ++i) {
+        w[i] = sc_sha1_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = sha1->state[0];
+    uint32_t b = sha1->state[1];
+    uint32_t c = sha1->state[2];
+    uint32_t d = sha1->state[3];
+    uint32_t e = sha1->state[4];
+
+    for (unsigned i = 0; i < 80; ++i) {
+        uint32_t f;
+        uint32_t k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t tmp = sc_sha1_rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = sc_sha1_rol(b, 30);
+        b = a;
+        a = tmp;
+    }
+
+    sha1->state[0] += a;
+    sha1->state[1] += b;
+    sha1->state[2] += c;
+    sha1->state[3] += d;
+    sha1->state[4] += e;
+}
+
+void
+sc_sha1_init(struct sc_sha1 *sha1) {
+    sha1->state[0] = 0x67452301;
+    sha1->state[1] = 0xEFCDAB89;
+    sha1->state[2] = 0x98BADCFE;
+    sha1->state[3] = 0x10325476;
+    sha1->state[4] = 0xC3D2E1F0;
+    sha1->len = 0;
+}
+
+void
+sc_sha1_update(struct sc_sha1 *sha1, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len) {
+        size_t offset = sha1->len % 64;
+        size_t n = MIN(len, 64 - offset);
+        memcpy(&sha1->block[offset], p, n);
+        sha1->len += n;
+        p += n;
+        len -= n;
+
+        if (offset + n == 64) {
+            sc_sha1_process_block(sha1, sha1->block);
+        }
+    }
+}
+
+void
+sc_sha1_final(struct sc_sha1 *sha1, uint8_t digest[SC_SHA1_DIGEST_SIZE]) {
+    uint64_t bit_len = sha1->len * 8;
+
+    // Padding: a '1' bit, then '0' bits up to 56 bytes modulo 64, then the
+    // message length in bits
+    static const uint8_t padding[64] = {0x80};
+    size_t offset = sha1->len % 64;
+    size_t padding_len = offset < 56 ? 56 - offset : 120 - offset;
+    sc_sha1_update(sha1, padding, padding_len);
+
+    uint8_t len_be[8];
+    sc_write64be(len_be, bit_len);
+    sc_sha1_update(sha1, len_be, 8);
+
+    for (unsigned i = 0; i < 5; ++i) {
+        sc_write32be(&digest[i * 4], sha1->state[i]);
+    }
+}
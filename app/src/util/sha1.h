@@ -0,0 +1,26 @@
+#ifndef SC_SHA1_H
+#define SC_SHA1_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SC_SHA1_DIGEST_SIZE 20
+
+struct sc_sha1 {
+    uint32_t state[5];
+    uint64_t len; // total length, in bytes
+    uint8_t block[64];
+};
+
+void
+sc_sha1_init(struct sc_sha1 *sha1);
+
+void
+sc_sha1_update(struct sc_sha1 *sha1, const void *data, size_t len);
+
+void
+sc_sha1_final(struct sc_sha1 *sha1, uint8_t digest[SC_SHA1_DIGEST_SIZE]);
+
+#endif
@@ -1,6 +1,7 @@
 #include "str.h"
 
 #include <assert.h>
+#include <ctype.h>
 #include <errno.h>
 #include <limits.h>
 #include <stdio.h>
@@ -373,3 +374,62 @@ sc_str_to_hex_string(const uint8_t *data, size_t size) {
 
     return buffer;
 }
+
+char *
+sc_str_to_base64(const uint8_t *data, size_t len) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    size_t out_len = (len + 2) / 3 * 4;
+    char *out = malloc(out_len + 1);
+    if (!out) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    char *p = out;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *p++ = alphabet[(v >> 18) & 0x3f];
+        *p++ = alphabet[(v >> 12) & 0x3f];
+        *p++ = alphabet[(v >> 6) & 0x3f];
+        *p++ = alphabet[v & 0x3f];
+    }
+
+    if (i < len) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < len) {
+            v |= data[i + 1] << 8;
+        }
+        *p++ = alphabet[(v >> 18) & 0x3f];
+        *p++ = alphabet[(v >> 12) & 0x3f];
+        *p++ = i + 1 < len ? alphabet[(v >> 6) & 0x3f] : '=';
+        *p++ = '=';
+    }
+
+    *p = '\0';
+    assert((size_t) (p - out) == out_len);
+    return out;
+}
+
+const char *
+sc_str_header_value(const char *line, const char *name) {
+    size_t len = strlen(name);
+    for (size_t i = 0; i < len; ++i) {
+        if (tolower((unsigned char) line[i])
+                != tolower((unsigned char) name[i])) {
+            return NULL;
+        }
+    }
+
+    if (line[len] != ':') {
+        return NULL;
+    }
+
+    const char *value = &line[len + 1];
+    while (*value == ' ' || *value == '\t') {
+        ++value;
+    }
+    return value;
+}
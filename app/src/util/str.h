@@ -155,4 +155,21 @@ sc_str_remove_trailing_cr(char *s, size_t len);
 char *
 sc_str_to_hex_string(const uint8_t *data, size_t len);
 
+/**
+ * Encode binary data to base64 (RFC 4648, with padding)
+ *
+ * Return a new allocated string, to be freed by the caller.
+ */
+char *
+sc_str_to_base64(const uint8_t *data, size_t len);
+
+/**
+ * If `line` starts with the header `name` (case-insensitive) of an HTTP-like
+ * request (HTTP, RTSP), return its value (without the leading whitespaces)
+ *
+ * Return NULL otherwise.
+ */
+const char *
+sc_str_header_value(const char *line, const char *name);
+
 #endif
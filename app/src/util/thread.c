@@ -7,9 +7,33 @@
 #include <SDL2/SDL_thread.h>
 
 #include "util/log.h"
+#include "util/thread_policy.h"
+#include "util/trace.h"
 
 sc_thread_id SC_MAIN_THREAD_ID;
 
+// Set once the priority is imposed by a thread policy
+static _Thread_local bool sc_thread_priority_forced;
+
+struct sc_thread_start {
+    sc_thread_fn *fn;
+    void *userdata;
+    const struct sc_thread_policy *policy;
+};
+
+static int
+run_thread_with_policy(void *data) {
+    struct sc_thread_start *start = data;
+    sc_thread_fn *fn = start->fn;
+    void *userdata = start->userdata;
+    const struct sc_thread_policy *policy = start->policy;
+    free(start);
+
+    sc_thread_policy_apply(policy);
+
+    return fn(userdata);
+}
+
 bool
 sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
                  void *userdata) {
@@ -17,13 +41,39 @@ sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
     // longer than 16 bytes (including the final '\0')
     assert(strlen(name) <= 15);
 
-    SDL_Thread *sdl_thread = SDL_CreateThread(fn, name, userdata);
+    SDL_Thread *sdl_thread;
+
+    const struct sc_thread_policy *policy = sc_thread_policy_find(name);
+    if (policy) {
+        // Apply the policy from the new thread before running fn
+        struct sc_thread_start *start = malloc(sizeof(*start));
+        if (!start) {
+            LOG_OOM();
+            return false;
+        }
+        start->fn = fn;
+        start->userdata = userdata;
+        start->policy = policy;
+
+        sdl_thread = SDL_CreateThread(run_thread_with_policy, name, start);
+        if (!sdl_thread) {
+            free(start);
+        }
+    } else {
+        sdl_thread = SDL_CreateThread(fn, name, userdata);
+    }
+
     if (!sdl_thread) {
         LOG_OOM();
         return false;
     }
 
     thread->thread = sdl_thread;
+
+    if (sc_trace_enabled) {
+        sc_trace_set_thread_name(SDL_GetThreadID(sdl_thread), name);
+    }
+
     return true;
 }
 
@@ -50,6 +100,11 @@ to_sdl_thread_priority(enum sc_thread_priority priority) {
 
 bool
 sc_thread_set_priority(enum sc_thread_priority priority) {
+    if (sc_thread_priority_forced) {
+        // The thread policy takes precedence
+        return true;
+    }
+
     SDL_ThreadPriority sdl_priority = to_sdl_thread_priority(priority);
     int r = SDL_SetThreadPriority(sdl_priority);
     if (r) {
@@ -60,6 +115,14 @@ sc_thread_set_priority(enum sc_thread_priority priority) {
     return true;
 }
 
+bool
+sc_thread_force_priority(enum sc_thread_priority priority) {
+    sc_thread_priority_forced = false;
+    bool ok = sc_thread_set_priority(priority);
+    sc_thread_priority_forced = true;
+    return ok;
+}
+
 void
 sc_thread_join(sc_thread *thread, int *status) {
     SDL_WaitThread(thread->thread, status);
@@ -6,19 +6,29 @@
 #include <stdatomic.h>
 #include <stdbool.h>
 
+#ifndef HAVE_SDL
+# include <pthread.h>
+#endif
+
 #include "tick.h"
 
+#ifdef HAVE_SDL
 /* Forward declarations */
 typedef struct SDL_Thread SDL_Thread;
 typedef struct SDL_mutex SDL_mutex;
 typedef struct SDL_cond SDL_cond;
+#endif
 
 typedef int sc_thread_fn(void *);
 typedef unsigned sc_thread_id;
 typedef atomic_uint sc_atomic_thread_id;
 
 typedef struct sc_thread {
+#ifdef HAVE_SDL
     SDL_Thread *thread;
+#else
+    pthread_t thread;
+#endif
 } sc_thread;
 
 enum sc_thread_priority {
@@ -29,14 +39,22 @@ enum sc_thread_priority {
 };
 
 typedef struct sc_mutex {
+#ifdef HAVE_SDL
     SDL_mutex *mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
 #ifndef NDEBUG
     sc_atomic_thread_id locker;
 #endif
 } sc_mutex;
 
 typedef struct sc_cond {
+#ifdef HAVE_SDL
     SDL_cond *cond;
+#else
+    pthread_cond_t cond;
+#endif
 } sc_cond;
 
 extern sc_thread_id SC_MAIN_THREAD_ID;
@@ -51,6 +69,13 @@ sc_thread_join(sc_thread *thread, int *status);
 bool
 sc_thread_set_priority(enum sc_thread_priority priority);
 
+/**
+ * Set the priority of the current thread, and ignore any further call to
+ * sc_thread_set_priority() from this thread
+ */
+bool
+sc_thread_force_priority(enum sc_thread_priority priority);
+
 bool
 sc_mutex_init(sc_mutex *mutex);
 
@@ -0,0 +1,252 @@
+#include "thread_policy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+# include <sched.h>
+#endif
+
+#include "util/log.h"
+
+static const struct sc_thread_policy *sc_thread_policies;
+static unsigned sc_thread_policy_count;
+
+bool
+sc_cpu_set_is_empty(const struct sc_cpu_set *set) {
+    for (size_t i = 0; i < ARRAY_LEN(set->bits); ++i) {
+        if (set->bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+sc_cpu_set_parse_cpu(const char *s, char **end, long *cpu) {
+    if (*s < '0' || *s > '9') {
+        return false;
+    }
+
+    *cpu = strtol(s, end, 10);
+    return *cpu < SC_CPU_SET_MAX_CPUS;
+}
+
+bool
+sc_cpu_set_parse(const char *s, struct sc_cpu_set *set) {
+    memset(set, 0, sizeof(*set));
+
+    const char *p = s;
+    for (;;) {
+        char *end;
+        long first;
+        if (!sc_cpu_set_parse_cpu(p, &end, &first)) {
+            return false;
+        }
+
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            if (!sc_cpu_set_parse_cpu(p, &end, &last) || last < first) {
+                return false;
+            }
+        }
+
+        for (long cpu = first; cpu <= last; ++cpu) {
+            sc_cpu_set_add(set, cpu);
+        }
+
+        if (*end == '\0') {
+            return true;
+        }
+
+        if (*end != ',') {
+            return false;
+        }
+
+        p = end + 1;
+    }
+}
+
+void
+sc_cpu_set_format(const struct sc_cpu_set *set, char *out, size_t len) {
+    assert(len);
+    out[0] = '\0';
+
+    size_t pos = 0;
+    unsigned cpu = 0;
+    while (cpu < SC_CPU_SET_MAX_CPUS) {
+        if (!sc_cpu_set_contains(set, cpu)) {
+            ++cpu;
+            continue;
+        }
+
+        unsigned first = cpu;
+        while (cpu + 1 < SC_CPU_SET_MAX_CPUS
+                && sc_cpu_set_contains(set, cpu + 1)) {
+            ++cpu;
+        }
+
+        int r;
+        if (first == cpu) {
+            r = snprintf(out + pos, len - pos, "%s%u", pos ? "," : "", cpu);
+        } else {
+            r = snprintf(out + pos, len - pos, "%s%u-%u", pos ? "," : "",
+                         first, cpu);
+        }
+        if (r < 0 || (size_t) r >= len - pos) {
+            // truncated
+            return;
+        }
+        pos += r;
+        ++cpu;
+    }
+}
+
+void
+sc_thread_policy_configure(const struct sc_thread_policy *policies,
+                           unsigned count) {
+    sc_thread_policies = policies;
+    sc_thread_policy_count = count;
+}
+
+const struct sc_thread_policy *
+sc_thread_policy_find(const char *role) {
+    for (unsigned i = 0; i < sc_thread_policy_count; ++i) {
+        if (!strcmp(sc_thread_policies[i].role, role)) {
+            return &sc_thread_policies[i];
+        }
+    }
+    return NULL;
+}
+
+static const char *
+sc_thread_priority_name(enum sc_thread_priority priority) {
+    switch (priority) {
+        case SC_THREAD_PRIORITY_LOW:
+            return "low";
+        case SC_THREAD_PRIORITY_NORMAL:
+            return "normal";
+        case SC_THREAD_PRIORITY_HIGH:
+            return "high";
+        case SC_THREAD_PRIORITY_TIME_CRITICAL:
+            return "time-critical";
+        default:
+            assert(!"unexpected thread priority");
+            return "?";
+    }
+}
+
+#ifdef __linux__
+static bool
+sc_numa_node_cpus(int node, struct sc_cpu_set *set) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char buf[1024];
+    bool ok = fgets(buf, sizeof(buf), file);
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+
+    buf[strcspn(buf, "\n")] = '\0';
+    return sc_cpu_set_parse(buf, set);
+}
+
+static bool
+sc_thread_set_affinity(const struct sc_cpu_set *set) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (unsigned cpu = 0; cpu < SC_CPU_SET_MAX_CPUS && cpu < CPU_SETSIZE;
+            ++cpu) {
+        if (sc_cpu_set_contains(set, cpu)) {
+            CPU_SET(cpu, &cpuset);
+        }
+    }
+
+    // pid 0 is the calling thread
+    return !sched_setaffinity(0, sizeof(cpuset), &cpuset);
+}
+
+static bool
+sc_thread_get_affinity(struct sc_cpu_set *set) {
+    cpu_set_t cpuset;
+    if (sched_getaffinity(0, sizeof(cpuset), &cpuset)) {
+        return false;
+    }
+
+    memset(set, 0, sizeof(*set));
+    for (unsigned cpu = 0; cpu < SC_CPU_SET_MAX_CPUS && cpu < CPU_SETSIZE;
+            ++cpu) {
+        if (CPU_ISSET(cpu, &cpuset)) {
+            sc_cpu_set_add(set, cpu);
+        }
+    }
+    return true;
+}
+#endif
+
+void
+sc_thread_policy_apply(const struct sc_thread_policy *policy) {
+    const char *role = policy->role;
+
+#ifdef __linux__
+    struct sc_cpu_set cpus = policy->cpus;
+    if (policy->numa_node >= 0) {
+        struct sc_cpu_set node_cpus;
+        if (sc_numa_node_cpus(policy->numa_node, &node_cpus)) {
+            if (sc_cpu_set_is_empty(&cpus)) {
+                cpus = node_cpus;
+            } else {
+                for (size_t i = 0; i < ARRAY_LEN(cpus.bits); ++i) {
+                    cpus.bits[i] &= node_cpus.bits[i];
+                }
+                if (sc_cpu_set_is_empty(&cpus)) {
+                    LOGW("Thread '%s': no requested CPU on NUMA node %d",
+                         role, policy->numa_node);
+                    cpus = policy->cpus;
+                }
+            }
+        } else {
+            LOGW("Thread '%s': could not read the CPUs of NUMA node %d",
+                 role, policy->numa_node);
+        }
+    }
+
+    if (!sc_cpu_set_is_empty(&cpus) && !sc_thread_set_affinity(&cpus)) {
+        LOGW("Thread '%s': could not set CPU affinity", role);
+    }
+#else
+    if (!sc_cpu_set_is_empty(&policy->cpus) || policy->numa_node >= 0) {
+        LOGW("Thread '%s': CPU affinity is only supported on Linux", role);
+    }
+#endif
+
+    if (policy->has_priority && !sc_thread_force_priority(policy->priority)) {
+        LOGW("Thread '%s': could not set priority %s", role,
+             sc_thread_priority_name(policy->priority));
+    }
+
+    // Report the actual placement
+    const char *priority = policy->has_priority
+                         ? sc_thread_priority_name(policy->priority)
+                         : "default";
+#ifdef __linux__
+    char list[256] = "?";
+    struct sc_cpu_set actual;
+    if (sc_thread_get_affinity(&actual)) {
+        sc_cpu_set_format(&actual, list, sizeof(list));
+    }
+    LOGI("Thread '%s': CPUs %s (running on CPU %d), priority %s", role, list,
+         sched_getcpu(), priority);
+#else
+    LOGI("Thread '%s': priority %s", role, priority);
+#endif
+}
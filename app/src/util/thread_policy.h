@@ -0,0 +1,80 @@
+#ifndef SC_THREAD_POLICY_H
+#define SC_THREAD_POLICY_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/thread.h"
+
+#define SC_THREAD_POLICY_MAX 16
+#define SC_CPU_SET_MAX_CPUS 1024
+
+struct sc_cpu_set {
+    uint64_t bits[SC_CPU_SET_MAX_CPUS / 64];
+};
+
+/**
+ * Placement and scheduling policy for the threads having a given name (the
+ * name passed to sc_thread_create(), or "main" for the main thread)
+ */
+struct sc_thread_policy {
+    char role[16];
+    struct sc_cpu_set cpus; // empty = unchanged
+    int numa_node; // -1 = unchanged
+    bool has_priority;
+    enum sc_thread_priority priority;
+};
+
+static inline void
+sc_cpu_set_add(struct sc_cpu_set *set, unsigned cpu) {
+    assert(cpu < SC_CPU_SET_MAX_CPUS);
+    set->bits[cpu / 64] |= UINT64_C(1) << (cpu % 64);
+}
+
+static inline bool
+sc_cpu_set_contains(const struct sc_cpu_set *set, unsigned cpu) {
+    assert(cpu < SC_CPU_SET_MAX_CPUS);
+    return set->bits[cpu / 64] & (UINT64_C(1) << (cpu % 64));
+}
+
+bool
+sc_cpu_set_is_empty(const struct sc_cpu_set *set);
+
+/**
+ * Parse a CPU list, in the Linux cpuset format (e.g. "0-3,8,10-11")
+ */
+bool
+sc_cpu_set_parse(const char *s, struct sc_cpu_set *set);
+
+/**
+ * Format a CPU set as a CPU list (the output is truncated to fit)
+ */
+void
+sc_cpu_set_format(const struct sc_cpu_set *set, char *out, size_t len);
+
+/**
+ * Register the policies (the array must outlive the threads)
+ *
+ * It must be called before any thread is started.
+ */
+void
+sc_thread_policy_configure(const struct sc_thread_policy *policies,
+                           unsigned count);
+
+/**
+ * Return the policy for the given role, or NULL
+ */
+const struct sc_thread_policy *
+sc_thread_policy_find(const char *role);
+
+/**
+ * Apply the policy to the current thread, and log the actual placement
+ */
+void
+sc_thread_policy_apply(const struct sc_thread_policy *policy);
+
+#endif
@@ -0,0 +1,368 @@
+#include "thread.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+# include <sys/resource.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include "util/log.h"
+#include "util/thread_policy.h"
+#include "util/trace.h"
+
+// Threads implementation without SDL (for the headless build), with the same
+// behavior as the SDL implementation (thread.c)
+
+#ifndef __APPLE__
+// The conditions wait on the same clock as sc_tick_now()
+# define SC_COND_CLOCK_MONOTONIC
+#endif
+
+sc_thread_id SC_MAIN_THREAD_ID;
+
+// 0 is never a valid thread id (it is the locker of a free mutex)
+static atomic_uint sc_thread_next_id = 1;
+static _Thread_local sc_thread_id sc_thread_current_id;
+
+// Set once the priority is imposed by a thread policy
+static _Thread_local bool sc_thread_priority_forced;
+
+struct sc_thread_start {
+    sc_thread_fn *fn;
+    void *userdata;
+    const struct sc_thread_policy *policy;
+    sc_thread_id id;
+    char name[16];
+};
+
+static sc_thread_id
+sc_thread_new_id(void) {
+    return atomic_fetch_add_explicit(&sc_thread_next_id, 1,
+                                     memory_order_relaxed);
+}
+
+static void *
+run_thread(void *data) {
+    struct sc_thread_start *start = data;
+    sc_thread_fn *fn = start->fn;
+    void *userdata = start->userdata;
+    const struct sc_thread_policy *policy = start->policy;
+    sc_thread_current_id = start->id;
+
+#ifdef __APPLE__
+    pthread_setname_np(start->name);
+#else
+    pthread_setname_np(pthread_self(), start->name);
+#endif
+    free(start);
+
+    // Like the SDL threads, do not receive the signals handled by the main
+    // thread
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGQUIT);
+    sigaddset(&set, SIGPIPE);
+    sigaddset(&set, SIGALRM);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGCHLD);
+    sigaddset(&set, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    if (policy) {
+        sc_thread_policy_apply(policy);
+    }
+
+    int ret = fn(userdata);
+    return (void *) (intptr_t) ret;
+}
+
+bool
+sc_thread_create(sc_thread *thread, sc_thread_fn fn, const char *name,
+                 void *userdata) {
+    // The thread name length is limited on some systems. Never use a name
+    // longer than 16 bytes (including the final '\0')
+    assert(strlen(name) <= 15);
+
+    struct sc_thread_start *start = malloc(sizeof(*start));
+    if (!start) {
+        LOG_OOM();
+        return false;
+    }
+    start->fn = fn;
+    start->userdata = userdata;
+    // Applied from the new thread before running fn
+    start->policy = sc_thread_policy_find(name);
+    // Assigned by the creator, so that it is known before the thread starts
+    start->id = sc_thread_new_id();
+    snprintf(start->name, sizeof(start->name), "%s", name);
+
+    sc_thread_id id = start->id;
+
+    int r = pthread_create(&thread->thread, NULL, run_thread, start);
+    if (r) {
+        LOGE("Could not create thread %s: %s", name, strerror(r));
+        free(start);
+        return false;
+    }
+
+    if (sc_trace_enabled) {
+        sc_trace_set_thread_name(id, name);
+    }
+
+    return true;
+}
+
+#ifdef __linux__
+static int
+to_nice_value(enum sc_thread_priority priority) {
+    // Same values as SDL
+    switch (priority) {
+        case SC_THREAD_PRIORITY_TIME_CRITICAL:
+            return -20;
+        case SC_THREAD_PRIORITY_HIGH:
+            return -10;
+        case SC_THREAD_PRIORITY_NORMAL:
+            return 0;
+        case SC_THREAD_PRIORITY_LOW:
+            return 19;
+        default:
+            assert(!"Unknown thread priority");
+            return 0;
+    }
+}
+#endif
+
+bool
+sc_thread_set_priority(enum sc_thread_priority priority) {
+    if (sc_thread_priority_forced) {
+        // The thread policy takes precedence
+        return true;
+    }
+
+#ifdef __linux__
+    // On Linux, the nice value is per-thread
+    pid_t tid = syscall(SYS_gettid);
+    if (setpriority(PRIO_PROCESS, tid, to_nice_value(priority))) {
+        LOGD("Could not set thread priority: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+#else
+    (void) priority;
+    LOGD("Could not set thread priority: not supported");
+    return false;
+#endif
+}
+
+bool
+sc_thread_force_priority(enum sc_thread_priority priority) {
+    sc_thread_priority_forced = false;
+    bool ok = sc_thread_set_priority(priority);
+    sc_thread_priority_forced = true;
+    return ok;
+}
+
+void
+sc_thread_join(sc_thread *thread, int *status) {
+    void *ret;
+    int r = pthread_join(thread->thread, &ret);
+    if (r) {
+        LOGE("Could not join thread: %s", strerror(r));
+        abort();
+    }
+
+    if (status) {
+        *status = (int) (intptr_t) ret;
+    }
+}
+
+bool
+sc_mutex_init(sc_mutex *mutex) {
+    int r = pthread_mutex_init(&mutex->mutex, NULL);
+    if (r) {
+        LOG_OOM();
+        return false;
+    }
+
+#ifndef NDEBUG
+    atomic_init(&mutex->locker, 0);
+#endif
+    return true;
+}
+
+void
+sc_mutex_destroy(sc_mutex *mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+}
+
+void
+sc_mutex_lock(sc_mutex *mutex) {
+    assert(!sc_mutex_held(mutex));
+    int r = pthread_mutex_lock(&mutex->mutex);
+#ifndef NDEBUG
+    if (r) {
+        LOGE("Could not lock mutex: %s", strerror(r));
+        abort();
+    }
+
+    atomic_store_explicit(&mutex->locker, sc_thread_get_id(),
+                          memory_order_relaxed);
+#else
+    (void) r;
+#endif
+}
+
+void
+sc_mutex_unlock(sc_mutex *mutex) {
+#ifndef NDEBUG
+    assert(sc_mutex_held(mutex));
+    atomic_store_explicit(&mutex->locker, 0, memory_order_relaxed);
+#endif
+    int r = pthread_mutex_unlock(&mutex->mutex);
+#ifndef NDEBUG
+    if (r) {
+        LOGE("Could not unlock mutex: %s", strerror(r));
+        abort();
+    }
+#else
+    (void) r;
+#endif
+}
+
+sc_thread_id
+sc_thread_get_id(void) {
+    if (!sc_thread_current_id) {
+        // A thread not created by sc_thread_create() (e.g. the main thread)
+        sc_thread_current_id = sc_thread_new_id();
+    }
+    return sc_thread_current_id;
+}
+
+#ifndef NDEBUG
+bool
+sc_mutex_held(struct sc_mutex *mutex) {
+    sc_thread_id locker_id =
+        atomic_load_explicit(&mutex->locker, memory_order_relaxed);
+    return locker_id == sc_thread_get_id();
+}
+#endif
+
+bool
+sc_cond_init(sc_cond *cond) {
+    pthread_condattr_t attr;
+    int r = pthread_condattr_init(&attr);
+    if (r) {
+        LOG_OOM();
+        return false;
+    }
+
+#ifdef SC_COND_CLOCK_MONOTONIC
+    r = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    assert(!r);
+#endif
+
+    r = pthread_cond_init(&cond->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (r) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_cond_destroy(sc_cond *cond) {
+    pthread_cond_destroy(&cond->cond);
+}
+
+void
+sc_cond_wait(sc_cond *cond, sc_mutex *mutex) {
+    int r = pthread_cond_wait(&cond->cond, &mutex->mutex);
+#ifndef NDEBUG
+    if (r) {
+        LOGE("Could not wait on condition: %s", strerror(r));
+        abort();
+    }
+
+    atomic_store_explicit(&mutex->locker, sc_thread_get_id(),
+                          memory_order_relaxed);
+#else
+    (void) r;
+#endif
+}
+
+bool
+sc_cond_timedwait(sc_cond *cond, sc_mutex *mutex, sc_tick deadline) {
+    sc_tick now = sc_tick_now();
+    if (deadline <= now) {
+        return false; // timeout
+    }
+
+    struct timespec ts;
+#ifdef SC_COND_CLOCK_MONOTONIC
+    // The deadline is expressed in the clock of the condition
+    ts.tv_sec = SC_TICK_TO_SEC(deadline);
+    ts.tv_nsec = SC_TICK_TO_NS(deadline % SC_TICK_FREQ);
+#else
+    // Convert to the realtime clock, rounded up to the next millisecond to
+    // guarantee that the deadline is reached when returning due to timeout
+    clock_gettime(CLOCK_REALTIME, &ts);
+    sc_tick timeout = deadline - now + SC_TICK_FROM_MS(1);
+    sc_tick nsec = ts.tv_nsec + SC_TICK_TO_NS(timeout % SC_TICK_FREQ);
+    ts.tv_sec += SC_TICK_TO_SEC(timeout) + nsec / 1000000000;
+    ts.tv_nsec = nsec % 1000000000;
+#endif
+
+    int r = pthread_cond_timedwait(&cond->cond, &mutex->mutex, &ts);
+#ifndef NDEBUG
+    if (r && r != ETIMEDOUT) {
+        LOGE("Could not wait on condition with timeout: %s", strerror(r));
+        abort();
+    }
+
+    atomic_store_explicit(&mutex->locker, sc_thread_get_id(),
+                          memory_order_relaxed);
+#endif
+    assert(r == 0 || r == ETIMEDOUT);
+    // The deadline is reached on timeout
+    assert(r != ETIMEDOUT || sc_tick_now() >= deadline);
+    return r == 0;
+}
+
+void
+sc_cond_signal(sc_cond *cond) {
+    int r = pthread_cond_signal(&cond->cond);
+#ifndef NDEBUG
+    if (r) {
+        LOGE("Could not signal a condition: %s", strerror(r));
+        abort();
+    }
+#else
+    (void) r;
+#endif
+}
+
+void
+sc_cond_broadcast(sc_cond *cond) {
+    int r = pthread_cond_broadcast(&cond->cond);
+#ifndef NDEBUG
+    if (r) {
+        LOGE("Could not broadcast a condition: %s", strerror(r));
+        abort();
+    }
+#else
+    (void) r;
+#endif
+}
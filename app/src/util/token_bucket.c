@@ -0,0 +1,59 @@
+#include "token_bucket.h"
+
+#include <assert.h>
+
+void
+sc_token_bucket_init(struct sc_token_bucket *tb, uint64_t rate, uint64_t burst,
+                     sc_tick now) {
+    assert(rate);
+    assert(burst && burst <= INT64_MAX);
+    tb->rate = rate;
+    tb->burst = burst;
+    tb->tokens = burst;
+    tb->last = now;
+}
+
+static void
+sc_token_bucket_refill(struct sc_token_bucket *tb, sc_tick now) {
+    if (now <= tb->last) {
+        return;
+    }
+
+    // Avoid overflows on long idle periods: beyond this duration, the bucket
+    // is full anyway
+    uint64_t missing = tb->burst - tb->tokens;
+    uint64_t elapsed = now - tb->last;
+    if (elapsed >= missing * SC_TICK_FREQ / tb->rate + 1) {
+        tb->tokens = tb->burst;
+        tb->last = now;
+        return;
+    }
+
+    uint64_t added = elapsed * tb->rate / SC_TICK_FREQ;
+    if (!added) {
+        // Do not lose the fractional tokens: keep the last refill time
+        return;
+    }
+
+    tb->tokens += added;
+    if (tb->tokens > (int64_t) tb->burst) {
+        tb->tokens = tb->burst;
+    }
+    // Only account for the time corresponding to the added tokens
+    tb->last += added * SC_TICK_FREQ / tb->rate;
+}
+
+sc_tick
+sc_token_bucket_take(struct sc_token_bucket *tb, uint64_t n, sc_tick now) {
+    sc_token_bucket_refill(tb, now);
+
+    tb->tokens -= n;
+    if (tb->tokens >= 0) {
+        return now;
+    }
+
+    // Round up, so that the debt is paid at the deadline
+    uint64_t debt = -tb->tokens;
+    sc_tick wait = (debt * SC_TICK_FREQ + tb->rate - 1) / tb->rate;
+    return now + wait;
+}
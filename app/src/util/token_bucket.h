@@ -0,0 +1,32 @@
+#ifndef SC_TOKEN_BUCKET_H
+#define SC_TOKEN_BUCKET_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Token bucket, to limit a rate (for example in bytes per second) while
+// allowing bursts up to a given size
+//
+// Taking tokens never fails: if not enough tokens are available, the bucket
+// goes into debt, and the caller must wait until the returned deadline.
+struct sc_token_bucket {
+    uint64_t rate; // tokens per second
+    uint64_t burst; // capacity
+    int64_t tokens; // may be negative (debt)
+    sc_tick last; // last refill
+};
+
+// The bucket is initially full
+void
+sc_token_bucket_init(struct sc_token_bucket *tb, uint64_t rate, uint64_t burst,
+                     sc_tick now);
+
+// Take n tokens, and return the time when they are actually available (now
+// if they are available immediately)
+sc_tick
+sc_token_bucket_take(struct sc_token_bucket *tb, uint64_t n, sc_tick now);
+
+#endif
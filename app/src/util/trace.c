@@ -0,0 +1,368 @@
+#include "trace.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+# include <pthread.h>
+# include <signal.h>
+#endif
+
+#include "util/log.h"
+#include "util/tick.h"
+
+#define SC_TRACE_MAX_THREAD_NAMES 64
+
+struct sc_trace_event {
+    const char *name;
+    sc_tick ts;
+    char phase;
+};
+
+struct sc_trace_buffer {
+    struct sc_trace_buffer *next;
+    sc_thread_id tid;
+    // Only incremented by the owner thread, once the event is written, so
+    // that the buffer may be read concurrently
+    atomic_uint count;
+    struct sc_trace_event events[SC_TRACE_BUFFER_CAPACITY];
+};
+
+struct sc_trace_thread_name {
+    sc_thread_id tid;
+    char name[16];
+};
+
+bool sc_trace_enabled;
+
+static struct {
+    char *filename;
+    sc_tick start;
+
+    // Lock-free list of all the thread buffers
+    _Atomic(struct sc_trace_buffer *) buffers;
+    atomic_uint_least64_t dropped;
+
+    // Protects the thread names and the file writing
+    sc_mutex mutex;
+    struct sc_trace_thread_name names[SC_TRACE_MAX_THREAD_NAMES];
+    unsigned name_count;
+
+#ifndef _WIN32
+    bool signal_dump;
+    // Raw pthread, to be able to send it the signal on stop
+    pthread_t signal_thread;
+    atomic_bool stopped;
+    // Restored on destroy
+    struct sigaction old_action;
+    sigset_t old_mask;
+#endif
+} sc_trace;
+
+// Incremented by each sc_trace_init(), so that a thread never reuses a buffer
+// from a previous tracing session (freed by sc_trace_destroy())
+static unsigned sc_trace_generation;
+
+static _Thread_local struct sc_trace_buffer *sc_trace_local_buffer;
+static _Thread_local unsigned sc_trace_local_generation;
+
+void
+sc_trace_set_thread_name(sc_thread_id tid, const char *name) {
+    if (!sc_trace_enabled) {
+        return;
+    }
+
+    sc_mutex_lock(&sc_trace.mutex);
+    if (sc_trace.name_count < SC_TRACE_MAX_THREAD_NAMES) {
+        struct sc_trace_thread_name *tn =
+            &sc_trace.names[sc_trace.name_count++];
+        tn->tid = tid;
+        snprintf(tn->name, sizeof(tn->name), "%s", name);
+    }
+    sc_mutex_unlock(&sc_trace.mutex);
+}
+
+static struct sc_trace_buffer *
+sc_trace_buffer_new(void) {
+    struct sc_trace_buffer *buffer = malloc(sizeof(*buffer));
+    if (!buffer) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    buffer->tid = sc_thread_get_id();
+    atomic_init(&buffer->count, 0);
+
+    // Push to the list (the buffers are never removed until destroy)
+    struct sc_trace_buffer *head =
+        atomic_load_explicit(&sc_trace.buffers, memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&sc_trace.buffers, &head,
+                                                    buffer,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+
+    return buffer;
+}
+
+void
+sc_trace_push_(const char *name, char phase) {
+    sc_tick now = sc_tick_now();
+
+    struct sc_trace_buffer *buffer = sc_trace_local_buffer;
+    if (!buffer || sc_trace_local_generation != sc_trace_generation) {
+        buffer = sc_trace_buffer_new();
+        if (!buffer) {
+            atomic_fetch_add_explicit(&sc_trace.dropped, 1,
+                                      memory_order_relaxed);
+            return;
+        }
+        sc_trace_local_buffer = buffer;
+        sc_trace_local_generation = sc_trace_generation;
+    }
+
+    unsigned count =
+        atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    if (count == SC_TRACE_BUFFER_CAPACITY) {
+        atomic_fetch_add_explicit(&sc_trace.dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    struct sc_trace_event *event = &buffer->events[count];
+    event->name = name;
+    event->ts = now;
+    event->phase = phase;
+
+    // Publish the event
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+static void
+sc_trace_write_events(FILE *file) {
+    bool first = true;
+
+    for (unsigned i = 0; i < sc_trace.name_count; ++i) {
+        struct sc_trace_thread_name *tn = &sc_trace.names[i];
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                      "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", tn->tid, tn->name);
+        first = false;
+    }
+
+    struct sc_trace_buffer *buffer =
+        atomic_load_explicit(&sc_trace.buffers, memory_order_acquire);
+    for (; buffer; buffer = buffer->next) {
+        unsigned count =
+            atomic_load_explicit(&buffer->count, memory_order_acquire);
+        for (unsigned i = 0; i < count; ++i) {
+            struct sc_trace_event *event = &buffer->events[i];
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRItick
+                          ",\"pid\":1,\"tid\":%u}",
+                    first ? "" : ",", event->name, event->phase,
+                    event->ts - sc_trace.start, buffer->tid);
+            first = false;
+        }
+    }
+}
+
+static bool
+sc_trace_write(void) {
+    sc_mutex_lock(&sc_trace.mutex);
+
+    FILE *file = fopen(sc_trace.filename, "w");
+    if (!file) {
+        LOGE("Could not open trace file: %s", sc_trace.filename);
+        sc_mutex_unlock(&sc_trace.mutex);
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    sc_trace_write_events(file);
+    fputs("\n]}\n", file);
+
+    bool ok = !ferror(file);
+    if (fclose(file)) {
+        ok = false;
+    }
+
+    sc_mutex_unlock(&sc_trace.mutex);
+
+    if (!ok) {
+        LOGE("Could not write trace file: %s", sc_trace.filename);
+        return false;
+    }
+
+    uint64_t dropped =
+        atomic_load_explicit(&sc_trace.dropped, memory_order_relaxed);
+    if (dropped) {
+        LOGW("Trace: %" PRIu64 " events dropped (buffer full)", dropped);
+    }
+
+    LOGI("Trace written to %s", sc_trace.filename);
+    return true;
+}
+
+#ifndef _WIN32
+static void
+sc_trace_ignore_signal(int signum) {
+    // Only called if the signal is delivered to a thread which did not
+    // inherit the signal mask, ignore it
+    (void) signum;
+}
+
+static void *
+run_trace_signal(void *data) {
+    (void) data;
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+
+    for (;;) {
+        int sig;
+        if (sigwait(&set, &sig)) {
+            LOGE("Trace: could not wait for signal");
+            break;
+        }
+
+        if (atomic_load_explicit(&sc_trace.stopped, memory_order_relaxed)) {
+            break;
+        }
+
+        sc_trace_write();
+    }
+
+    return NULL;
+}
+
+static bool
+sc_trace_start_signal_thread(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sc_trace_ignore_signal;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGUSR1, &sa, &sc_trace.old_action)) {
+        LOGW("Trace: could not set SIGUSR1 handler");
+        return false;
+    }
+
+    // Block SIGUSR1 in the current thread, so that it is blocked in all the
+    // threads created afterwards, and only received by sigwait()
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    if (pthread_sigmask(SIG_BLOCK, &set, &sc_trace.old_mask)) {
+        LOGW("Trace: could not block SIGUSR1");
+        sigaction(SIGUSR1, &sc_trace.old_action, NULL);
+        return false;
+    }
+
+    atomic_init(&sc_trace.stopped, false);
+
+    if (pthread_create(&sc_trace.signal_thread, NULL, run_trace_signal,
+                       NULL)) {
+        LOGW("Trace: could not start signal thread");
+        pthread_sigmask(SIG_SETMASK, &sc_trace.old_mask, NULL);
+        sigaction(SIGUSR1, &sc_trace.old_action, NULL);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+sc_trace_stop_signal_thread(void) {
+    atomic_store_explicit(&sc_trace.stopped, true, memory_order_relaxed);
+    pthread_kill(sc_trace.signal_thread, SIGUSR1);
+    pthread_join(sc_trace.signal_thread, NULL);
+
+    // Consume a SIGUSR1 received in the meantime, so that it is not delivered
+    // to the previous handler once unblocked
+    sigset_t pending;
+    if (!sigpending(&pending) && sigismember(&pending, SIGUSR1)) {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        int sig;
+        sigwait(&set, &sig);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &sc_trace.old_mask, NULL);
+    sigaction(SIGUSR1, &sc_trace.old_action, NULL);
+}
+#endif
+
+bool
+sc_trace_init(const char *filename, bool signal_dump) {
+    assert(!sc_trace_enabled);
+
+    sc_trace.filename = strdup(filename);
+    if (!sc_trace.filename) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&sc_trace.mutex);
+    if (!ok) {
+        free(sc_trace.filename);
+        return false;
+    }
+
+    sc_trace.start = sc_tick_now();
+    atomic_init(&sc_trace.buffers, NULL);
+    atomic_init(&sc_trace.dropped, 0);
+    sc_trace.name_count = 0;
+    ++sc_trace_generation;
+
+    sc_trace_enabled = true;
+
+    sc_trace_set_thread_name(sc_thread_get_id(), "main");
+
+#ifndef _WIN32
+    sc_trace.signal_dump = signal_dump;
+    if (signal_dump) {
+        ok = sc_trace_start_signal_thread();
+        if (!ok) {
+            sc_trace_enabled = false;
+            sc_mutex_destroy(&sc_trace.mutex);
+            free(sc_trace.filename);
+            return false;
+        }
+    }
+#else
+    (void) signal_dump;
+#endif
+
+    return true;
+}
+
+void
+sc_trace_destroy(void) {
+    assert(sc_trace_enabled);
+
+#ifndef _WIN32
+    if (sc_trace.signal_dump) {
+        sc_trace_stop_signal_thread();
+    }
+#endif
+
+    sc_trace_write();
+
+    sc_trace_enabled = false;
+
+    struct sc_trace_buffer *buffer =
+        atomic_load_explicit(&sc_trace.buffers, memory_order_acquire);
+    while (buffer) {
+        struct sc_trace_buffer *next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    sc_trace_local_buffer = NULL;
+
+    sc_mutex_destroy(&sc_trace.mutex);
+    free(sc_trace.filename);
+}
@@ -0,0 +1,79 @@
+#ifndef SC_TRACE_H
+#define SC_TRACE_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "util/thread.h"
+
+/**
+ * Timeline tracing of the pipeline activity.
+ *
+ * Each thread records its begin/end events to its own buffer (allocated on
+ * first use), without any lock. On exit, all the events are written in the
+ * Chrome trace event format, which can be opened in chrome://tracing or
+ * <https://ui.perfetto.dev>.
+ *
+ * On POSIX systems, if requested on init, the events recorded so far may also
+ * be written at any time by sending SIGUSR1 to the process.
+ *
+ * When tracing is disabled, sc_trace_begin() and sc_trace_end() only test a
+ * global flag.
+ */
+
+// Maximum number of events per thread (further events are dropped)
+#define SC_TRACE_BUFFER_CAPACITY (1 << 16)
+
+// Set once by sc_trace_init(), before any other thread is started
+extern bool sc_trace_enabled;
+
+/**
+ * Enable tracing
+ *
+ * It must be called before any other thread is started.
+ *
+ * If signal_dump is set (POSIX only), a SIGUSR1 handler is installed for the
+ * whole process and SIGUSR1 is blocked in the calling thread (so in all the
+ * threads it creates afterwards). This must only be requested by the
+ * executable, which owns the process signal disposition.
+ */
+bool
+sc_trace_init(const char *filename, bool signal_dump);
+
+/**
+ * Write the recorded events to the file passed to sc_trace_init() and
+ * disable tracing
+ *
+ * It must be called from the thread which called sc_trace_init(), once all
+ * the traced threads are joined. The previous SIGUSR1 handler and signal mask
+ * are restored.
+ */
+void
+sc_trace_destroy(void);
+
+/**
+ * Associate a name to a thread (displayed in the timeline)
+ */
+void
+sc_trace_set_thread_name(sc_thread_id tid, const char *name);
+
+// The name must be a string literal (it is not copied nor escaped)
+void
+sc_trace_push_(const char *name, char phase);
+
+static inline void
+sc_trace_begin(const char *name) {
+    if (sc_trace_enabled) {
+        sc_trace_push_(name, 'B');
+    }
+}
+
+static inline void
+sc_trace_end(const char *name) {
+    if (sc_trace_enabled) {
+        sc_trace_push_(name, 'E');
+    }
+}
+
+#endif
@@ -378,4 +378,15 @@ sc_vecdeque_growsize_(size_t value)
 #define sc_vecdeque_pop(pv) \
     (*sc_vecdeque_popref(pv))
 
+/**
+ * Return a pointer to the item at index `i` (0 is the oldest item)
+ *
+ * It is an error to call this function if `i` is out of bounds.
+ */
+#define sc_vecdeque_at(pv, i) \
+({ \
+    assert((size_t) (i) < (pv)->size); \
+    &(pv)->data[((pv)->origin + (i)) % (pv)->cap]; \
+})
+
 #endif
@@ -0,0 +1,319 @@
+#include "websocket.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/sha1.h"
+#include "util/str.h"
+
+#define SC_WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define SC_WEBSOCKET_REQUEST_MAX_SIZE 4096
+// Control frames payload must not exceed 125 bytes
+#define SC_WEBSOCKET_MAX_CONTROL_PAYLOAD 125
+
+#define SC_WEBSOCKET_FIN 0x80
+#define SC_WEBSOCKET_MASK 0x80
+
+bool
+sc_websocket_compute_accept(const char *key,
+                            char accept[SC_WEBSOCKET_ACCEPT_SIZE]) {
+    struct sc_sha1 sha1;
+    sc_sha1_init(&sha1);
+    sc_sha1_update(&sha1, key, strlen(key));
+    sc_sha1_update(&sha1, SC_WEBSOCKET_GUID, sizeof(SC_WEBSOCKET_GUID) - 1);
+
+    uint8_t digest[SC_SHA1_DIGEST_SIZE];
+    sc_sha1_final(&sha1, digest);
+
+    char *base64 = sc_str_to_base64(digest, sizeof(digest));
+    if (!base64) {
+        return false;
+    }
+
+    assert(strlen(base64) == SC_WEBSOCKET_ACCEPT_SIZE - 1);
+    memcpy(accept, base64, SC_WEBSOCKET_ACCEPT_SIZE);
+    free(base64);
+
+    return true;
+}
+
+static bool
+sc_websocket_send_all(sc_socket socket, const void *data, size_t len) {
+    ssize_t w = net_send_all(socket, data, len);
+    return w >= 0 && (size_t) w == len;
+}
+
+bool
+sc_websocket_accept(sc_socket socket) {
+    char buf[SC_WEBSOCKET_REQUEST_MAX_SIZE];
+    size_t len = 0;
+
+    // The client must not send any frame before receiving the handshake
+    // response, so reading more than the request is not possible
+    for (;;) {
+        if (len == sizeof(buf) - 1) {
+            LOGW("WebSocket: handshake request too large");
+            return false;
+        }
+
+        ssize_t r = net_recv(socket, buf + len, sizeof(buf) - 1 - len);
+        if (r <= 0) {
+            return false;
+        }
+        len += r;
+        buf[len] = '\0';
+
+        if (strstr(buf, "\r\n\r\n")) {
+            break;
+        }
+    }
+
+    const char *key = NULL;
+    bool upgrade = false;
+    char *line = buf;
+    while (*line) {
+        char *eol = strstr(line, "\r\n");
+        if (!eol) {
+            break;
+        }
+        *eol = '\0';
+
+        const char *value;
+        if ((value = sc_str_header_value(line, "Sec-WebSocket-Key"))) {
+            key = value;
+        } else if ((value = sc_str_header_value(line, "Upgrade"))) {
+            char protocols[64];
+            sc_strncpy(protocols, value, sizeof(protocols));
+            for (char *c = protocols; *c; ++c) {
+                *c = tolower((unsigned char) *c);
+            }
+            upgrade = strstr(protocols, "websocket");
+        }
+
+        line = eol + 2;
+    }
+
+    if (strncmp(buf, "GET ", 4) || !upgrade || !key || !*key) {
+        LOGW("WebSocket: invalid handshake request");
+        static const char bad_request[] =
+            "HTTP/1.1 400 Bad Request\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n";
+        sc_websocket_send_all(socket, bad_request, sizeof(bad_request) - 1);
+        return false;
+    }
+
+    char accept[SC_WEBSOCKET_ACCEPT_SIZE];
+    if (!sc_websocket_compute_accept(key, accept)) {
+        return false;
+    }
+
+    char response[256];
+    int n = snprintf(response, sizeof(response),
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n"
+                     "\r\n", accept);
+    assert(n > 0 && (size_t) n < sizeof(response));
+
+    return sc_websocket_send_all(socket, response, n);
+}
+
+size_t
+sc_websocket_write_frame_header(uint8_t *buf, enum sc_websocket_opcode opcode,
+                                uint64_t len) {
+    buf[0] = SC_WEBSOCKET_FIN | opcode;
+    if (len < 126) {
+        buf[1] = len;
+        return 2;
+    }
+
+    if (len <= 0xFFFF) {
+        buf[1] = 126;
+        sc_write16be(&buf[2], len);
+        return 4;
+    }
+
+    buf[1] = 127;
+    sc_write64be(&buf[2], len);
+    return 10;
+}
+
+bool
+sc_websocket_send_binary(sc_socket socket, const void *header,
+                         size_t header_len, const void *data, size_t len) {
+    uint8_t frame_header[SC_WEBSOCKET_MAX_HEADER_SIZE];
+    size_t n = sc_websocket_write_frame_header(frame_header,
+                                               SC_WEBSOCKET_OPCODE_BINARY,
+                                               header_len + len);
+    // Write the whole frame at once
+    const struct sc_net_buf bufs[] = {
+        {frame_header, n},
+        {header, header_len},
+        {data, len},
+    };
+    size_t total = n + header_len + len;
+    ssize_t w = net_sendv_all(socket, bufs, ARRAY_LEN(bufs));
+    return w >= 0 && (size_t) w == total;
+}
+
+void
+sc_websocket_unmask(uint8_t *data, size_t len, const uint8_t mask[4],
+                    unsigned offset) {
+    for (size_t i = 0; i < len; ++i) {
+        data[i] ^= mask[(offset + i) % 4];
+    }
+}
+
+void
+sc_websocket_reader_init(struct sc_websocket_reader *reader,
+                         sc_socket socket) {
+    reader->socket = socket;
+    reader->remaining = 0;
+    reader->mask_offset = 0;
+    reader->send_mutex = NULL;
+}
+
+static bool
+sc_websocket_recv_all(sc_socket socket, void *buf, size_t len) {
+    ssize_t r = net_recv_all(socket, buf, len);
+    return r >= 0 && (size_t) r == len;
+}
+
+// Read a frame header, and return its opcode (or -1 on error or close)
+static int
+sc_websocket_read_frame_header(struct sc_websocket_reader *reader,
+                               uint64_t *payload_len) {
+    uint8_t header[2];
+    if (!sc_websocket_recv_all(reader->socket, header, 2)) {
+        return -1;
+    }
+
+    int opcode = header[0] & 0x0F;
+    if (!(header[1] & SC_WEBSOCKET_MASK)) {
+        // RFC 6455 section 5.1
+        LOGW("WebSocket: unmasked client frame");
+        return -1;
+    }
+
+    uint64_t len = header[1] & 0x7F;
+    if (len == 126) {
+        uint8_t ext[2];
+        if (!sc_websocket_recv_all(reader->socket, ext, 2)) {
+            return -1;
+        }
+        len = sc_read16be(ext);
+    } else if (len == 127) {
+        uint8_t ext[8];
+        if (!sc_websocket_recv_all(reader->socket, ext, 8)) {
+            return -1;
+        }
+        len = sc_read64be(ext);
+    }
+
+    if (!sc_websocket_recv_all(reader->socket, reader->mask, 4)) {
+        return -1;
+    }
+
+    reader->mask_offset = 0;
+    *payload_len = len;
+    return opcode;
+}
+
+static bool
+sc_websocket_reader_send_control(struct sc_websocket_reader *reader,
+                                 enum sc_websocket_opcode opcode,
+                                 const uint8_t *payload, size_t len) {
+    assert(len <= SC_WEBSOCKET_MAX_CONTROL_PAYLOAD);
+
+    // Send the whole frame at once, so that it is not interleaved with data
+    // sent by another thread
+    uint8_t frame[SC_WEBSOCKET_MAX_HEADER_SIZE
+                  + SC_WEBSOCKET_MAX_CONTROL_PAYLOAD];
+    size_t n = sc_websocket_write_frame_header(frame, opcode, len);
+    memcpy(frame + n, payload, len);
+
+    if (reader->send_mutex) {
+        sc_mutex_lock(reader->send_mutex);
+    }
+    bool ok = sc_websocket_send_all(reader->socket, frame, n + len);
+    if (reader->send_mutex) {
+        sc_mutex_unlock(reader->send_mutex);
+    }
+
+    return ok;
+}
+
+// Handle a control frame, return false if the connection must be closed
+static bool
+sc_websocket_handle_control_frame(struct sc_websocket_reader *reader,
+                                  int opcode, uint64_t len) {
+    if (len > SC_WEBSOCKET_MAX_CONTROL_PAYLOAD) {
+        LOGW("WebSocket: control frame too large");
+        return false;
+    }
+
+    uint8_t payload[SC_WEBSOCKET_MAX_CONTROL_PAYLOAD];
+    if (!sc_websocket_recv_all(reader->socket, payload, len)) {
+        return false;
+    }
+    sc_websocket_unmask(payload, len, reader->mask, 0);
+
+    if (opcode == SC_WEBSOCKET_OPCODE_PING) {
+        return sc_websocket_reader_send_control(reader,
+                                                SC_WEBSOCKET_OPCODE_PONG,
+                                                payload, len);
+    }
+
+    if (opcode == SC_WEBSOCKET_OPCODE_CLOSE) {
+        // Echo the status code, then close
+        sc_websocket_reader_send_control(reader, SC_WEBSOCKET_OPCODE_CLOSE,
+                                         payload, MIN(len, 2));
+        return false;
+    }
+
+    // Ignore pongs and unknown control frames
+    return true;
+}
+
+ssize_t
+sc_websocket_recv(struct sc_websocket_reader *reader, void *buf, size_t len) {
+    assert(len);
+
+    while (!reader->remaining) {
+        uint64_t payload_len;
+        int opcode = sc_websocket_read_frame_header(reader, &payload_len);
+        if (opcode < 0) {
+            return 0;
+        }
+
+        if (opcode & 0x8) {
+            if (!sc_websocket_handle_control_frame(reader, opcode,
+                                                   payload_len)) {
+                return 0;
+            }
+            continue;
+        }
+
+        // Data frame (possibly empty)
+        reader->remaining = payload_len;
+    }
+
+    size_t n = MIN(len, reader->remaining);
+    ssize_t r = net_recv(reader->socket, buf, n);
+    if (r <= 0) {
+        return r;
+    }
+
+    sc_websocket_unmask(buf, r, reader->mask, reader->mask_offset);
+    reader->mask_offset = (reader->mask_offset + r) % 4;
+    reader->remaining -= r;
+    return r;
+}
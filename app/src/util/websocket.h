@@ -0,0 +1,102 @@
+#ifndef SC_WEBSOCKET_H
+#define SC_WEBSOCKET_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+
+// Minimal server-side WebSocket (RFC 6455) support
+
+// 2 bytes + 8 bytes extended payload length (server frames are not masked)
+#define SC_WEBSOCKET_MAX_HEADER_SIZE 10
+
+// Length of the Sec-WebSocket-Accept value (base64 of a SHA-1), with the '\0'
+#define SC_WEBSOCKET_ACCEPT_SIZE 29
+
+enum sc_websocket_opcode {
+    SC_WEBSOCKET_OPCODE_CONTINUATION = 0x0,
+    SC_WEBSOCKET_OPCODE_TEXT = 0x1,
+    SC_WEBSOCKET_OPCODE_BINARY = 0x2,
+    SC_WEBSOCKET_OPCODE_CLOSE = 0x8,
+    SC_WEBSOCKET_OPCODE_PING = 0x9,
+    SC_WEBSOCKET_OPCODE_PONG = 0xA,
+};
+
+/**
+ * State to read the payload of data frames from a client
+ */
+struct sc_websocket_reader {
+    sc_socket socket;
+    uint64_t remaining; // remaining payload bytes in the current frame
+    uint8_t mask[4];
+    unsigned mask_offset;
+    // If not NULL, locked to reply to control frames (if another thread
+    // sends on the same socket), NULL by default
+    sc_mutex *send_mutex;
+};
+
+/**
+ * Compute the Sec-WebSocket-Accept value for a Sec-WebSocket-Key
+ *
+ * Return false on allocation failure.
+ */
+bool
+sc_websocket_compute_accept(const char *key,
+                            char accept[SC_WEBSOCKET_ACCEPT_SIZE]);
+
+/**
+ * Perform the server side of the opening handshake (read the HTTP upgrade
+ * request and reply)
+ */
+bool
+sc_websocket_accept(sc_socket socket);
+
+/**
+ * Write an unfragmented frame header for a payload of size `len`
+ *
+ * Return the number of bytes written (at most SC_WEBSOCKET_MAX_HEADER_SIZE).
+ */
+size_t
+sc_websocket_write_frame_header(uint8_t *buf, enum sc_websocket_opcode opcode,
+                                uint64_t len);
+
+/**
+ * Send a binary message as a single frame
+ *
+ * The payload is the concatenation of `header` and `data` (either may be
+ * empty), so that a message can be sent without copying it.
+ */
+bool
+sc_websocket_send_binary(sc_socket socket, const void *header,
+                         size_t header_len, const void *data, size_t len);
+
+/**
+ * Apply (or remove) the client-to-server masking
+ *
+ * `offset` is the position of `data` in the payload.
+ */
+void
+sc_websocket_unmask(uint8_t *data, size_t len, const uint8_t mask[4],
+                    unsigned offset);
+
+void
+sc_websocket_reader_init(struct sc_websocket_reader *reader,
+                         sc_socket socket);
+
+/**
+ * Read payload bytes from data frames (text, binary or continuation)
+ *
+ * Control frames are handled transparently (a ping is answered by a pong).
+ *
+ * Return the number of bytes read, 0 if the connection is closed (by a close
+ * frame or end-of-stream), or -1 on error.
+ */
+ssize_t
+sc_websocket_recv(struct sc_websocket_reader *reader, void *buf, size_t len);
+
+#endif
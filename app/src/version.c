@@ -10,17 +10,23 @@
 #ifdef HAVE_USB
 # include <libusb-1.0/libusb.h>
 #endif
-#include <SDL2/SDL_version.h>
+#ifdef HAVE_SDL
+# include <SDL2/SDL_version.h>
+#endif
 
 void
 scrcpy_print_version(void) {
     printf("\nDependencies (compiled / linked):\n");
 
+#ifdef HAVE_SDL
     SDL_version sdl;
     SDL_GetVersion(&sdl);
     printf(" - SDL: %u.%u.%u / %u.%u.%u\n",
            SDL_MAJOR_VERSION, SDL_MINOR_VERSION, SDL_PATCHLEVEL,
            (unsigned) sdl.major, (unsigned) sdl.minor, (unsigned) sdl.patch);
+#else
+    printf(" - SDL: none (headless build)\n");
+#endif
 
     unsigned avcodec = avcodec_version();
     printf(" - libavcodec: %u.%u.%u / %u.%u.%u\n",
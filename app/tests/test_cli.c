@@ -149,6 +149,210 @@ static void test_parse_shortcut_mods(void) {
     assert(!ok);
 }
 
+static void test_thread_policy(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {
+        "scrcpy",
+        "--thread-policy=video-demuxer:cpus=0-2,8:priority=high",
+        "--thread-policy=scrcpy-recorder:node=1",
+    };
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->thread_policy_count == 2);
+
+    const struct sc_thread_policy *policy = &opts->thread_policies[0];
+    assert(!strcmp(policy->role, "video-demuxer"));
+    assert(sc_cpu_set_contains(&policy->cpus, 0));
+    assert(sc_cpu_set_contains(&policy->cpus, 2));
+    assert(!sc_cpu_set_contains(&policy->cpus, 3));
+    assert(sc_cpu_set_contains(&policy->cpus, 8));
+    assert(policy->numa_node == -1);
+    assert(policy->has_priority);
+    assert(policy->priority == SC_THREAD_PRIORITY_HIGH);
+
+    char list[32];
+    sc_cpu_set_format(&policy->cpus, list, sizeof(list));
+    assert(!strcmp(list, "0-2,8"));
+
+    policy = &opts->thread_policies[1];
+    assert(!strcmp(policy->role, "scrcpy-recorder"));
+    assert(sc_cpu_set_is_empty(&policy->cpus));
+    assert(policy->numa_node == 1);
+    assert(!policy->has_priority);
+}
+
+static void test_thread_policy_invalid(void) {
+    const char *invalid[] = {
+        "--thread-policy=video-demuxer",
+        "--thread-policy=video-demuxer:",
+        "--thread-policy=:cpus=0",
+        "--thread-policy=video-demuxer:cpus=3-1",
+        "--thread-policy=video-demuxer:cpus=0,",
+        "--thread-policy=video-demuxer:priority=max",
+        "--thread-policy=video-demuxer:color=red",
+        "--thread-policy=a-very-long-thread-name:cpus=0",
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(invalid); ++i) {
+        struct scrcpy_cli_args args = {
+            .opts = scrcpy_options_default,
+            .help = false,
+            .version = false,
+        };
+
+        char *argv[] = {"scrcpy", (char *) invalid[i]};
+        bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+        assert(!ok);
+    }
+}
+
+static void test_tcp_pacing_rate(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--tcp-restream=8080", "--tcp-pacing-rate=20M"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.tcp_restream_port == 8080);
+    assert(args.opts.tcp_pacing_rate == 20000000);
+
+    // Pacing requires the restream server
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--tcp-pacing-rate=20M"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+#ifdef HAVE_SDL
+// Audio playback is not available in a headless build
+static void test_audio_raw_aggregation(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--audio-codec=raw",
+                    "--audio-raw-aggregation=60"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.audio_raw_aggregation == 60);
+    // The default audio buffer is increased
+    assert(args.opts.audio_buffer == SC_TICK_FROM_MS(110));
+
+    // Only for raw audio
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--audio-raw-aggregation=60"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+#endif
+
+#ifndef _WIN32
+static void test_headless(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--headless", "--tcp-restream=8080",
+                    "--tcp-control-forwarding=8081"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.headless);
+    assert(!args.opts.window);
+    assert(!args.opts.video_playback);
+    assert(!args.opts.audio_playback);
+    assert(args.opts.control);
+    assert(args.opts.mouse_input_mode == SC_MOUSE_INPUT_MODE_DISABLED);
+    assert(args.opts.gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_DISABLED);
+    assert(!args.opts.clipboard_autosync);
+
+    // No input device on the computer in headless mode
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--headless", "--tcp-restream=8080",
+                     "--keyboard=uhid"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+#endif
+
+static void test_resume(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--resume", "--no-window",
+                    "--tcp-restream=8080"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.resume);
+
+    // The UHID devices would be lost on resume
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--resume", "--keyboard=uhid"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_latency_test(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--no-window", "--latency-test=50",
+                    "--latency-test-event=key",
+                    "--latency-test-region=10:20:30:40"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    // The video is captured for the latency test only
+    assert(args.opts.video);
+    assert(args.opts.latency_test == 50);
+    assert(args.opts.latency_test_event == SC_LATENCY_TEST_EVENT_KEY);
+    assert(args.opts.latency_test_region.x == 10);
+    assert(args.opts.latency_test_region.y == 20);
+    assert(args.opts.latency_test_region.width == 30);
+    assert(args.opts.latency_test_region.height == 40);
+
+    // The events are injected via the controller
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--latency-test=50", "--no-control"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--latency-test-region=0:0:10:10"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv4[] = {"scrcpy", "--latency-test=50",
+                     "--latency-test-region=0:0:0:10"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv4), argv4);
+    assert(!ok);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -158,5 +362,16 @@ int main(int argc, char *argv[]) {
     test_options();
     test_options2();
     test_parse_shortcut_mods();
+    test_thread_policy();
+    test_thread_policy_invalid();
+    test_tcp_pacing_rate();
+    test_resume();
+    test_latency_test();
+#ifdef HAVE_SDL
+    test_audio_raw_aggregation();
+#endif
+#ifndef _WIN32
+    test_headless();
+#endif
     return 0;
 }
@@ -426,6 +426,33 @@ static void test_serialize_reset_video(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_set_video_config(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG,
+        .set_video_config = {
+            .max_size = 1024,
+            .max_fps = 30.5f,
+            .crop_width = 800,
+            .crop_height = 600,
+            .crop_x = 100,
+            .crop_y = 200,
+        },
+    };
+
+    uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+    size_t size = sc_control_msg_serialize(&msg, buf);
+    assert(size == 15);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG,
+        0x04, 0x00, // max size
+        0x41, 0xf4, 0x00, 0x00, // max fps (30.5f)
+        0x03, 0x20, 0x02, 0x58, // crop size 800x600
+        0x00, 0x64, 0x00, 0xc8, // crop offset 100:200
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -449,5 +476,6 @@ int main(int argc, char *argv[]) {
     test_serialize_uhid_destroy();
     test_serialize_open_hard_keyboard();
     test_serialize_reset_video();
+    test_serialize_set_video_config();
     return 0;
 }
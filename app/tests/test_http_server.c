@@ -0,0 +1,126 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/http_server.h"
+#include "util/net.h"
+
+static void
+on_request(struct sc_http_server *server, sc_socket socket, const char *path,
+           void *userdata) {
+    (void) server;
+    (void) userdata;
+
+    if (!strcmp(path, "/wait")) {
+        // Block until the server is stopped (the socket is interrupted)
+        char c;
+        net_recv(socket, &c, 1);
+        return;
+    }
+
+    // Echo the path
+    sc_http_send_response(socket, "200 OK", "text/plain", path, strlen(path));
+}
+
+static sc_socket
+connect_and_send(uint16_t port, const char *request) {
+    sc_socket socket = net_socket();
+    assert(socket != SC_SOCKET_NONE);
+    bool ok = net_connect(socket, IPV4_LOCALHOST, port);
+    assert(ok);
+    (void) ok;
+
+    size_t len = strlen(request);
+    ssize_t w = net_send_all(socket, request, len);
+    assert(w == (ssize_t) len);
+    (void) w;
+
+    return socket;
+}
+
+// Read until the connection is closed
+static size_t
+read_all(sc_socket socket, char *buf, size_t size) {
+    size_t len = 0;
+    for (;;) {
+        assert(len < size - 1);
+        ssize_t r = net_recv(socket, buf + len, size - 1 - len);
+        if (r <= 0) {
+            break;
+        }
+        len += r;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+static void test_http_server(void) {
+    bool ok = net_init();
+    assert(ok);
+
+    static const struct sc_http_server_callbacks cbs = {
+        .on_request = on_request,
+    };
+
+    const struct sc_http_server_params params = {
+        .name = "Test",
+        .thread_name = "test-http",
+        .client_thread_name = "test-http-cli",
+        .port = 0,
+        .max_clients = 2,
+    };
+
+    struct sc_http_server server;
+    ok = sc_http_server_init(&server, &params, &cbs, NULL);
+    assert(ok);
+    ok = sc_http_server_start(&server);
+    assert(ok);
+    uint16_t port = server.params.port;
+    assert(port);
+
+    char buf[1024];
+
+    // The query string is removed
+    sc_socket socket = connect_and_send(port, "GET /abc?x=1 HTTP/1.1\r\n"
+                                              "Host: localhost\r\n\r\n");
+    read_all(socket, buf, sizeof(buf));
+    assert(!strncmp(buf, "HTTP/1.1 200 OK\r\n", 17));
+    assert(strstr(buf, "Content-Length: 4\r\n"));
+    assert(!strcmp(strstr(buf, "\r\n\r\n") + 4, "/abc"));
+    net_close(socket);
+
+    // Only GET is supported, the connection is closed without response
+    socket = connect_and_send(port, "POST / HTTP/1.1\r\n\r\n");
+    size_t len = read_all(socket, buf, sizeof(buf));
+    assert(!len);
+    (void) len;
+    net_close(socket);
+
+    // The client slots are reused once the clients are disconnected
+    for (unsigned i = 0; i < 4; ++i) {
+        socket = connect_and_send(port, "GET /again HTTP/1.1\r\n\r\n");
+        read_all(socket, buf, sizeof(buf));
+        assert(!strcmp(strstr(buf, "\r\n\r\n") + 4, "/again"));
+        net_close(socket);
+    }
+
+    // A pending request must not block the stop
+    socket = connect_and_send(port, "GET /wait HTTP/1.1\r\n\r\n");
+
+    sc_http_server_stop(&server);
+    sc_http_server_join(&server);
+    sc_http_server_destroy(&server);
+
+    net_close(socket);
+    net_cleanup();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_http_server();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/latency_stats.h"
+
+static void test_single_sample(void) {
+    sc_tick samples[] = {42};
+
+    struct sc_latency_stats stats;
+    sc_latency_stats_compute(samples, ARRAY_LEN(samples), &stats);
+    assert(stats.count == 1);
+    assert(stats.min == 42);
+    assert(stats.max == 42);
+    assert(stats.mean == 42);
+    assert(stats.p50 == 42);
+    assert(stats.p99 == 42);
+}
+
+static void test_distribution(void) {
+    // 1 to 100, shuffled
+    sc_tick samples[100];
+    for (unsigned i = 0; i < 100; ++i) {
+        samples[i] = (i * 37) % 100 + 1;
+    }
+
+    struct sc_latency_stats stats;
+    sc_latency_stats_compute(samples, ARRAY_LEN(samples), &stats);
+    assert(stats.count == 100);
+    assert(stats.min == 1);
+    assert(stats.max == 100);
+    assert(stats.mean == 50); // 50.5, truncated
+    assert(stats.p50 == 50);
+    assert(stats.p90 == 90);
+    assert(stats.p95 == 95);
+    assert(stats.p99 == 99);
+
+    // Sorted in place
+    for (unsigned i = 0; i < 100; ++i) {
+        assert(samples[i] == i + 1);
+    }
+}
+
+static void test_nearest_rank(void) {
+    sc_tick samples[] = {10, 20, 30, 40};
+
+    assert(sc_latency_stats_percentile(samples, 4, 0) == 10);
+    assert(sc_latency_stats_percentile(samples, 4, 25) == 10);
+    assert(sc_latency_stats_percentile(samples, 4, 26) == 20);
+    assert(sc_latency_stats_percentile(samples, 4, 50) == 20);
+    assert(sc_latency_stats_percentile(samples, 4, 75) == 30);
+    assert(sc_latency_stats_percentile(samples, 4, 99) == 40);
+    assert(sc_latency_stats_percentile(samples, 4, 100) == 40);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_single_sample();
+    test_distribution();
+    test_nearest_rank();
+
+    return 0;
+}
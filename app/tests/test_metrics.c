@@ -0,0 +1,82 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "util/strbuf.h"
+
+static size_t
+count_occurrences(const char *s, const char *pattern) {
+    size_t count = 0;
+    size_t len = strlen(pattern);
+    while ((s = strstr(s, pattern))) {
+        ++count;
+        s += len;
+    }
+    return count;
+}
+
+static void test_metrics_values(void) {
+    sc_metrics_reset();
+
+    sc_metrics_add(SC_METRIC_DEMUXER_VIDEO_PACKETS, 1);
+    sc_metrics_add(SC_METRIC_DEMUXER_VIDEO_PACKETS, 2);
+    assert(sc_metrics_get(SC_METRIC_DEMUXER_VIDEO_PACKETS) == 3);
+
+    sc_metrics_set(SC_METRIC_TCP_SINK_QUEUE, 42);
+    sc_metrics_set(SC_METRIC_TCP_SINK_QUEUE, 7);
+    assert(sc_metrics_get(SC_METRIC_TCP_SINK_QUEUE) == 7);
+
+    sc_metrics_add(SC_METRIC_MJPEG_CLIENTS, 1);
+    sc_metrics_add(SC_METRIC_MJPEG_CLIENTS, -1);
+    assert(sc_metrics_get(SC_METRIC_MJPEG_CLIENTS) == 0);
+
+    sc_metrics_reset();
+    assert(sc_metrics_get(SC_METRIC_DEMUXER_VIDEO_PACKETS) == 0);
+    assert(sc_metrics_get(SC_METRIC_TCP_SINK_QUEUE) == 0);
+}
+
+static void test_metrics_format(void) {
+    sc_metrics_reset();
+
+    sc_metrics_add(SC_METRIC_DEMUXER_VIDEO_PACKETS, 12);
+    sc_metrics_add(SC_METRIC_DEMUXER_AUDIO_BYTES, 3456);
+    sc_metrics_set(SC_METRIC_CONTROLLER_QUEUE, 5);
+
+    struct sc_strbuf buf;
+    bool ok = sc_strbuf_init(&buf, 64);
+    assert(ok);
+
+    ok = sc_metrics_format(&buf);
+    assert(ok);
+
+    const char *s = buf.s;
+    assert(strstr(s, "scrcpy_demuxer_packets_total{stream=\"video\"} 12\n"));
+    assert(strstr(s, "scrcpy_demuxer_packets_total{stream=\"audio\"} 0\n"));
+    assert(strstr(s, "scrcpy_demuxer_bytes_total{stream=\"audio\"} 3456\n"));
+    assert(strstr(s, "scrcpy_controller_queue_messages 5\n"));
+    assert(strstr(s, "# TYPE scrcpy_demuxer_packets_total counter\n"));
+    assert(strstr(s, "# TYPE scrcpy_controller_queue_messages gauge\n"));
+
+    // HELP and TYPE are written once per metric name
+    assert(count_occurrences(s, "# TYPE scrcpy_demuxer_packets_total ") == 1);
+    assert(count_occurrences(s, "# HELP scrcpy_sink_queue_packets ") == 1);
+    assert(count_occurrences(s, "scrcpy_sink_queue_packets{") == 6);
+
+    // The output ends with a newline
+    assert(buf.len && s[buf.len - 1] == '\n');
+
+    free(buf.s);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_metrics_values();
+    test_metrics_format();
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "util/net.h"
+#include "util/net_reader.h"
+#include "util/thread.h"
+
+#define STREAM_LEN (1 << 20)
+
+static uint8_t
+expected_byte(size_t i) {
+    return i % 251;
+}
+
+static int
+run_sender(void *data) {
+    sc_socket socket = *(sc_socket *) data;
+
+    uint8_t *stream = malloc(STREAM_LEN);
+    assert(stream);
+    for (size_t i = 0; i < STREAM_LEN; ++i) {
+        stream[i] = expected_byte(i);
+    }
+
+    // Send in chunks of various sizes, unrelated to the read sizes
+    static const size_t chunks[] = {1, 7, 12, 1000, 70000, 5, 300000};
+    size_t sent = 0;
+    unsigned i = 0;
+    while (sent < STREAM_LEN) {
+        size_t len = chunks[i++ % ARRAY_LEN(chunks)];
+        if (len > STREAM_LEN - sent) {
+            len = STREAM_LEN - sent;
+        }
+        ssize_t w = net_send_all(socket, &stream[sent], len);
+        assert(w == (ssize_t) len);
+        (void) w;
+        sent += len;
+    }
+
+    free(stream);
+    net_close(socket);
+    return 0;
+}
+
+static void test_read(void) {
+    bool ok = net_init();
+    assert(ok);
+
+    sc_socket server = net_socket();
+    assert(server != SC_SOCKET_NONE);
+    ok = net_listen(server, IPV4_LOCALHOST, 0, 1);
+    assert(ok);
+    uint16_t port;
+    ok = net_get_local_port(server, &port);
+    assert(ok);
+
+    sc_socket client = net_socket();
+    assert(client != SC_SOCKET_NONE);
+    ok = net_connect(client, IPV4_LOCALHOST, port);
+    assert(ok);
+    sc_socket conn = net_accept(server);
+    assert(conn != SC_SOCKET_NONE);
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_sender, "test-sender", &conn);
+    assert(ok);
+
+    struct sc_net_reader reader;
+    ok = sc_net_reader_init(&reader, client);
+    assert(ok);
+
+    // Small reads (served from the read-ahead buffer) and large reads
+    // (received directly)
+    static const size_t reads[] = {12, 3, 12, 200, 12, 40000, 12, 100000, 1};
+    uint8_t *buf = malloc(100000);
+    assert(buf);
+    size_t offset = 0;
+    unsigned i = 0;
+    while (offset < STREAM_LEN) {
+        size_t len = reads[i++ % ARRAY_LEN(reads)];
+        if (len > STREAM_LEN - offset) {
+            len = STREAM_LEN - offset;
+        }
+        ok = sc_net_reader_read(&reader, buf, len);
+        assert(ok);
+        for (size_t j = 0; j < len; ++j) {
+            assert(buf[j] == expected_byte(offset + j));
+        }
+        offset += len;
+    }
+
+    // End of stream
+    ok = sc_net_reader_read(&reader, buf, 1);
+    assert(!ok);
+    (void) ok;
+
+    sc_thread_join(&thread, NULL);
+
+    free(buf);
+    sc_net_reader_destroy(&reader);
+    net_close(client);
+    net_close(server);
+    net_cleanup();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_read();
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/pixconv.h"
+
+static const enum sc_pixconv_impl impls[] = {
+    SC_PIXCONV_IMPL_SCALAR,
+    SC_PIXCONV_IMPL_SSE2,
+    SC_PIXCONV_IMPL_AVX2,
+    SC_PIXCONV_IMPL_NEON,
+};
+
+// Odd sizes and sizes around the SIMD block sizes (16 and 32 pixels)
+static const unsigned widths[] = {1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 64, 130};
+static const unsigned heights[] = {1, 2, 3, 5};
+
+struct test_image {
+    uint8_t *planes[3];
+    struct sc_pixconv_yuv420p yuv;
+};
+
+static uint32_t
+next_rand(uint32_t *state) {
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void
+test_image_init(struct test_image *image, unsigned width, unsigned height,
+                uint32_t seed) {
+    // Add padding, to check that the linesize is respected
+    size_t linesizes[3] = {width + 7, (width + 1) / 2 + 5, (width + 1) / 2 + 3};
+    unsigned plane_heights[3] = {height, (height + 1) / 2, (height + 1) / 2};
+
+    uint32_t state = seed;
+    for (unsigned i = 0; i < 3; ++i) {
+        size_t size = linesizes[i] * plane_heights[i];
+        image->planes[i] = malloc(size);
+        assert(image->planes[i]);
+        for (size_t j = 0; j < size; ++j) {
+            // Cover the whole byte range, including out of range values
+            image->planes[i][j] = next_rand(&state) >> 24;
+        }
+
+        image->yuv.data[i] = image->planes[i];
+        image->yuv.linesize[i] = linesizes[i];
+    }
+
+    image->yuv.width = width;
+    image->yuv.height = height;
+}
+
+static void
+test_image_destroy(struct test_image *image) {
+    for (unsigned i = 0; i < 3; ++i) {
+        free(image->planes[i]);
+    }
+}
+
+static void test_known_values(void) {
+    const uint8_t y[] = {16, 235, 126, 126, 81, 81};
+    const uint8_t u[] = {128, 128, 128};
+    const uint8_t v[] = {128, 128, 240};
+    struct sc_pixconv_yuv420p yuv = {
+        .data = {y, u, v},
+        .linesize = {sizeof(y), sizeof(u), sizeof(v)},
+        .width = 6,
+        .height = 1,
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(impls); ++i) {
+        if (!sc_pixconv_set_impl(impls[i])) {
+            continue;
+        }
+
+        uint8_t rgb[18];
+        sc_pixconv_to_rgb24(&yuv, rgb, sizeof(rgb));
+        // Black and white
+        assert(rgb[0] == 0 && rgb[1] == 0 && rgb[2] == 0);
+        assert(rgb[3] == 255 && rgb[4] == 255 && rgb[5] == 255);
+        // Gray: 110 * 255 / 219 = 128.08
+        assert(rgb[6] == 128 && rgb[7] == 128 && rgb[8] == 128);
+        // 1.164 * (81 - 16) + 1.596 * (240 - 128) = 254.4
+        assert(rgb[12] == 254);
+
+        uint8_t gray[6];
+        sc_pixconv_to_gray(y, sizeof(y), 6, 1, gray, sizeof(gray));
+        assert(gray[0] == 0);
+        assert(gray[1] == 255);
+        assert(gray[2] == 128); // 110 * 255 / 219 = 128.08
+    }
+
+    sc_pixconv_set_impl(SC_PIXCONV_IMPL_AUTO);
+}
+
+static void test_bit_exact(void) {
+    uint32_t seed = 0x12345678;
+
+    for (size_t w = 0; w < ARRAY_LEN(widths); ++w) {
+        for (size_t h = 0; h < ARRAY_LEN(heights); ++h) {
+            unsigned width = widths[w];
+            unsigned height = heights[h];
+            unsigned chroma_width = (width + 1) / 2;
+            unsigned chroma_height = (height + 1) / 2;
+
+            struct test_image image;
+            test_image_init(&image, width, height, seed++);
+
+            size_t rgb_linesize = 3 * width + 1;
+            size_t uv_linesize = 2 * chroma_width;
+            size_t rgb_size = rgb_linesize * height;
+            size_t y_size = width * height;
+            size_t uv_size = uv_linesize * chroma_height;
+
+            uint8_t *ref_rgb = malloc(rgb_size);
+            uint8_t *ref_y = malloc(y_size);
+            uint8_t *ref_uv = malloc(uv_size);
+            uint8_t *ref_gray = malloc(y_size);
+            uint8_t *rgb = malloc(rgb_size);
+            uint8_t *out_y = malloc(y_size);
+            uint8_t *uv = malloc(uv_size);
+            uint8_t *gray = malloc(y_size);
+            assert(ref_rgb && ref_y && ref_uv && ref_gray);
+            assert(rgb && out_y && uv && gray);
+
+            memset(ref_rgb, 0, rgb_size);
+            memset(rgb, 0, rgb_size);
+
+            bool ok = sc_pixconv_set_impl(SC_PIXCONV_IMPL_SCALAR);
+            assert(ok);
+            (void) ok;
+            sc_pixconv_to_rgb24(&image.yuv, ref_rgb, rgb_linesize);
+            sc_pixconv_to_nv12(&image.yuv, ref_y, width, ref_uv, uv_linesize);
+            sc_pixconv_to_gray(image.yuv.data[0], image.yuv.linesize[0], width,
+                               height, ref_gray, width);
+
+            for (size_t i = 0; i < ARRAY_LEN(impls); ++i) {
+                if (!sc_pixconv_set_impl(impls[i])) {
+                    continue;
+                }
+
+                sc_pixconv_to_rgb24(&image.yuv, rgb, rgb_linesize);
+                assert(!memcmp(rgb, ref_rgb, rgb_size));
+
+                sc_pixconv_to_nv12(&image.yuv, out_y, width, uv, uv_linesize);
+                assert(!memcmp(out_y, ref_y, y_size));
+                assert(!memcmp(uv, ref_uv, uv_size));
+
+                sc_pixconv_to_gray(image.yuv.data[0], image.yuv.linesize[0],
+                                   width, height, gray, width);
+                assert(!memcmp(gray, ref_gray, y_size));
+
+                // In place
+                for (unsigned row = 0; row < height; ++row) {
+                    memcpy(gray + row * width,
+                           image.yuv.data[0] + row * image.yuv.linesize[0],
+                           width);
+                }
+                sc_pixconv_to_gray(gray, width, width, height, gray, width);
+                assert(!memcmp(gray, ref_gray, y_size));
+            }
+
+            free(ref_rgb);
+            free(ref_y);
+            free(ref_uv);
+            free(ref_gray);
+            free(rgb);
+            free(out_y);
+            free(uv);
+            free(gray);
+            test_image_destroy(&image);
+        }
+    }
+
+    sc_pixconv_set_impl(SC_PIXCONV_IMPL_AUTO);
+}
+
+static void test_impl_selection(void) {
+    assert(sc_pixconv_supports(SC_PIXCONV_IMPL_SCALAR));
+
+    bool ok = sc_pixconv_set_impl(SC_PIXCONV_IMPL_SCALAR);
+    assert(ok);
+    assert(sc_pixconv_get_impl() == SC_PIXCONV_IMPL_SCALAR);
+
+    ok = sc_pixconv_set_impl(SC_PIXCONV_IMPL_AUTO);
+    assert(ok);
+    (void) ok;
+    assert(sc_pixconv_get_impl() != SC_PIXCONV_IMPL_AUTO);
+    assert(sc_pixconv_supports(sc_pixconv_get_impl()));
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_known_values();
+    test_bit_exact();
+    test_impl_selection();
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "rendition_cache.h"
+
+struct test_sink {
+    struct sc_frame_sink frame_sink;
+    unsigned pushed;
+};
+
+static bool
+test_sink_open(struct sc_frame_sink *sink, const AVCodecContext *ctx) {
+    (void) sink;
+    (void) ctx;
+    return true;
+}
+
+static void
+test_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+}
+
+static bool
+test_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    (void) frame;
+    struct test_sink *ts = container_of(sink, struct test_sink, frame_sink);
+    ++ts->pushed;
+    return true;
+}
+
+static const struct sc_frame_sink_ops test_sink_ops = {
+    .open = test_sink_open,
+    .close = test_sink_close,
+    .push = test_sink_push,
+};
+
+static AVFrame *
+new_frame(unsigned width, unsigned height, uint8_t y, uint8_t uv) {
+    AVFrame *frame = av_frame_alloc();
+    assert(frame);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    int ret = av_frame_get_buffer(frame, 0);
+    assert(!ret);
+    (void) ret;
+
+    for (unsigned row = 0; row < height; ++row) {
+        memset(frame->data[0] + row * frame->linesize[0], y, width);
+    }
+    for (unsigned row = 0; row < (height + 1) / 2; ++row) {
+        memset(frame->data[1] + row * frame->linesize[1], uv, (width + 1) / 2);
+        memset(frame->data[2] + row * frame->linesize[2], uv, (width + 1) / 2);
+    }
+    return frame;
+}
+
+static void test_compute_size(void) {
+    unsigned w;
+    unsigned h;
+
+    struct sc_rendition_spec spec = {
+        .max_size = 640,
+        .format = AV_PIX_FMT_YUV420P,
+    };
+    bool ok = sc_rendition_compute_size(&spec, 1080, 2400, &w, &h);
+    assert(ok);
+    assert(w == 288);
+    assert(h == 640);
+
+    spec.max_size = 0;
+    ok = sc_rendition_compute_size(&spec, 1080, 2400, &w, &h);
+    assert(ok);
+    assert(w == 1080);
+    assert(h == 2400);
+
+    spec.width = 224;
+    spec.height = 224;
+    ok = sc_rendition_compute_size(&spec, 1080, 2400, &w, &h);
+    assert(ok);
+    assert(w == 224);
+    assert(h == 224);
+
+    // No upscaling
+    ok = sc_rendition_compute_size(&spec, 200, 400, &w, &h);
+    assert(!ok);
+}
+
+static void test_shared_renditions(void) {
+    struct sc_rendition_cache cache;
+    bool ok = sc_rendition_cache_init(&cache);
+    assert(ok);
+
+    struct test_sink sink = {
+        .frame_sink = {.ops = &test_sink_ops},
+        .pushed = 0,
+    };
+    sc_frame_source_add_sink(&cache.frame_source, &sink.frame_sink);
+
+    AVFrame *frame = new_frame(64, 32, 100, 50);
+    ok = cache.frame_sink.ops->push(&cache.frame_sink, frame);
+    assert(ok);
+    assert(sink.pushed == 1);
+
+    sc_metrics_reset();
+
+    struct sc_rendition_spec spec = {
+        .max_size = 16,
+        .format = AV_PIX_FMT_YUV420P,
+    };
+
+    AVFrame *r1 = av_frame_alloc();
+    AVFrame *r2 = av_frame_alloc();
+    AVFrame *r3 = av_frame_alloc();
+    assert(r1 && r2 && r3);
+
+    ok = sc_rendition_cache_get(&cache, frame, &spec, r1);
+    assert(ok);
+    assert(r1->width == 16);
+    assert(r1->height == 8);
+    assert(r1->format == AV_PIX_FMT_YUV420P);
+    assert(r1->data[0][0] == 100);
+    assert(r1->data[1][0] == 50);
+
+    // The same rendition, requested with an equivalent spec, is shared
+    struct sc_rendition_spec spec2 = {
+        .width = 16,
+        .height = 8,
+        .format = AV_PIX_FMT_YUV420P,
+    };
+    ok = sc_rendition_cache_get(&cache, frame, &spec2, r2);
+    assert(ok);
+    assert(r2->data[0] == r1->data[0]);
+
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_COMPUTED) == 1);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_SHARED) == 1);
+
+    // A grayscale rendition is a distinct rendition (full range)
+    spec.format = AV_PIX_FMT_GRAY8;
+    ok = sc_rendition_cache_get(&cache, frame, &spec, r3);
+    assert(ok);
+    assert(r3->format == AV_PIX_FMT_GRAY8);
+    assert(r3->data[0] != r1->data[0]);
+    assert(r3->data[0][0] == 98); // (100 - 16) * 255 / 219 = 97.8
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_COMPUTED) == 2);
+
+    av_frame_unref(r2);
+    av_frame_unref(r3);
+
+    // An RGB24 rendition is converted from the (shared) YUV420P rendition
+    spec.format = AV_PIX_FMT_RGB24;
+    ok = sc_rendition_cache_get(&cache, frame, &spec, r2);
+    assert(ok);
+    assert(r2->format == AV_PIX_FMT_RGB24);
+    assert(r2->width == 16);
+    assert(r2->height == 8);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_COMPUTED) == 3);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_SHARED) == 2);
+
+    ok = sc_rendition_cache_get(&cache, frame, &spec, r3);
+    assert(ok);
+    assert(r3->data[0] == r2->data[0]);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_SHARED) == 3);
+
+    av_frame_unref(r1);
+    av_frame_unref(r2);
+    av_frame_unref(r3);
+
+    // The full-size YUV420P rendition is the decoded frame itself
+    spec.max_size = 0;
+    spec.format = AV_PIX_FMT_YUV420P;
+    ok = sc_rendition_cache_get(&cache, frame, &spec, r1);
+    assert(ok);
+    assert(r1->data[0] == frame->data[0]);
+    av_frame_unref(r1);
+
+    cache.frame_sink.ops->close(&cache.frame_sink);
+    sc_rendition_cache_destroy(&cache);
+
+    av_frame_free(&r1);
+    av_frame_free(&r2);
+    av_frame_free(&r3);
+    av_frame_free(&frame);
+}
+
+static void test_evicted_frame(void) {
+    struct sc_rendition_cache cache;
+    bool ok = sc_rendition_cache_init(&cache);
+    assert(ok);
+
+    struct test_sink sink = {
+        .frame_sink = {.ops = &test_sink_ops},
+        .pushed = 0,
+    };
+    sc_frame_source_add_sink(&cache.frame_source, &sink.frame_sink);
+
+    AVFrame *first = new_frame(32, 32, 10, 20);
+    ok = cache.frame_sink.ops->push(&cache.frame_sink, first);
+    assert(ok);
+
+    AVFrame *frames[SC_RENDITION_CACHE_FRAMES];
+    for (unsigned i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        frames[i] = new_frame(32, 32, i, i);
+        ok = cache.frame_sink.ops->push(&cache.frame_sink, frames[i]);
+        assert(ok);
+    }
+    assert(sink.pushed == SC_RENDITION_CACHE_FRAMES + 1);
+
+    sc_metrics_reset();
+
+    struct sc_rendition_spec spec = {
+        .max_size = 8,
+        .format = AV_PIX_FMT_YUV420P,
+    };
+
+    // The first frame has been evicted: its renditions are not cached
+    AVFrame *r1 = av_frame_alloc();
+    AVFrame *r2 = av_frame_alloc();
+    assert(r1 && r2);
+    ok = sc_rendition_cache_get(&cache, first, &spec, r1);
+    assert(ok);
+    ok = sc_rendition_cache_get(&cache, first, &spec, r2);
+    assert(ok);
+    assert(r1->data[0] != r2->data[0]);
+    assert(r1->data[0][0] == 10);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_COMPUTED) == 2);
+    assert(sc_metrics_get(SC_METRIC_RENDITIONS_SHARED) == 0);
+
+    av_frame_unref(r1);
+    av_frame_unref(r2);
+    av_frame_free(&r1);
+    av_frame_free(&r2);
+
+    cache.frame_sink.ops->close(&cache.frame_sink);
+    sc_rendition_cache_destroy(&cache);
+
+    for (unsigned i = 0; i < SC_RENDITION_CACHE_FRAMES; ++i) {
+        av_frame_free(&frames[i]);
+    }
+    av_frame_free(&first);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_compute_size();
+    test_shared_renditions();
+    test_evicted_frame();
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "restream_client.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+#define FLAG_CONFIG    (UINT64_C(1) << 63)
+#define FLAG_KEY_FRAME (UINT64_C(1) << 62)
+
+struct test_server {
+    sc_socket server_socket;
+    uint16_t port;
+};
+
+static void
+send_codec_info(sc_socket socket, uint32_t width, uint32_t height) {
+    uint8_t buf[12];
+    sc_write32be(buf, SC_RESTREAM_CODEC_ID_H264);
+    sc_write32be(&buf[4], width);
+    sc_write32be(&buf[8], height);
+    bool ok = net_send_all(socket, buf, sizeof(buf));
+    assert(ok);
+}
+
+static void
+send_packet(sc_socket socket, uint64_t pts_flags, uint8_t value, size_t len) {
+    uint8_t header[12];
+    sc_write64be(header, pts_flags);
+    sc_write32be(&header[8], len);
+    bool ok = net_send_all(socket, header, sizeof(header));
+    assert(ok);
+
+    // Send the payload byte by byte, so that the client receives it in
+    // several chunks
+    for (size_t i = 0; i < len; ++i) {
+        ok = net_send_all(socket, &value, 1);
+        assert(ok);
+    }
+}
+
+static void
+send_session(sc_socket socket, uint32_t width, uint32_t height) {
+    uint8_t buf[24];
+    sc_write64be(buf, FLAG_CONFIG | FLAG_KEY_FRAME);
+    sc_write32be(&buf[8], 12);
+    sc_write32be(&buf[12], SC_RESTREAM_CODEC_ID_H264);
+    sc_write32be(&buf[16], width);
+    sc_write32be(&buf[20], height);
+    bool ok = net_send_all(socket, buf, sizeof(buf));
+    assert(ok);
+}
+
+static int
+run_server(void *data) {
+    struct test_server *server = data;
+
+    // First connection
+    sc_socket socket = net_accept(server->server_socket);
+    assert(socket != SC_SOCKET_NONE);
+
+    send_codec_info(socket, 1080, 1920);
+    send_packet(socket, 1000, 0x10, 100); // skipped (no key frame yet)
+    send_packet(socket, FLAG_CONFIG, 0x11, 20);
+    send_packet(socket, FLAG_KEY_FRAME | 2000, 0x12, 3000);
+    send_packet(socket, 3000, 0x13, 50);
+    send_session(socket, 1920, 1080);
+    send_packet(socket, 4000, 0x14, 10); // skipped (new session)
+    send_packet(socket, FLAG_CONFIG, 0x15, 20);
+    send_packet(socket, FLAG_KEY_FRAME | 5000, 0x16, 200);
+    send_packet(socket, 6000, 0x17, 60);
+    net_close(socket);
+
+    // Reconnection
+    socket = net_accept(server->server_socket);
+    assert(socket != SC_SOCKET_NONE);
+
+    send_codec_info(socket, 1920, 1080);
+    send_packet(socket, 7000, 0x18, 10); // skipped (new connection)
+    send_packet(socket, FLAG_KEY_FRAME | 8000, 0x19, 30);
+    net_close(socket);
+
+    return 0;
+}
+
+static void
+assert_packet(struct sc_restream_client *client, int64_t pts, bool config,
+              bool key_frame, uint8_t value, size_t len) {
+    struct sc_restream_packet packet;
+    enum sc_restream_status status =
+        sc_restream_client_read_packet(client, &packet);
+    assert(status == SC_RESTREAM_OK);
+    assert(packet.pts == pts);
+    assert(packet.config == config);
+    assert(packet.key_frame == key_frame);
+    assert(packet.size == len);
+    for (size_t i = 0; i < len; ++i) {
+        assert(packet.data[i] == value);
+    }
+}
+
+static void test_read_packets(void) {
+    struct test_server server;
+    server.server_socket = net_socket();
+    assert(server.server_socket != SC_SOCKET_NONE);
+
+    bool ok = net_listen(server.server_socket, IPV4_LOCALHOST, 0, 1);
+    assert(ok);
+    ok = net_get_local_port(server.server_socket, &server.port);
+    assert(ok);
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_server, "test-server", &server);
+    assert(ok);
+
+    struct sc_restream_client_params params = {
+        .host = "127.0.0.1",
+        .port = server.port,
+        .reconnect = true,
+        .max_reconnect_delay_ms = 100,
+        .decode = false,
+    };
+    struct sc_restream_client *client = sc_restream_client_open(&params);
+    assert(client);
+
+    struct sc_restream_info info;
+    sc_restream_client_get_info(client, &info);
+    assert(info.codec_id == SC_RESTREAM_CODEC_ID_H264);
+    assert(info.width == 1080);
+    assert(info.height == 1920);
+    assert(info.session == 1);
+
+    assert_packet(client, -1, true, false, 0x11, 20);
+    assert_packet(client, 2000, false, true, 0x12, 3000);
+    assert_packet(client, 3000, false, false, 0x13, 50);
+
+    assert_packet(client, -1, true, false, 0x15, 20);
+    sc_restream_client_get_info(client, &info);
+    assert(info.width == 1920);
+    assert(info.height == 1080);
+    assert(info.session == 2);
+
+    assert_packet(client, 5000, false, true, 0x16, 200);
+    assert_packet(client, 6000, false, false, 0x17, 60);
+
+    // The connection is closed, the client reconnects
+    assert_packet(client, 8000, false, true, 0x19, 30);
+    sc_restream_client_get_info(client, &info);
+    assert(info.session == 3);
+
+    struct sc_restream_stats stats;
+    sc_restream_client_get_stats(client, &stats);
+    assert(stats.packets == 10);
+    assert(stats.skipped == 3);
+    assert(stats.reconnections == 1);
+
+    sc_thread_join(&thread, NULL);
+
+    // No more connection: interrupt the reconnection attempts
+    sc_restream_client_interrupt(client);
+    struct sc_restream_packet packet;
+    enum sc_restream_status status =
+        sc_restream_client_read_packet(client, &packet);
+    assert(status == SC_RESTREAM_INTERRUPTED);
+
+    sc_restream_client_close(client);
+    net_close(server.server_socket);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    test_read_packets();
+
+    net_cleanup();
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "rtp.h"
+#include "util/binary.h"
+
+#define MAX_PACKETS 16
+
+struct capture {
+    unsigned count;
+    uint8_t packets[MAX_PACKETS][SC_RTP_HEADER_SIZE + SC_RTP_MAX_PAYLOAD_SIZE];
+    size_t lens[MAX_PACKETS];
+};
+
+static bool
+capture_packet(uint8_t *packet, size_t len, void *userdata) {
+    struct capture *c = userdata;
+    assert(c->count < MAX_PACKETS);
+    assert(len <= SC_RTP_HEADER_SIZE + SC_RTP_MAX_PAYLOAD_SIZE);
+
+    // The interleaved header bytes must be writable
+    memset(packet - SC_RTP_INTERLEAVED_HEADER_SIZE, 0,
+           SC_RTP_INTERLEAVED_HEADER_SIZE);
+
+    memcpy(c->packets[c->count], packet, len);
+    c->lens[c->count] = len;
+    ++c->count;
+    return true;
+}
+
+static bool
+marker(const uint8_t *packet) {
+    return packet[1] & 0x80;
+}
+
+static void test_next_nal(void) {
+    const uint8_t data[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, // 4-byte start code
+        0x00, 0x00, 0x01, 0x68, 0xce, 0x00, // 3-byte start code, trailing 0
+        0x00, 0x00, 0x01, 0x00, 0x00, 0x01, // empty NAL unit
+        0x65, 0x88, 0x84,
+    };
+
+    const uint8_t *p = data;
+    const uint8_t *end = data + sizeof(data);
+    size_t len;
+
+    const uint8_t *nal = sc_rtp_next_nal(&p, end, &len);
+    assert(nal == &data[4]);
+    assert(len == 2);
+
+    nal = sc_rtp_next_nal(&p, end, &len);
+    assert(nal == &data[9]);
+    assert(len == 2);
+
+    nal = sc_rtp_next_nal(&p, end, &len);
+    assert(nal == &data[18]);
+    assert(len == 3);
+
+    nal = sc_rtp_next_nal(&p, end, &len);
+    assert(!nal);
+}
+
+static void test_h264_fu_a(void) {
+    // SPS + PPS + IDR slice requiring 3 fragments
+    uint8_t data[4 + 4 + 4 + 4 + 3000];
+    size_t i = 0;
+    memcpy(&data[i], "\x00\x00\x00\x01\x67\x42\xc0\x1f", 8);
+    i += 8;
+    memcpy(&data[i], "\x00\x00\x00\x01\x68\xce", 6);
+    i += 6;
+    memcpy(&data[i], "\x00\x00\x01\x65", 4);
+    i += 4;
+    size_t idr_payload = sizeof(data) - i;
+    memset(&data[i], 0x42, idr_payload);
+
+    struct sc_rtp_packetizer p;
+    sc_rtp_packetizer_init(&p, AV_CODEC_ID_H264, 96, 90000, 0x12345678,
+                           1000, 0);
+
+    struct capture c = {0};
+    bool ok = sc_rtp_packetize(&p, data, sizeof(data), 1000000,
+                               capture_packet, &c);
+    assert(ok);
+    assert(c.count == 5);
+
+    for (unsigned k = 0; k < c.count; ++k) {
+        const uint8_t *pkt = c.packets[k];
+        assert(pkt[0] == 0x80);
+        assert((pkt[1] & 0x7f) == 96);
+        assert(sc_read16be(&pkt[2]) == 1000 + k);
+        assert(sc_read32be(&pkt[4]) == 90000); // 1 second
+        assert(sc_read32be(&pkt[8]) == 0x12345678);
+        // Only the last packet of the access unit has the marker bit
+        assert(marker(pkt) == (k == c.count - 1));
+    }
+
+    // SPS and PPS as single NAL unit packets
+    assert(c.lens[0] == SC_RTP_HEADER_SIZE + 4);
+    assert(c.packets[0][SC_RTP_HEADER_SIZE] == 0x67);
+    assert(c.lens[1] == SC_RTP_HEADER_SIZE + 2);
+    assert(c.packets[1][SC_RTP_HEADER_SIZE] == 0x68);
+
+    // FU-A: indicator (NRI from the NAL header, type 28), then FU header
+    size_t total = 0;
+    for (unsigned k = 2; k < 5; ++k) {
+        const uint8_t *payload = &c.packets[k][SC_RTP_HEADER_SIZE];
+        assert(payload[0] == ((0x65 & 0xe0) | 28));
+        uint8_t fu_header = payload[1];
+        assert((fu_header & 0x1f) == 5);
+        assert(!!(fu_header & 0x80) == (k == 2)); // start
+        assert(!!(fu_header & 0x40) == (k == 4)); // end
+        total += c.lens[k] - SC_RTP_HEADER_SIZE - 2;
+    }
+    assert(total == idr_payload);
+}
+
+static void test_h265_fu(void) {
+    uint8_t data[3 + 2 + 2000];
+    memcpy(data, "\x00\x00\x01\x26\x01", 5); // IDR_W_RADL
+    memset(&data[5], 0x11, sizeof(data) - 5);
+
+    struct sc_rtp_packetizer p;
+    sc_rtp_packetizer_init(&p, AV_CODEC_ID_HEVC, 96, 90000, 1, 0, 10);
+
+    struct capture c = {0};
+    bool ok = sc_rtp_packetize(&p, data, sizeof(data), 0, capture_packet, &c);
+    assert(ok);
+    assert(c.count == 2);
+
+    for (unsigned k = 0; k < 2; ++k) {
+        const uint8_t *payload = &c.packets[k][SC_RTP_HEADER_SIZE];
+        assert(sc_read32be(&c.packets[k][4]) == 10); // ts_offset
+        assert(((payload[0] >> 1) & 0x3f) == 49);
+        assert(payload[1] == 0x01);
+        assert((payload[2] & 0x3f) == 19);
+    }
+    assert(c.packets[0][SC_RTP_HEADER_SIZE + 2] & 0x80);
+    assert(c.packets[1][SC_RTP_HEADER_SIZE + 2] & 0x40);
+    assert(!marker(c.packets[0]));
+    assert(marker(c.packets[1]));
+}
+
+static void test_aac(void) {
+    uint8_t data[300];
+    memset(data, 0x21, sizeof(data));
+
+    struct sc_rtp_packetizer p;
+    sc_rtp_packetizer_init(&p, AV_CODEC_ID_AAC, 97, 48000, 2, 0, 0);
+
+    struct capture c = {0};
+    bool ok = sc_rtp_packetize(&p, data, sizeof(data), 20000, capture_packet,
+                               &c);
+    assert(ok);
+    assert(c.count == 1);
+    assert(c.lens[0] == SC_RTP_HEADER_SIZE + 4 + sizeof(data));
+    assert(marker(c.packets[0]));
+    assert(sc_read32be(&c.packets[0][4]) == 960); // 20ms at 48kHz
+
+    const uint8_t *payload = &c.packets[0][SC_RTP_HEADER_SIZE];
+    assert(sc_read16be(&payload[0]) == 16);
+    assert(sc_read16be(&payload[2]) >> 3 == sizeof(data));
+    assert((sc_read16be(&payload[2]) & 0x7) == 0);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_next_nal();
+    test_h264_fu_a();
+    test_h265_fu();
+    test_aac();
+    return 0;
+}
@@ -0,0 +1,350 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "rtsp_sink.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define FLOOD_FRAMES 400
+#define FLOOD_FRAME_SIZE 65536
+#define MARKER_SIZE 100
+#define MARKER_BYTE 0xAB
+
+struct test_reader {
+    sc_socket socket;
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool found; // the marker frame has been received
+};
+
+static void
+send_str(sc_socket socket, const char *s) {
+    size_t len = strlen(s);
+    ssize_t w = net_send_all(socket, s, len);
+    assert(w == (ssize_t) len);
+    (void) w;
+}
+
+// Read a response (headers and body) into buf, and return its status code
+static int
+read_response(sc_socket socket, char *buf, size_t size) {
+    size_t len = 0;
+    while (len < 4 || memcmp(&buf[len - 4], "\r\n\r\n", 4)) {
+        assert(len < size - 1);
+        ssize_t r = net_recv_all(socket, &buf[len], 1);
+        assert(r == 1);
+        (void) r;
+        ++len;
+    }
+    buf[len] = '\0';
+
+    const char *cl = strstr(buf, "Content-Length: ");
+    if (cl) {
+        size_t body_len = strtoul(cl + 16, NULL, 10);
+        assert(len + body_len < size);
+        ssize_t r = net_recv_all(socket, &buf[len], body_len);
+        assert(r == (ssize_t) body_len);
+        (void) r;
+        buf[len + body_len] = '\0';
+    }
+
+    int status = 0;
+    sscanf(buf, "RTSP/1.0 %d", &status);
+    return status;
+}
+
+// Connect a client playing the video over interleaved TCP
+static sc_socket
+connect_client(uint16_t port) {
+    sc_socket socket = net_socket();
+    assert(socket != SC_SOCKET_NONE);
+    bool ok = net_connect(socket, IPV4_LOCALHOST, port);
+    assert(ok);
+    (void) ok;
+
+    char req[512];
+    char resp[2048];
+
+    snprintf(req, sizeof(req), "DESCRIBE rtsp://127.0.0.1:%" PRIu16 "/ "
+                               "RTSP/1.0\r\nCSeq: 1\r\n\r\n", port);
+    send_str(socket, req);
+    int status = read_response(socket, resp, sizeof(resp));
+    assert(status == 200);
+    assert(strstr(resp, "H264/90000"));
+
+    snprintf(req, sizeof(req), "SETUP rtsp://127.0.0.1:%" PRIu16 "/trackID=0 "
+                               "RTSP/1.0\r\nCSeq: 2\r\n"
+                               "Transport: RTP/AVP/TCP;unicast;"
+                               "interleaved=0-1\r\n\r\n", port);
+    send_str(socket, req);
+    status = read_response(socket, resp, sizeof(resp));
+    assert(status == 200);
+
+    char session[32];
+    const char *s = strstr(resp, "Session: ");
+    assert(s);
+    int n = sscanf(s + 9, "%31[0-9A-F]", session);
+    assert(n == 1);
+    (void) n;
+
+    snprintf(req, sizeof(req), "PLAY rtsp://127.0.0.1:%" PRIu16 "/ "
+                               "RTSP/1.0\r\nCSeq: 3\r\nSession: %s\r\n\r\n",
+             port, session);
+    send_str(socket, req);
+    status = read_response(socket, resp, sizeof(resp));
+    assert(status == 200);
+    (void) status;
+
+    return socket;
+}
+
+static int
+run_reader(void *data) {
+    struct test_reader *reader = data;
+
+    uint8_t frame[65536];
+    for (;;) {
+        uint8_t header[SC_RTP_INTERLEAVED_HEADER_SIZE];
+        ssize_t r = net_recv_all(reader->socket, header, sizeof(header));
+        if (r != sizeof(header)) {
+            break;
+        }
+        assert(header[0] == '$');
+        assert(header[1] == 0);
+
+        uint16_t len = sc_read16be(&header[2]);
+        r = net_recv_all(reader->socket, frame, len);
+        if (r != len) {
+            break;
+        }
+
+        // The marker NAL fits in a single RTP packet (after the 12-byte RTP
+        // header)
+        if (len == 12 + MARKER_SIZE && frame[12] == 0x65
+                && frame[13] == MARKER_BYTE && frame[len - 1] == MARKER_BYTE) {
+            sc_mutex_lock(&reader->mutex);
+            reader->found = true;
+            sc_cond_signal(&reader->cond);
+            sc_mutex_unlock(&reader->mutex);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void
+push_frame(struct sc_rtsp_sink *sink, int64_t pts, uint8_t fill, size_t size) {
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+    int ret = av_new_packet(packet, 4 + size);
+    assert(!ret);
+    (void) ret;
+
+    static const uint8_t start_code[] = {0, 0, 0, 1};
+    memcpy(packet->data, start_code, 4);
+    packet->data[4] = 0x65; // IDR slice
+    memset(&packet->data[5], fill, size - 1);
+    packet->pts = pts;
+    packet->dts = pts;
+    packet->flags = AV_PKT_FLAG_KEY;
+
+    struct sc_packet_sink *ps = &sink->video_packet_sink;
+    bool ok = ps->ops->push(ps, packet);
+    assert(ok);
+    (void) ok;
+
+    av_packet_free(&packet);
+}
+
+static void
+sleep_ms(unsigned ms) {
+    sc_mutex mutex;
+    sc_cond cond;
+    bool ok = sc_mutex_init(&mutex);
+    assert(ok);
+    ok = sc_cond_init(&cond);
+    assert(ok);
+    (void) ok;
+
+    sc_tick deadline = sc_tick_now() + SC_TICK_FROM_MS(ms);
+    sc_mutex_lock(&mutex);
+    while (sc_tick_now() < deadline) {
+        sc_cond_timedwait(&cond, &mutex, deadline);
+    }
+    sc_mutex_unlock(&mutex);
+
+    sc_cond_destroy(&cond);
+    sc_mutex_destroy(&mutex);
+}
+
+// Open the video track with an H.264 stream, and push its config packet
+static AVCodecContext *
+open_video(struct sc_rtsp_sink *sink) {
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    assert(ctx);
+    ctx->codec_type = AVMEDIA_TYPE_VIDEO;
+    ctx->codec_id = AV_CODEC_ID_H264;
+
+    struct sc_packet_sink *ps = &sink->video_packet_sink;
+    bool ok = ps->ops->open(ps, ctx);
+    assert(ok);
+
+    // SPS and PPS
+    static const uint8_t config[] = {
+        0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1f, 0xda,
+        0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80,
+    };
+    AVPacket *packet = av_packet_alloc();
+    assert(packet);
+    int ret = av_new_packet(packet, sizeof(config));
+    assert(!ret);
+    (void) ret;
+    memcpy(packet->data, config, sizeof(config));
+    packet->pts = AV_NOPTS_VALUE;
+    packet->dts = AV_NOPTS_VALUE;
+    ok = ps->ops->push(ps, packet);
+    assert(ok);
+    (void) ok;
+    av_packet_free(&packet);
+
+    return ctx;
+}
+
+static void test_client_not_reading(void) {
+    bool ok = net_init();
+    assert(ok);
+
+    sc_metrics_reset();
+
+    struct sc_rtsp_sink sink;
+    ok = sc_rtsp_sink_init(&sink, 0, true, false);
+    assert(ok);
+    ok = sc_rtsp_sink_start(&sink);
+    assert(ok);
+    assert(sink.port);
+
+    AVCodecContext *ctx = open_video(&sink);
+    struct sc_packet_sink *ps = &sink.video_packet_sink;
+
+    // This client never reads the stream
+    sc_socket stalled = connect_client(sink.port);
+
+    struct test_reader reader = {
+        .socket = connect_client(sink.port),
+        .found = false,
+    };
+    ok = sc_mutex_init(&reader.mutex);
+    assert(ok);
+    ok = sc_cond_init(&reader.cond);
+    assert(ok);
+    ok = sc_thread_create(&reader.thread, run_reader, "test-reader", &reader);
+    assert(ok);
+
+    // Much more than the socket buffers and the client send buffer
+    int64_t pts = 0;
+    for (unsigned i = 0; i < FLOOD_FRAMES; ++i) {
+        push_frame(&sink, pts, 0x11, FLOOD_FRAME_SIZE);
+        pts += 16666;
+    }
+
+    // The other client must still receive the stream (a frame may be dropped
+    // if the reader is slower than the sender, so retry)
+    sc_mutex_lock(&reader.mutex);
+    for (unsigned i = 0; !reader.found && i < 200; ++i) {
+        sc_mutex_unlock(&reader.mutex);
+        push_frame(&sink, pts, MARKER_BYTE, MARKER_SIZE);
+        pts += 16666;
+        sc_mutex_lock(&reader.mutex);
+        sc_cond_timedwait(&reader.cond, &reader.mutex,
+                          sc_tick_now() + SC_TICK_FROM_MS(50));
+    }
+    bool found = reader.found;
+    sc_mutex_unlock(&reader.mutex);
+    assert(found);
+    (void) found;
+
+    // The packets for the stalled client have been dropped
+    assert(sc_metrics_get(SC_METRIC_RTSP_DROPPED) > 0);
+
+    sc_rtsp_sink_stop(&sink);
+    sc_rtsp_sink_join(&sink);
+    ps->ops->close(ps);
+    sc_rtsp_sink_destroy(&sink);
+
+    sc_thread_join(&reader.thread, NULL);
+    sc_cond_destroy(&reader.cond);
+    sc_mutex_destroy(&reader.mutex);
+
+    net_close(reader.socket);
+    net_close(stalled);
+    avcodec_free_context(&ctx);
+    net_cleanup();
+}
+
+static void test_session_timeout(void) {
+    bool ok = net_init();
+    assert(ok);
+
+    struct sc_rtsp_sink sink;
+    ok = sc_rtsp_sink_init(&sink, 0, true, false);
+    assert(ok);
+    sink.session_timeout = SC_TICK_FROM_MS(300);
+    ok = sc_rtsp_sink_start(&sink);
+    assert(ok);
+
+    AVCodecContext *ctx = open_video(&sink);
+    struct sc_packet_sink *ps = &sink.video_packet_sink;
+
+    sc_socket idle = connect_client(sink.port);
+    sc_socket alive = connect_client(sink.port);
+
+    // Keep one session alive, for more than the timeout
+    char req[128];
+    char resp[2048];
+    for (unsigned i = 0; i < 8; ++i) {
+        snprintf(req, sizeof(req), "GET_PARAMETER rtsp://127.0.0.1/ "
+                                   "RTSP/1.0\r\nCSeq: %u\r\n\r\n", 10 + i);
+        send_str(alive, req);
+        int status = read_response(alive, resp, sizeof(resp));
+        assert(status == 200);
+        (void) status;
+        sleep_ms(100);
+    }
+
+    // The idle session has expired, the connection is closed (it never
+    // received any video packet)
+    char c;
+    ssize_t r = net_recv(idle, &c, 1);
+    assert(r == 0);
+    (void) r;
+
+    sc_rtsp_sink_stop(&sink);
+    sc_rtsp_sink_join(&sink);
+    ps->ops->close(ps);
+    sc_rtsp_sink_destroy(&sink);
+
+    net_close(alive);
+    net_close(idle);
+    avcodec_free_context(&ctx);
+    net_cleanup();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_client_not_reading();
+    test_session_timeout();
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/scale.h"
+
+static void test_scale_identity(void) {
+    const uint8_t src[] = {
+        1, 2, 3, 0xff, // last byte is padding
+        4, 5, 6, 0xff,
+    };
+    uint8_t dst[6];
+
+    sc_scale_plane_down(src, 4, 3, 2, dst, 3, 3, 2);
+    const uint8_t expected[] = {1, 2, 3, 4, 5, 6};
+    assert(!memcmp(dst, expected, sizeof(expected)));
+}
+
+static void test_scale_half(void) {
+    const uint8_t src[] = {
+        10, 20, 30, 40,
+        30, 40, 50, 61,
+        0, 0, 255, 255,
+        0, 1, 255, 255,
+    };
+    uint8_t dst[4];
+
+    sc_scale_plane_down(src, 4, 4, 4, dst, 2, 2, 2);
+    assert(dst[0] == 25);
+    assert(dst[1] == 45); // 181 / 4 = 45.25
+    assert(dst[2] == 0); // 1 / 4 = 0.25
+    assert(dst[3] == 255);
+}
+
+static void test_scale_non_integer_ratio(void) {
+    // 3 columns to 2: source columns [0; 1) and [1; 3)
+    const uint8_t src[] = {
+        100, 0, 50,
+    };
+    uint8_t dst[2];
+
+    sc_scale_plane_down(src, 3, 3, 1, dst, 2, 2, 1);
+    assert(dst[0] == 100);
+    assert(dst[1] == 25);
+}
+
+static void test_compute_size(void) {
+    unsigned w;
+    unsigned h;
+
+    sc_scale_compute_size(1920, 1080, 0, &w, &h);
+    assert(w == 1920 && h == 1080);
+
+    sc_scale_compute_size(1920, 1080, 2000, &w, &h);
+    assert(w == 1920 && h == 1080);
+
+    sc_scale_compute_size(1920, 1080, 960, &w, &h);
+    assert(w == 960 && h == 540);
+
+    // Portrait, rounded down to even values
+    sc_scale_compute_size(1080, 2400, 801, &w, &h);
+    assert(h == 800);
+    assert(w == 360);
+
+    sc_scale_compute_size(1080, 2340, 1000, &w, &h);
+    assert(h == 1000);
+    assert(w == 460); // 461 rounded down
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_scale_identity();
+    test_scale_half();
+    test_scale_non_integer_ratio();
+    test_compute_size();
+    return 0;
+}
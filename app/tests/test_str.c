@@ -386,6 +386,52 @@ static void test_remove_trailing_cr(void) {
     assert(!strcmp(s3, "adb\rdef"));
 }
 
+static void test_to_base64(void) {
+    char *s = sc_str_to_base64((const uint8_t *) "", 0);
+    assert(s);
+    assert(!strcmp(s, ""));
+    free(s);
+
+    s = sc_str_to_base64((const uint8_t *) "f", 1);
+    assert(s);
+    assert(!strcmp(s, "Zg=="));
+    free(s);
+
+    s = sc_str_to_base64((const uint8_t *) "fo", 2);
+    assert(s);
+    assert(!strcmp(s, "Zm8="));
+    free(s);
+
+    s = sc_str_to_base64((const uint8_t *) "foobar", 6);
+    assert(s);
+    assert(!strcmp(s, "Zm9vYmFy"));
+    free(s);
+
+    const uint8_t sps[] = {0x67, 0x42, 0xc0, 0x1f, 0xff};
+    s = sc_str_to_base64(sps, sizeof(sps));
+    assert(s);
+    assert(!strcmp(s, "Z0LAH/8="));
+    free(s);
+}
+
+static void test_header_value(void) {
+    const char *value = sc_str_header_value("CSeq: 42", "CSeq");
+    assert(value);
+    assert(!strcmp(value, "42"));
+
+    value = sc_str_header_value("content-length:\t 12", "Content-Length");
+    assert(value);
+    assert(!strcmp(value, "12"));
+
+    value = sc_str_header_value("Upgrade:", "Upgrade");
+    assert(value);
+    assert(!strcmp(value, ""));
+
+    assert(!sc_str_header_value("Session-Id: 1", "Session"));
+    assert(!sc_str_header_value("Sess", "Session"));
+    assert(!sc_str_header_value("", "Session"));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -408,5 +454,7 @@ int main(int argc, char *argv[]) {
     test_wrap_lines();
     test_index_of_column();
     test_remove_trailing_cr();
+    test_to_base64();
+    test_header_value();
     return 0;
 }
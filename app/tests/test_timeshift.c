@@ -0,0 +1,140 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "timeshift.h"
+
+static void push(struct sc_timeshift *ts, int64_t pts, bool key_frame) {
+    AVPacket packet = {0};
+    packet.pts = pts;
+    packet.dts = pts;
+    packet.flags = key_frame ? AV_PKT_FLAG_KEY : 0;
+
+    bool ok = sc_timeshift_push(ts, &packet);
+    assert(ok);
+}
+
+static void test_timeshift_ignore_before_key_frame(void) {
+    struct sc_timeshift ts;
+    sc_timeshift_init(&ts, SC_TICK_FROM_SEC(10));
+
+    uint64_t seq;
+    assert(!sc_timeshift_seek(&ts, 0, &seq));
+
+    push(&ts, 0, false);
+    assert(sc_timeshift_end(&ts) == 0);
+    assert(!sc_timeshift_seek(&ts, 0, &seq));
+
+    push(&ts, 1000, true);
+    push(&ts, 2000, false);
+    assert(sc_timeshift_end(&ts) == 2);
+    assert(sc_timeshift_get(&ts, 0)->pts == 1000);
+    assert(sc_timeshift_get(&ts, 1)->pts == 2000);
+    assert(!sc_timeshift_get(&ts, 2));
+
+    sc_timeshift_destroy(&ts);
+}
+
+static void test_timeshift_seek(void) {
+    struct sc_timeshift ts;
+    sc_timeshift_init(&ts, SC_TICK_FROM_SEC(60));
+
+    // One key frame every second, 10 packets per second, during 5 seconds
+    for (int i = 0; i < 50; ++i) {
+        push(&ts, SC_TICK_FROM_MS(i * 100), i % 10 == 0);
+    }
+    assert(sc_timeshift_end(&ts) == 50);
+
+    // The last packet is at 4.9s
+    uint64_t seq;
+    bool ok = sc_timeshift_seek(&ts, 0, &seq);
+    assert(ok);
+    assert(seq == 40); // key frame at 4s
+
+    ok = sc_timeshift_seek(&ts, -SC_TICK_FROM_MS(900), &seq);
+    assert(ok);
+    assert(seq == 40); // 4s exactly
+
+    ok = sc_timeshift_seek(&ts, -SC_TICK_FROM_MS(901), &seq);
+    assert(ok);
+    assert(seq == 30);
+
+    ok = sc_timeshift_seek(&ts, -SC_TICK_FROM_SEC(2), &seq);
+    assert(ok);
+    assert(seq == 20); // 2.9s => key frame at 2s
+
+    // Before the start: first key frame
+    ok = sc_timeshift_seek(&ts, -SC_TICK_FROM_SEC(3600), &seq);
+    assert(ok);
+    assert(seq == 0);
+
+    sc_timeshift_destroy(&ts);
+}
+
+static void test_timeshift_evict(void) {
+    struct sc_timeshift ts;
+    sc_timeshift_init(&ts, SC_TICK_FROM_SEC(2));
+
+    // One key frame every second, 10 packets per second
+    for (int i = 0; i < 50; ++i) {
+        push(&ts, SC_TICK_FROM_MS(i * 100), i % 10 == 0);
+    }
+
+    // The last packet is at 4.9s, 2 seconds must be covered (from 2.9s), so
+    // the store must start at the key frame at 2s
+    assert(ts.first_seq == 20);
+    assert(sc_timeshift_end(&ts) == 50);
+    assert(!sc_timeshift_get(&ts, 19));
+    assert(sc_timeshift_get(&ts, 20)->pts == SC_TICK_FROM_SEC(2));
+
+    uint64_t seq;
+    bool ok = sc_timeshift_seek(&ts, -SC_TICK_FROM_SEC(10), &seq);
+    assert(ok);
+    assert(seq == 20);
+
+    // At 5s, the GOP starting at 3s covers the duration
+    push(&ts, SC_TICK_FROM_SEC(5), true);
+    assert(ts.first_seq == 30);
+    assert(sc_timeshift_end(&ts) == 51);
+
+    sc_timeshift_destroy(&ts);
+}
+
+static void test_timeshift_clear(void) {
+    struct sc_timeshift ts;
+    sc_timeshift_init(&ts, SC_TICK_FROM_SEC(10));
+
+    push(&ts, 0, true);
+    push(&ts, 100, false);
+    assert(sc_timeshift_end(&ts) == 2);
+
+    sc_timeshift_clear(&ts);
+    assert(ts.first_seq == 2);
+    assert(sc_timeshift_end(&ts) == 2);
+    assert(!sc_timeshift_get(&ts, 1));
+
+    uint64_t seq;
+    assert(!sc_timeshift_seek(&ts, 0, &seq));
+
+    // A key frame is required again
+    push(&ts, 200, false);
+    assert(sc_timeshift_end(&ts) == 2);
+
+    push(&ts, 300, true);
+    assert(sc_timeshift_get(&ts, 2)->pts == 300);
+    assert(sc_timeshift_seek(&ts, 0, &seq));
+    assert(seq == 2);
+
+    sc_timeshift_destroy(&ts);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_timeshift_ignore_before_key_frame();
+    test_timeshift_seek();
+    test_timeshift_evict();
+    test_timeshift_clear();
+    return 0;
+}
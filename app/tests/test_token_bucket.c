@@ -0,0 +1,81 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/token_bucket.h"
+
+static void test_burst(void) {
+    struct sc_token_bucket tb;
+    // 1000 tokens per second, burst of 100
+    sc_token_bucket_init(&tb, 1000, 100, 0);
+
+    // The bucket is initially full
+    assert(sc_token_bucket_take(&tb, 60, 0) == 0);
+    assert(sc_token_bucket_take(&tb, 40, 0) == 0);
+
+    // Empty: 10 tokens take 10 ms
+    assert(sc_token_bucket_take(&tb, 10, 0) == SC_TICK_FROM_MS(10));
+}
+
+static void test_debt(void) {
+    struct sc_token_bucket tb;
+    sc_token_bucket_init(&tb, 1000, 100, 0);
+
+    // Taking more than the burst is allowed, the debt delays the next takes
+    assert(sc_token_bucket_take(&tb, 600, 0) == SC_TICK_FROM_MS(500));
+    assert(sc_token_bucket_take(&tb, 100, SC_TICK_FROM_MS(500))
+            == SC_TICK_FROM_MS(600));
+    assert(sc_token_bucket_take(&tb, 1, SC_TICK_FROM_MS(600))
+            == SC_TICK_FROM_MS(601));
+}
+
+static void test_refill(void) {
+    struct sc_token_bucket tb;
+    sc_token_bucket_init(&tb, 1000, 100, 0);
+
+    assert(sc_token_bucket_take(&tb, 100, 0) == 0);
+
+    // After 30 ms, 30 tokens are available
+    sc_tick now = SC_TICK_FROM_MS(30);
+    assert(sc_token_bucket_take(&tb, 30, now) == now);
+    assert(sc_token_bucket_take(&tb, 1, now) == now + SC_TICK_FROM_MS(1));
+
+    // The bucket never contains more than the burst
+    now = SC_TICK_FROM_SEC(3600);
+    assert(sc_token_bucket_take(&tb, 100, now) == now);
+    assert(sc_token_bucket_take(&tb, 1, now) == now + SC_TICK_FROM_MS(1));
+}
+
+static void test_fractional_refill(void) {
+    struct sc_token_bucket tb;
+    // 1 token every 3 ms
+    sc_token_bucket_init(&tb, 333, 1, 0);
+
+    assert(sc_token_bucket_take(&tb, 1, 0) == 0);
+
+    // Frequent refills must not lose the fractional tokens
+    sc_tick now = 0;
+    sc_tick available = 0;
+    unsigned taken = 0;
+    while (now < SC_TICK_FROM_SEC(3)) {
+        now += 100;
+        if (now >= available) {
+            available = sc_token_bucket_take(&tb, 1, now);
+            ++taken;
+        }
+    }
+
+    assert(taken >= 998 && taken <= 1001);
+    (void) taken;
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_burst();
+    test_debt();
+    test_refill();
+    test_fractional_refill();
+    return 0;
+}
@@ -184,6 +184,40 @@ static void test_vecdeque_push_hole(void) {
     sc_vecdeque_destroy(&vdq);
 }
 
+static void test_vecdeque_at(void) {
+    struct SC_VECDEQUE(int) vdq = SC_VECDEQUE_INITIALIZER;
+
+    bool ok = sc_vecdeque_reserve(&vdq, 20);
+    assert(ok);
+    assert(vdq.cap == 20);
+
+    for (int i = 0; i < 20; ++i) {
+        ok = sc_vecdeque_push(&vdq, i);
+        assert(ok);
+    }
+
+    // Wrap around the end of the ring buffer
+    for (int i = 0; i < 15; ++i) {
+        int v = sc_vecdeque_pop(&vdq);
+        assert(v == i);
+    }
+    for (int i = 20; i < 25; ++i) {
+        ok = sc_vecdeque_push(&vdq, i);
+        assert(ok);
+    }
+    assert(vdq.cap == 20);
+    assert(sc_vecdeque_size(&vdq) == 10);
+
+    for (int i = 0; i < 10; ++i) {
+        assert(*sc_vecdeque_at(&vdq, i) == 15 + i);
+    }
+
+    *sc_vecdeque_at(&vdq, 7) = 42;
+    assert(*sc_vecdeque_at(&vdq, 7) == 42);
+
+    sc_vecdeque_destroy(&vdq);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -192,6 +226,7 @@ int main(int argc, char *argv[]) {
     test_vecdeque_reserve();
     test_vecdeque_grow();
     test_vecdeque_push_hole();
+    test_vecdeque_at();
 
     return 0;
 }
@@ -0,0 +1,195 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/sha1.h"
+#include "util/thread.h"
+#include "util/websocket.h"
+
+static void
+check_sha1(const char *input, const uint8_t expected[SC_SHA1_DIGEST_SIZE]) {
+    struct sc_sha1 sha1;
+    sc_sha1_init(&sha1);
+    sc_sha1_update(&sha1, input, strlen(input));
+
+    uint8_t digest[SC_SHA1_DIGEST_SIZE];
+    sc_sha1_final(&sha1, digest);
+    assert(!memcmp(digest, expected, SC_SHA1_DIGEST_SIZE));
+}
+
+static void test_sha1(void) {
+    // RFC 3174 section 7.3
+    check_sha1("abc", (const uint8_t[]) {
+        0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A, 0xBA, 0x3E,
+        0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D,
+    });
+
+    // Two blocks
+    check_sha1("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+               (const uint8_t[]) {
+        0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE,
+        0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5, 0xE5, 0x46, 0x70, 0xF1,
+    });
+
+    check_sha1("", (const uint8_t[]) {
+        0xDA, 0x39, 0xA3, 0xEE, 0x5E, 0x6B, 0x4B, 0x0D, 0x32, 0x55,
+        0xBF, 0xEF, 0x95, 0x60, 0x18, 0x90, 0xAF, 0xD8, 0x07, 0x09,
+    });
+}
+
+static void test_sha1_incremental(void) {
+    const char *s = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    uint8_t digest1[SC_SHA1_DIGEST_SIZE];
+    struct sc_sha1 sha1;
+    sc_sha1_init(&sha1);
+    sc_sha1_update(&sha1, s, strlen(s));
+    sc_sha1_final(&sha1, digest1);
+
+    uint8_t digest2[SC_SHA1_DIGEST_SIZE];
+    sc_sha1_init(&sha1);
+    for (size_t i = 0; i < strlen(s); ++i) {
+        sc_sha1_update(&sha1, &s[i], 1);
+    }
+    sc_sha1_final(&sha1, digest2);
+
+    assert(!memcmp(digest1, digest2, SC_SHA1_DIGEST_SIZE));
+}
+
+static void test_compute_accept(void) {
+    // RFC 6455 section 1.3
+    char accept[SC_WEBSOCKET_ACCEPT_SIZE];
+    bool ok = sc_websocket_compute_accept("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    assert(ok);
+    (void) ok;
+    assert(!strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+}
+
+static void test_frame_header(void) {
+    uint8_t buf[SC_WEBSOCKET_MAX_HEADER_SIZE];
+
+    size_t n = sc_websocket_write_frame_header(buf, SC_WEBSOCKET_OPCODE_BINARY,
+                                               125);
+    assert(n == 2);
+    assert(buf[0] == 0x82);
+    assert(buf[1] == 125);
+
+    n = sc_websocket_write_frame_header(buf, SC_WEBSOCKET_OPCODE_BINARY, 126);
+    assert(n == 4);
+    assert(buf[1] == 126);
+    assert(sc_read16be(&buf[2]) == 126);
+
+    n = sc_websocket_write_frame_header(buf, SC_WEBSOCKET_OPCODE_PONG,
+                                        0x10000);
+    assert(n == 10);
+    assert(buf[0] == 0x8A);
+    assert(buf[1] == 127);
+    assert(sc_read64be(&buf[2]) == 0x10000);
+}
+
+static void test_unmask(void) {
+    // RFC 6455 section 5.7: a masked "Hello"
+    uint8_t data[] = {0x7f, 0x9f, 0x4d, 0x51, 0x58};
+    const uint8_t mask[] = {0x37, 0xfa, 0x21, 0x3d};
+
+    // Unmask in two parts, the offset must be taken into account
+    sc_websocket_unmask(data, 3, mask, 0);
+    sc_websocket_unmask(&data[3], 2, mask, 3);
+    assert(!memcmp(data, "Hello", 5));
+}
+
+#define SEND_BINARY_HEADER_LEN 12
+#define SEND_BINARY_DATA_LEN (1 << 20)
+
+static int
+run_send_binary(void *data) {
+    sc_socket socket = *(sc_socket *) data;
+    const uint8_t header[SEND_BINARY_HEADER_LEN] = "0123456789AB";
+    uint8_t *payload = malloc(SEND_BINARY_DATA_LEN);
+    assert(payload);
+    for (size_t i = 0; i < SEND_BINARY_DATA_LEN; ++i) {
+        payload[i] = i % 251;
+    }
+
+    bool ok = sc_websocket_send_binary(socket, header, sizeof(header), payload,
+                                       SEND_BINARY_DATA_LEN);
+    assert(ok);
+    // A frame without data
+    ok = sc_websocket_send_binary(socket, header, sizeof(header), NULL, 0);
+    assert(ok);
+    (void) ok;
+
+    free(payload);
+    return 0;
+}
+
+static void test_send_binary(void) {
+    bool ok = net_init();
+    assert(ok);
+
+    sc_socket server = net_socket();
+    assert(server != SC_SOCKET_NONE);
+    ok = net_listen(server, IPV4_LOCALHOST, 0, 1);
+    assert(ok);
+    uint16_t port;
+    ok = net_get_local_port(server, &port);
+    assert(ok);
+
+    sc_socket client = net_socket();
+    assert(client != SC_SOCKET_NONE);
+    ok = net_connect(client, IPV4_LOCALHOST, port);
+    assert(ok);
+    sc_socket conn = net_accept(server);
+    assert(conn != SC_SOCKET_NONE);
+
+    // The payload exceeds the socket buffers, send from another thread
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_send_binary, "test-ws-send", &conn);
+    assert(ok);
+
+    size_t len = 10 + SEND_BINARY_HEADER_LEN + SEND_BINARY_DATA_LEN;
+    uint8_t *buf = malloc(len);
+    assert(buf);
+    ssize_t r = net_recv_all(client, buf, len);
+    assert(r == (ssize_t) len);
+    assert(buf[0] == 0x82);
+    assert(buf[1] == 127);
+    assert(sc_read64be(&buf[2])
+            == SEND_BINARY_HEADER_LEN + SEND_BINARY_DATA_LEN);
+    assert(!memcmp(&buf[10], "0123456789AB", SEND_BINARY_HEADER_LEN));
+    for (size_t i = 0; i < SEND_BINARY_DATA_LEN; ++i) {
+        assert(buf[10 + SEND_BINARY_HEADER_LEN + i] == i % 251);
+    }
+
+    r = net_recv_all(client, buf, 2 + SEND_BINARY_HEADER_LEN);
+    assert(r == 2 + SEND_BINARY_HEADER_LEN);
+    assert(buf[0] == 0x82);
+    assert(buf[1] == SEND_BINARY_HEADER_LEN);
+    assert(!memcmp(&buf[2], "0123456789AB", SEND_BINARY_HEADER_LEN));
+    (void) r;
+
+    sc_thread_join(&thread, NULL);
+
+    free(buf);
+    net_close(conn);
+    net_close(client);
+    net_close(server);
+    net_cleanup();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_sha1();
+    test_sha1_incremental();
+    test_compute_accept();
+    test_frame_header();
+    test_unmask();
+    test_send_binary();
+    return 0;
+}
@@ -0,0 +1,1877 @@
+// Standalone tool: do not include common.h (it depends on SDL headers)
+#include "config.h"
+
+/**
+ * Fake device server
+ *
+ * It replaces scrcpy-server (executed on the device) to run the client
+ * without any device, typically to benchmark or load-test the whole scrcpy
+ * binary on a CI machine. It is started by a stub adb (tools/fake_adb), which
+ * forwards the server parameters, and speaks the same socket protocol as the
+ * real server: device meta, codec ids, video size, 12-byte frame metas,
+ * session packets and device messages.
+ *
+ * The video is a test pattern encoded with libavcodec (H.264 or H.265). The
+ * pattern loops every GOP, so each GOP is encoded once, then replayed in real
+ * time: the fake server consumes almost no CPU, even at high resolution and
+ * frame rate. The audio is a tone (OPUS, AAC or RAW), encoded live.
+ *
+ * For the client latency test, a marker region may be flipped on each
+ * injected touch or key press: the GOP is then also encoded with the marker
+ * flipped, and the replay switches to the other GOP (from its key frame).
+ *
+ * See doc/fake_server.md.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libavcodec/version.h>
+#include <libavutil/version.h>
+
+// Same condition as SCRCPY_LAVU_HAS_CHLAYOUT in compat.h
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 23, 100)
+# define SC_FAKE_HAS_CHLAYOUT
+#endif
+
+// avcodec_get_supported_config() has been added in lavc 61.13.100, which
+// deprecates AVCodec.sample_fmts (see ffmpeg/doc/APIchanges)
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+# define SC_FAKE_HAS_GET_SUPPORTED_CONFIG
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+#define SC_FAKE_PACKET_FLAG_CONFIG    (UINT64_C(1) << 63)
+#define SC_FAKE_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+
+#define SC_FAKE_DEVICE_NAME_FIELD_LENGTH 64
+#define SC_FAKE_CONTROL_MSG_MAX_SIZE (1 << 18) // 256k
+
+// Device messages (see device_msg.h)
+#define SC_FAKE_DEVICE_MSG_TYPE_CLIPBOARD 0
+#define SC_FAKE_DEVICE_MSG_TYPE_ACK_CLIPBOARD 1
+
+// Control messages (see control_msg.h)
+enum sc_fake_control_msg_type {
+    SC_FAKE_CONTROL_MSG_TYPE_INJECT_KEYCODE,
+    SC_FAKE_CONTROL_MSG_TYPE_INJECT_TEXT,
+    SC_FAKE_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+    SC_FAKE_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT,
+    SC_FAKE_CONTROL_MSG_TYPE_BACK_OR_SCREEN_ON,
+    SC_FAKE_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL,
+    SC_FAKE_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL,
+    SC_FAKE_CONTROL_MSG_TYPE_COLLAPSE_PANELS,
+    SC_FAKE_CONTROL_MSG_TYPE_GET_CLIPBOARD,
+    SC_FAKE_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+    SC_FAKE_CONTROL_MSG_TYPE_SET_DISPLAY_POWER,
+    SC_FAKE_CONTROL_MSG_TYPE_ROTATE_DEVICE,
+    SC_FAKE_CONTROL_MSG_TYPE_UHID_CREATE,
+    SC_FAKE_CONTROL_MSG_TYPE_UHID_INPUT,
+    SC_FAKE_CONTROL_MSG_TYPE_UHID_DESTROY,
+    SC_FAKE_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS,
+    SC_FAKE_CONTROL_MSG_TYPE_START_APP,
+    SC_FAKE_CONTROL_MSG_TYPE_RESET_VIDEO,
+    SC_FAKE_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG,
+};
+
+// Memory bound for the pre-encoded GOP
+#define SC_FAKE_MAX_GOP_FRAMES 3600
+
+#define SC_FAKE_AUDIO_SAMPLE_RATE 48000
+#define SC_FAKE_AUDIO_CHANNELS 2
+// Frame size for the RAW codec (and for encoders without fixed frame size)
+#define SC_FAKE_AUDIO_DEFAULT_FRAME_SIZE 960
+
+#define LOG(level, fmt, ...) \
+    fprintf(stderr, "[fake-server] " level ": " fmt "\n", ## __VA_ARGS__)
+#define LOGD(fmt, ...) do { \
+        if (sc_fake_debug) { \
+            LOG("DEBUG", fmt, ## __VA_ARGS__); \
+        } \
+    } while (0)
+#define LOGI(fmt, ...) LOG("INFO", fmt, ## __VA_ARGS__)
+#define LOGW(fmt, ...) LOG("WARN", fmt, ## __VA_ARGS__)
+#define LOGE(fmt, ...) LOG("ERROR", fmt, ## __VA_ARGS__)
+#define LOG_OOM() LOGE("OOM: %s:%d %s()", __FILE__, __LINE__, __func__)
+
+static bool sc_fake_debug;
+
+struct sc_fake_codec {
+    const char *name; // as passed by the client
+    uint32_t id; // as written on the socket
+    enum AVCodecID av_id; // AV_CODEC_ID_NONE for RAW
+    const char *encoder; // preferred encoder, if available
+};
+
+static const struct sc_fake_codec sc_fake_video_codecs[] = {
+    {"h264", UINT32_C(0x68323634), AV_CODEC_ID_H264, "libx264"},
+    {"h265", UINT32_C(0x68323635), AV_CODEC_ID_HEVC, "libx265"},
+};
+
+static const struct sc_fake_codec sc_fake_audio_codecs[] = {
+    {"opus", UINT32_C(0x6f707573), AV_CODEC_ID_OPUS, "libopus"},
+    {"aac", UINT32_C(0x00616163), AV_CODEC_ID_AAC, "aac"},
+    {"raw", UINT32_C(0x00726177), AV_CODEC_ID_NONE, NULL},
+};
+
+struct sc_fake_options {
+    // Server parameters, as passed by the client
+    uint32_t scid;
+    bool video;
+    bool audio;
+    bool control;
+    const struct sc_fake_codec *video_codec;
+    const struct sc_fake_codec *audio_codec;
+    const char *video_encoder;
+    const char *audio_encoder;
+    uint32_t video_bit_rate;
+    uint32_t audio_bit_rate;
+    uint16_t max_size;
+    float max_fps;
+    float i_frame_interval; // in seconds
+    bool tunnel_forward;
+    bool send_device_meta;
+    bool send_codec_meta;
+    bool send_frame_meta;
+    bool send_dummy_byte;
+
+    // Added by the stub adb
+    uint16_t tunnel_port;
+
+    // Fake device properties (environment variables)
+    const char *device_name;
+    uint32_t width;
+    uint32_t height;
+    float fps;
+    unsigned duration; // in seconds, 0 for unlimited
+    bool latency_marker;
+};
+
+struct sc_fake_packet {
+    uint8_t *data;
+    size_t size;
+    bool key_frame;
+};
+
+struct sc_fake_server {
+    struct sc_fake_options options;
+
+    int video_socket;
+    int audio_socket;
+    int control_socket;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopped; // protected by mutex
+
+    // Requested by control messages, handled by the video thread
+    atomic_bool rotate_requested;
+    atomic_bool reset_requested;
+    atomic_bool config_requested;
+    // Flipped by the injected events (only written by the control thread)
+    atomic_bool marker_requested;
+    // The requested video config (protected by mutex)
+    uint16_t requested_max_size;
+    float requested_max_fps;
+
+    char *clipboard;
+
+    struct {
+        uint64_t video_frames;
+        uint64_t video_bytes;
+        uint64_t audio_packets;
+        uint64_t control_msgs;
+    } stats;
+};
+
+static uint64_t
+sc_fake_now_ns(void) {
+    struct timespec ts;
+    int r = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(!r);
+    (void) r;
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+sc_fake_sleep_until(uint64_t deadline_ns) {
+    struct timespec ts = {
+        .tv_sec = deadline_ns / 1000000000,
+        .tv_nsec = deadline_ns % 1000000000,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static void
+sc_fake_write32be(uint8_t *buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static void
+sc_fake_write64be(uint8_t *buf, uint64_t value) {
+    sc_fake_write32be(buf, value >> 32);
+    sc_fake_write32be(&buf[4], (uint32_t) value);
+}
+
+static uint16_t
+sc_fake_read16be(const uint8_t *buf) {
+    return (buf[0] << 8) | buf[1];
+}
+
+static uint32_t
+sc_fake_read32be(const uint8_t *buf) {
+    return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+}
+
+static uint64_t
+sc_fake_read64be(const uint8_t *buf) {
+    return ((uint64_t) sc_fake_read32be(buf) << 32)
+         | sc_fake_read32be(&buf[4]);
+}
+
+static bool
+sc_fake_send_all(int socket, const void *buf, size_t len) {
+    const uint8_t *data = buf;
+    while (len) {
+        ssize_t w = send(socket, data, len, MSG_NOSIGNAL);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += w;
+        len -= w;
+    }
+    return true;
+}
+
+static bool
+sc_fake_send_packet(int socket, bool send_frame_meta, uint64_t pts_flags,
+                    const uint8_t *data, size_t size) {
+    if (send_frame_meta) {
+        uint8_t header[12];
+        sc_fake_write64be(header, pts_flags);
+        sc_fake_write32be(&header[8], size);
+        if (!sc_fake_send_all(socket, header, sizeof(header))) {
+            return false;
+        }
+    }
+
+    return sc_fake_send_all(socket, data, size);
+}
+
+static void
+sc_fake_server_stop(struct sc_fake_server *server) {
+    pthread_mutex_lock(&server->mutex);
+    if (!server->stopped) {
+        server->stopped = true;
+        pthread_cond_broadcast(&server->cond);
+
+        // Wake up blocking calls
+        if (server->video_socket != -1) {
+            shutdown(server->video_socket, SHUT_RDWR);
+        }
+        if (server->audio_socket != -1) {
+            shutdown(server->audio_socket, SHUT_RDWR);
+        }
+        if (server->control_socket != -1) {
+            shutdown(server->control_socket, SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&server->mutex);
+}
+
+static bool
+sc_fake_server_is_stopped(struct sc_fake_server *server) {
+    pthread_mutex_lock(&server->mutex);
+    bool stopped = server->stopped;
+    pthread_mutex_unlock(&server->mutex);
+    return stopped;
+}
+
+static const struct sc_fake_codec *
+sc_fake_find_codec(const struct sc_fake_codec *codecs, size_t count,
+                   const char *name) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!strcmp(codecs[i].name, name)) {
+            return &codecs[i];
+        }
+    }
+    return NULL;
+}
+
+static const AVCodec *
+sc_fake_find_encoder(const struct sc_fake_codec *codec, const char *name) {
+    if (name) {
+        const AVCodec *encoder = avcodec_find_encoder_by_name(name);
+        if (!encoder || encoder->id != codec->av_id) {
+            LOGE("Encoder '%s' not found for codec %s", name, codec->name);
+            return NULL;
+        }
+        return encoder;
+    }
+
+    if (codec->encoder) {
+        const AVCodec *encoder = avcodec_find_encoder_by_name(codec->encoder);
+        if (encoder) {
+            return encoder;
+        }
+    }
+
+    const AVCodec *encoder = avcodec_find_encoder(codec->av_id);
+    if (!encoder) {
+        LOGE("No encoder found for codec %s", codec->name);
+    }
+    return encoder;
+}
+
+static bool
+sc_fake_write_disable_stream(int socket, bool error) {
+    // Same as Streamer.writeDisableStream() in the real server
+    uint8_t code[4] = {0, 0, 0, error};
+    return sc_fake_send_all(socket, code, sizeof(code));
+}
+
+// Video
+
+struct sc_fake_gop {
+    uint8_t *config;
+    size_t config_size;
+    struct sc_fake_packet *packets;
+    size_t packet_count;
+};
+
+struct sc_fake_video {
+    struct sc_fake_server *server;
+    uint32_t width;
+    uint32_t height;
+    // Pattern rows, twice as wide as the frame, to scroll with memcpy()
+    uint8_t *luma_row;
+    uint8_t *cb_row;
+    uint8_t *cr_row;
+
+    // The GOP with the latency marker off, and on (if enabled)
+    struct sc_fake_gop gops[2];
+};
+
+static void
+sc_fake_compute_video_size(const struct sc_fake_options *options,
+                           uint32_t *width, uint32_t *height) {
+    // Same as Size.limit(maxSize).round8() in the real server
+    uint32_t w = options->width;
+    uint32_t h = options->height;
+    bool portrait = h > w;
+    uint32_t major = portrait ? h : w;
+    uint32_t minor = portrait ? w : h;
+
+    uint32_t max_size = options->max_size & ~7;
+    if (max_size && major > max_size) {
+        minor = max_size * minor / major;
+        major = max_size;
+    }
+
+    major &= ~7;
+    minor = (minor + 4) & ~7;
+    if (minor > major) {
+        minor = major;
+    }
+
+    *width = portrait ? minor : major;
+    *height = portrait ? major : minor;
+}
+
+static float
+sc_fake_video_fps(const struct sc_fake_options *options) {
+    if (options->max_fps > 0 && options->max_fps < options->fps) {
+        return options->max_fps;
+    }
+    return options->fps;
+}
+
+static unsigned
+sc_fake_video_gop_frames(const struct sc_fake_options *options) {
+    float fps = sc_fake_video_fps(options);
+    // As for MediaFormat.KEY_I_FRAME_INTERVAL, 0 means all key frames (and a
+    // negative value, no key frame except the first, which is not possible
+    // for a looping GOP: use the default)
+    float interval = options->i_frame_interval;
+    if (interval < 0) {
+        interval = 10;
+    }
+    float frames = roundf(interval * fps);
+    if (frames < 1) {
+        return 1;
+    }
+    if (frames > SC_FAKE_MAX_GOP_FRAMES) {
+        LOGW("GOP limited to %d frames", SC_FAKE_MAX_GOP_FRAMES);
+        return SC_FAKE_MAX_GOP_FRAMES;
+    }
+    return frames;
+}
+
+static void
+sc_fake_gop_clear(struct sc_fake_gop *gop) {
+    for (size_t i = 0; i < gop->packet_count; ++i) {
+        free(gop->packets[i].data);
+    }
+    free(gop->packets);
+    gop->packets = NULL;
+    gop->packet_count = 0;
+    free(gop->config);
+    gop->config = NULL;
+    gop->config_size = 0;
+}
+
+static void
+sc_fake_video_clear_gops(struct sc_fake_video *video) {
+    sc_fake_gop_clear(&video->gops[0]);
+    sc_fake_gop_clear(&video->gops[1]);
+}
+
+static bool
+sc_fake_video_init_pattern(struct sc_fake_video *video) {
+    uint32_t w = video->width;
+    uint32_t cw = (w + 1) / 2;
+
+    free(video->luma_row);
+    free(video->cb_row);
+    free(video->cr_row);
+    video->luma_row = malloc(2 * w);
+    video->cb_row = malloc(2 * cw);
+    video->cr_row = malloc(2 * cw);
+    if (!video->luma_row || !video->cb_row || !video->cr_row) {
+        LOG_OOM();
+        return false;
+    }
+
+    // A luma ramp and 8 color bars (75% SMPTE colors)
+    static const uint8_t bars[8][2] = {
+        {128, 128}, {44, 136}, {156, 44}, {72, 58},
+        {184, 198}, {100, 212}, {212, 114}, {128, 128},
+    };
+    for (uint32_t x = 0; x < w; ++x) {
+        uint8_t value = 16 + x * 219 / w;
+        video->luma_row[x] = value;
+        video->luma_row[x + w] = value;
+    }
+    for (uint32_t x = 0; x < cw; ++x) {
+        unsigned bar = x * 8 / cw;
+        video->cb_row[x] = video->cb_row[x + cw] = bars[bar][0];
+        video->cr_row[x] = video->cr_row[x + cw] = bars[bar][1];
+    }
+    return true;
+}
+
+static void
+sc_fake_video_draw(struct sc_fake_video *video, AVFrame *frame,
+                   unsigned index, unsigned count, bool marker) {
+    int w = frame->width;
+    int h = frame->height;
+    int cw = (w + 1) / 2;
+    int ch = (h + 1) / 2;
+
+    // The pattern scrolls by exactly its width over the GOP, so that the
+    // replayed GOP loops seamlessly
+    int shift = (uint64_t) index * w / count;
+    int cshift = shift / 2;
+
+    for (int y = 0; y < h; ++y) {
+        memcpy(frame->data[0] + y * frame->linesize[0],
+               video->luma_row + shift, w);
+    }
+    for (int y = 0; y < ch; ++y) {
+        memcpy(frame->data[1] + y * frame->linesize[1],
+               video->cb_row + cshift, cw);
+        memcpy(frame->data[2] + y * frame->linesize[2],
+               video->cr_row + cshift, cw);
+    }
+
+    // A white square moving vertically, so that motion is obvious
+    int side = (w < h ? w : h) / 8;
+    int x0 = (w - side) / 2;
+    int y0 = (uint64_t) index * (h - side) / count;
+    for (int y = y0; y < y0 + side; ++y) {
+        memset(frame->data[0] + y * frame->linesize[0] + x0, 235, side);
+    }
+
+    if (video->server->options.latency_marker) {
+        // A black (off) or white (on) square in the top-left corner, of the
+        // same size as the moving square (which never overlaps it)
+        uint8_t luma = marker ? 235 : 16;
+        for (int y = 0; y < side; ++y) {
+            memset(frame->data[0] + y * frame->linesize[0], luma, side);
+        }
+        for (int y = 0; y < side / 2; ++y) {
+            memset(frame->data[1] + y * frame->linesize[1], 128, side / 2);
+            memset(frame->data[2] + y * frame->linesize[2], 128, side / 2);
+        }
+    }
+}
+
+static bool
+sc_fake_gop_append_packet(struct sc_fake_gop *gop, AVPacket *packet,
+                          size_t *capacity) {
+    if (gop->packet_count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        struct sc_fake_packet *packets =
+            realloc(gop->packets, new_capacity * sizeof(*packets));
+        if (!packets) {
+            LOG_OOM();
+            return false;
+        }
+        gop->packets = packets;
+        *capacity = new_capacity;
+    }
+
+    uint8_t *data = malloc(packet->size);
+    if (!data) {
+        LOG_OOM();
+        return false;
+    }
+    memcpy(data, packet->data, packet->size);
+
+    struct sc_fake_packet *p = &gop->packets[gop->packet_count++];
+    p->data = data;
+    p->size = packet->size;
+    p->key_frame = packet->flags & AV_PKT_FLAG_KEY;
+    return true;
+}
+
+static bool
+sc_fake_gop_drain(struct sc_fake_gop *gop, AVCodecContext *ctx,
+                  AVPacket *packet, size_t *capacity) {
+    for (;;) {
+        int ret = avcodec_receive_packet(ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            LOGE("Could not encode video");
+            return false;
+        }
+        bool ok = sc_fake_gop_append_packet(gop, packet, capacity);
+        av_packet_unref(packet);
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+// Encode a GOP at the current size, to be replayed in a loop
+static bool
+sc_fake_video_encode_gop(struct sc_fake_video *video, struct sc_fake_gop *gop,
+                         bool marker) {
+    const struct sc_fake_options *options = &video->server->options;
+
+    const AVCodec *encoder =
+        sc_fake_find_encoder(options->video_codec, options->video_encoder);
+    if (!encoder) {
+        return false;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(encoder);
+    if (!ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    unsigned gop_frames = sc_fake_video_gop_frames(options);
+    AVRational framerate = av_d2q(sc_fake_video_fps(options), 100000);
+
+    ctx->width = video->width;
+    ctx->height = video->height;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->framerate = framerate;
+    ctx->time_base = av_inv_q(framerate);
+    ctx->bit_rate = options->video_bit_rate;
+    ctx->gop_size = gop_frames;
+    // MediaCodec does not produce B-frames by default: the packets are in
+    // presentation order, and each GOP is independent
+    ctx->max_b_frames = 0;
+    // Config packets are sent separately, as MediaCodec does
+    ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    if (!strcmp(encoder->name, "libx264") || !strcmp(encoder->name, "libx265")) {
+        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+        if (!strcmp(encoder->name, "libx265")) {
+            av_opt_set(ctx->priv_data, "x265-params", "log-level=error", 0);
+        }
+    }
+
+    AVFrame *frame = NULL;
+    AVPacket *packet = NULL;
+    bool ok = false;
+
+    if (avcodec_open2(ctx, encoder, NULL) < 0) {
+        LOGE("Could not open video encoder %s", encoder->name);
+        goto end;
+    }
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+    if (!frame || !packet) {
+        LOG_OOM();
+        goto end;
+    }
+
+    frame->format = ctx->pix_fmt;
+    frame->width = ctx->width;
+    frame->height = ctx->height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        LOG_OOM();
+        goto end;
+    }
+
+    uint64_t start = sc_fake_now_ns();
+    size_t capacity = 0;
+    for (unsigned i = 0; i < gop_frames; ++i) {
+        if (av_frame_make_writable(frame) < 0) {
+            LOG_OOM();
+            goto end;
+        }
+        sc_fake_video_draw(video, frame, i, gop_frames, marker);
+        frame->pts = i;
+        if (avcodec_send_frame(ctx, frame) < 0) {
+            LOGE("Could not encode video");
+            goto end;
+        }
+        if (!sc_fake_gop_drain(gop, ctx, packet, &capacity)) {
+            goto end;
+        }
+    }
+
+    // Flush
+    if (avcodec_send_frame(ctx, NULL) < 0
+            || !sc_fake_gop_drain(gop, ctx, packet, &capacity)) {
+        LOGE("Could not flush video encoder");
+        goto end;
+    }
+
+    if (!gop->packet_count) {
+        LOGE("No video packet produced");
+        goto end;
+    }
+
+    if (ctx->extradata_size) {
+        gop->config = malloc(ctx->extradata_size);
+        if (!gop->config) {
+            LOG_OOM();
+            goto end;
+        }
+        memcpy(gop->config, ctx->extradata, ctx->extradata_size);
+        gop->config_size = ctx->extradata_size;
+    }
+
+    uint64_t elapsed_ms = (sc_fake_now_ns() - start) / 1000000;
+    LOGI("Video: %" PRIu32 "x%" PRIu32 " %s (%s), %u frames GOP%s encoded in "
+         "%" PRIu64 " ms", video->width, video->height,
+         options->video_codec->name, encoder->name, gop_frames,
+         marker ? " (latency marker on)" : "", elapsed_ms);
+    ok = true;
+
+end:
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    if (!ok) {
+        sc_fake_gop_clear(gop);
+    }
+    return ok;
+}
+
+// Encode the GOP(s) at the current size
+static bool
+sc_fake_video_encode(struct sc_fake_video *video) {
+    sc_fake_video_clear_gops(video);
+    if (!sc_fake_video_init_pattern(video)) {
+        return false;
+    }
+
+    if (!sc_fake_video_encode_gop(video, &video->gops[0], false)) {
+        return false;
+    }
+
+    if (video->server->options.latency_marker
+            && !sc_fake_video_encode_gop(video, &video->gops[1], true)) {
+        sc_fake_video_clear_gops(video);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_fake_video_write_session(struct sc_fake_video *video, int socket) {
+    const struct sc_fake_options *options = &video->server->options;
+    if (!options->send_codec_meta || !options->send_frame_meta) {
+        return true;
+    }
+
+    uint8_t buf[24];
+    sc_fake_write64be(buf, SC_FAKE_PACKET_FLAG_CONFIG
+                         | SC_FAKE_PACKET_FLAG_KEY_FRAME);
+    sc_fake_write32be(&buf[8], 12);
+    sc_fake_write32be(&buf[12], options->video_codec->id);
+    sc_fake_write32be(&buf[16], video->width);
+    sc_fake_write32be(&buf[20], video->height);
+    return sc_fake_send_all(socket, buf, sizeof(buf));
+}
+
+static void *
+run_video(void *data) {
+    struct sc_fake_server *server = data;
+    const struct sc_fake_options *options = &server->options;
+    int socket = server->video_socket;
+
+    struct sc_fake_video video = {
+        .server = server,
+    };
+    sc_fake_compute_video_size(options, &video.width, &video.height);
+
+    if (!sc_fake_video_encode(&video)) {
+        sc_fake_write_disable_stream(socket, true);
+        goto end;
+    }
+
+    if (options->send_codec_meta) {
+        uint8_t header[12];
+        sc_fake_write32be(header, options->video_codec->id);
+        sc_fake_write32be(&header[4], video.width);
+        sc_fake_write32be(&header[8], video.height);
+        if (!sc_fake_send_all(socket, header, sizeof(header))) {
+            goto end;
+        }
+    }
+
+    double frame_duration_ns = 1e9 / sc_fake_video_fps(options);
+    uint64_t start = sc_fake_now_ns();
+    uint64_t pts_base_ns = 0; // PTS of the first frame of the capture
+    uint64_t frame_index = 0; // since the start of the capture
+    bool send_config = true;
+    size_t gop_index = 0;
+    bool rotated = false;
+    bool marker = false; // the latency marker state of the current GOP
+
+    while (!sc_fake_server_is_stopped(server)) {
+        bool rotate = atomic_exchange(&server->rotate_requested, false);
+        bool reset = atomic_exchange(&server->reset_requested, false);
+        bool config = atomic_exchange(&server->config_requested, false);
+        if (rotate || reset || config) {
+            // Restart the capture, as the real server does
+            if (config) {
+                // These options are only read by the video thread
+                pthread_mutex_lock(&server->mutex);
+                server->options.max_size = server->requested_max_size;
+                server->options.max_fps = server->requested_max_fps;
+                pthread_mutex_unlock(&server->mutex);
+                sc_fake_compute_video_size(options, &video.width,
+                                           &video.height);
+                if (rotated) {
+                    uint32_t tmp = video.width;
+                    video.width = video.height;
+                    video.height = tmp;
+                }
+            }
+            if (rotate) {
+                uint32_t tmp = video.width;
+                video.width = video.height;
+                video.height = tmp;
+                rotated = !rotated;
+            }
+            if (!sc_fake_video_encode(&video)) {
+                break;
+            }
+            if (!sc_fake_video_write_session(&video, socket)) {
+                break;
+            }
+            send_config = true;
+            gop_index = 0;
+            // Do not try to catch up the time spent encoding
+            pts_base_ns += frame_index * frame_duration_ns;
+            frame_index = 0;
+            frame_duration_ns = 1e9 / sc_fake_video_fps(options);
+            start = sc_fake_now_ns();
+        }
+
+        if (options->latency_marker) {
+            bool requested = atomic_load(&server->marker_requested);
+            if (requested != marker) {
+                // Switch to the other GOP, from its key frame (its packets
+                // could not be decoded after a frame of the current GOP)
+                marker = requested;
+                gop_index = 0;
+                send_config = true;
+            }
+        }
+
+        struct sc_fake_gop *gop = &video.gops[marker];
+
+        if (send_config && gop->config_size) {
+            if (!sc_fake_send_packet(socket, options->send_frame_meta,
+                                     SC_FAKE_PACKET_FLAG_CONFIG, gop->config,
+                                     gop->config_size)) {
+                break;
+            }
+        }
+        send_config = false;
+
+        uint64_t offset_ns = frame_index * frame_duration_ns;
+        sc_fake_sleep_until(start + offset_ns);
+
+        uint64_t pts_ns = pts_base_ns + offset_ns;
+
+        struct sc_fake_packet *p = &gop->packets[gop_index];
+        uint64_t pts_flags = pts_ns / 1000;
+        if (p->key_frame) {
+            pts_flags |= SC_FAKE_PACKET_FLAG_KEY_FRAME;
+        }
+        if (!sc_fake_send_packet(socket, options->send_frame_meta, pts_flags,
+                                 p->data, p->size)) {
+            break;
+        }
+
+        ++server->stats.video_frames;
+        server->stats.video_bytes += p->size;
+        ++frame_index;
+        gop_index = (gop_index + 1) % gop->packet_count;
+    }
+
+end:
+    sc_fake_video_clear_gops(&video);
+    free(video.luma_row);
+    free(video.cb_row);
+    free(video.cr_row);
+    sc_fake_server_stop(server);
+    return NULL;
+}
+
+// Audio
+
+static void
+sc_fake_audio_fill(AVFrame *frame, uint64_t sample_index) {
+    // 440 Hz on the left channel, 660 Hz on the right channel
+    static const float freqs[SC_FAKE_AUDIO_CHANNELS] = {440, 660};
+    int fmt = frame->format;
+    for (int i = 0; i < frame->nb_samples; ++i) {
+        double t = (double) (sample_index + i) / SC_FAKE_AUDIO_SAMPLE_RATE;
+        for (int c = 0; c < SC_FAKE_AUDIO_CHANNELS; ++c) {
+            float value = 0.25f * sinf(2 * M_PI * freqs[c] * t);
+            switch (fmt) {
+                case AV_SAMPLE_FMT_S16:
+                    ((int16_t *) frame->data[0])[i * SC_FAKE_AUDIO_CHANNELS + c]
+                        = value * INT16_MAX;
+                    break;
+                case AV_SAMPLE_FMT_S16P:
+                    ((int16_t *) frame->data[c])[i] = value * INT16_MAX;
+                    break;
+                case AV_SAMPLE_FMT_FLT:
+                    ((float *) frame->data[0])[i * SC_FAKE_AUDIO_CHANNELS + c]
+                        = value;
+                    break;
+                case AV_SAMPLE_FMT_FLTP:
+                    ((float *) frame->data[c])[i] = value;
+                    break;
+                default:
+                    assert(!"unexpected sample format");
+            }
+        }
+    }
+}
+
+static enum AVSampleFormat
+sc_fake_audio_select_sample_fmt(const AVCodec *encoder) {
+    const enum AVSampleFormat *fmts;
+#ifdef SC_FAKE_HAS_GET_SUPPORTED_CONFIG
+    const void *configs;
+    int ret = avcodec_get_supported_config(NULL, encoder,
+                                           AV_CODEC_CONFIG_SAMPLE_FORMAT, 0,
+                                           &configs, NULL);
+    fmts = ret < 0 ? NULL : configs;
+#else
+    fmts = encoder->sample_fmts;
+#endif
+    if (!fmts) {
+        return AV_SAMPLE_FMT_S16;
+    }
+    for (; *fmts != AV_SAMPLE_FMT_NONE; ++fmts) {
+        switch (*fmts) {
+            case AV_SAMPLE_FMT_S16:
+            case AV_SAMPLE_FMT_S16P:
+            case AV_SAMPLE_FMT_FLT:
+            case AV_SAMPLE_FMT_FLTP:
+                return *fmts;
+            default:
+                break;
+        }
+    }
+    return AV_SAMPLE_FMT_NONE;
+}
+
+static AVCodecContext *
+sc_fake_audio_open_encoder(const struct sc_fake_options *options) {
+    const AVCodec *encoder =
+        sc_fake_find_encoder(options->audio_codec, options->audio_encoder);
+    if (!encoder) {
+        return NULL;
+    }
+
+    enum AVSampleFormat sample_fmt = sc_fake_audio_select_sample_fmt(encoder);
+    if (sample_fmt == AV_SAMPLE_FMT_NONE) {
+        LOGE("No supported sample format for audio encoder %s",
+             encoder->name);
+        return NULL;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(encoder);
+    if (!ctx) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    ctx->sample_rate = SC_FAKE_AUDIO_SAMPLE_RATE;
+    ctx->sample_fmt = sample_fmt;
+#ifdef SC_FAKE_HAS_CHLAYOUT
+    ctx->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+    ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+    ctx->channels = SC_FAKE_AUDIO_CHANNELS;
+#endif
+    ctx->time_base = (AVRational) {1, SC_FAKE_AUDIO_SAMPLE_RATE};
+    ctx->bit_rate = options->audio_bit_rate;
+    ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    // The native OPUS encoder is experimental
+    ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+    if (avcodec_open2(ctx, encoder, NULL) < 0) {
+        LOGE("Could not open audio encoder %s", encoder->name);
+        avcodec_free_context(&ctx);
+        return NULL;
+    }
+
+    LOGI("Audio: %s (%s)", options->audio_codec->name, encoder->name);
+    return ctx;
+}
+
+static bool
+sc_fake_audio_drain(struct sc_fake_server *server, AVCodecContext *ctx,
+                    AVPacket *packet) {
+    const struct sc_fake_options *options = &server->options;
+    for (;;) {
+        int ret = avcodec_receive_packet(ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            LOGE("Could not encode audio");
+            return false;
+        }
+
+        // The encoder delay may produce negative timestamps, which would
+        // overlap the packet flags
+        int64_t pts = av_rescale_q(packet->pts, ctx->time_base,
+                                   (AVRational) {1, 1000000});
+        uint64_t pts_flags = pts > 0 ? (uint64_t) pts : 0;
+        if (packet->flags & AV_PKT_FLAG_KEY) {
+            pts_flags |= SC_FAKE_PACKET_FLAG_KEY_FRAME;
+        }
+        bool ok = sc_fake_send_packet(server->audio_socket,
+                                      options->send_frame_meta, pts_flags,
+                                      packet->data, packet->size);
+        av_packet_unref(packet);
+        if (!ok) {
+            return false;
+        }
+        ++server->stats.audio_packets;
+    }
+}
+
+static void *
+run_audio(void *data) {
+    struct sc_fake_server *server = data;
+    const struct sc_fake_options *options = &server->options;
+    int socket = server->audio_socket;
+
+    bool raw = options->audio_codec->av_id == AV_CODEC_ID_NONE;
+
+    AVCodecContext *ctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket *packet = NULL;
+
+    if (!raw) {
+        ctx = sc_fake_audio_open_encoder(options);
+        if (!ctx) {
+            sc_fake_write_disable_stream(socket, true);
+            goto end;
+        }
+    }
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+    if (!frame || !packet) {
+        LOG_OOM();
+        goto end;
+    }
+
+    frame->format = raw ? AV_SAMPLE_FMT_S16 : ctx->sample_fmt;
+    frame->nb_samples = ctx && ctx->frame_size ? ctx->frame_size
+                                               : SC_FAKE_AUDIO_DEFAULT_FRAME_SIZE;
+#ifdef SC_FAKE_HAS_CHLAYOUT
+    frame->ch_layout = (AVChannelLayout) AV_CHANNEL_LAYOUT_STEREO;
+#else
+    frame->channel_layout = AV_CH_LAYOUT_STEREO;
+    frame->channels = SC_FAKE_AUDIO_CHANNELS;
+#endif
+    frame->sample_rate = SC_FAKE_AUDIO_SAMPLE_RATE;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        LOG_OOM();
+        goto end;
+    }
+
+    if (options->send_codec_meta) {
+        uint8_t header[4];
+        sc_fake_write32be(header, options->audio_codec->id);
+        if (!sc_fake_send_all(socket, header, sizeof(header))) {
+            goto end;
+        }
+    }
+
+    if (ctx && ctx->extradata_size) {
+        // OpusHead for OPUS, AudioSpecificConfig for AAC, as expected by the
+        // client
+        if (!sc_fake_send_packet(socket, options->send_frame_meta,
+                                 SC_FAKE_PACKET_FLAG_CONFIG, ctx->extradata,
+                                 ctx->extradata_size)) {
+            goto end;
+        }
+    }
+
+    uint64_t start = sc_fake_now_ns();
+    uint64_t sample_index = 0;
+    while (!sc_fake_server_is_stopped(server)) {
+        uint64_t pts_ns = sample_index * 1000000000 / SC_FAKE_AUDIO_SAMPLE_RATE;
+        sc_fake_sleep_until(start + pts_ns);
+
+        if (av_frame_make_writable(frame) < 0) {
+            LOG_OOM();
+            break;
+        }
+        sc_fake_audio_fill(frame, sample_index);
+
+        if (raw) {
+            size_t size = frame->nb_samples * SC_FAKE_AUDIO_CHANNELS
+                        * sizeof(int16_t);
+            uint64_t pts_flags = pts_ns / 1000;
+            if (!sc_fake_send_packet(socket, options->send_frame_meta,
+                                     pts_flags, frame->data[0], size)) {
+                break;
+            }
+            ++server->stats.audio_packets;
+        } else {
+            frame->pts = sample_index;
+            if (avcodec_send_frame(ctx, frame) < 0) {
+                LOGE("Could not encode audio");
+                break;
+            }
+            if (!sc_fake_audio_drain(server, ctx, packet)) {
+                break;
+            }
+        }
+
+        sample_index += frame->nb_samples;
+    }
+
+end:
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    sc_fake_server_stop(server);
+    return NULL;
+}
+
+// Control
+
+static bool
+sc_fake_send_device_clipboard(struct sc_fake_server *server) {
+    const char *text = server->clipboard ? server->clipboard : "";
+    size_t len = strlen(text);
+
+    uint8_t header[5];
+    header[0] = SC_FAKE_DEVICE_MSG_TYPE_CLIPBOARD;
+    sc_fake_write32be(&header[1], len);
+    return sc_fake_send_all(server->control_socket, header, sizeof(header))
+        && sc_fake_send_all(server->control_socket, text, len);
+}
+
+static bool
+sc_fake_send_device_ack_clipboard(struct sc_fake_server *server,
+                                  uint64_t sequence) {
+    uint8_t buf[9];
+    buf[0] = SC_FAKE_DEVICE_MSG_TYPE_ACK_CLIPBOARD;
+    sc_fake_write64be(&buf[1], sequence);
+    return sc_fake_send_all(server->control_socket, buf, sizeof(buf));
+}
+
+// Return the length of the control message at the start of buf, 0 if it is
+// incomplete, -1 if it is invalid (see sc_control_msg_serialize())
+static ssize_t
+sc_fake_control_msg_length(const uint8_t *buf, size_t len) {
+    if (!len) {
+        return 0;
+    }
+
+#define REQUIRE(n) do { \
+        if (len < (size_t) (n)) { \
+            return 0; \
+        } \
+    } while (0)
+
+    switch (buf[0]) {
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_KEYCODE:
+            return 14;
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_TEXT:
+            REQUIRE(5);
+            return 5 + sc_fake_read32be(&buf[1]);
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+            return 32;
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT:
+            return 21;
+        case SC_FAKE_CONTROL_MSG_TYPE_BACK_OR_SCREEN_ON:
+        case SC_FAKE_CONTROL_MSG_TYPE_GET_CLIPBOARD:
+        case SC_FAKE_CONTROL_MSG_TYPE_SET_DISPLAY_POWER:
+            return 2;
+        case SC_FAKE_CONTROL_MSG_TYPE_SET_CLIPBOARD:
+            REQUIRE(14);
+            return 14 + sc_fake_read32be(&buf[10]);
+        case SC_FAKE_CONTROL_MSG_TYPE_UHID_CREATE: {
+            REQUIRE(8);
+            size_t name_len = buf[7];
+            REQUIRE(8 + name_len + 2);
+            return 8 + name_len + 2 + sc_fake_read16be(&buf[8 + name_len]);
+        }
+        case SC_FAKE_CONTROL_MSG_TYPE_UHID_INPUT:
+            REQUIRE(5);
+            return 5 + sc_fake_read16be(&buf[3]);
+        case SC_FAKE_CONTROL_MSG_TYPE_UHID_DESTROY:
+            return 3;
+        case SC_FAKE_CONTROL_MSG_TYPE_START_APP:
+            REQUIRE(2);
+            return 2 + buf[1];
+        case SC_FAKE_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
+        case SC_FAKE_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
+        case SC_FAKE_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
+        case SC_FAKE_CONTROL_MSG_TYPE_ROTATE_DEVICE:
+        case SC_FAKE_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS:
+        case SC_FAKE_CONTROL_MSG_TYPE_RESET_VIDEO:
+            return 1;
+        case SC_FAKE_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG:
+            return 15;
+        default:
+            LOGE("Unknown control message type: %u", (unsigned) buf[0]);
+            return -1;
+    }
+
+#undef REQUIRE
+}
+
+static bool
+sc_fake_handle_control_msg(struct sc_fake_server *server, const uint8_t *msg,
+                           size_t len) {
+    ++server->stats.control_msgs;
+
+    switch (msg[0]) {
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_KEYCODE:
+        case SC_FAKE_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT:
+            // Flip the latency marker on ACTION_DOWN (0 for both key and
+            // motion events)
+            if (server->options.latency_marker && !msg[1]) {
+                bool marker = atomic_load(&server->marker_requested);
+                atomic_store(&server->marker_requested, !marker);
+                LOGD("Latency marker %s", marker ? "off" : "on");
+            }
+            return true;
+        case SC_FAKE_CONTROL_MSG_TYPE_GET_CLIPBOARD:
+            return sc_fake_send_device_clipboard(server);
+        case SC_FAKE_CONTROL_MSG_TYPE_SET_CLIPBOARD: {
+            uint64_t sequence = sc_fake_read64be(&msg[1]);
+            char *text = strndup((const char *) &msg[14], len - 14);
+            if (!text) {
+                LOG_OOM();
+                return false;
+            }
+            free(server->clipboard);
+            server->clipboard = text;
+            // 0 is SC_SEQUENCE_INVALID: no acknowledgement requested
+            if (sequence) {
+                return sc_fake_send_device_ack_clipboard(server, sequence);
+            }
+            return true;
+        }
+        case SC_FAKE_CONTROL_MSG_TYPE_ROTATE_DEVICE:
+            if (server->options.video) {
+                atomic_store(&server->rotate_requested, true);
+            }
+            return true;
+        case SC_FAKE_CONTROL_MSG_TYPE_RESET_VIDEO:
+            if (server->options.video) {
+                atomic_store(&server->reset_requested, true);
+            }
+            return true;
+        case SC_FAKE_CONTROL_MSG_TYPE_SET_VIDEO_CONFIG: {
+            if (!server->options.video) {
+                return true;
+            }
+            uint32_t max_fps_bits = sc_fake_read32be(&msg[3]);
+            float max_fps;
+            memcpy(&max_fps, &max_fps_bits, sizeof(max_fps));
+            // The crop is ignored, as for the --crop option
+            pthread_mutex_lock(&server->mutex);
+            server->requested_max_size = sc_fake_read16be(&msg[1]);
+            server->requested_max_fps = max_fps;
+            pthread_mutex_unlock(&server->mutex);
+            atomic_store(&server->config_requested, true);
+            return true;
+        }
+        default:
+            LOGD("Control message type %u (%zu bytes)", (unsigned) msg[0],
+                 len);
+            return true;
+    }
+}
+
+static void *
+run_control(void *data) {
+    struct sc_fake_server *server = data;
+
+    uint8_t *buf = malloc(SC_FAKE_CONTROL_MSG_MAX_SIZE);
+    if (!buf) {
+        LOG_OOM();
+        goto end;
+    }
+
+    size_t head = 0;
+    for (;;) {
+        assert(head < SC_FAKE_CONTROL_MSG_MAX_SIZE);
+        ssize_t r = recv(server->control_socket, buf + head,
+                         SC_FAKE_CONTROL_MSG_MAX_SIZE - head, 0);
+        if (r <= 0) {
+            if (r == -1 && errno == EINTR) {
+                continue;
+            }
+            // The client closed the connection
+            break;
+        }
+        head += r;
+
+        size_t consumed = 0;
+        for (;;) {
+            ssize_t len = sc_fake_control_msg_length(buf + consumed,
+                                                     head - consumed);
+            if (len == -1 || len > SC_FAKE_CONTROL_MSG_MAX_SIZE) {
+                LOGE("Invalid control message");
+                goto end;
+            }
+            if (!len || (size_t) len > head - consumed) {
+                // Incomplete message
+                break;
+            }
+            if (!sc_fake_handle_control_msg(server, buf + consumed, len)) {
+                goto end;
+            }
+            consumed += len;
+        }
+
+        if (consumed) {
+            memmove(buf, buf + consumed, head - consumed);
+            head -= consumed;
+        }
+    }
+
+end:
+    free(buf);
+    sc_fake_server_stop(server);
+    return NULL;
+}
+
+// Connection
+
+static int
+sc_fake_connect(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        LOGE("Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        LOGE("Could not connect to port %" PRIu16 ": %s", port,
+             strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int
+sc_fake_listen(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        LOGE("Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1
+            || listen(fd, 3) == -1) {
+        LOGE("Could not listen on port %" PRIu16 ": %s", port,
+             strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Same as DesktopConnection.open() in the real server
+static bool
+sc_fake_server_connect(struct sc_fake_server *server) {
+    const struct sc_fake_options *options = &server->options;
+
+    int server_socket = -1;
+    if (options->tunnel_forward) {
+        server_socket = sc_fake_listen(options->tunnel_port);
+        if (server_socket == -1) {
+            return false;
+        }
+    }
+
+    struct {
+        bool enabled;
+        int *socket;
+    } slots[] = {
+        {options->video, &server->video_socket},
+        {options->audio, &server->audio_socket},
+        {options->control, &server->control_socket},
+    };
+
+    bool send_dummy_byte = options->tunnel_forward && options->send_dummy_byte;
+    int first_socket = -1;
+    for (size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i) {
+        if (!slots[i].enabled) {
+            continue;
+        }
+
+        int fd;
+        if (options->tunnel_forward) {
+            fd = accept(server_socket, NULL, NULL);
+            if (fd == -1) {
+                LOGE("Could not accept connection: %s", strerror(errno));
+            }
+        } else {
+            fd = sc_fake_connect(options->tunnel_port);
+        }
+        if (fd == -1) {
+            goto fail;
+        }
+        *slots[i].socket = fd;
+
+        if (first_socket == -1) {
+            first_socket = fd;
+        }
+
+        if (send_dummy_byte) {
+            // The client reads one byte to detect a connection error
+            uint8_t dummy = 0;
+            if (!sc_fake_send_all(fd, &dummy, 1)) {
+                goto fail;
+            }
+            send_dummy_byte = false;
+        }
+    }
+
+    if (server_socket != -1) {
+        close(server_socket);
+        server_socket = -1;
+    }
+
+    if (server->control_socket != -1) {
+        int nodelay = 1;
+        setsockopt(server->control_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay,
+                   sizeof(nodelay));
+    }
+
+    if (options->send_device_meta) {
+        assert(first_socket != -1);
+        char name[SC_FAKE_DEVICE_NAME_FIELD_LENGTH] = {0};
+        strncpy(name, options->device_name, sizeof(name) - 1);
+        if (!sc_fake_send_all(first_socket, name, sizeof(name))) {
+            LOGE("Could not send device meta");
+            goto fail;
+        }
+    }
+
+    return true;
+
+fail:
+    if (server_socket != -1) {
+        close(server_socket);
+    }
+    for (size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i) {
+        if (*slots[i].socket != -1) {
+            close(*slots[i].socket);
+            *slots[i].socket = -1;
+        }
+    }
+    return false;
+}
+
+// Parameters
+
+static bool
+sc_fake_parse_bool(const char *key, const char *value, bool *out) {
+    if (!strcmp(value, "true")) {
+        *out = true;
+        return true;
+    }
+    if (!strcmp(value, "false")) {
+        *out = false;
+        return true;
+    }
+    LOGE("Invalid boolean for %s: \"%s\"", key, value);
+    return false;
+}
+
+static bool
+sc_fake_parse_u32(const char *key, const char *value, int base,
+                  uint32_t max, uint32_t *out) {
+    char *endptr;
+    errno = 0;
+    unsigned long v = strtoul(value, &endptr, base);
+    if (errno || *value == '\0' || *endptr != '\0' || v > max) {
+        LOGE("Invalid value for %s: \"%s\"", key, value);
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static bool
+sc_fake_parse_float(const char *key, const char *value, float *out) {
+    char *endptr;
+    errno = 0;
+    float v = strtof(value, &endptr);
+    if (errno || *value == '\0' || *endptr != '\0') {
+        LOGE("Invalid value for %s: \"%s\"", key, value);
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static bool
+sc_fake_parse_video_codec_options(const char *value,
+                                  struct sc_fake_options *options) {
+    // Format: "key[:type]=value[,...]" (only i-frame-interval is meaningful
+    // for the fake server)
+    static const char key[] = "i-frame-interval";
+    const size_t key_len = sizeof(key) - 1;
+
+    const char *p = value;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (len > key_len && !strncmp(p, key, key_len)
+                && (p[key_len] == '=' || p[key_len] == ':')) {
+            const char *eq = memchr(p, '=', len);
+            if (eq) {
+                char *v = strndup(eq + 1, len - (eq + 1 - p));
+                if (!v) {
+                    LOG_OOM();
+                    return false;
+                }
+                bool ok = sc_fake_parse_float(key, v,
+                                              &options->i_frame_interval);
+                free(v);
+                if (!ok) {
+                    return false;
+                }
+            }
+        }
+        p += len;
+        if (*p == ',') {
+            ++p;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_fake_parse_param(const char *key, const char *value,
+                    struct sc_fake_options *options) {
+    uint32_t u32;
+    bool b;
+
+    if (!strcmp(key, "scid")) {
+        return sc_fake_parse_u32(key, value, 16, UINT32_MAX, &options->scid);
+    }
+    if (!strcmp(key, "log_level")) {
+        sc_fake_debug = !strcmp(value, "debug") || !strcmp(value, "verbose");
+        return true;
+    }
+    if (!strcmp(key, "video")) {
+        return sc_fake_parse_bool(key, value, &options->video);
+    }
+    if (!strcmp(key, "audio")) {
+        return sc_fake_parse_bool(key, value, &options->audio);
+    }
+    if (!strcmp(key, "control")) {
+        return sc_fake_parse_bool(key, value, &options->control);
+    }
+    if (!strcmp(key, "video_codec") || !strcmp(key, "audio_codec")) {
+        bool video = key[0] == 'v';
+        const struct sc_fake_codec *codecs =
+            video ? sc_fake_video_codecs : sc_fake_audio_codecs;
+        size_t count = video ? sizeof(sc_fake_video_codecs)
+                             / sizeof(sc_fake_video_codecs[0])
+                             : sizeof(sc_fake_audio_codecs)
+                             / sizeof(sc_fake_audio_codecs[0]);
+        const struct sc_fake_codec *codec =
+            sc_fake_find_codec(codecs, count, value);
+        if (!codec) {
+            LOGE("Codec not supported by the fake server: %s", value);
+            return false;
+        }
+        if (video) {
+            options->video_codec = codec;
+        } else {
+            options->audio_codec = codec;
+        }
+        return true;
+    }
+    if (!strcmp(key, "video_encoder")) {
+        options->video_encoder = value;
+        return true;
+    }
+    if (!strcmp(key, "audio_encoder")) {
+        options->audio_encoder = value;
+        return true;
+    }
+    if (!strcmp(key, "video_bit_rate")) {
+        return sc_fake_parse_u32(key, value, 10, UINT32_MAX,
+                                 &options->video_bit_rate);
+    }
+    if (!strcmp(key, "audio_bit_rate")) {
+        return sc_fake_parse_u32(key, value, 10, UINT32_MAX,
+                                 &options->audio_bit_rate);
+    }
+    if (!strcmp(key, "max_size")) {
+        if (!sc_fake_parse_u32(key, value, 10, UINT16_MAX, &u32)) {
+            return false;
+        }
+        options->max_size = u32;
+        return true;
+    }
+    if (!strcmp(key, "max_fps")) {
+        return sc_fake_parse_float(key, value, &options->max_fps);
+    }
+    if (!strcmp(key, "video_codec_options")) {
+        return sc_fake_parse_video_codec_options(value, options);
+    }
+    if (!strcmp(key, "tunnel_forward")) {
+        return sc_fake_parse_bool(key, value, &options->tunnel_forward);
+    }
+    if (!strcmp(key, "tunnel_port")) {
+        if (!sc_fake_parse_u32(key, value, 10, UINT16_MAX, &u32)) {
+            return false;
+        }
+        options->tunnel_port = u32;
+        return true;
+    }
+    if (!strcmp(key, "send_device_meta")) {
+        return sc_fake_parse_bool(key, value, &options->send_device_meta);
+    }
+    if (!strcmp(key, "send_codec_meta")) {
+        return sc_fake_parse_bool(key, value, &options->send_codec_meta);
+    }
+    if (!strcmp(key, "send_frame_meta")) {
+        return sc_fake_parse_bool(key, value, &options->send_frame_meta);
+    }
+    if (!strcmp(key, "send_dummy_byte")) {
+        return sc_fake_parse_bool(key, value, &options->send_dummy_byte);
+    }
+    if (!strcmp(key, "raw_stream")) {
+        if (!sc_fake_parse_bool(key, value, &b)) {
+            return false;
+        }
+        if (b) {
+            options->send_device_meta = false;
+            options->send_codec_meta = false;
+            options->send_frame_meta = false;
+            if (options->tunnel_forward) {
+                options->send_dummy_byte = false;
+            }
+        }
+        return true;
+    }
+    if (!strncmp(key, "list_", 5)) {
+        LOGE("Listing is not supported by the fake server");
+        return false;
+    }
+
+    // Capture options (crop, display_id, camera_*...) and device options
+    // (stay_awake, show_touches...) have no effect on a fake device
+    LOGD("Ignored parameter: %s=%s", key, value);
+    return true;
+}
+
+static bool
+sc_fake_parse_env(struct sc_fake_options *options) {
+    const char *size = getenv("SCRCPY_FAKE_SERVER_SIZE");
+    if (size) {
+        uint32_t w, h;
+        char end;
+        if (sscanf(size, "%" SCNu32 "x%" SCNu32 "%c", &w, &h, &end) != 2
+                || w < 8 || h < 8 || w > 0xFFFF || h > 0xFFFF) {
+            LOGE("Invalid SCRCPY_FAKE_SERVER_SIZE: \"%s\"", size);
+            return false;
+        }
+        options->width = w;
+        options->height = h;
+    }
+
+    const char *fps = getenv("SCRCPY_FAKE_SERVER_FPS");
+    if (fps) {
+        if (!sc_fake_parse_float("SCRCPY_FAKE_SERVER_FPS", fps, &options->fps)
+                || options->fps <= 0) {
+            LOGE("Invalid SCRCPY_FAKE_SERVER_FPS: \"%s\"", fps);
+            return false;
+        }
+    }
+
+    const char *duration = getenv("SCRCPY_FAKE_SERVER_DURATION");
+    if (duration) {
+        uint32_t d;
+        if (!sc_fake_parse_u32("SCRCPY_FAKE_SERVER_DURATION", duration, 10,
+                               UINT32_MAX, &d)) {
+            return false;
+        }
+        options->duration = d;
+    }
+
+    const char *name = getenv("SCRCPY_FAKE_SERVER_NAME");
+    if (name) {
+        options->device_name = name;
+    }
+
+    const char *marker = getenv("SCRCPY_FAKE_SERVER_LATENCY_MARKER");
+    if (marker) {
+        if (!sc_fake_parse_bool("SCRCPY_FAKE_SERVER_LATENCY_MARKER", marker,
+                                &options->latency_marker)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+sc_fake_parse_args(int argc, char *argv[], struct sc_fake_options *options) {
+    if (argc < 2) {
+        LOGE("Missing client version (this server is started by the stub "
+             "adb, see doc/fake_server.md)");
+        return false;
+    }
+
+    const char *client_version = argv[1];
+    if (strcmp(client_version, SCRCPY_VERSION)) {
+        LOGE("The server version (" SCRCPY_VERSION ") does not match the "
+             "client (%s)", client_version);
+        return false;
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        char *arg = argv[i];
+        char *eq = strchr(arg, '=');
+        if (!eq) {
+            LOGE("Invalid key=value pair: \"%s\"", arg);
+            return false;
+        }
+        *eq = '\0';
+        if (!sc_fake_parse_param(arg, eq + 1, options)) {
+            return false;
+        }
+    }
+
+    if (!options->tunnel_port) {
+        LOGE("Missing tunnel_port (this server is started by the stub adb, "
+             "see doc/fake_server.md)");
+        return false;
+    }
+
+    if (!options->video && !options->audio && !options->control) {
+        LOGE("No video, no audio, no control");
+        return false;
+    }
+
+    return sc_fake_parse_env(options);
+}
+
+int
+main(int argc, char *argv[]) {
+    struct sc_fake_server server = {
+        .options = {
+            .video = true,
+            .audio = true,
+            .control = true,
+            .video_codec = &sc_fake_video_codecs[0],
+            .audio_codec = &sc_fake_audio_codecs[0],
+            .video_bit_rate = 8000000,
+            .audio_bit_rate = 128000,
+            .i_frame_interval = 10,
+            .send_device_meta = true,
+            .send_codec_meta = true,
+            .send_frame_meta = true,
+            .send_dummy_byte = true,
+            .device_name = "Fake device",
+            .width = 1080,
+            .height = 1920,
+            .fps = 60,
+        },
+        .video_socket = -1,
+        .audio_socket = -1,
+        .control_socket = -1,
+    };
+    const struct sc_fake_options *options = &server.options;
+
+    if (!sc_fake_parse_args(argc, argv, &server.options)) {
+        return 1;
+    }
+
+    pthread_mutex_init(&server.mutex, NULL);
+    pthread_cond_init(&server.cond, NULL);
+    atomic_init(&server.rotate_requested, false);
+    atomic_init(&server.reset_requested, false);
+    atomic_init(&server.config_requested, false);
+    atomic_init(&server.marker_requested, false);
+
+    if (!sc_fake_server_connect(&server)) {
+        return 1;
+    }
+
+    LOGI("Device: %s (scid=%08" PRIx32 ")", options->device_name,
+         options->scid);
+
+    pthread_t video_thread;
+    pthread_t audio_thread;
+    pthread_t control_thread;
+    bool video_started = false;
+    bool audio_started = false;
+    bool control_started = false;
+
+    if (options->video) {
+        video_started =
+            !pthread_create(&video_thread, NULL, run_video, &server);
+    }
+    if (options->audio) {
+        audio_started =
+            !pthread_create(&audio_thread, NULL, run_audio, &server);
+    }
+    if (options->control) {
+        control_started =
+            !pthread_create(&control_thread, NULL, run_control, &server);
+    }
+
+    if (video_started == options->video && audio_started == options->audio
+            && control_started == options->control) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += options->duration;
+
+        pthread_mutex_lock(&server.mutex);
+        while (!server.stopped) {
+            if (options->duration) {
+                int r = pthread_cond_timedwait(&server.cond, &server.mutex,
+                                               &deadline);
+                if (r == ETIMEDOUT) {
+                    LOGI("Duration elapsed (%u s)", options->duration);
+                    break;
+                }
+            } else {
+                pthread_cond_wait(&server.cond, &server.mutex);
+            }
+        }
+        pthread_mutex_unlock(&server.mutex);
+    } else {
+        LOGE("Could not start threads");
+    }
+
+    sc_fake_server_stop(&server);
+
+    if (video_started) {
+        pthread_join(video_thread, NULL);
+    }
+    if (audio_started) {
+        pthread_join(audio_thread, NULL);
+    }
+    if (control_started) {
+        pthread_join(control_thread, NULL);
+    }
+
+    if (server.video_socket != -1) {
+        close(server.video_socket);
+    }
+    if (server.audio_socket != -1) {
+        close(server.audio_socket);
+    }
+    if (server.control_socket != -1) {
+        close(server.control_socket);
+    }
+
+    LOGI("Sent %" PRIu64 " video frames (%" PRIu64 " bytes), %" PRIu64
+         " audio packets, received %" PRIu64 " control messages",
+         server.stats.video_frames, server.stats.video_bytes,
+         server.stats.audio_packets, server.stats.control_msgs);
+
+    free(server.clipboard);
+    pthread_cond_destroy(&server.cond);
+    pthread_mutex_destroy(&server.mutex);
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * Benchmark of the pixel format conversions (src/util/pixconv.c)
+ *
+ * It measures every implementation supported by the CPU (scalar, SSE2, AVX2,
+ * NEON) against libswscale, for YUV420P (limited range) frames converted to
+ * RGB24, NV12 and GRAY8, at 1080p and 1440p.
+ *
+ * Usage: scrcpy-pixconv-bench [iterations]
+ */
+
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+
+#include "util/pixconv.h"
+
+#define SC_BENCH_DEFAULT_ITERATIONS 200
+
+struct sc_bench_size {
+    unsigned width;
+    unsigned height;
+};
+
+static const struct sc_bench_size sizes[] = {
+    {1920, 1080},
+    {2560, 1440},
+};
+
+static const enum sc_pixconv_impl impls[] = {
+    SC_PIXCONV_IMPL_SCALAR,
+    SC_PIXCONV_IMPL_SSE2,
+    SC_PIXCONV_IMPL_AVX2,
+    SC_PIXCONV_IMPL_NEON,
+};
+
+static const enum AVPixelFormat formats[] = {
+    AV_PIX_FMT_RGB24,
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_GRAY8,
+};
+
+static uint64_t
+sc_bench_now_ns(void) {
+    struct timespec ts;
+    int r = clock_gettime(CLOCK_MONOTONIC, &ts);
+    assert(!r);
+    (void) r;
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *
+sc_bench_format_name(enum AVPixelFormat format) {
+    switch (format) {
+        case AV_PIX_FMT_RGB24:
+            return "rgb24";
+        case AV_PIX_FMT_NV12:
+            return "nv12";
+        default:
+            assert(format == AV_PIX_FMT_GRAY8);
+            return "gray8";
+    }
+}
+
+static AVFrame *
+sc_bench_alloc_frame(unsigned width, unsigned height,
+                     enum AVPixelFormat format) {
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return NULL;
+    }
+
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32)) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+
+    return frame;
+}
+
+static void
+sc_bench_fill(AVFrame *frame) {
+    // Limited range values, with some variation so that the work is not
+    // trivially predictable
+    uint32_t x = 0x2545F491;
+    for (unsigned i = 0; i < 3; ++i) {
+        unsigned w = i ? (frame->width + 1) / 2 : frame->width;
+        unsigned h = i ? (frame->height + 1) / 2 : frame->height;
+        for (unsigned row = 0; row < h; ++row) {
+            uint8_t *line = frame->data[i] + row * frame->linesize[i];
+            for (unsigned col = 0; col < w; ++col) {
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                line[col] = 16 + (x >> 24) % 220;
+            }
+        }
+    }
+}
+
+static void
+sc_bench_convert(const AVFrame *src, AVFrame *dst) {
+    struct sc_pixconv_yuv420p yuv = {
+        .data = {src->data[0], src->data[1], src->data[2]},
+        .linesize = {src->linesize[0], src->linesize[1], src->linesize[2]},
+        .width = src->width,
+        .height = src->height,
+    };
+
+    switch (dst->format) {
+        case AV_PIX_FMT_RGB24:
+            sc_pixconv_to_rgb24(&yuv, dst->data[0], dst->linesize[0]);
+            break;
+        case AV_PIX_FMT_NV12:
+            sc_pixconv_to_nv12(&yuv, dst->data[0], dst->linesize[0],
+                               dst->data[1], dst->linesize[1]);
+            break;
+        default:
+            assert(dst->format == AV_PIX_FMT_GRAY8);
+            sc_pixconv_to_gray(src->data[0], src->linesize[0], src->width,
+                               src->height, dst->data[0], dst->linesize[0]);
+            break;
+    }
+}
+
+static void
+sc_bench_print(const char *name, uint64_t elapsed_ns, unsigned iterations) {
+    double ms = (double) elapsed_ns / iterations / 1000000;
+    printf("    %-8s %8.3f ms/frame\n", name, ms);
+}
+
+static bool
+sc_bench_run(const AVFrame *src, AVFrame *dst, unsigned iterations) {
+    for (size_t i = 0; i < ARRAY_LEN(impls); ++i) {
+        if (!sc_pixconv_set_impl(impls[i])) {
+            continue;
+        }
+
+        // Warm up
+        sc_bench_convert(src, dst);
+
+        uint64_t start = sc_bench_now_ns();
+        for (unsigned j = 0; j < iterations; ++j) {
+            sc_bench_convert(src, dst);
+        }
+        uint64_t elapsed = sc_bench_now_ns() - start;
+        sc_bench_print(sc_pixconv_impl_name(impls[i]), elapsed, iterations);
+    }
+
+    sc_pixconv_set_impl(SC_PIXCONV_IMPL_AUTO);
+
+    // Single-threaded, with the default scaler (no scaling is involved anyway)
+    struct SwsContext *sws =
+        sws_getContext(src->width, src->height, src->format,
+                       dst->width, dst->height, dst->format,
+                       SWS_BILINEAR, NULL, NULL, NULL);
+    if (!sws) {
+        fprintf(stderr, "Could not create the swscale context\n");
+        return false;
+    }
+
+    const uint8_t *const *src_data = (const uint8_t *const *) src->data;
+    sws_scale(sws, src_data, src->linesize, 0, src->height, dst->data,
+              dst->linesize);
+
+    uint64_t start = sc_bench_now_ns();
+    for (unsigned j = 0; j < iterations; ++j) {
+        sws_scale(sws, src_data, src->linesize, 0, src->height, dst->data,
+                  dst->linesize);
+    }
+    uint64_t elapsed = sc_bench_now_ns() - start;
+    sc_bench_print("swscale", elapsed, iterations);
+
+    sws_freeContext(sws);
+    return true;
+}
+
+int
+main(int argc, char *argv[]) {
+    unsigned iterations = SC_BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        char *endptr;
+        long value = strtol(argv[1], &endptr, 0);
+        if (*argv[1] == '\0' || *endptr != '\0' || value <= 0
+                || value > 1000000) {
+            fprintf(stderr, "Invalid iterations: %s\n", argv[1]);
+            return 1;
+        }
+        iterations = value;
+    }
+
+    printf("pixconv: %s (auto)\n",
+           sc_pixconv_impl_name(sc_pixconv_get_impl()));
+
+    for (size_t i = 0; i < ARRAY_LEN(sizes); ++i) {
+        unsigned width = sizes[i].width;
+        unsigned height = sizes[i].height;
+
+        AVFrame *src = sc_bench_alloc_frame(width, height, AV_PIX_FMT_YUV420P);
+        if (!src) {
+            fprintf(stderr, "Could not allocate frame\n");
+            return 1;
+        }
+        sc_bench_fill(src);
+
+        for (size_t j = 0; j < ARRAY_LEN(formats); ++j) {
+            AVFrame *dst = sc_bench_alloc_frame(width, height, formats[j]);
+            if (!dst) {
+                fprintf(stderr, "Could not allocate frame\n");
+                av_frame_free(&src);
+                return 1;
+            }
+
+            printf("%ux%u yuv420p -> %s:\n", width, height,
+                   sc_bench_format_name(formats[j]));
+            bool ok = sc_bench_run(src, dst, iterations);
+            av_frame_free(&dst);
+            if (!ok) {
+                av_frame_free(&src);
+                return 1;
+            }
+        }
+
+        av_frame_free(&src);
+    }
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+Throughput benchmark of the restream clients: the framing loop of
+test_tcp_client.py (pure Python) against libscrcpy-restream (scrcpy_restream.py).
+
+A local server replays a stream as fast as possible, so that the client is the
+bottleneck. The stream is either synthetic (random payloads, framing only), or
+the video packets of a file recorded by scrcpy (for example with
+--record=file.mkv), which also allows to benchmark decoding (requires PyAV).
+
+Usage:
+
+    python3 benchmark_restream.py [--input FILE] [--decode] [--repeat N]
+"""
+
+import argparse
+import os
+import random
+import socket
+import struct
+import threading
+import time
+
+import scrcpy_restream
+
+FLAG_CONFIG = 1 << 63
+FLAG_KEY_FRAME = 1 << 62
+
+
+def synthetic_packets(count):
+    """Packets sized like a 8 Mbps 60 fps stream, with a key frame every 60
+    packets (the payload is random, it cannot be decoded)"""
+    rand = random.Random(42)
+    packets = [(FLAG_CONFIG, os.urandom(30))]
+    for i in range(count):
+        if i % 60 == 0:
+            packets.append((FLAG_KEY_FRAME | i * 16666,
+                            os.urandom(rand.randint(80000, 120000))))
+        else:
+            packets.append((i * 16666, os.urandom(rand.randint(8000, 24000))))
+    return scrcpy_restream.CODEC_ID_H264, 1920, 1080, packets
+
+
+def file_packets(filename):
+    import av
+    container = av.open(filename)
+    stream = container.streams.video[0]
+    codec_ids = {'h264': scrcpy_restream.CODEC_ID_H264,
+                 'hevc': scrcpy_restream.CODEC_ID_H265}
+    codec_id = codec_ids.get(stream.codec_context.name)
+    if codec_id is None:
+        raise SystemExit(f'Unsupported codec: {stream.codec_context.name}')
+
+    packets = []
+    extradata = bytes(stream.codec_context.extradata or b'')
+    if extradata.startswith(b'\x00\x00\x01') \
+            or extradata.startswith(b'\x00\x00\x00\x01'):
+        # Annex B config (SPS/PPS), as sent by scrcpy
+        packets.append((FLAG_CONFIG, extradata))
+        bsf = None
+    else:
+        # The container stores length-prefixed NAL units: convert them to
+        # Annex B, as sent by scrcpy (the config is inserted before the key
+        # frames)
+        from av.bitstream import BitStreamFilterContext
+        name = stream.codec_context.name
+        bsf = BitStreamFilterContext(f'{name}_mp4toannexb', stream)
+
+    for packet in container.demux(stream):
+        if packet.size == 0:
+            continue
+        for p in bsf.filter(packet) if bsf else [packet]:
+            pts = int(p.pts * p.time_base * 1_000_000)
+            flags = FLAG_KEY_FRAME if p.is_keyframe else 0
+            packets.append((flags | pts, bytes(p)))
+    return codec_id, stream.width, stream.height, packets
+
+
+def serialize(codec_id, width, height, packets):
+    header = struct.pack('>III', codec_id, width, height)
+    body = b''.join(struct.pack('>QI', pts_flags, len(data)) + data
+                    for pts_flags, data in packets)
+    return header, body
+
+
+class ReplayServer:
+    def __init__(self, header, body, repeat):
+        self.header = header
+        self.body = body
+        self.repeat = repeat
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(('127.0.0.1', 0))
+        self.sock.listen(1)
+        self.port = self.sock.getsockname()[1]
+
+    def serve_one(self):
+        def run():
+            conn, _ = self.sock.accept()
+            try:
+                conn.sendall(self.header)
+                for _ in range(self.repeat):
+                    conn.sendall(self.body)
+            except OSError:
+                pass
+            finally:
+                conn.close()
+        thread = threading.Thread(target=run, daemon=True)
+        thread.start()
+        return thread
+
+
+def baseline_packets(port, decode):
+    """The reading loop of test_tcp_client.py (bare recv() for the headers,
+    data += chunk for the payload)"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.connect(('localhost', port))
+    codec_id = struct.unpack('>I', sock.recv(4))[0]
+    sock.recv(8)
+
+    codec = None
+    if decode:
+        import av
+        codec_name = 'h264' if codec_id == 0x68323634 else 'hevc'
+        codec = av.CodecContext.create(codec_name, 'r')
+
+    packets = 0
+    total = 0
+    frames = 0
+    error = None
+    while True:
+        header = sock.recv(12)
+        if len(header) < 12:
+            if header:
+                error = 'incomplete header (bare recv(12))'
+            break
+        pts_flags, size = struct.unpack('>QI', header)
+        data = b''
+        while len(data) < size:
+            chunk = sock.recv(min(size - len(data), 8192))
+            if not chunk:
+                error = 'connection closed within a packet'
+                break
+            data += chunk
+        if error:
+            break
+        packets += 1
+        total += size
+        if codec is not None:
+            try:
+                for frame in codec.decode(av.Packet(data)):
+                    frames += 1
+            except av.error.FFmpegError:
+                pass
+    sock.close()
+    return packets, total, frames, error
+
+
+def native_packets(port, decode):
+    client = scrcpy_restream.RestreamClient('localhost', port,
+                                            reconnect=False, decode=decode)
+    with client:
+        if decode:
+            for frame in client.frames():
+                pass
+        else:
+            for packet in client.packets():
+                pass
+        stats = client.stats
+    return stats['packets'], stats['bytes'], stats['frames'], None
+
+
+def run(name, fn, server, decode):
+    thread = server.serve_one()
+    start = time.perf_counter()
+    packets, total, frames, error = fn(server.port, decode)
+    elapsed = time.perf_counter() - start
+    thread.join()
+
+    line = (f'{name:<28} {elapsed:7.3f} s {total / elapsed / 1e6:9.1f} MB/s '
+            f'{packets / elapsed:10.0f} packets/s')
+    if decode:
+        line += f' {frames / elapsed:8.0f} frames/s'
+    if error:
+        line += f'  [stopped: {error}]'
+    print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('--input', help='video file recorded by scrcpy')
+    parser.add_argument('--decode', action='store_true',
+                        help='also decode the frames (requires --input)')
+    parser.add_argument('--packets', type=int, default=3000,
+                        help='number of synthetic packets (default: 3000)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='number of times the stream is sent (default: 3)')
+    args = parser.parse_args()
+
+    if args.decode and not args.input:
+        parser.error('--decode requires --input')
+
+    if args.input:
+        codec_id, width, height, packets = file_packets(args.input)
+    else:
+        codec_id, width, height, packets = synthetic_packets(args.packets)
+
+    header, body = serialize(codec_id, width, height, packets)
+    print(f'{len(packets)} packets, {len(body) / 1e6:.1f} MB, '
+          f'sent {args.repeat} times')
+
+    server = ReplayServer(header, body, args.repeat)
+    run('test_tcp_client.py loop', baseline_packets, server, args.decode)
+    run('libscrcpy-restream', native_packets, server, args.decode)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""
+Python bindings for libscrcpy-restream, the client library for the scrcpy TCP
+restream (scrcpy --tcp-restream PORT).
+
+The library handles the framing, the reconnection and the synchronization on
+key frames, and decodes the video. Packets and frames are returned as
+memoryviews on memory owned by the library (no copy): they are only valid
+until the next read. Copy them (bytes(view), numpy.array(view)) to keep them.
+
+Build the library with:
+
+    meson setup builddir -Drestream_client=true
+    ninja -C builddir
+
+The library is searched in the system library path, in builddir/app, or at the
+path given by the SCRCPY_RESTREAM_LIB environment variable.
+
+Example:
+
+    with RestreamClient('localhost', 8080) as client:
+        for frame in client.frames():
+            y, u, v = frame.planes[:3]  # memoryviews (with line padding)
+            i420 = frame.packed()       # contiguous planes (reused buffer)
+"""
+
+import ctypes
+import ctypes.util
+import os
+import sys
+
+CODEC_ID_H264 = 0x68323634
+CODEC_ID_H265 = 0x68323635
+
+STATUS_OK = 0
+STATUS_EOS = 1
+STATUS_INTERRUPTED = 2
+STATUS_ERROR = 3
+
+
+class _Params(ctypes.Structure):
+    _fields_ = [
+        ('host', ctypes.c_char_p),
+        ('port', ctypes.c_uint16),
+        ('reconnect', ctypes.c_bool),
+        ('max_reconnect_delay_ms', ctypes.c_uint32),
+        ('decode', ctypes.c_bool),
+    ]
+
+
+class _Info(ctypes.Structure):
+    _fields_ = [
+        ('codec_id', ctypes.c_uint32),
+        ('width', ctypes.c_uint32),
+        ('height', ctypes.c_uint32),
+        ('session', ctypes.c_uint32),
+    ]
+
+
+class _Packet(ctypes.Structure):
+    _fields_ = [
+        ('data', ctypes.c_void_p),
+        ('size', ctypes.c_size_t),
+        ('pts', ctypes.c_int64),
+        ('config', ctypes.c_bool),
+        ('key_frame', ctypes.c_bool),
+    ]
+
+
+class _Frame(ctypes.Structure):
+    _fields_ = [
+        ('data', ctypes.c_void_p * 4),
+        ('linesize', ctypes.c_int * 4),
+        ('width', ctypes.c_int),
+        ('height', ctypes.c_int),
+        ('format', ctypes.c_int),
+        ('pts', ctypes.c_int64),
+    ]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [
+        ('packets', ctypes.c_uint64),
+        ('bytes', ctypes.c_uint64),
+        ('frames', ctypes.c_uint64),
+        ('skipped', ctypes.c_uint64),
+        ('reconnections', ctypes.c_uint64),
+    ]
+
+
+def _find_library():
+    path = os.environ.get('SCRCPY_RESTREAM_LIB')
+    if path:
+        return path
+
+    path = ctypes.util.find_library('scrcpy-restream')
+    if path:
+        return path
+
+    here = os.path.dirname(os.path.abspath(__file__))
+    if sys.platform == 'win32':
+        name = 'libscrcpy-restream.dll'
+    elif sys.platform == 'darwin':
+        name = 'libscrcpy-restream.dylib'
+    else:
+        name = 'libscrcpy-restream.so'
+    return os.path.join(here, 'builddir', 'app', name)
+
+
+_lib = None
+
+
+def _load_library():
+    global _lib
+    if _lib is not None:
+        return _lib
+
+    lib = ctypes.CDLL(_find_library())
+
+    lib.sc_restream_client_open.argtypes = [ctypes.POINTER(_Params)]
+    lib.sc_restream_client_open.restype = ctypes.c_void_p
+    lib.sc_restream_client_close.argtypes = [ctypes.c_void_p]
+    lib.sc_restream_client_close.restype = None
+    lib.sc_restream_client_read_packet.argtypes = [ctypes.c_void_p,
+                                                   ctypes.POINTER(_Packet)]
+    lib.sc_restream_client_read_packet.restype = ctypes.c_int
+    lib.sc_restream_client_read_frame.argtypes = [ctypes.c_void_p,
+                                                  ctypes.POINTER(_Frame)]
+    lib.sc_restream_client_read_frame.restype = ctypes.c_int
+    lib.sc_restream_client_pack_frame.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_size_t)]
+    lib.sc_restream_client_pack_frame.restype = ctypes.c_void_p
+    lib.sc_restream_client_seek.argtypes = [ctypes.c_void_p, ctypes.c_int64,
+                                            ctypes.c_uint32]
+    lib.sc_restream_client_seek.restype = ctypes.c_bool
+    lib.sc_restream_client_interrupt.argtypes = [ctypes.c_void_p]
+    lib.sc_restream_client_interrupt.restype = None
+    lib.sc_restream_client_get_info.argtypes = [ctypes.c_void_p,
+                                                ctypes.POINTER(_Info)]
+    lib.sc_restream_client_get_info.restype = None
+    lib.sc_restream_client_get_stats.argtypes = [ctypes.c_void_p,
+                                                 ctypes.POINTER(_Stats)]
+    lib.sc_restream_client_get_stats.restype = None
+
+    _lib = lib
+    return lib
+
+
+def _view(address, size):
+    """Return a memoryview on native memory (no copy)"""
+    if not size:
+        return memoryview(b'')
+    array = (ctypes.c_uint8 * size).from_address(address)
+    return memoryview(array).cast('B')
+
+
+class Packet:
+    __slots__ = ('data', 'pts', 'config', 'key_frame')
+
+    def __init__(self, data, pts, config, key_frame):
+        self.data = data  # memoryview, valid until the next read
+        self.pts = pts  # microseconds, None for config packets
+        self.config = config
+        self.key_frame = key_frame
+
+
+class Frame:
+    __slots__ = ('_client', 'planes', 'linesizes', 'width', 'height',
+                 'format', 'pts')
+
+    def __init__(self, client, planes, linesizes, width, height, format, pts):
+        self._client = client
+        # memoryviews on the decoded planes (each line is linesizes[i] bytes,
+        # including padding), valid until the next read
+        self.planes = planes
+        self.linesizes = linesizes
+        self.width = width
+        self.height = height
+        self.format = format  # AVPixelFormat value (0 is yuv420p)
+        self.pts = pts
+
+    def packed(self):
+        """Return the planes copied contiguously without padding (for
+        yuv420p, an I420 buffer), in a buffer reused for the next frames"""
+        return self._client._pack_frame()
+
+
+class RestreamError(Exception):
+    pass
+
+
+class RestreamClient:
+    def __init__(self, host='localhost', port=8080, reconnect=True,
+                 decode=True, max_reconnect_delay_ms=0):
+        self._client = None
+        self._lib = _load_library()
+        self._decode = decode
+        params = _Params(host.encode(), port, reconnect,
+                         max_reconnect_delay_ms, decode)
+        self._client = self._lib.sc_restream_client_open(ctypes.byref(params))
+        if not self._client:
+            raise RestreamError(f'Could not connect to {host}:{port}')
+        # Reused for every read
+        self._packet = _Packet()
+        self._frame = _Frame()
+        self._size = ctypes.c_size_t()
+        # The packet buffer is reused by the library (until it grows): keep a
+        # view on it, sliced for each packet (creating a ctypes array type
+        # for each packet size would be slower than the read itself)
+        self._buffer_address = None
+        self._buffer_view = None
+
+    def close(self):
+        if self._client:
+            self._lib.sc_restream_client_close(self._client)
+            self._client = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def _check(self, status):
+        if status == STATUS_OK:
+            return True
+        if status == STATUS_ERROR:
+            raise RestreamError('Restream client error')
+        # end of stream or interrupted
+        return False
+
+    def _packet_view(self, address, size):
+        view = self._buffer_view
+        if address != self._buffer_address or size > len(view):
+            # Only recreated for a packet larger than all the previous ones
+            self._buffer_address = address
+            view = _view(address, size)
+            self._buffer_view = view
+        return view[:size]
+
+    def read_packet(self):
+        """Return the next packet, or None at the end of the stream"""
+        p = self._packet
+        status = self._lib.sc_restream_client_read_packet(self._client,
+                                                          ctypes.byref(p))
+        if not self._check(status):
+            return None
+        return Packet(self._packet_view(p.data, p.size),
+                      None if p.config else p.pts, p.config, p.key_frame)
+
+    def read_frame(self):
+        """Return the next decoded frame, or None at the end of the stream"""
+        if not self._decode:
+            raise RestreamError('The client was opened with decode=False')
+        f = self._frame
+        status = self._lib.sc_restream_client_read_frame(self._client,
+                                                         ctypes.byref(f))
+        if not self._check(status):
+            return None
+
+        planes = []
+        linesizes = []
+        for i in range(4):
+            if not f.data[i]:
+                break
+            # Chroma planes of yuv420p have half the height
+            height = f.height if i == 0 else (f.height + 1) // 2
+            planes.append(_view(f.data[i], f.linesize[i] * height))
+            linesizes.append(f.linesize[i])
+        return Frame(self, planes, linesizes, f.width, f.height, f.format,
+                     f.pts)
+
+    def _pack_frame(self):
+        address = self._lib.sc_restream_client_pack_frame(
+                self._client, ctypes.byref(self._size))
+        if not address:
+            raise RestreamError('Could not pack frame')
+        return _view(address, self._size.value)
+
+    def packets(self):
+        while True:
+            packet = self.read_packet()
+            if packet is None:
+                return
+            yield packet
+
+    def frames(self):
+        while True:
+            frame = self.read_frame()
+            if frame is None:
+                return
+            yield frame
+
+    def seek(self, offset_us, speed=100):
+        """Replay from offset_us (<= 0) relative to live, at speed percent of
+        the real-time rate (requires --tcp-timeshift)"""
+        if not self._lib.sc_restream_client_seek(self._client, offset_us,
+                                                 speed):
+            raise RestreamError('Could not send seek request')
+
+    def interrupt(self):
+        """Interrupt a blocking read (may be called from another thread)"""
+        self._lib.sc_restream_client_interrupt(self._client)
+
+    @property
+    def info(self):
+        info = _Info()
+        self._lib.sc_restream_client_get_info(self._client,
+                                              ctypes.byref(info))
+        codec = {CODEC_ID_H264: 'h264', CODEC_ID_H265: 'h265'}
+        return {
+            'codec': codec.get(info.codec_id, 'unknown'),
+            'width': info.width,
+            'height': info.height,
+            'session': info.session,
+        }
+
+    @property
+    def stats(self):
+        stats = _Stats()
+        self._lib.sc_restream_client_get_stats(self._client,
+                                               ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in _Stats._fields_}
+
+
+if __name__ == '__main__':
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 8080
+    with RestreamClient('localhost', port) as client:
+        print(client.info)
+        try:
+            for frame in client.frames():
+                stats = client.stats
+                if stats['frames'] % 30 == 0:
+                    print(f"{frame.width}x{frame.height} {stats}")
+        except KeyboardInterrupt:
+            pass
@@ -32,6 +32,7 @@ public class Options {
     private VideoSource videoSource = VideoSource.DISPLAY;
     private AudioSource audioSource = AudioSource.OUTPUT;
     private boolean audioDup;
+    private int audioRawAggregation; // in milliseconds
     private int videoBitRate = 8000000;
     private int audioBitRate = 128000;
     private float maxFps;
@@ -120,6 +121,10 @@ public class Options {
         return audioDup;
     }
 
+    public int getAudioRawAggregation() {
+        return audioRawAggregation;
+    }
+
     public int getVideoBitRate() {
         return videoBitRate;
     }
@@ -358,6 +363,9 @@ public class Options {
                 case "audio_dup":
                     options.audioDup = Boolean.parseBoolean(value);
                     break;
+                case "audio_raw_aggregation":
+                    options.audioRawAggregation = Integer.parseInt(value);
+                    break;
                 case "max_size":
                     options.maxSize = Integer.parseInt(value) & ~7; // multiple of 8
                     break;
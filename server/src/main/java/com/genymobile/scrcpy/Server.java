@@ -128,7 +128,7 @@ public final class Server {
                 Streamer audioStreamer = new Streamer(connection.getAudioFd(), audioCodec, options.getSendCodecMeta(), options.getSendFrameMeta());
                 AsyncProcessor audioRecorder;
                 if (audioCodec == AudioCodec.RAW) {
-                    audioRecorder = new AudioRawRecorder(audioCapture, audioStreamer);
+                    audioRecorder = new AudioRawRecorder(audioCapture, audioStreamer, options.getAudioRawAggregation());
                 } else {
                     audioRecorder = new AudioEncoder(audioCapture, audioStreamer, options);
                 }
@@ -155,6 +155,7 @@ public final class Server {
 
                 if (controller != null) {
                     controller.setSurfaceCapture(surfaceCapture);
+                    controller.setSurfaceEncoder(surfaceEncoder);
                 }
             }
 
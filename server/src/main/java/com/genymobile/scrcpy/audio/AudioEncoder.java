@@ -11,6 +11,7 @@ import com.genymobile.scrcpy.util.CodecUtils;
 import com.genymobile.scrcpy.util.IO;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
+import com.genymobile.scrcpy.util.RingBlockingQueue;
 
 import android.annotation.TargetApi;
 import android.media.MediaCodec;
@@ -23,27 +24,18 @@ import android.os.Looper;
 import java.io.IOException;
 import java.nio.ByteBuffer;
 import java.util.List;
-import java.util.concurrent.ArrayBlockingQueue;
-import java.util.concurrent.BlockingQueue;
 
 public final class AudioEncoder implements AsyncProcessor {
 
-    private static class InputTask {
-        private final int index;
+    // The tasks are recycled (through the free queues), so that the encoding does not allocate in steady state
 
-        InputTask(int index) {
-            this.index = index;
-        }
+    private static class InputTask {
+        private int index;
     }
 
     private static class OutputTask {
-        private final int index;
-        private final MediaCodec.BufferInfo bufferInfo;
-
-        OutputTask(int index, MediaCodec.BufferInfo bufferInfo) {
-            this.index = index;
-            this.bufferInfo = bufferInfo;
-        }
+        private int index;
+        private final MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
     }
 
     private static final int SAMPLE_RATE = AudioConfig.SAMPLE_RATE;
@@ -60,8 +52,12 @@ public final class AudioEncoder implements AsyncProcessor {
 
     // Capacity of 64 is in practice "infinite" (it is limited by the number of available MediaCodec buffers, typically 4).
     // So many pending tasks would lead to an unacceptable delay anyway.
-    private final BlockingQueue<InputTask> inputTasks = new ArrayBlockingQueue<>(64);
-    private final BlockingQueue<OutputTask> outputTasks = new ArrayBlockingQueue<>(64);
+    private static final int TASK_QUEUE_CAPACITY = 64;
+
+    private final RingBlockingQueue<InputTask> inputTasks = new RingBlockingQueue<>(TASK_QUEUE_CAPACITY);
+    private final RingBlockingQueue<OutputTask> outputTasks = new RingBlockingQueue<>(TASK_QUEUE_CAPACITY);
+    private final RingBlockingQueue<InputTask> freeInputTasks = new RingBlockingQueue<>(TASK_QUEUE_CAPACITY);
+    private final RingBlockingQueue<OutputTask> freeOutputTasks = new RingBlockingQueue<>(TASK_QUEUE_CAPACITY);
 
     private Thread thread;
     private HandlerThread mediaCodecThread;
@@ -77,6 +73,11 @@ public final class AudioEncoder implements AsyncProcessor {
         this.bitRate = options.getAudioBitRate();
         this.codecOptions = options.getAudioCodecOptions();
         this.encoderName = options.getAudioEncoder();
+
+        for (int i = 0; i < TASK_QUEUE_CAPACITY; ++i) {
+            freeInputTasks.offer(new InputTask());
+            freeOutputTasks.offer(new OutputTask());
+        }
     }
 
     private static MediaFormat createFormat(String mimeType, int bitRate, List<CodecOption> codecOptions) {
@@ -104,13 +105,16 @@ public final class AudioEncoder implements AsyncProcessor {
 
         while (!Thread.currentThread().isInterrupted()) {
             InputTask task = inputTasks.take();
-            ByteBuffer buffer = mediaCodec.getInputBuffer(task.index);
+            int index = task.index;
+            freeInputTasks.put(task);
+
+            ByteBuffer buffer = mediaCodec.getInputBuffer(index);
             int r = capture.read(buffer, bufferInfo);
             if (r <= 0) {
                 throw new IOException("Could not read audio: " + r);
             }
 
-            mediaCodec.queueInputBuffer(task.index, bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags);
+            mediaCodec.queueInputBuffer(index, bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags);
         }
     }
 
@@ -128,6 +132,7 @@ public final class AudioEncoder implements AsyncProcessor {
             } finally {
                 mediaCodec.releaseOutputBuffer(task.index, false);
             }
+            freeOutputTasks.put(task);
         }
     }
 
@@ -351,7 +356,9 @@ public final class AudioEncoder implements AsyncProcessor {
         @Override
         public void onInputBufferAvailable(MediaCodec codec, int index) {
             try {
-                inputTasks.put(new InputTask(index));
+                InputTask task = freeInputTasks.take();
+                task.index = index;
+                inputTasks.put(task);
             } catch (InterruptedException e) {
                 end();
             }
@@ -360,7 +367,11 @@ public final class AudioEncoder implements AsyncProcessor {
         @Override
         public void onOutputBufferAvailable(MediaCodec codec, int index, MediaCodec.BufferInfo bufferInfo) {
             try {
-                outputTasks.put(new OutputTask(index, bufferInfo));
+                // The BufferInfo is copied, so that the task can be reused
+                OutputTask task = freeOutputTasks.take();
+                task.index = index;
+                task.bufferInfo.set(bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags);
+                outputTasks.put(task);
             } catch (InterruptedException e) {
                 end();
             }
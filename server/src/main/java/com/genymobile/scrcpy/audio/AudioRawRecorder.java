@@ -16,12 +16,71 @@ public final class AudioRawRecorder implements AsyncProcessor {
 
     private final AudioCapture capture;
     private final Streamer streamer;
+    // Number of successive reads aggregated in a single packet
+    private final int readsPerPacket;
+
+    private final MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
+    // The timestamp of the first read of the current packet
+    private long packetPts;
 
     private Thread thread;
 
-    public AudioRawRecorder(AudioCapture capture, Streamer streamer) {
+    /**
+     * Source of the aggregated blocks.
+     * <p>
+     * Like {@link android.media.AudioRecord#read(ByteBuffer, int)}, a read always writes at the start of the direct buffer, whatever its
+     * position.
+     */
+    interface BlockReader {
+        int read(ByteBuffer directBuffer, int index);
+    }
+
+    public AudioRawRecorder(AudioCapture capture, Streamer streamer, int aggregationMs) {
         this.capture = capture;
         this.streamer = streamer;
+        this.readsPerPacket = getReadsPerPacket(aggregationMs);
+    }
+
+    private static int getReadsPerPacket(int aggregationMs) {
+        // Each read returns (at most) MAX_READ_SIZE bytes
+        int samplesPerRead = AudioConfig.MAX_READ_SIZE / (AudioConfig.CHANNELS * AudioConfig.BYTES_PER_SAMPLE);
+        int samples = (int) ((long) aggregationMs * AudioConfig.SAMPLE_RATE / 1000);
+        return Math.max(1, (samples + samplesPerRead - 1) / samplesPerRead);
+    }
+
+    /**
+     * Read {@code count} blocks, and store them contiguously in {@code packet}.
+     * <p>
+     * The first block is read in place, the next ones are read into {@code scratch}, then copied after the previous ones.
+     *
+     * @return the packet size (the packet is ready to be read)
+     */
+    static int aggregate(BlockReader reader, int count, ByteBuffer packet, ByteBuffer scratch) throws IOException {
+        packet.clear();
+        for (int i = 0; i < count; ++i) {
+            ByteBuffer target = i == 0 ? packet : scratch;
+            target.clear();
+            int r = reader.read(target, i);
+            if (r < 0) {
+                throw new IOException("Could not read audio: " + r);
+            }
+            if (i == 0) {
+                packet.position(r);
+            } else {
+                scratch.limit(r);
+                packet.put(scratch);
+            }
+        }
+        packet.flip();
+        return packet.limit();
+    }
+
+    private int readBlock(ByteBuffer directBuffer, int index) {
+        int r = capture.read(directBuffer, bufferInfo);
+        if (index == 0) {
+            packetPts = bufferInfo.presentationTimeUs;
+        }
+        return r;
     }
 
     private void record() throws IOException, AudioCaptureException {
@@ -31,8 +90,13 @@ public final class AudioRawRecorder implements AsyncProcessor {
             return;
         }
 
-        final ByteBuffer buffer = ByteBuffer.allocateDirect(AudioConfig.MAX_READ_SIZE);
-        final MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
+        final ByteBuffer buffer = ByteBuffer.allocateDirect(AudioConfig.MAX_READ_SIZE * readsPerPacket);
+        // Each read writes at the start of its buffer, so the blocks after the first one are copied from a scratch buffer
+        final ByteBuffer scratch = readsPerPacket > 1 ? ByteBuffer.allocateDirect(AudioConfig.MAX_READ_SIZE) : null;
+        final BlockReader reader = this::readBlock;
+        if (readsPerPacket > 1) {
+            Ln.i("Raw audio: " + readsPerPacket + " reads aggregated per packet");
+        }
 
         try {
             try {
@@ -45,12 +109,10 @@ public final class AudioRawRecorder implements AsyncProcessor {
 
             streamer.writeAudioHeader();
             while (!Thread.currentThread().isInterrupted()) {
-                buffer.position(0);
-                int r = capture.read(buffer, bufferInfo);
-                if (r < 0) {
-                    throw new IOException("Could not read audio: " + r);
-                }
-                buffer.limit(r);
+                // Aggregate several reads in a single packet, to reduce the per-packet overhead (the packet timestamp is that of the first
+                // read, the samples are contiguous)
+                int size = aggregate(reader, readsPerPacket, buffer, scratch);
+                bufferInfo.set(0, size, packetPts, 0);
 
                 streamer.writePacket(buffer, bufferInfo);
             }
@@ -1,6 +1,8 @@
 package com.genymobile.scrcpy.control;
 
+import com.genymobile.scrcpy.device.Point;
 import com.genymobile.scrcpy.device.Position;
+import com.genymobile.scrcpy.device.Size;
 
 /**
  * Union of all supported event types, identified by their {@code type}.
@@ -25,6 +27,7 @@ public final class ControlMessage {
     public static final int TYPE_OPEN_HARD_KEYBOARD_SETTINGS = 15;
     public static final int TYPE_START_APP = 16;
     public static final int TYPE_RESET_VIDEO = 17;
+    public static final int TYPE_SET_VIDEO_CONFIG = 18;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -53,6 +56,10 @@ public final class ControlMessage {
     private boolean on;
     private int vendorId;
     private int productId;
+    private int maxSize;
+    private float maxFps;
+    private Size cropSize;
+    private Point cropOffset;
 
     private ControlMessage() {
     }
@@ -166,6 +173,16 @@ public final class ControlMessage {
         return msg;
     }
 
+    public static ControlMessage createSetVideoConfig(int maxSize, float maxFps, Size cropSize, Point cropOffset) {
+        ControlMessage msg = new ControlMessage();
+        msg.type = TYPE_SET_VIDEO_CONFIG;
+        msg.maxSize = maxSize;
+        msg.maxFps = maxFps;
+        msg.cropSize = cropSize;
+        msg.cropOffset = cropOffset;
+        return msg;
+    }
+
     public int getType() {
         return type;
     }
@@ -249,4 +266,20 @@ public final class ControlMessage {
     public int getProductId() {
         return productId;
     }
+
+    public int getMaxSize() {
+        return maxSize;
+    }
+
+    public float getMaxFps() {
+        return maxFps;
+    }
+
+    public Size getCropSize() {
+        return cropSize;
+    }
+
+    public Point getCropOffset() {
+        return cropOffset;
+    }
 }
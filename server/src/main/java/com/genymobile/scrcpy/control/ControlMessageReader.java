@@ -1,6 +1,8 @@
 package com.genymobile.scrcpy.control;
 
+import com.genymobile.scrcpy.device.Point;
 import com.genymobile.scrcpy.device.Position;
+import com.genymobile.scrcpy.device.Size;
 import com.genymobile.scrcpy.util.Binary;
 
 import java.io.BufferedInputStream;
@@ -56,6 +58,8 @@ public class ControlMessageReader {
                 return parseUhidDestroy();
             case ControlMessage.TYPE_START_APP:
                 return parseStartApp();
+            case ControlMessage.TYPE_SET_VIDEO_CONFIG:
+                return parseSetVideoConfig();
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
@@ -166,6 +170,20 @@ public class ControlMessageReader {
         return ControlMessage.createStartApp(name);
     }
 
+    private ControlMessage parseSetVideoConfig() throws IOException {
+        int maxSize = dis.readUnsignedShort();
+        float maxFps = dis.readFloat();
+        int cropWidth = dis.readUnsignedShort();
+        int cropHeight = dis.readUnsignedShort();
+        int cropX = dis.readUnsignedShort();
+        int cropY = dis.readUnsignedShort();
+        if (cropWidth == 0 || cropHeight == 0) {
+            // No crop
+            return ControlMessage.createSetVideoConfig(maxSize, maxFps, null, null);
+        }
+        return ControlMessage.createSetVideoConfig(maxSize, maxFps, new Size(cropWidth, cropHeight), new Point(cropX, cropY));
+    }
+
     private Position parsePosition() throws IOException {
         int x = dis.readInt();
         int y = dis.readInt();
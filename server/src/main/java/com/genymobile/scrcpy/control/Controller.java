@@ -13,12 +13,14 @@ import com.genymobile.scrcpy.device.Size;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
 import com.genymobile.scrcpy.video.SurfaceCapture;
+import com.genymobile.scrcpy.video.SurfaceEncoder;
 import com.genymobile.scrcpy.video.VirtualDisplayListener;
 import com.genymobile.scrcpy.wrappers.ClipboardManager;
 import com.genymobile.scrcpy.wrappers.InputManager;
 import com.genymobile.scrcpy.wrappers.ServiceManager;
 
 import android.content.Intent;
+import android.graphics.Rect;
 import android.os.Build;
 import android.os.SystemClock;
 import android.util.Pair;
@@ -99,6 +101,8 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
 
     // Used for resetting video encoding on RESET_VIDEO message
     private SurfaceCapture surfaceCapture;
+    // Used for reconfiguring video encoding on SET_VIDEO_CONFIG message
+    private SurfaceEncoder surfaceEncoder;
 
     public Controller(ControlChannel controlChannel, CleanUp cleanUp, Options options) {
         this.displayId = options.getDisplayId();
@@ -152,6 +156,10 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
         this.surfaceCapture = surfaceCapture;
     }
 
+    public void setSurfaceEncoder(SurfaceEncoder surfaceEncoder) {
+        this.surfaceEncoder = surfaceEncoder;
+    }
+
     private UhidManager getUhidManager() {
         if (uhidManager == null) {
             int uhidDisplayId = displayId;
@@ -331,6 +339,9 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             case ControlMessage.TYPE_RESET_VIDEO:
                 resetVideo();
                 break;
+            case ControlMessage.TYPE_SET_VIDEO_CONFIG:
+                setVideoConfig(msg.getMaxSize(), msg.getMaxFps(), msg.getCropSize(), msg.getCropOffset());
+                break;
             default:
                 // do nothing
         }
@@ -754,4 +765,16 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             surfaceCapture.requestInvalidate();
         }
     }
+
+    private void setVideoConfig(int maxSize, float maxFps, Size cropSize, Point cropOffset) {
+        if (surfaceEncoder != null) {
+            Rect crop = null;
+            if (cropSize != null) {
+                int x = cropOffset.getX();
+                int y = cropOffset.getY();
+                crop = new Rect(x, y, x + cropSize.getWidth(), y + cropSize.getHeight());
+            }
+            surfaceEncoder.setVideoConfig(maxSize, maxFps, crop);
+        }
+    }
 }
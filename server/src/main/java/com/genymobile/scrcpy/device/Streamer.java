@@ -17,15 +17,30 @@ public final class Streamer {
     private static final long PACKET_FLAG_CONFIG = 1L << 63;
     private static final long PACKET_FLAG_KEY_FRAME = 1L << 62;
 
-    private final FileDescriptor fd;
+    /**
+     * Destination of the stream.
+     */
+    public interface Output {
+        /**
+         * Write all the remaining bytes of the buffer.
+         */
+        void write(ByteBuffer buffer) throws IOException;
+    }
+
+    private final Output output;
     private final Codec codec;
     private final boolean sendCodecMeta;
     private final boolean sendFrameMeta;
 
-    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
+    // Reused for all the headers, so that streaming does not allocate (a session packet is 12 + 12 bytes)
+    private final ByteBuffer headerBuffer = ByteBuffer.allocate(24);
 
     public Streamer(FileDescriptor fd, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
-        this.fd = fd;
+        this(buffer -> IO.writeFully(fd, buffer), codec, sendCodecMeta, sendFrameMeta);
+    }
+
+    public Streamer(Output output, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
+        this.output = output;
         this.codec = codec;
         this.sendCodecMeta = sendCodecMeta;
         this.sendFrameMeta = sendFrameMeta;
@@ -37,33 +52,53 @@ public final class Streamer {
 
     public void writeAudioHeader() throws IOException {
         if (sendCodecMeta) {
-            ByteBuffer buffer = ByteBuffer.allocate(4);
-            buffer.putInt(codec.getId());
-            buffer.flip();
-            IO.writeFully(fd, buffer);
+            headerBuffer.clear();
+            headerBuffer.putInt(codec.getId());
+            headerBuffer.flip();
+            output.write(headerBuffer);
         }
     }
 
     public void writeVideoHeader(Size videoSize) throws IOException {
         if (sendCodecMeta) {
-            ByteBuffer buffer = ByteBuffer.allocate(12);
-            buffer.putInt(codec.getId());
-            buffer.putInt(videoSize.getWidth());
-            buffer.putInt(videoSize.getHeight());
-            buffer.flip();
-            IO.writeFully(fd, buffer);
+            headerBuffer.clear();
+            putVideoHeader(videoSize);
+            headerBuffer.flip();
+            output.write(headerBuffer);
+        }
+    }
+
+    /**
+     * Announce a new capture session with a different video size.
+     * <p>
+     * It is written as a packet flagged both as config and key frame (a combination never used for media packets), whose payload has the
+     * same layout as the video header.
+     */
+    public void writeVideoSession(Size videoSize) throws IOException {
+        if (sendCodecMeta && sendFrameMeta) {
+            headerBuffer.clear();
+            headerBuffer.putLong(PACKET_FLAG_CONFIG | PACKET_FLAG_KEY_FRAME);
+            headerBuffer.putInt(12);
+            putVideoHeader(videoSize);
+            headerBuffer.flip();
+            output.write(headerBuffer);
         }
     }
 
+    private void putVideoHeader(Size videoSize) {
+        headerBuffer.putInt(codec.getId());
+        headerBuffer.putInt(videoSize.getWidth());
+        headerBuffer.putInt(videoSize.getHeight());
+    }
+
     public void writeDisableStream(boolean error) throws IOException {
         // Writing a specific code as codec-id means that the device disables the stream
         //   code 0: it explicitly disables the stream (because it could not capture audio), scrcpy should continue mirroring video only
         //   code 1: a configuration error occurred, scrcpy must be stopped
-        byte[] code = new byte[4];
-        if (error) {
-            code[3] = 1;
-        }
-        IO.writeFully(fd, code, 0, code.length);
+        headerBuffer.clear();
+        headerBuffer.putInt(error ? 1 : 0);
+        headerBuffer.flip();
+        output.write(headerBuffer);
     }
 
     public void writePacket(ByteBuffer buffer, long pts, boolean config, boolean keyFrame) throws IOException {
@@ -76,10 +111,10 @@ public final class Streamer {
         }
 
         if (sendFrameMeta) {
-            writeFrameMeta(fd, buffer.remaining(), pts, config, keyFrame);
+            writeFrameMeta(buffer.remaining(), pts, config, keyFrame);
         }
 
-        IO.writeFully(fd, buffer);
+        output.write(buffer);
     }
 
     public void writePacket(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException {
@@ -89,7 +124,7 @@ public final class Streamer {
         writePacket(codecBuffer, pts, config, keyFrame);
     }
 
-    private void writeFrameMeta(FileDescriptor fd, int packetSize, long pts, boolean config, boolean keyFrame) throws IOException {
+    private void writeFrameMeta(int packetSize, long pts, boolean config, boolean keyFrame) throws IOException {
         headerBuffer.clear();
 
         long ptsAndFlags;
@@ -105,7 +140,7 @@ public final class Streamer {
         headerBuffer.putLong(ptsAndFlags);
         headerBuffer.putInt(packetSize);
         headerBuffer.flip();
-        IO.writeFully(fd, headerBuffer);
+        output.write(headerBuffer);
     }
 
     private static void fixOpusConfigPacket(ByteBuffer buffer) throws IOException {
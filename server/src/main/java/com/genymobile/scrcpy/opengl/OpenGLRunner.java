@@ -29,6 +29,8 @@ public final class OpenGLRunner {
 
     private final OpenGLFilter filter;
     private final float[] overrideTransformMatrix;
+    // Reused for every frame, to avoid allocations on the rendering path
+    private final float[] transformMatrix = new float[16];
 
     private SurfaceTexture surfaceTexture;
     private Surface inputSurface;
@@ -213,7 +215,7 @@ public final class OpenGLRunner {
         if (overrideTransformMatrix != null) {
             matrix = overrideTransformMatrix;
         } else {
-            matrix = new float[16];
+            matrix = transformMatrix;
             surfaceTexture.getTransformMatrix(matrix);
         }
 
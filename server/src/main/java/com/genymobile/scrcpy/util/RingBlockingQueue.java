@@ -0,0 +1,76 @@
+package com.genymobile.scrcpy.util;
+
+/**
+ * Bounded blocking FIFO queue which never allocates once created.
+ * <p>
+ * The blocking operations of {@link java.util.concurrent.ArrayBlockingQueue} allocate a node each time a thread waits, which happens for
+ * almost every item when the consumer is faster than the producer. This queue relies on the object monitor instead, so that passing items
+ * between threads in steady state does not produce garbage.
+ *
+ * @param <E> the type of the items
+ */
+public final class RingBlockingQueue<E> {
+
+    private final Object[] items;
+    private int head; // index of the next item to take
+    private int count;
+
+    public RingBlockingQueue(int capacity) {
+        if (capacity <= 0) {
+            throw new IllegalArgumentException("Invalid capacity: " + capacity);
+        }
+        items = new Object[capacity];
+    }
+
+    /**
+     * Insert an item, if the queue is not full.
+     *
+     * @return {@code true} if the item has been inserted, {@code false} if the queue is full
+     */
+    public synchronized boolean offer(E item) {
+        if (count == items.length) {
+            return false;
+        }
+        enqueue(item);
+        return true;
+    }
+
+    /**
+     * Insert an item, waiting for space to become available if the queue is full.
+     */
+    public synchronized void put(E item) throws InterruptedException {
+        while (count == items.length) {
+            wait();
+        }
+        enqueue(item);
+    }
+
+    /**
+     * Remove the head of the queue, waiting for an item to become available if the queue is empty.
+     */
+    public synchronized E take() throws InterruptedException {
+        while (count == 0) {
+            wait();
+        }
+        @SuppressWarnings("unchecked")
+        E item = (E) items[head];
+        items[head] = null;
+        head = (head + 1) % items.length;
+        --count;
+        notifyAll();
+        return item;
+    }
+
+    public synchronized int size() {
+        return count;
+    }
+
+    private void enqueue(E item) {
+        if (item == null) {
+            throw new NullPointerException();
+        }
+        items[(head + count) % items.length] = item;
+        ++count;
+        notifyAll();
+    }
+}
@@ -60,7 +60,7 @@ public class CameraCapture extends SurfaceCapture {
     private final CameraAspectRatio aspectRatio;
     private final int fps;
     private final boolean highSpeed;
-    private final Rect crop;
+    private Rect crop;
     private final Orientation captureOrientation;
     private final float angle;
 
@@ -304,6 +304,12 @@ public class CameraCapture extends SurfaceCapture {
         return true;
     }
 
+    @Override
+    public boolean setCrop(Rect newCrop) {
+        crop = newCrop;
+        return true;
+    }
+
     @SuppressLint("MissingPermission")
     @TargetApi(AndroidVersions.API_31_ANDROID_12)
     private CameraDevice openCamera(String id) throws CameraAccessException, InterruptedException {
@@ -51,7 +51,7 @@ public class NewDisplayCapture extends SurfaceCapture {
     private int mainDisplayDpi;
     private int maxSize;
     private int displayImePolicy;
-    private final Rect crop;
+    private Rect crop;
     private final boolean captureOrientationLocked;
     private final Orientation captureOrientation;
     private final float angle;
@@ -256,6 +256,12 @@ public class NewDisplayCapture extends SurfaceCapture {
         return true;
     }
 
+    @Override
+    public synchronized boolean setCrop(Rect newCrop) {
+        crop = newCrop;
+        return true;
+    }
+
     private static int scaleDpi(Size initialSize, int initialDpi, Size size) {
         int den = initialSize.getMax();
         int num = size.getMax();
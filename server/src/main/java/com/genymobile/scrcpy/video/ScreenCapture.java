@@ -30,7 +30,7 @@ public class ScreenCapture extends SurfaceCapture {
     private final VirtualDisplayListener vdListener;
     private final int displayId;
     private int maxSize;
-    private final Rect crop;
+    private Rect crop;
     private Orientation.Lock captureOrientationLock;
     private Orientation captureOrientation;
     private final float angle;
@@ -193,6 +193,12 @@ public class ScreenCapture extends SurfaceCapture {
         return true;
     }
 
+    @Override
+    public boolean setCrop(Rect newCrop) {
+        crop = newCrop;
+        return true;
+    }
+
     private static IBinder createDisplay() throws Exception {
         // Since Android 12 (preview), secure displays could not be created with shell permissions anymore.
         // On Android 12 preview, SDK_INT is still R (not S), but CODENAME is "S".
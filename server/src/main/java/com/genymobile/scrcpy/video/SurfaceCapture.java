@@ -3,6 +3,7 @@ package com.genymobile.scrcpy.video;
 import com.genymobile.scrcpy.device.ConfigurationException;
 import com.genymobile.scrcpy.device.Size;
 
+import android.graphics.Rect;
 import android.view.Surface;
 
 import java.io.IOException;
@@ -78,6 +79,16 @@ public abstract class SurfaceCapture {
      */
     public abstract boolean setMaxSize(int maxSize);
 
+    /**
+     * Set the crop (requested at runtime by the client), applied on the next {@link #prepare()}.
+     *
+     * @param crop the crop rectangle, or {@code null} to capture the whole content
+     * @return {@code true} if the capture supports cropping, {@code false} otherwise
+     */
+    public boolean setCrop(Rect crop) {
+        return false;
+    }
+
     /**
      * Indicate if the capture has been closed internally.
      *
@@ -13,6 +13,7 @@ import com.genymobile.scrcpy.util.IO;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
 
+import android.graphics.Rect;
 import android.media.MediaCodec;
 import android.media.MediaCodecInfo;
 import android.media.MediaFormat;
@@ -25,6 +26,7 @@ import java.io.IOException;
 import java.nio.ByteBuffer;
 import java.util.List;
 import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicReference;
 
 public class SurfaceEncoder implements AsyncProcessor {
 
@@ -41,7 +43,8 @@ public class SurfaceEncoder implements AsyncProcessor {
     private final String encoderName;
     private final List<CodecOption> codecOptions;
     private final int videoBitRate;
-    private final float maxFps;
+    private float maxFps;
+    private Rect crop;
     private final boolean downsizeOnError;
 
     private boolean firstFrameSent;
@@ -52,11 +55,27 @@ public class SurfaceEncoder implements AsyncProcessor {
 
     private final CaptureReset reset = new CaptureReset();
 
+    // Requested by the client at runtime, applied on the next capture reset
+    private final AtomicReference<VideoConfig> pendingConfig = new AtomicReference<>();
+
+    private static final class VideoConfig {
+        private final int maxSize;
+        private final float maxFps;
+        private final Rect crop;
+
+        private VideoConfig(int maxSize, float maxFps, Rect crop) {
+            this.maxSize = maxSize;
+            this.maxFps = maxFps;
+            this.crop = crop;
+        }
+    }
+
     public SurfaceEncoder(SurfaceCapture capture, Streamer streamer, Options options) {
         this.capture = capture;
         this.streamer = streamer;
         this.videoBitRate = options.getVideoBitRate();
         this.maxFps = options.getMaxFps();
+        this.crop = options.getCrop();
         this.codecOptions = options.getVideoCodecOptions();
         this.encoderName = options.getVideoEncoder();
         this.downsizeOnError = options.getDownsizeOnError();
@@ -71,15 +90,37 @@ public class SurfaceEncoder implements AsyncProcessor {
 
         try {
             boolean alive;
-            boolean headerWritten = false;
+            Size headerSize = null; // the video size last sent to the client
 
             do {
                 reset.consumeReset(); // If a capture reset was requested, it is implicitly fulfilled
-                capture.prepare();
+
+                // Read after consumeReset(), so that a configuration set concurrently is never missed
+                VideoConfig config = pendingConfig.getAndSet(null);
+                if (config != null) {
+                    Rect previousCrop = crop;
+                    applyVideoConfig(config);
+                    format = createFormat(codec.getMimeType(), videoBitRate, maxFps, codecOptions);
+                    try {
+                        capture.prepare();
+                    } catch (IllegalArgumentException e) {
+                        // For example, the requested crop exceeds the display: keep the previous crop
+                        Ln.e("Invalid video configuration: " + e.getMessage());
+                        crop = previousCrop;
+                        capture.setCrop(crop);
+                        capture.prepare();
+                    }
+                } else {
+                    capture.prepare();
+                }
                 Size size = capture.getSize();
-                if (!headerWritten) {
+                if (headerSize == null) {
                     streamer.writeVideoHeader(size);
-                    headerWritten = true;
+                    headerSize = size;
+                } else if (!size.equals(headerSize)) {
+                    // Notify the client in-band, so that its sinks can be reset without reconnecting
+                    streamer.writeVideoSession(size);
+                    headerSize = size;
                 }
 
                 format.setInteger(MediaFormat.KEY_WIDTH, size.getWidth());
@@ -146,6 +187,29 @@ public class SurfaceEncoder implements AsyncProcessor {
         }
     }
 
+    private void applyVideoConfig(VideoConfig config) {
+        if (!capture.setMaxSize(config.maxSize)) {
+            Ln.w("Could not change the max size of this capture");
+        }
+        if (capture.setCrop(config.crop)) {
+            crop = config.crop;
+        } else {
+            Ln.w("Could not change the crop of this capture");
+        }
+        maxFps = config.maxFps;
+        Ln.i("Video configuration: max size " + config.maxSize + ", max fps " + config.maxFps + ", crop " + config.crop);
+    }
+
+    /**
+     * Change the max size, the max fps and the crop of the video (0 and {@code null} mean unlimited).
+     * <p>
+     * The capture is restarted with the new configuration (the client is notified in-band if the video size changes).
+     */
+    public void setVideoConfig(int newMaxSize, float newMaxFps, Rect newCrop) {
+        pendingConfig.set(new VideoConfig(newMaxSize & ~7, newMaxFps, newCrop)); // max size must be a multiple of 8
+        reset.reset();
+    }
+
     private boolean prepareRetry(Size currentSize) {
         if (firstFrameSent) {
             ++consecutiveErrors;
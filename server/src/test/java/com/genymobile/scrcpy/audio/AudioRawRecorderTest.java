@@ -0,0 +1,66 @@
+package com.genymobile.scrcpy.audio;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+public class AudioRawRecorderTest {
+
+    // Like AudioRecord.read(ByteBuffer, int): write at the start of the buffer, whatever its position
+    private static final class FakeBlockReader implements AudioRawRecorder.BlockReader {
+        private final int[] sizes;
+
+        FakeBlockReader(int... sizes) {
+            this.sizes = sizes;
+        }
+
+        @Override
+        public int read(ByteBuffer directBuffer, int index) {
+            int size = sizes[index];
+            for (int i = 0; i < size; ++i) {
+                // Each byte identifies its block
+                directBuffer.put(i, (byte) (index + 1));
+            }
+            return size;
+        }
+    }
+
+    @Test
+    public void testAggregateBlocksInOrder() throws IOException {
+        ByteBuffer packet = ByteBuffer.allocateDirect(12);
+        ByteBuffer scratch = ByteBuffer.allocateDirect(4);
+
+        // The second block is a short read
+        int size = AudioRawRecorder.aggregate(new FakeBlockReader(4, 2, 4), 3, packet, scratch);
+        Assert.assertEquals(10, size);
+        Assert.assertEquals(0, packet.position());
+        Assert.assertEquals(10, packet.limit());
+
+        byte[] data = new byte[size];
+        packet.get(data);
+        byte[] expected = {1, 1, 1, 1, 2, 2, 3, 3, 3, 3};
+        Assert.assertArrayEquals(expected, data);
+    }
+
+    @Test
+    public void testAggregateSingleBlock() throws IOException {
+        ByteBuffer packet = ByteBuffer.allocateDirect(4);
+
+        int size = AudioRawRecorder.aggregate(new FakeBlockReader(3), 1, packet, null);
+        Assert.assertEquals(3, size);
+
+        byte[] data = new byte[size];
+        packet.get(data);
+        Assert.assertArrayEquals(new byte[] {1, 1, 1}, data);
+    }
+
+    @Test(expected = IOException.class)
+    public void testAggregateReadError() throws IOException {
+        ByteBuffer packet = ByteBuffer.allocateDirect(8);
+        ByteBuffer scratch = ByteBuffer.allocateDirect(4);
+
+        AudioRawRecorder.aggregate(new FakeBlockReader(4, -3), 2, packet, scratch);
+    }
+}
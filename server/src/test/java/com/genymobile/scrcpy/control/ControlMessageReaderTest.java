@@ -422,6 +422,57 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParseSetVideoConfig() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_VIDEO_CONFIG);
+        dos.writeShort(1024); // max size
+        dos.writeFloat(30.5f); // max fps
+        dos.writeShort(800); // crop width
+        dos.writeShort(600); // crop height
+        dos.writeShort(100); // crop x
+        dos.writeShort(200); // crop y
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SET_VIDEO_CONFIG, event.getType());
+        Assert.assertEquals(1024, event.getMaxSize());
+        Assert.assertEquals(30.5f, event.getMaxFps(), 0f);
+        Assert.assertEquals(800, event.getCropSize().getWidth());
+        Assert.assertEquals(600, event.getCropSize().getHeight());
+        Assert.assertEquals(100, event.getCropOffset().getX());
+        Assert.assertEquals(200, event.getCropOffset().getY());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
+    @Test
+    public void testParseSetVideoConfigWithoutCrop() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SET_VIDEO_CONFIG);
+        dos.writeShort(0); // max size
+        dos.writeFloat(0); // max fps
+        dos.write(new byte[8]); // no crop
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SET_VIDEO_CONFIG, event.getType());
+        Assert.assertEquals(0, event.getMaxSize());
+        Assert.assertEquals(0f, event.getMaxFps(), 0f);
+        Assert.assertNull(event.getCropSize());
+        Assert.assertNull(event.getCropOffset());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
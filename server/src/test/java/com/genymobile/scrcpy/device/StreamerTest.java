@@ -0,0 +1,87 @@
+package com.genymobile.scrcpy.device;
+
+import com.genymobile.scrcpy.util.Allocations;
+import com.genymobile.scrcpy.video.VideoCodec;
+
+import org.junit.Assert;
+import org.junit.Assume;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.nio.ByteBuffer;
+
+public class StreamerTest {
+
+    private static final class CountingOutput implements Streamer.Output {
+        private long bytes;
+
+        @Override
+        public void write(ByteBuffer buffer) {
+            bytes += buffer.remaining();
+            buffer.position(buffer.limit());
+        }
+    }
+
+    private static final class RecordingOutput implements Streamer.Output {
+        private final ByteArrayOutputStream bos = new ByteArrayOutputStream();
+
+        @Override
+        public void write(ByteBuffer buffer) {
+            while (buffer.hasRemaining()) {
+                bos.write(buffer.get());
+            }
+        }
+    }
+
+    @Test
+    public void testWritePacket() throws Exception {
+        RecordingOutput output = new RecordingOutput();
+        Streamer streamer = new Streamer(output, VideoCodec.H264, true, true);
+
+        ByteBuffer packet = ByteBuffer.wrap(new byte[] {1, 2, 3});
+        streamer.writePacket(packet, 0x123456, false, true);
+
+        byte[] expected = {
+                0x40, 0, 0, 0, 0, 0x12, 0x34, 0x56, // key frame flag and PTS
+                0, 0, 0, 3, // size
+                1, 2, 3,
+        };
+        Assert.assertArrayEquals(expected, output.bos.toByteArray());
+    }
+
+    @Test
+    public void testWriteVideoSession() throws Exception {
+        RecordingOutput output = new RecordingOutput();
+        Streamer streamer = new Streamer(output, VideoCodec.H264, true, true);
+
+        streamer.writeVideoHeader(new Size(1920, 1080));
+        streamer.writeVideoSession(new Size(1080, 1920));
+
+        byte[] expected = {
+                0x68, 0x32, 0x36, 0x34, 0, 0, 0x07, (byte) 0x80, 0, 0, 0x04, 0x38, // header
+                (byte) 0xC0, 0, 0, 0, 0, 0, 0, 0, // config and key frame flags
+                0, 0, 0, 12, // size
+                0x68, 0x32, 0x36, 0x34, 0, 0, 0x04, 0x38, 0, 0, 0x07, (byte) 0x80, // session
+        };
+        Assert.assertArrayEquals(expected, output.bos.toByteArray());
+    }
+
+    @Test
+    public void testWritePacketDoesNotAllocate() throws Exception {
+        Assume.assumeTrue(Allocations.isSupported());
+
+        CountingOutput output = new CountingOutput();
+        Streamer streamer = new Streamer(output, VideoCodec.H264, true, true);
+        ByteBuffer packet = ByteBuffer.allocate(1000);
+
+        final int iterations = 10000;
+        long allocated = Allocations.measure(iterations, () -> {
+            packet.clear();
+            streamer.writePacket(packet, 42, false, false);
+        });
+
+        Assert.assertEquals(2 * iterations * (12 + 1000), output.bytes);
+        // Less than 1 byte per packet: no allocation in steady state
+        Assert.assertTrue("Allocated " + allocated + " bytes for " + iterations + " packets", allocated < iterations);
+    }
+}
@@ -0,0 +1,71 @@
+package com.genymobile.scrcpy.util;
+
+import java.lang.reflect.Method;
+
+/**
+ * Measure the memory allocated by the current thread on the JVM running the unit tests.
+ * <p>
+ * The management API is not part of the Android SDK, so it is accessed by reflection (the tests must be skipped if it is not available).
+ */
+public final class Allocations {
+
+    public interface Operation {
+        void run() throws Exception;
+    }
+
+    private static final Object THREAD_MX_BEAN;
+    private static final Method GET_THREAD_ALLOCATED_BYTES;
+
+    static {
+        Object bean = null;
+        Method method = null;
+        try {
+            Class<?> managementFactory = Class.forName("java.lang.management.ManagementFactory");
+            bean = managementFactory.getMethod("getThreadMXBean").invoke(null);
+            Class<?> beanClass = Class.forName("com.sun.management.ThreadMXBean");
+            if (beanClass.isInstance(bean)) {
+                method = beanClass.getMethod("getThreadAllocatedBytes", long.class);
+            }
+        } catch (ReflectiveOperationException e) {
+            // not supported
+        }
+        THREAD_MX_BEAN = bean;
+        GET_THREAD_ALLOCATED_BYTES = method;
+    }
+
+    private Allocations() {
+        // not instantiable
+    }
+
+    public static boolean isSupported() {
+        return GET_THREAD_ALLOCATED_BYTES != null && allocatedBytes() >= 0;
+    }
+
+    private static long allocatedBytes() {
+        try {
+            return (Long) GET_THREAD_ALLOCATED_BYTES.invoke(THREAD_MX_BEAN, Thread.currentThread().getId());
+        } catch (ReflectiveOperationException e) {
+            throw new AssertionError(e);
+        }
+    }
+
+    /**
+     * Return the number of bytes allocated by the current thread to execute the operation {@code iterations} times (after a warm-up).
+     */
+    public static long measure(int iterations, Operation operation) throws Exception {
+        // Warm-up, so that lazy initializations are not measured
+        for (int i = 0; i < iterations; ++i) {
+            operation.run();
+        }
+
+        // The measurement itself allocates (by reflection)
+        long overheadStart = allocatedBytes();
+        long overhead = allocatedBytes() - overheadStart;
+
+        long start = allocatedBytes();
+        for (int i = 0; i < iterations; ++i) {
+            operation.run();
+        }
+        return Math.max(0, allocatedBytes() - start - overhead);
+    }
+}
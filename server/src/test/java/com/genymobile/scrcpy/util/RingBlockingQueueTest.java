@@ -0,0 +1,92 @@
+package com.genymobile.scrcpy.util;
+
+import org.junit.Assert;
+import org.junit.Assume;
+import org.junit.Test;
+
+public class RingBlockingQueueTest {
+
+    @Test
+    public void testFifo() throws InterruptedException {
+        RingBlockingQueue<String> queue = new RingBlockingQueue<>(3);
+        Assert.assertTrue(queue.offer("a"));
+        Assert.assertTrue(queue.offer("b"));
+        Assert.assertEquals("a", queue.take());
+        Assert.assertTrue(queue.offer("c"));
+        Assert.assertTrue(queue.offer("d")); // wraps around
+        Assert.assertFalse(queue.offer("e")); // full
+        Assert.assertEquals(3, queue.size());
+        Assert.assertEquals("b", queue.take());
+        Assert.assertEquals("c", queue.take());
+        Assert.assertEquals("d", queue.take());
+        Assert.assertEquals(0, queue.size());
+    }
+
+    @Test
+    public void testBlocking() throws InterruptedException {
+        RingBlockingQueue<Integer> queue = new RingBlockingQueue<>(2);
+        final int count = 1000;
+
+        Thread producer = new Thread(() -> {
+            try {
+                for (int i = 0; i < count; ++i) {
+                    queue.put(i); // blocks when full
+                }
+            } catch (InterruptedException e) {
+                // ignore
+            }
+        });
+        producer.start();
+
+        for (int i = 0; i < count; ++i) {
+            Assert.assertEquals(i, (int) queue.take()); // blocks when empty
+        }
+        producer.join();
+    }
+
+    @Test
+    public void testDoesNotAllocate() throws Exception {
+        Assume.assumeTrue(Allocations.isSupported());
+
+        RingBlockingQueue<Object> queue = new RingBlockingQueue<>(4);
+        Object task = new Object();
+
+        final int iterations = 10000;
+        long allocated = Allocations.measure(iterations, () -> {
+            queue.put(task);
+            queue.take();
+        });
+
+        // Less than 1 byte per task: no allocation in steady state
+        Assert.assertTrue("Allocated " + allocated + " bytes for " + iterations + " tasks", allocated < iterations);
+    }
+
+    @Test
+    public void testTakeBlockingDoesNotAllocate() throws Exception {
+        Assume.assumeTrue(Allocations.isSupported());
+
+        // Recycle the same tasks between a producer and a consumer, which waits for each task (as the audio encoder does)
+        RingBlockingQueue<Object> tasks = new RingBlockingQueue<>(4);
+        RingBlockingQueue<Object> freeTasks = new RingBlockingQueue<>(4);
+        freeTasks.offer(new Object());
+
+        final int iterations = 10000;
+        Thread producer = new Thread(() -> {
+            try {
+                // 2 rounds: warm-up and measure
+                for (int i = 0; i < 2 * iterations; ++i) {
+                    tasks.put(freeTasks.take());
+                }
+            } catch (InterruptedException e) {
+                // ignore
+            }
+        });
+        producer.start();
+
+        long allocated = Allocations.measure(iterations, () -> freeTasks.put(tasks.take()));
+        producer.join();
+
+        // Measured on the consumer thread
+        Assert.assertTrue("Allocated " + allocated + " bytes for " + iterations + " tasks", allocated < iterations);
+    }
+}
@@ -110,7 +110,14 @@ def read_scrcpy_stream(host='localhost', port=8080):
             packet_count += 1
             total_bytes += packet_size
             
-            if is_config:
+            if is_config and is_keyframe:
+                # Session packet: the video size changed
+                codec_id, width, height = struct.unpack('>III', data)
+                print(f"\nNew session: {width}x{height}")
+                if codec is not None:
+                    codec = av.CodecContext.create(codec_name, 'r')
+                continue
+            elif is_config:
                 config_packet_count += 1
                 packet_type = "CONFIG"
             elif is_keyframe: